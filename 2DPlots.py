@@ -3,68 +3,26 @@
 import plotTools as ptls
 import matplotlib.pyplot as plt
 
-def interp(dfEul, dfMEul, dfRK4, dfRKF45):
-    """
-    Interpolate Euler, Modified Euler and RK4 solutions to RKF45 grid.
-
-    Parameters
-    ----------
-    dfEul : Data Frame.
-            Contains the Euler solution, including time values.
-    dfMEul : Data Frame.
-            Contains the Modified Euler solution, including time values.
-    dfRK4 : Data Frame.
-            Contains the Runge-Kutta 4th order solution, including time values.
-
-    Returns
-    -------
-    t : NumPy array.
-        Contains RKF45 time values.
-    uEul : NumPy array.
-        u values of the Euler solution.
-    duEul : NumPy array.
-        du/dx values of the Euler solution.
-    uMEul : NumPy array.
-        u values of the Modified Euler solution.
-    duMEul : NumPy array.
-        du/dx values of the Modified Euler solution.
-    uRK4 : NumPy array.
-        u values of the RK4 solution.
-    duRK4 : NumPy array.
-        du/dx values of the RK4 solution.
-    """
-    t = dfRKF45.t
-    uEul = ptls.spline(dfEul.t, dfEul.u, t)
-    duEul = ptls.spline(dfEul.t, dfEul.du, t)
-    uMEul = ptls.spline(dfMEul.t, dfMEul.u, t)
-    duMEul = ptls.spline(dfMEul.t, dfMEul.du, t)
-    uRK4 = ptls.spline(dfRK4.t, dfRK4.u, t)
-    duRK4 = ptls.spline(dfRK4.t, dfRK4.du, t)
-
-    return t, uEul, duEul, uMEul, duMEul, uRK4, duRK4
-
 def main():
     with open('ODE_prob.txt', 'r') as file:
         prob = file.read().replace('\n', '')
 
-    # Import data from CSV file
+    # Import data from CSV file; each solution is plotted on its own grid
     N, tol, dfEul, dfMEul, dfRK4, dfRKF45 = ptls.importData("ODE")
-    
-    # Interpolate to get solutions on the same grid (RKF45's grid)
-    t, uEul, duEul, uMEul, duMEul, uRK4, duRK4 = interp(dfEul, dfMEul, dfRK4, dfRKF45)
+    dfErrs = ptls.importErrors("ODE")
 
     # Plot Euler method solution
     plt.figure(1)
-    plt.plot(t, uEul, label="u")
-    plt.plot(t, duEul, label="$\\frac{du}{dt}$")
+    plt.plot(dfEul.t, dfEul.u, label="u")
+    plt.plot(dfEul.t, dfEul.du, label="$\\frac{du}{dt}$")
     plt.title("Euler solution to {} (N={})".format(prob, N))
     plt.legend()
     plt.savefig("{}/Figure_1:_Euler_solution_to_{}.png".format(prob, prob))
 
     # Plot Modified Euler method solution
     plt.figure(2)
-    plt.plot(t, uMEul, label="u")
-    plt.plot(t, duMEul, label="$\\frac{du}{dt}$")
+    plt.plot(dfMEul.t, dfMEul.u, label="u")
+    plt.plot(dfMEul.t, dfMEul.du, label="$\\frac{du}{dt}$")
     plt.title("Modified Euler solution to {} (N={})".format(prob, N))
     plt.legend()
     plt.savefig("{}/Figure_2:_Modified_Euler_solution_to_{}.png".format(prob,
@@ -72,8 +30,8 @@ def main():
 
     # Plot Runge-Kutta fourth-order method solution
     plt.figure(3)
-    plt.plot(t, uRK4, label="u")
-    plt.plot(t, duRK4, label="$\\frac{du}{dt}$")
+    plt.plot(dfRK4.t, dfRK4.u, label="u")
+    plt.plot(dfRK4.t, dfRK4.du, label="$\\frac{du}{dt}$")
     plt.title("Runge-Kutta fourth order solution to {} (N={})".format(prob, N))
     plt.legend()
     plt.savefig("{}/Figure_3:_RK4_solution_to_{}.png".format(prob,
@@ -81,8 +39,8 @@ def main():
 
     # Plot RKF45 solution
     plt.figure(4)
-    plt.plot(t, dfRKF45.u, label="u")
-    plt.plot(t, dfRKF45.du, label="$\\frac{du}{dt}$")
+    plt.plot(dfRKF45.t, dfRKF45.u, label="u")
+    plt.plot(dfRKF45.t, dfRKF45.du, label="$\\frac{du}{dt}$")
     plt.legend()
     plt.title("RKF45 solution to {} (tol={})".format(prob, tol))
     plt.savefig("{}/Figure_4:_RKF45_solution_to_{}.png".format(prob, prob))
@@ -90,10 +48,10 @@ def main():
     # Plot u values from three different methods against each other to get
     # some feeling for errors in the various methods
     plt.figure(5)
-    plt.plot(t, uEul, label='u (Euler)')
-    plt.plot(t, uMEul, label='u (Modified Euler)')
-    plt.plot(t, uRK4, label='u (RK4)')
-    plt.plot(t, dfRKF45.u, label="u (RKF45)")
+    plt.plot(dfEul.t, dfEul.u, label='u (Euler)')
+    plt.plot(dfMEul.t, dfMEul.u, label='u (Modified Euler)')
+    plt.plot(dfRK4.t, dfRK4.u, label='u (RK4)')
+    plt.plot(dfRKF45.t, dfRKF45.u, label="u (RKF45)")
     plt.legend()
     plt.title("Comparison of u solutions to {} from four different numerical schemes \n(N={}, tol={})".format(prob, N, tol))
     plt.savefig("{}/Figure_5:_u_value_approximations_{}.png".format(prob, 
@@ -101,13 +59,20 @@ def main():
 
     # Phase plot du against u
     plt.figure(6)
-    plt.plot(uEul, duEul, label="Euler")
-    plt.plot(uMEul, duMEul, label="Modified Euler")
-    plt.plot(uRK4, duRK4, label="Runge-Kutta 4th order")
+    plt.plot(dfEul.u, dfEul.du, label="Euler")
+    plt.plot(dfMEul.u, dfMEul.du, label="Modified Euler")
+    plt.plot(dfRK4.u, dfRK4.du, label="Runge-Kutta 4th order")
     plt.plot(dfRKF45.u, dfRKF45.du, label="Runge-Kutta-Fehlberg 4(5)th order")
     plt.legend()
     plt.title("Comparison of u solutions to {} from four different numerical schemes \n(N={}, tol={})".format(prob, N, tol))
     plt.savefig("{}/Figure_6:_du_value_approximations_{}.png".format(prob, prob))
 
+    # Errors against the RKF45 solution, computed by solveProblem
+    plt.figure(7)
+    ptls.plotErrors(dfErrs, "u", "u")
+    plt.legend()
+    plt.title("Errors in u relative to RKF45 for {} \n(N={}, tol={})".format(prob, N, tol))
+    plt.savefig("{}/Figure_7:_u_errors_{}.png".format(prob, prob))
+
 if __name__ == "__main__":
     main()
\ No newline at end of file
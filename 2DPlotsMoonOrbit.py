@@ -4,76 +4,22 @@ import plotTools as ptls
 import matplotlib.pyplot as plt
 import numpy as np
 
-def interp(dfEul, dfMEul, dfRK4, dfRKF45):
-    """
-    Interpolate Euler, Modified Euler and RK4 solutions to RKF45 grid.
-
-    Parameters
-    ----------
-    dfEul : Data Frame.
-            Contains the Euler solution, including time values.
-    dfMEul : Data Frame.
-            Contains the Modified Euler solution, including time values.
-    dfRK4 : Data Frame.
-            Contains the Runge-Kutta 4th order solution, including time values.
-
-    Returns
-    -------
-    t : NumPy array.
-        Contains RKF45 time values.
-    rEul : NumPy array.
-        r values of the Euler solution.
-    drEul : NumPy array.
-        dr/dt values of the Euler solution.
-    thetEul : NumPy array.
-        theta values of the Euler solution.
-    rMEul : NumPy array.
-        r values of the Modified Euler solution.
-    drMEul : NumPy array.
-        dr/dt values of the Modified Euler solution.
-    thetMEul : NumPy array.
-        theta values of the Modified Euler solution.
-    rRK4 : NumPy array.
-        r values of the RK4 solution.
-    drRK4 : NumPy array.
-        dr/dt values of the RK4 solution.
-    thetRK4 : NumPy array.
-        theta values of the RK4 solution.
-    """
-    t = dfRKF45.t
-    # Euler
-    rEul = ptls.spline(dfEul.t, dfEul.r, t)
-    drEul = ptls.spline(dfEul.t, dfEul.dr, t)
-    thetEul = ptls.spline(dfEul.t, dfEul.theta, t)
-    # Modified Euler
-    rMEul = ptls.spline(dfMEul.t, dfMEul.r, t)
-    drMEul = ptls.spline(dfMEul.t, dfMEul.dr, t)
-    thetMEul = ptls.spline(dfMEul.t, dfMEul.theta, t)
-    # RK4
-    rRK4 = ptls.spline(dfRK4.t, dfRK4.r, t)
-    drRK4 = ptls.spline(dfRK4.t, dfRK4.dr, t)
-    thetRK4 = ptls.spline(dfRK4.t, dfRK4.theta, t)
-
-    return t, rEul, drEul, thetEul, rMEul, drMEul, thetMEul, rRK4, drRK4, thetRK4
-
 def main():
     with open('ODE_prob.txt', 'r') as file:
         prob = file.read().replace('\n', '')
 
-    # Import data from CSV file
+    # Import data from CSV file; each solution is plotted on its own grid
     N, tol, dfEul, dfMEul, dfRK4, dfRKF45 = ptls.importData("ODE")
-    
-    # Interpolate to get solutions on the same grid (RKF45's grid)
-    t, rEul, drEul, thetEul, rMEul, drMEul, thetMEul, rRK4, drRK4, thetRK4 = interp(dfEul, dfMEul, dfRK4, dfRKF45)
+    dfErrs = ptls.importErrors("ODE")
 
     # x and y coordinates computed from r and theta values obtained using
     # the four numerical schemes. 
-    xEul = rEul*np.cos(thetEul)
-    yEul = rEul*np.sin(thetEul)
-    xMEul = rMEul*np.cos(thetMEul)
-    yMEul = rMEul*np.sin(thetMEul)
-    xRK4 = rRK4*np.cos(thetRK4)
-    yRK4 = rRK4*np.sin(thetRK4)
+    xEul = dfEul.r*np.cos(dfEul.theta)
+    yEul = dfEul.r*np.sin(dfEul.theta)
+    xMEul = dfMEul.r*np.cos(dfMEul.theta)
+    yMEul = dfMEul.r*np.sin(dfMEul.theta)
+    xRK4 = dfRK4.r*np.cos(dfRK4.theta)
+    yRK4 = dfRK4.r*np.sin(dfRK4.theta)
     xRKF45 = dfRKF45.r*np.cos(dfRKF45.theta)
     yRKF45 = dfRKF45.r*np.sin(dfRKF45.theta)
 
@@ -92,10 +38,10 @@ def main():
     # Plot r values from four different methods against each other to get
     # some feeling for errors in the various methods
     plt.figure(2)
-    plt.plot(t, rEul, label='Euler')
-    plt.plot(t, rMEul, label='Modified Euler')
-    plt.plot(t, rRK4, label='Runge-Kutta 4th order')
-    plt.plot(t, dfRKF45.r, label="Runge-Kutta-Fehlberg 4(5)th order")
+    plt.plot(dfEul.t, dfEul.r, label='Euler')
+    plt.plot(dfMEul.t, dfMEul.r, label='Modified Euler')
+    plt.plot(dfRK4.t, dfRK4.r, label='Runge-Kutta 4th order')
+    plt.plot(dfRKF45.t, dfRKF45.r, label="Runge-Kutta-Fehlberg 4(5)th order")
     plt.legend()
     plt.xlabel("$t$ (seconds)")
     plt.ylabel("$r$ (metres)")
@@ -105,10 +51,10 @@ def main():
 
     # Plot dr values from the four different methods
     plt.figure(3)
-    plt.plot(t, drEul, label='Euler')
-    plt.plot(t, drMEul, label='Modified Euler')
-    plt.plot(t, drRK4, label='Runge-Kutta 4th order')
-    plt.plot(t, dfRKF45.dr, label="Runge-Kutta-Fehlberg 4(5)th order")
+    plt.plot(dfEul.t, dfEul.dr, label='Euler')
+    plt.plot(dfMEul.t, dfMEul.dr, label='Modified Euler')
+    plt.plot(dfRK4.t, dfRK4.dr, label='Runge-Kutta 4th order')
+    plt.plot(dfRKF45.t, dfRKF45.dr, label="Runge-Kutta-Fehlberg 4(5)th order")
     plt.legend()
     plt.xlabel("$t$ (seconds)")
     plt.ylabel("$\\frac{dr}{dt}$ (metres per second)")
@@ -118,10 +64,10 @@ def main():
 
     # Plot theta values from the four different methods
     plt.figure(4)
-    plt.plot(t, thetEul, label='Euler')
-    plt.plot(t, thetMEul, label='Modified Euler')
-    plt.plot(t, thetRK4, label='Runge-Kutta 4th order')
-    plt.plot(t, dfRKF45.theta, label="Runge-Kutta-Fehlberg 4(5)th order")
+    plt.plot(dfEul.t, dfEul.theta, label='Euler')
+    plt.plot(dfMEul.t, dfMEul.theta, label='Modified Euler')
+    plt.plot(dfRK4.t, dfRK4.theta, label='Runge-Kutta 4th order')
+    plt.plot(dfRKF45.t, dfRKF45.theta, label="Runge-Kutta-Fehlberg 4(5)th order")
     plt.legend()
     plt.xlabel("$t$ (seconds)")
     plt.ylabel("$\\theta$ (radians)")
@@ -131,9 +77,9 @@ def main():
 
     # Phase plot dr against r
     plt.figure(5)
-    plt.plot(rEul, drEul, label="Euler")
-    plt.plot(rMEul, drMEul, label="Modified Euler")
-    plt.plot(rRK4, drRK4, label="Runge-Kutta 4th order")
+    plt.plot(dfEul.r, dfEul.dr, label="Euler")
+    plt.plot(dfMEul.r, dfMEul.dr, label="Modified Euler")
+    plt.plot(dfRK4.r, dfRK4.dr, label="Runge-Kutta 4th order")
     plt.plot(dfRKF45.r, dfRKF45.dr, label="Runge-Kutta-Fehlberg 4(5)th order")
     plt.xlabel("$r$ (metres)")
     plt.ylabel("$\\frac{dr}{dt}$ (metres per second)")
@@ -141,6 +87,13 @@ def main():
     plt.title("Phase plots of dr/dt against r for various numerical schemes \n(N={}, tol={})".format(prob, N, tol))
     plt.savefig("{}/Figure_5:_dr_value_approximations_{}.png".format(prob, prob))
 
+    # Errors in r against the RKF45 solution, computed by solveProblem
+    plt.figure(6)
+    ptls.plotErrors(dfErrs, "r", "r")
+    plt.legend()
+    plt.title("Errors in r relative to RKF45 for {} \n(N={}, tol={})".format(prob, N, tol))
+    plt.savefig("{}/Figure_6:_r_errors_{}.png".format(prob, prob))
+
     print("Minimum of r is: {}".format(np.min(dfRKF45.r)))
     print("Maximum of r is: {}".format(np.max(dfRKF45.r)))
 
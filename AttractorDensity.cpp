@@ -0,0 +1,189 @@
+// Written to estimate the invariant densities of the Lorenz, Chen, Rossler
+// and Thomas attractors with attractorDensity.h
+#include <attractorDensity.h>
+
+/**
+ * Returns the right-hand side of the Lorenz system.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> lorenz(double t, vector<double> X, vector<double> params) {
+    double x = X[0];
+    double y = X[1];
+    double z = X[2];
+
+    double sigma = params[0];
+    double rho = params[1];
+    double beta = params[2];
+
+    vector<double> dX {
+        sigma*(y-x),
+        x*(rho-z)-y,
+        x*y-beta*z
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of the Chen system.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> chen(double t, vector<double> X, vector<double> params) {
+    double x = X[0];
+    double y = X[1];
+    double z = X[2];
+
+    double a = params[0];
+    double b = params[1];
+    double c = params[2];
+
+    vector<double> dX {
+        a*(y-x),
+        x*(c-a-z)+c*y,
+        x*y-b*z
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of the Rossler system.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> rossler(double t, vector<double> X, vector<double> params) {
+    double x = X[0];
+    double y = X[1];
+    double z = X[2];
+
+    double a = params[0];
+    double b = params[1];
+    double c = params[2];
+
+    vector<double> dX {
+        - y - z,
+        x + a * y,
+        b + z * (x-c)
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of Thomas' cyclically symmetric system.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> thomas(double t, vector<double> X, vector<double> params) {
+    double x = X[0];
+    double y = X[1];
+    double z = X[2];
+
+    double b = params[0];
+
+    vector<double> dX {
+        sin(y)-b*x,
+        sin(z)-b*y,
+        sin(x)-b*z
+    };
+
+    return dX;
+}
+
+/**
+ * Accumulates the 3D density of one attractor over an ensemble of nTraj
+ * trajectories started near X0, each of N steps of length dt, and writes its
+ * xy, xz and yz projections to <name>_density_<axes>.csv.
+ *
+ * @param name     Name of the system.
+ * @param f        Right-hand side.
+ * @param X0       Initial condition the ensemble is started around.
+ * @param params   Vector of parameter values.
+ * @param lo       Lower bounds of x, y and z.
+ * @param hi       Upper bounds of x, y and z.
+ * @param dt       Step size.
+ * @param N        Number of steps of each trajectory.
+ * @param nTraj    Number of trajectories.
+ * @return         Nothing.
+ */
+void attractorDensity(string name, vector<double>(*f)(double, vector<double>,
+vector<double>), vector<double> X0, vector<double> params, vector<double> lo,
+vector<double> hi, double dt, long N, int nTraj) {
+    // Trajectories start 1e-3 apart and are left to settle for 1000 steps
+    vector<vector<double>> X0s;
+    for (int k = 0; k < nTraj; k++) {
+        X0s.push_back(vecAdd(X0, vector<double>(3, 1e-3*k)));
+    }
+    densityHistogram prototype({0, 1, 2}, lo, hi, {128, 128, 128});
+
+    auto start = chrono::steady_clock::now();
+    densityHistogram hist = densityEnsemble(f, X0s, 0, N*dt, N, params,
+    prototype, 1000*dt);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    vector<string> names {"x", "y", "z"};
+    int pairs[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+    for (int p = 0; p < 3; p++) {
+        int a = pairs[p][0], b = pairs[p][1];
+        hist.projection(a, b).writeCSV(name + "_density_" + names[a] +
+        names[b] + ".csv", {names[a], names[b]});
+    }
+    cout << setw(8) << name << setw(14) << hist.total << setw(12);
+    cout << setprecision(3) << double (hist.outside)/hist.total << setw(12);
+    cout << hist.bytes()/1048576.0 << setw(12) << elapsed.count() << endl;
+}
+
+/**
+ * Main function, writes the density projections of the Lorenz, Chen,
+ * Rossler and Thomas attractors, then the xz density of the Lorenz system
+ * for several values of rho. The number of steps of each trajectory can be
+ * given as the first argument (default 1e6); memory use does not depend on
+ * it.
+ */
+int main(int argc, char *argv[]) {
+    long N = (argc > 1) ? atol(argv[1]) : 1000000;
+    int nTraj = 4;
+
+    cout << setw(8) << "system" << setw(14) << "states" << setw(12);
+    cout << "outside" << setw(12) << "MiB" << setw(12) << "seconds" << endl;
+    attractorDensity("Lorenz", lorenz, {1.0, 1.0, 1.0}, {10.0, 28.0, 8.0/3.0},
+    {-25, -35, 0}, {25, 35, 60}, 0.005, N, nTraj);
+    attractorDensity("Chen", chen, {-0.1, 0.5, -0.6}, {40.0, 3.0, 28.0},
+    {-35, -35, 0}, {35, 35, 60}, 0.002, N, nTraj);
+    attractorDensity("Rossler", rossler, {-0.1, 0.5, -0.6}, {0.1, 0.1, 14.0},
+    {-30, -30, 0}, {30, 30, 90}, 0.01, N, nTraj);
+    attractorDensity("Thomas", thomas, {-0.5, -1.0, -2.0}, {0.1998},
+    {-5, -5, -5}, {5, 5, 5}, 0.05, N, nTraj);
+
+    // Sweep over rho, one 2D histogram per value
+    vector<double> rhos {24.5, 28.0, 50.0, 99.65};
+    vector<vector<double>> paramSets;
+    for (int k = 0; k < rhos.size(); k++) {
+        paramSets.push_back({10.0, rhos[k], 8.0/3.0});
+    }
+    densityHistogram prototype({0, 2}, {-40, 0}, {40, 150}, {256, 256});
+    vector<densityHistogram> hists = densitySweep(lorenz, {1.0, 1.0, 1.0}, 0,
+    N*0.005, N, paramSets, prototype, 5.0);
+    for (int k = 0; k < rhos.size(); k++) {
+        ostringstream filename;
+        filename << "Lorenz_rho" << rhos[k] << "_density_xz.csv";
+        hists[k].writeCSV(filename.str(), {"x", "z"});
+        cout << setprecision(4) << "rho = " << rhos[k] << ": ";
+        cout << hists[k].total << " states, ";
+        cout << double (hists[k].outside)/hists[k].total << " outside" << endl;
+    }
+}
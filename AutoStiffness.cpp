@@ -0,0 +1,111 @@
+// Written to compare RKF45 with the stiffness switching "auto" method of
+// solClass
+#include <chrono>
+#include <ODE.h>
+
+/**
+ * Returns the right-hand side of the Van der Pol oscillator.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> vanderPol(double t, vector<double> X, vector<double> params) {
+    double u = X[0];
+    double du = X[1];
+
+    double mu = params[0];
+
+    vector<double> dX {
+        du,
+        mu*(1-pow(u,2))*du - u
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of the Hindmarsh-Rose neuron model.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> hindmarshRose(double t, vector<double> X,
+vector<double> params) {
+    double x = X[0];
+    double y = X[1];
+    double z = X[2];
+
+    double a = params[0];
+    double b = params[1];
+    double c = params[2];
+    double d = params[3];
+    double r = params[4];
+    double s = params[5];
+    double xR = params[6];
+    double I = params[7];
+
+    vector<double> dX {
+        y-a*pow(x,3)+b*pow(x,2)-z+I,
+        c-d*pow(x,2)-y,
+        r*(s*(x-xR)-z)
+    };
+
+    return dX;
+}
+
+/**
+ * Solves a problem with RKF45 and with "auto" and prints how far each got,
+ * the work done and the number of method switches.
+ *
+ * @param name     Name of the problem.
+ * @param f        Right-hand side.
+ * @param X0       Initial condition.
+ * @param tf       Final time.
+ * @param params   Vector of parameter values.
+ * @param tol      Error tolerance.
+ * @return         Nothing.
+ */
+void compare(string name, vector<double>(*f)(double, vector<double>,
+vector<double>), vector<double> X0, double tf, vector<double> params,
+double tol) {
+    vector<string> methods {"RKF45", "auto"};
+    for (int m = 0; m < methods.size(); m++) {
+        auto start = chrono::steady_clock::now();
+        solClass solution(f, X0, 0.0, tf, params, tol, 1000000, 1e-1,
+        methods[m]);
+        chrono::duration<double> elapsed = chrono::steady_clock::now() -
+        start;
+        solverStats stats = solution.getStats();
+        cout << setw(22) << name << setw(7) << methods[m] << setw(10);
+        cout << solution.getT().back() << setw(10) << stats.nAccept;
+        cout << setw(8) << stats.nReject << setw(10) << stats.nfev;
+        cout << setw(7) << stats.nJac << setw(9) << stats.nSwitch;
+        cout << setw(12) << elapsed.count() << endl;
+    }
+}
+
+/**
+ * Main function, compares RKF45 and "auto" on the Van der Pol oscillator
+ * for increasingly stiff mu and on the Hindmarsh-Rose model with a fast and
+ * a slow adaptation rate r. RKF45 stops at itMax = 10^6 steps before tf on
+ * the stiffest problem.
+ */
+int main() {
+    cout << setw(22) << "problem" << setw(7) << "method" << setw(10);
+    cout << "reached" << setw(10) << "accepted" << setw(8) << "reject";
+    cout << setw(10) << "nfev" << setw(7) << "nJac" << setw(9) << "switches";
+    cout << setw(12) << "seconds" << endl;
+    vector<double> mus {1, 100, 1000};
+    for (int k = 0; k < mus.size(); k++) {
+        compare("Van der Pol mu=" + to_string(int (mus[k])), vanderPol,
+        {2.0, 0.0}, 3000, {mus[k]}, 1e-6);
+    }
+    compare("Hindmarsh-Rose r=1e-3", hindmarshRose, {1.0, 1.0, 1.0}, 2000,
+    {1.0, 3.0, 1.0, 5.0, 1e-3, 4.0, -1.6, 3.25}, 1e-8);
+    compare("Hindmarsh-Rose r=0.5", hindmarshRose, {1.0, 1.0, 1.0}, 2000,
+    {1.0, 3.0, 1.0, 5.0, 0.5, 4.0, -1.6, 3.25}, 1e-8);
+}
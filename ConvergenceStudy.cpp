@@ -0,0 +1,142 @@
+// Written to check the convergence order of the fixed step methods with
+// convergence.h
+#include <convergence.h>
+
+/**
+ * Returns the right-hand side of the Van der Pol oscillator.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> vanderPol(double t, vector<double> X, vector<double> params) {
+    double u = X[0];
+    double du = X[1];
+
+    double mu = params[0];
+
+    vector<double> dX {
+        du,
+        mu*(1-pow(u,2))*du - u
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of the orbit of the Earth about the Sun in
+ * polar coordinates.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> orbit(double t, vector<double> X, vector<double> params) {
+    // Extract dependent variables from X vector
+    double r = X[0];
+    double dr = X[1];
+
+    // Constants
+    double G = 6.674e-11; // Gravitational constant
+    double M = params[0]; // Mass of the central body (kg)
+    double c = params[1]; // r^2 theta dot = angular momentum/orbiting mass
+
+    vector<double> dX {
+        dr,                               // dr/dt
+        pow(c,2)/pow(r,3)-G*M/pow(r,2),   // d^2r/dt^2
+        c/pow(r,2)                        // dtheta/dt
+    };
+
+    return dX;
+}
+
+/**
+ * Prints the runs and fits of a convergence study, and the cheapest method
+ * (with its number of steps) for a few target errors.
+ *
+ * @param prob     Problem name.
+ * @param fits     Result of convergenceStudy.
+ * @param targets  Relative errors wanted.
+ * @return         Nothing.
+ */
+void report(string prob, const vector<convergenceFit> &fits,
+vector<double> targets) {
+    cout << prob << endl;
+    cout << setw(10) << "method" << setw(9) << "N" << setw(10) << "nfev";
+    cout << setw(12) << "error" << setw(8) << "order" << setw(8) << "digits";
+    cout << setw(14) << "nfev/digit" << setw(11) << "seconds" << endl;
+    for (int m = 0; m < fits.size(); m++) {
+        for (int level = 0; level < fits[m].runs.size(); level++) {
+            const convergenceRun &run = fits[m].runs[level];
+            double digits = -log10(run.err);
+            cout << setw(10) << run.method << setw(9) << run.N << setw(10);
+            cout << run.nfev << setw(12) << setprecision(3) << run.err;
+            // Order observed between this grid and the previous one
+            cout << setw(8);
+            if (level > 0) {
+                cout << log2(fits[m].runs[level-1].err/run.err);
+            } else {
+                cout << "";
+            }
+            cout << setw(8) << digits << setw(14);
+            cout << (digits > 0 ? run.nfev/digits : INFINITY) << setw(11);
+            cout << run.seconds << endl;
+        }
+    }
+
+    // Fitted orders; each extra digit costs 10^(1/order) times the work
+    cout << endl << setw(10) << "method" << setw(10) << "nominal";
+    cout << setw(10) << "fitted" << setw(8) << "runs" << setw(24);
+    cout << "work per extra digit" << endl;
+    for (int m = 0; m < fits.size(); m++) {
+        cout << setw(10) << fits[m].method << setw(10);
+        cout << fits[m].nominalOrder << setw(10) << fits[m].order << setw(8);
+        cout << fits[m].nFit << setw(23) << pow(10, 1/fits[m].order) << "x";
+        cout << endl;
+    }
+
+    // Cheapest method for each target error
+    cout << endl;
+    for (int i = 0; i < targets.size(); i++) {
+        int best = 0;
+        for (int m = 1; m < fits.size(); m++) {
+            if (costForError(fits[m], targets[i]) <
+            costForError(fits[best], targets[i])) {
+                best = m;
+            }
+        }
+        double nfev = costForError(fits[best], targets[i]);
+        cout << "Error " << targets[i] << ": " << fits[best].method;
+        cout << " with N = " << setprecision(6);
+        cout << nfev/stagesPerStep(fits[best].method) << " (" << nfev;
+        cout << " RHS evaluations)" << setprecision(3) << endl;
+    }
+    cout << endl;
+}
+
+/**
+ * Main function, studies the convergence of Euler, ModEuler, RK4 and ABM on
+ * the Van der Pol oscillator (against Bulirsch-Stoer and, as a check,
+ * against Richardson extrapolation) and on one year of the Earth's orbit.
+ */
+int main() {
+    vector<string> methods {"Euler", "ModEuler", "RK4", "ABM"};
+    vector<double> targets {1e-3, 1e-6, 1e-9};
+
+    vector<convergenceFit> fits = convergenceStudy(vanderPol, {1.0, 1.0}, 0,
+    10, {1.0}, methods, 100, 10);
+    report("Van der Pol (mu = 1) on [0, 10], Bulirsch-Stoer reference",
+    fits, targets);
+
+    fits = convergenceStudy(vanderPol, {1.0, 1.0}, 0, 10, {1.0}, methods,
+    100, 10, true);
+    report("Van der Pol (mu = 1) on [0, 10], Richardson reference", fits,
+    targets);
+
+    fits = convergenceStudy(orbit, {149.6e9, 310, 0}, 0, 3.16e7,
+    {1.9885e30, 4.4407e15}, methods, 100, 10);
+    report("Earth's orbit for one year, Bulirsch-Stoer reference", fits,
+    targets);
+}
@@ -0,0 +1,117 @@
+// Written to check the Lyapunov spectrum engine in Lyapunov.h
+#include <Lyapunov.h>
+
+/**
+ * Returns the right-hand side of our ODE (currently the Lorenz system).
+ * 
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> ODE(double t, vector<double> X, vector<double> params) {
+    // Dependent variables
+    double x = X[0];
+    double y = X[1];
+    double z = X[2];
+
+    // Parameters
+    double sigma = params[0];
+    double rho = params[1];
+    double beta = params[2];
+
+    // dX/dt
+    vector<double> dX {
+        sigma*(y-x), // dx/dt
+        x*(rho-z)-y, // dy/dt
+        x*y-beta*z   // dz/dt
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the Jacobian of the Lorenz system.
+ * 
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Jacobian, row i holds the derivatives of dX[i]/dt.
+ */
+vector<vector<double>> jacobian(double t, vector<double> X, 
+vector<double> params) {
+    // Dependent variables
+    double x = X[0];
+    double y = X[1];
+    double z = X[2];
+
+    // Parameters
+    double sigma = params[0];
+    double rho = params[1];
+    double beta = params[2];
+
+    vector<vector<double>> J {
+        {-sigma, sigma, 0.0},
+        {rho-z, -1.0, -x},
+        {y, x, -beta}
+    };
+
+    return J;
+}
+
+/**
+ * Main function, computes the Lyapunov spectrum of the Lorenz system for the
+ * classic parameters (with the analytic and the finite difference Jacobian),
+ * then sweeps rho and writes the spectra to Lyapunov_sweep.csv.
+ */
+int main() {
+    // Initialize variables
+    double t0 = 0;
+    double tf = 1000;
+    double tTrans = 50;
+    int N = int (1e5);
+    int orthoEvery = 10;
+    vector<double> X0 {
+        1.0,
+        1.0,
+        1.0
+    };
+    vector<double> params {
+        10.0,
+        28.0,
+        8.0/3.0
+    };
+
+    // Spectrum with the analytic Jacobian
+    vector<double> spectrum = lyapunovSpectrum(ODE, jacobian, X0, t0, tf, N, 
+    params, orthoEvery, tTrans);
+    printVec(spectrum, "lambda (analytic Jacobian)");
+
+    // Spectrum with finite difference Jacobian-vector products
+    spectrum = lyapunovSpectrum(ODE, nullptr, X0, t0, tf, N, params, 
+    orthoEvery, tTrans);
+    printVec(spectrum, "lambda (finite differences)");
+
+    // Sweep rho over several threads
+    int nRho = 40;
+    vector<double> rho = linspace(20.0, 220.0, nRho-1);
+    vector<vector<double>> paramSets;
+    for (int i = 0; i < nRho; i++) {
+        paramSets.push_back({params[0], rho[i], params[2]});
+    }
+    vector<vector<double>> spectra = lyapunovSweep(ODE, jacobian, X0, t0, 
+    tf/10, N/10, paramSets, orthoEvery, tTrans);
+
+    // Write sweep to file
+    ofstream file;
+    file.open("Lyapunov_sweep.csv");
+    file << "rho,lambda1,lambda2,lambda3" << endl;
+    for (int i = 0; i < nRho; i++) {
+        file << setprecision(15) << rho[i];
+        for (int j = 0; j < 3; j++) {
+            file << "," << spectra[i][j];
+        }
+        file << endl;
+    }
+    file.close();
+}
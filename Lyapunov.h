@@ -0,0 +1,297 @@
+#ifndef LYAPUNOV_H
+#define LYAPUNOV_H
+
+// Required for parameter sweeps over several threads
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <ODE.h>
+
+/**
+ * Applies the Jacobian of f at (t, X) to the tangent vector V. If jac is
+ * nullptr the product is approximated by a forward difference along V, which
+ * costs one extra evaluation of f.
+ *
+ * @param f        Function that returns dX/dt from the arguments t, X and
+ * params.
+ * @param jac      Function that returns the Jacobian df/dX (rows correspond
+ * to components of f) or nullptr.
+ * @param J        Jacobian already evaluated at (t, X) (unused if jac is
+ * nullptr).
+ * @param t        Time value.
+ * @param X        State the Jacobian is evaluated at.
+ * @param fX       f(t, X, params), reused by the finite difference.
+ * @param V        Tangent vector.
+ * @param params   Vector of parameter values.
+ * @return         J V.
+ */
+vector<double> jacobianVecProd(vector<double>(*f)(double, vector<double>,
+vector<double>), vector<vector<double>>(*jac)(double, vector<double>,
+vector<double>), const vector<vector<double>> &J, double t,
+const vector<double> &X, const vector<double> &fX, const vector<double> &V,
+const vector<double> &params) {
+    int n = X.size();
+    vector<double> JV(n, 0.0);
+
+    if (jac != nullptr) {
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                JV[i] += J[i][j]*V[j];
+            }
+        }
+        return JV;
+    }
+
+    // Scale the difference step to the size of X and V
+    double normX = 0, normV = 0;
+    for (int i = 0; i < n; i++) {
+        normX += X[i]*X[i];
+        normV += V[i]*V[i];
+    }
+    if (normV == 0) {
+        return JV;
+    }
+    double eps = sqrt(2.2e-16)*max(1.0, sqrt(normX))/sqrt(normV);
+    vector<double> fXeps = f(t, vecAdd(X, scalMult(eps, V)), params);
+    for (int i = 0; i < n; i++) {
+        JV[i] = (fXeps[i]-fX[i])/eps;
+    }
+
+    return JV;
+}
+
+/**
+ * Orthonormalizes the vectors in Q in place using modified Gram-Schmidt.
+ *
+ * @param Q        Vectors to be orthonormalized (Q[j] is the jth vector).
+ * @return         Diagonal of R in the QR factorization, i.e. the length of
+ * each vector after the earlier ones were projected out of it. A vector
+ * that has collapsed onto the earlier ones gets R[j] = 0 and is left
+ * unnormalized.
+ */
+vector<double> gramSchmidt(vector<vector<double>> &Q) {
+    int m = Q.size();
+    int n = Q[0].size();
+    vector<double> R(m);
+
+    for (int j = 0; j < m; j++) {
+        for (int k = 0; k < j; k++) {
+            double proj = 0;
+            for (int i = 0; i < n; i++) {
+                proj += Q[k][i]*Q[j][i];
+            }
+            for (int i = 0; i < n; i++) {
+                Q[j][i] -= proj*Q[k][i];
+            }
+        }
+        double norm = 0;
+        for (int i = 0; i < n; i++) {
+            norm += Q[j][i]*Q[j][i];
+        }
+        R[j] = sqrt(norm);
+        if (R[j] == 0) {
+            continue;
+        }
+        for (int i = 0; i < n; i++) {
+            Q[j][i] /= R[j];
+        }
+    }
+
+    return R;
+}
+
+/**
+ * Takes a single RK4 step of the state X together with the tangent vectors
+ * V, i.e. of the system dX/dt = f(t, X), dV/dt = J(t, X) V. Each stage
+ * evaluates the Jacobian once at the stage state and applies it to all the
+ * tangent vectors.
+ *
+ * @param f        Function that returns dX/dt from the arguments t, X and
+ * params.
+ * @param jac      Function that returns the Jacobian df/dX or nullptr to use
+ * finite differences.
+ * @param t        Time at the start of the step.
+ * @param dt       Step size.
+ * @param X        State, overwritten with the state at t+dt.
+ * @param V        Tangent vectors, overwritten with their values at t+dt.
+ * @param params   Vector of parameter values.
+ */
+void tangentRK4Step(vector<double>(*f)(double, vector<double>,
+vector<double>), vector<vector<double>>(*jac)(double, vector<double>,
+vector<double>), double t, double dt, vector<double> &X,
+vector<vector<double>> &V, const vector<double> &params) {
+    // Nodes and weights of the classical RK4 tableau
+    const double c[4] = {0.0, 0.5, 0.5, 1.0};
+    const double w[4] = {1.0/6.0, 1.0/3.0, 1.0/3.0, 1.0/6.0};
+    int m = V.size();
+    vector<double> Xs = X, kX, nextX = X;
+    vector<vector<double>> Vs = V, kV(m), nextV = V;
+    vector<vector<double>> J;
+
+    for (int s = 0; s < 4; s++) {
+        // Stage values are built from the previous stage's slopes
+        if (s > 0) {
+            Xs = vecAdd(X, scalMult(c[s]*dt, kX));
+            for (int j = 0; j < m; j++) {
+                Vs[j] = vecAdd(V[j], scalMult(c[s]*dt, kV[j]));
+            }
+        }
+        kX = f(t + c[s]*dt, Xs, params);
+        if (jac != nullptr && m > 0) {
+            J = jac(t + c[s]*dt, Xs, params);
+        }
+        for (int j = 0; j < m; j++) {
+            kV[j] = jacobianVecProd(f, jac, J, t + c[s]*dt, Xs, kX, Vs[j],
+            params);
+        }
+
+        // Accumulate weighted slopes
+        nextX = vecAdd(nextX, scalMult(w[s]*dt, kX));
+        for (int j = 0; j < m; j++) {
+            nextV[j] = vecAdd(nextV[j], scalMult(w[s]*dt, kV[j]));
+        }
+    }
+
+    X = nextX;
+    V = nextV;
+}
+
+/**
+ * Computes the full Lyapunov spectrum of dX/dt = f(t, X, params) by
+ * integrating the variational equations alongside X with RK4 and
+ * reorthonormalizing the tangent vectors every orthoEvery steps.
+ *
+ * @param f          Function that returns dX/dt from the arguments t, X and
+ * params.
+ * @param jac        Function that returns the Jacobian df/dX (rows
+ * correspond to components of f) or nullptr to use finite differences.
+ * @param X0         Initial condition.
+ * @param t0         Initial time.
+ * @param tf         Final time.
+ * @param N          Number of RK4 steps between t0 and tf.
+ * @param params     Vector of parameter values.
+ * @param orthoEvery Number of steps between Gram-Schmidt
+ * reorthonormalizations.
+ * @param tTrans     Length of the transient (integrated with the same step
+ * size before t0) that is discarded before averaging starts.
+ * @return           Lyapunov exponents, largest first. Throws a
+ * runtime_error if orthoEvery < 1 or if a tangent vector collapses to zero
+ * length between reorthonormalizations (reduce orthoEvery).
+ */
+vector<double> lyapunovSpectrum(vector<double>(*f)(double, vector<double>,
+vector<double>), vector<vector<double>>(*jac)(double, vector<double>,
+vector<double>), vector<double> X0, double t0, double tf, int N,
+vector<double> params, int orthoEvery=10, double tTrans=0) {
+    if (orthoEvery < 1) {
+        throw runtime_error("lyapunovSpectrum: orthoEvery must be >= 1");
+    }
+
+    // Initialize variables
+    int n = X0.size();
+    double dt = (tf-t0)/N;
+    vector<double> X = X0;
+    vector<double> logSum(n, 0.0);
+    vector<vector<double>> V(n, vector<double>(n, 0.0));
+    vector<vector<double>> noTangents;
+
+    // Discard the transient so that X is on the attractor
+    int nTrans = int (tTrans/dt);
+    for (int i = 0; i < nTrans; i++) {
+        tangentRK4Step(f, jac, t0 - (nTrans-i)*dt, dt, X, noTangents, params);
+    }
+
+    // Tangent vectors start as the identity
+    for (int j = 0; j < n; j++) {
+        V[j][j] = 1.0;
+    }
+
+    // Integrate state and tangent vectors together
+    for (int i = 0; i < N; i++) {
+        tangentRK4Step(f, jac, t0 + i*dt, dt, X, V, params);
+        if ((i+1) % orthoEvery == 0 || i == N-1) {
+            vector<double> R = gramSchmidt(V);
+            for (int j = 0; j < n; j++) {
+                if (!(R[j] > 0)) {
+                    throw runtime_error("lyapunovSpectrum: tangent vector "
+                    "collapsed at t = " + to_string(t0 + (i+1)*dt));
+                }
+                logSum[j] += log(R[j]);
+            }
+        }
+    }
+
+    // Average stretching rates over the integration time
+    vector<double> exponents = scalMult(1.0/(tf-t0), logSum);
+    sort(exponents.begin(), exponents.end(), greater<double>());
+
+    return exponents;
+}
+
+/**
+ * Computes the Lyapunov spectrum for each parameter set in paramSets,
+ * distributing the parameter sets over nThreads threads.
+ *
+ * @param f          Function that returns dX/dt from the arguments t, X and
+ * params.
+ * @param jac        Function that returns the Jacobian df/dX or nullptr to
+ * use finite differences.
+ * @param X0         Initial condition (shared by every parameter set).
+ * @param t0         Initial time.
+ * @param tf         Final time.
+ * @param N          Number of RK4 steps between t0 and tf.
+ * @param paramSets  Vector of parameter vectors.
+ * @param orthoEvery Number of steps between reorthonormalizations.
+ * @param tTrans     Length of the discarded transient.
+ * @param nThreads   Number of threads to use (0 means one per core).
+ * @return           Lyapunov spectrum for each entry of paramSets. Errors of
+ * lyapunovSpectrum are rethrown once every thread has finished.
+ */
+vector<vector<double>> lyapunovSweep(vector<double>(*f)(double,
+vector<double>, vector<double>), vector<vector<double>>(*jac)(double,
+vector<double>, vector<double>), vector<double> X0, double t0, double tf,
+int N, vector<vector<double>> paramSets, int orthoEvery=10, double tTrans=0,
+int nThreads=0) {
+    if (orthoEvery < 1) {
+        throw runtime_error("lyapunovSweep: orthoEvery must be at least 1");
+    }
+
+    // Initialize variables
+    int nSets = paramSets.size();
+    vector<vector<double>> spectra(nSets);
+    atomic<int> next(0);
+    exception_ptr error;
+    mutex errorLock;
+    if (nThreads <= 0) {
+        nThreads = max(1u, thread::hardware_concurrency());
+    }
+    nThreads = min(nThreads, max(nSets, 1));
+
+    // Each worker takes the next unclaimed parameter set until none remain
+    auto worker = [&]() {
+        for (int k = next++; k < nSets; k = next++) {
+            try {
+                spectra[k] = lyapunovSpectrum(f, jac, X0, t0, tf, N,
+                paramSets[k], orthoEvery, tTrans);
+            } catch (...) {
+                lock_guard<mutex> guard(errorLock);
+                error = current_exception();
+            }
+        }
+    };
+    vector<thread> threads;
+    for (int i = 0; i < nThreads; i++) {
+        threads.push_back(thread(worker));
+    }
+    for (int i = 0; i < nThreads; i++) {
+        threads[i].join();
+    }
+
+    if (error) {
+        rethrow_exception(error);
+    }
+
+    return spectra;
+}
+
+#endif
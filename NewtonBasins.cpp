@@ -0,0 +1,229 @@
+// Written to find every root of small nonlinear systems by Newton's method
+// from a dense grid of starting points, and to map the basin each starting
+// point lies in
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <newtonBasins.h>
+
+/**
+ * Batched form of fgJacob in Newtons.cpp: x^2 + 9y^2 - 16 = 0 and
+ * y - x^2 + 2x - p = 0.
+ *
+ * @param n        Number of points.
+ * @param X        X[j][i] is component j of point i.
+ * @param params   Vector of parameter values (p).
+ * @param F        Set to the function values.
+ * @param J        Set to the Jacobian components.
+ * @return         Nothing.
+ */
+void fgJacobBatch(size_t n, const double *const *X,
+const vector<double> &params, double *const *F, double *const *J) {
+    double p = params[0];
+    const double *x = X[0], *y = X[1];
+    for (size_t i = 0; i < n; i++) {
+        F[0][i] = x[i]*x[i] + 9*y[i]*y[i] - 16;
+        F[1][i] = y[i] - x[i]*x[i] + 2*x[i] - p;
+        J[0][i] = 2*x[i];
+        J[1][i] = 18*y[i];
+        J[2][i] = -2*x[i] + 2;
+        J[3][i] = 1;
+    }
+}
+
+/**
+ * z^3 - 1 = 0 for complex z = x + iy, written as a real system: the classic
+ * Newton fractal with three basins.
+ *
+ * @param n        Number of points.
+ * @param X        X[j][i] is component j of point i.
+ * @param params   Vector of parameter values (unused).
+ * @param F        Set to the function values.
+ * @param J        Set to the Jacobian components.
+ * @return         Nothing.
+ */
+void cubicBatch(size_t n, const double *const *X,
+const vector<double> &params, double *const *F, double *const *J) {
+    const double *x = X[0], *y = X[1];
+    for (size_t i = 0; i < n; i++) {
+        double x2 = x[i]*x[i], y2 = y[i]*y[i];
+        F[0][i] = x[i]*(x2 - 3*y2) - 1;
+        F[1][i] = y[i]*(3*x2 - y2);
+        // Cauchy-Riemann: J = [[a, -b], [b, a]] with 3z^2 = a + ib
+        J[0][i] = 3*(x2 - y2);
+        J[1][i] = -6*x[i]*y[i];
+        J[2][i] = 6*x[i]*y[i];
+        J[3][i] = 3*(x2 - y2);
+    }
+}
+
+/**
+ * Intersection of a sphere of radius sqrt(params[0]) with the paraboloid
+ * z = x^2 + y^2 - 1 and the saddle z = xy - params[1], which takes the 3 x 3
+ * path of the batched solver.
+ *
+ * @param n        Number of points.
+ * @param X        X[j][i] is component j of point i.
+ * @param params   Vector of parameter values.
+ * @param F        Set to the function values.
+ * @param J        Set to the Jacobian components.
+ * @return         Nothing.
+ */
+void surfacesBatch(size_t n, const double *const *X,
+const vector<double> &params, double *const *F, double *const *J) {
+    const double *x = X[0], *y = X[1], *z = X[2];
+    for (size_t i = 0; i < n; i++) {
+        F[0][i] = x[i]*x[i] + y[i]*y[i] + z[i]*z[i] - params[0];
+        F[1][i] = x[i]*x[i] + y[i]*y[i] - 1 - z[i];
+        F[2][i] = x[i]*y[i] - params[1] - z[i];
+        J[0][i] = 2*x[i];
+        J[1][i] = 2*y[i];
+        J[2][i] = 2*z[i];
+        J[3][i] = 2*x[i];
+        J[4][i] = 2*y[i];
+        J[5][i] = -1;
+        J[6][i] = y[i];
+        J[7][i] = x[i];
+        J[8][i] = -1;
+    }
+}
+
+/**
+ * fgJacob from Newtons.cpp, one point at a time, for the scalar reference.
+ *
+ * @param X        Vector of x and y values.
+ * @param params   Vector of parameter values.
+ * @param F        Set to the function values.
+ * @param Jacobian Set to the Jacobian components.
+ * @return         Nothing.
+ */
+void fgJacob(vector<double> X, vector<double> params, vector<double> &F,
+vector<double> &Jacobian) {
+    double p = params[0];
+    double x = X[0];
+    double y = X[1];
+    F = {pow(x, 2) + 9*pow(y,2)-16, y - pow(x,2) + 2*x -p};
+    Jacobian = {2*x, 18*y, -2*x+2, 1};
+}
+
+/**
+ * Maps the basins of fgJacob one starting point at a time, the way newtons
+ * in Newtons.cpp iterates, to compare with the batched version.
+ *
+ * @param params   Vector of parameter values.
+ * @param n        Number of grid points along each side.
+ * @param roots    Roots of the batched map, used to label the points.
+ * @return         Labels of the points, as in basinMap.
+ */
+vector<int16_t> scalarBasins(vector<double> params, int n,
+vector<vector<double>> roots) {
+    vector<int16_t> labels(size_t (n)*n, -1);
+    vector<double> F, Jacobian;
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            vector<double> X {-6 + x*12.0/(n - 1), 4 - y*8.0/(n - 1)};
+            for (int it = 0; it <= 50; it++) {
+                fgJacob(X, params, F, Jacobian);
+                double r = max(abs(F[0]), abs(F[1]));
+                if (r < 1e-10) {
+                    labels[size_t (y)*n + x] = newtonRootIndex(roots, X,
+                    1e-6);
+                    break;
+                }
+                if (!isfinite(r)) {
+                    break;
+                }
+                double detm = Jacobian[0]*Jacobian[3] -
+                Jacobian[1]*Jacobian[2];
+                X = {X[0] - (F[0]*Jacobian[3] - F[1]*Jacobian[1])/detm,
+                X[1] - (F[1]*Jacobian[0] - F[0]*Jacobian[2])/detm};
+            }
+        }
+    }
+
+    return labels;
+}
+
+/**
+ * Prints the roots and statistics of a basin map, and writes it as a PPM
+ * image and a binary grid.
+ *
+ * @param name     Name of the map, also used for the file names.
+ * @param map      Basin map.
+ * @param seconds  Time taken to compute it.
+ * @return         Nothing.
+ */
+void report(string name, basinMap &map, double seconds) {
+    size_t points = map.labels.size();
+    cout << name << ": " << map.nx << " x " << map.ny << " starting points, ";
+    cout << map.roots.size() << " roots" << endl;
+    for (size_t r = 0; r < map.roots.size(); r++) {
+        long count = 0;
+        for (size_t p = 0; p < points; p++) {
+            count += (map.labels[p] == r);
+        }
+        cout << "    (";
+        for (size_t j = 0; j < map.roots[r].size(); j++) {
+            cout << setprecision(12) << map.roots[r][j];
+            cout << ((j + 1 < map.roots[r].size()) ? ", " : ")");
+        }
+        cout << setprecision(4) << " from " << 100.0*count/points << "%";
+        cout << endl;
+    }
+    cout << "    no convergence from " << map.failed << " points, ";
+    cout << double (map.totalIterations)/points << " iterations per point";
+    cout << endl;
+    cout << "    " << seconds << " s, " << points/seconds/1e6;
+    cout << " million starting points/s" << endl;
+    map.writePPM("NewtonBasins_" + name + ".ppm");
+    map.writeGrid("NewtonBasins_" + name + ".bsn");
+}
+
+/**
+ * Main function. Maps the basins of the system of Newtons.cpp (at p = -0.5,
+ * where it has four roots), of z^3 = 1 and of a 3 x 3 system over n x n
+ * grids of starting points (n is the first argument, default 4096), and
+ * writes each as a PPM image and binary grid. The system of Newtons.cpp is
+ * also solved one point at a time on a smaller grid, to check the batched
+ * labels against and to time. The number of threads can be given as the
+ * second argument (default one per core).
+ */
+int main(int argc, char *argv[]) {
+    int n = (argc > 1) ? atoi(argv[1]) : 4096;
+    int nThreads = (argc > 2) ? atoi(argv[2]) : 0;
+    cout << "SIMD level: " << simdLevel() << endl;
+
+    auto start = chrono::steady_clock::now();
+    basinMap map = newtonBasins(fgJacobBatch, 2, {-0.5}, {0.0, 0.0}, 0, 1,
+    -6, 6, -4, 4, n, n, 1e-10, 50, 1e-6, nThreads);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    report("fgJacob", map, elapsed.count());
+
+    // Scalar reference on a 512 x 512 grid
+    int nRef = min(n, 512);
+    basinMap small = newtonBasins(fgJacobBatch, 2, {-0.5}, {0.0, 0.0}, 0, 1,
+    -6, 6, -4, 4, nRef, nRef, 1e-10, 50, 1e-6, nThreads);
+    start = chrono::steady_clock::now();
+    vector<int16_t> labels = scalarBasins({-0.5}, nRef, small.roots);
+    chrono::duration<double> scalar = chrono::steady_clock::now() - start;
+    long differ = 0;
+    for (size_t p = 0; p < labels.size(); p++) {
+        differ += (labels[p] != small.labels[p]);
+    }
+    cout << "    one point at a time: " << nRef*double (nRef)/
+    scalar.count()/1e6 << " million starting points/s, " << differ;
+    cout << " of " << labels.size() << " labels differ" << endl;
+
+    start = chrono::steady_clock::now();
+    map = newtonBasins(cubicBatch, 2, {}, {0.0, 0.0}, 0, 1, -2, 2, -2, 2, n,
+    n, 1e-10, 50, 1e-6, nThreads);
+    elapsed = chrono::steady_clock::now() - start;
+    report("cubic", map, elapsed.count());
+
+    // Starting points in the plane z = 0
+    start = chrono::steady_clock::now();
+    map = newtonBasins(surfacesBatch, 3, {4.0, -1.0}, {0.0, 0.0, 0.0}, 0, 1,
+    -3, 3, -3, 3, n, n, 1e-10, 50, 1e-6, nThreads);
+    elapsed = chrono::steady_clock::now() - start;
+    report("surfaces", map, elapsed.count());
+}
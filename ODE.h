@@ -1,3 +1,6 @@
+#ifndef ODE_H
+#define ODE_H
+
 // Used to write to file
 #include <fstream>
 // Required for system call later
@@ -6,33 +9,152 @@
 #include <sstream>
 #include <vecOps.h>
 #include <input.h>
+#include <solCache.h>
+#include <multistep.h>
+#include <errorAnalysis.h>
+#include <asyncOutput.h>
+#include <spillStore.h>
+#include <trace.h>
+// Used to hold the CSV writers
+#include <functional>
+#include <memory>
 
 // Load required namespace
 using namespace std;
 
 /**
- * Solution object class.
+ * Counters describing the work done by an adaptive solver.
+ */
+class solverStats {
+    public:
+        // Number of evaluations of the right-hand side
+        long nfev = 0;
+        // Number of accepted and rejected steps
+        long nAccept = 0;
+        long nReject = 0;
+        // Number of Jacobian evaluations and of switches between the 
+        // explicit and implicit methods (method "auto" only)
+        long nJac = 0;
+        long nSwitch = 0;
+};
+
+/**
+ * Solution object class, templated on the scalar type T (float, double, 
+ * long double or ddouble) used for t and X. solClass is the double version.
  */
-class solClass {
+template <typename T>
+class basicSolClass {
     public:
         // Simplest constructor
-        solClass(vector<double>, vector<vector<double>>);
-        // RKF45 constructor
-        solClass(vector<double>(*f)(double, vector<double>, vector<double>), 
-        vector<double>, double, double, vector<double>, double, int, double);
+        basicSolClass(vector<T>, vector<vector<T>>);
+        // Same with t held as a uniformGrid
+        basicSolClass(uniformGrid<T>, vector<vector<T>>);
+        // Adaptive (RKF45, Bulirsch-Stoer, ABM or auto) constructor
+        basicSolClass(vector<T>(*f)(T, vector<T>, vector<T>), vector<T>, 
+        T, T, vector<T>, double tol=1e-9, int itMax=1000000, 
+        T dtInit=1e-1, string method="RKF45");
         // Constructor that uses other methods
-        solClass(vector<double>(*f)(double, vector<double>, vector<double>), 
-        vector<double>, vector<double>, vector<double>, string);
+        basicSolClass(vector<T>(*f)(T, vector<T>, vector<T>), vector<T>, 
+        vector<T>, vector<T>, string method="RK4");
+        // Same on a uniform grid, which is not stored as a vector
+        basicSolClass(vector<T>(*f)(T, vector<T>, vector<T>), vector<T>, 
+        uniformGrid<T>, vector<T>, string method="RK4");
+        // Constructor that restarts an adaptive method from a checkpoint file
+        basicSolClass(vector<T>(*f)(T, vector<T>, vector<T>), string);
         // Write to CSV
         void writeToCSV(int, string, vector<string>);
+        // Accessors
+        const vector<T>& getT();
+        const vector<vector<T>>& getX();
+        // Number of points and point i, without building t for uniform grids
+        size_t size();
+        T tAt(size_t);
+        vector<T> XAt(size_t);
+        // Passes every point to sink in order, without building t or X
+        template <typename Sink>
+        void forEachPoint(Sink&&);
+        // Keep the solution in chunks spilled to disk rather than in memory
+        void setOutOfCore(size_t chunkRows=65536, int window=4, 
+        string dir="/tmp");
+        bool isOutOfCore();
+        // Whether t is held as a uniformGrid, and that grid
+        bool isUniform();
+        const uniformGrid<T>& getGrid();
+        solverStats getStats();
+        // Continue adaptive integration from the last accepted step
+        void extendTo(T);
+        // Write integrator state to a binary checkpoint file
+        void writeCheckpoint(string);
+        // Write a checkpoint every so many accepted steps during extendTo
+        void setAutoCheckpoint(string, int);
+        // Pass every step accepted by extendTo to sink as it is taken
+        void setStepSink(function<void(T, const vector<T>&)>);
  
     private:
         // Solution variables.
         // No compelling reason they need to be private, but they can be.
-        vector<double> t;
-        vector<vector<double>> X;
+        vector<T> t;
+        vector<vector<T>> X;
+        // Uniform grid of a fixed step solution; t is only filled in from it 
+        // if getT is called
+        bool uniform = false;
+        uniformGrid<T> grid;
+        // Rows of an out-of-core solution (copied along with the solution);
+        // t and X are only filled in from it if getT or getX is called
+        spillHandle<T> spill;
+
+        // Adaptive integrator state, needed to continue an integration.
+        string method = "RKF45";
+        vector<T>(*rhs)(T, vector<T>, vector<T>) = nullptr;
+        vector<T> rhsParams;
+        double tol = 1e-9;
+        int itMax = 1000000;
+        // Step size to be tried next
+        T dt = 1e-1;
+        // f at the last accepted step, reused as the first stage of the next
+        vector<T> fLast;
+        // Order to use next (extrapolation columns for Bulirsch-Stoer)
+        int kTarget = 4;
+        // Past (t, f) pairs used by Adams-Bashforth-Moulton
+        adamsHistory<T> hist;
+        // Whether "auto" is using the implicit method, and the numbers of 
+        // recent steps that looked stiff and nonstiff
+        bool stiff = false;
+        int stiffCount = 0;
+        int nonStiffCount = 0;
+        solverStats stats;
+
+        // Auto-checkpointing
+        string checkpointFile;
+        int checkpointEvery = 0;
+        // Called with every accepted step (if set)
+        function<void(T, const vector<T>&)> stepSink;
+
+        // Evaluate the right-hand side, counting the evaluation
+        vector<T> evalRHS(T, const vector<T>&);
+        // Append an accepted step to the solution
+        void acceptStep(T, const vector<T>&);
+        // Last point of the solution
+        T lastT();
+        vector<T> lastX();
+        // Method specific parts of extendTo
+        void extendRKF45(T);
+        void extendBulirschStoer(T);
+        void extendABM(T);
+        void extendAuto(T);
+        // Single RKF45 and Rosenbrock steps of size dt, returning the error
+        double rkf45Step(T, const vector<T>&, vector<T>&, vector<T>&, 
+        vector<T>&);
+        double rosenbrockStep(T, const vector<T>&, vector<T>&, 
+        vector<vector<T>>&);
+        // Finite difference Jacobian df/dX
+        vector<vector<T>> jacobian(T, const vector<T>&);
+        vector<T> rk4Step(T, T, const vector<T>&, const vector<T>&);
+        vector<T> modifiedMidpoint(T, T, const vector<T>&, int);
 };
 
+typedef basicSolClass<double> solClass;
+
 /**
  * Write solution to CSV file.
  * 
@@ -43,13 +165,16 @@ class solClass {
  * @param headings Vector containing headings for each variable to be written 
  * to the file.
  */
-void solClass::writeToCSV(int prec, string filename, vector<string> headings) {
-    if (headings.size() != X[0].size() + 1) {
+template <typename T>
+void basicSolClass<T>::writeToCSV(int prec, string filename, vector<string> headings) {
+    TRACE_ZONE("writeToCSV");
+    size_t nCols = spill ? spill->cols() : X[0].size() + 1;
+    if (headings.size() != nCols) {
         cout << "There should be a heading for t and each variable in the";
         cout << " separate columns of X" << endl;
         throw;
     }
-    int N = t.size();
+    size_t N = size();
 
     // Open file
     ofstream file;
@@ -65,13 +190,214 @@ void solClass::writeToCSV(int prec, string filename, vector<string> headings) {
     }
 
     // Write solution to file
-    for (int i = 0; i < N; i++) {
-        file << t[i] << setprecision(prec) << ",";
+    for (size_t i = 0; i < N; i++) {
+        const T *Xi = spill ? spill->row(i) + 1 : X[i].data();
+        file << tAt(i) << setprecision(prec) << ",";
         for (int j = 1 ; j < headings.size()-1; j++) {
-            file << X[i][j-1] << ",";
+            file << Xi[j-1] << ",";
+        }
+        file << Xi[headings.size()-2] << endl;
+    }
+}
+
+/**
+ * Returns the t values of the solution.
+ * 
+ * @return         t vector.
+ */
+template <typename T>
+const vector<T>& basicSolClass<T>::getT() {
+    // Build t from a uniform grid or the spilled chunks the first time it 
+    // is needed
+    if ((uniform || spill) && t.size() != size()) {
+        t.resize(size());
+        for (size_t i = 0; i < t.size(); i++) {
+            t[i] = tAt(i);
+        }
+    }
+
+    return t;
+}
+
+/**
+ * Returns the number of t values.
+ * 
+ * @return         Number of points in the solution.
+ */
+template <typename T>
+size_t basicSolClass<T>::size() {
+    if (spill) {
+        return spill->size();
+    }
+    return uniform ? grid.size() : t.size();
+}
+
+/**
+ * Returns the ith t value, without building t for a uniform grid.
+ * 
+ * @param i        Index.
+ * @return         t[i].
+ */
+template <typename T>
+T basicSolClass<T>::tAt(size_t i) {
+    if (spill) {
+        return spill->row(i)[0];
+    }
+    return uniform ? grid[i] : t[i];
+}
+
+/**
+ * Returns the ith X value, without building X for an out-of-core solution.
+ * 
+ * @param i        Index.
+ * @return         X[i].
+ */
+template <typename T>
+vector<T> basicSolClass<T>::XAt(size_t i) {
+    if (spill) {
+        const T *row = spill->row(i);
+        return vector<T>(row + 1, row + spill->cols());
+    }
+    return X[i];
+}
+
+/**
+ * Passes every point of the solution to sink in order. For an out-of-core 
+ * solution the chunks are read in sequence (and read ahead), so this is the
+ * way to make analysis passes over solutions larger than memory.
+ * 
+ * @param sink     Called as sink(t[i], X[i]) for every i.
+ * @return         Nothing.
+ */
+template <typename T>
+template <typename Sink>
+void basicSolClass<T>::forEachPoint(Sink &&sink) {
+    if (!spill) {
+        for (size_t i = 0; i < size(); i++) {
+            sink(tAt(i), X[i]);
         }
-        file << X[i][headings.size()-2] << endl;
+        return;
+    }
+    vector<T> Xi(spill->cols() - 1);
+    for (size_t i = 0; i < spill->size(); i++) {
+        const T *row = spill->row(i);
+        copy(row + 1, row + spill->cols(), Xi.begin());
+        sink(row[0], Xi);
+    }
+}
+
+/**
+ * Moves the solution into a spillStore, so that the rows of this and later
+ * steps are kept in chunks written to a temporary file in dir and mapped 
+ * back when read, with at most window chunks in memory. Meant for adaptive 
+ * solutions too large for memory: construct with tf = t0, call this, then 
+ * extendTo(tf). getT and getX still work but read the whole solution into
+ * memory; size, tAt, XAt, forEachPoint and writeToCSV do not.
+ * 
+ * @param chunkRows Number of rows per chunk.
+ * @param window   Largest number of chunks mapped at once.
+ * @param dir      Directory of the temporary file.
+ * @return         Nothing.
+ */
+template <typename T>
+void basicSolClass<T>::setOutOfCore(size_t chunkRows, int window, 
+string dir) {
+    if (spill) {
+        return;
+    }
+    size_t n = size();
+    unique_ptr<spillStore<T>> store(new spillStore<T>(X[0].size() + 1, 
+    chunkRows, window, dir));
+    for (size_t i = 0; i < n; i++) {
+        store->push(tAt(i), X[i]);
+    }
+    spill.reset(store.release());
+    uniform = false;
+    vector<T>().swap(t);
+    vector<vector<T>>().swap(X);
+}
+
+/**
+ * Returns whether the solution is kept out of core.
+ * 
+ * @return         True if so.
+ */
+template <typename T>
+bool basicSolClass<T>::isOutOfCore() {
+    return bool(spill);
+}
+
+/**
+ * Returns the t value of the last point of the solution.
+ * 
+ * @return         Last t value.
+ */
+template <typename T>
+T basicSolClass<T>::lastT() {
+    return spill ? spill->back()[0] : t.back();
+}
+
+/**
+ * Returns the X value of the last point of the solution.
+ * 
+ * @return         Last X value.
+ */
+template <typename T>
+vector<T> basicSolClass<T>::lastX() {
+    if (spill) {
+        return vector<T>(spill->back().begin() + 1, spill->back().end());
     }
+    return X.back();
+}
+
+/**
+ * Returns whether t is held as a uniform grid (a fixed step solution made 
+ * with a uniformGrid).
+ * 
+ * @return         True if so.
+ */
+template <typename T>
+bool basicSolClass<T>::isUniform() {
+    return uniform;
+}
+
+/**
+ * Returns the uniform grid of the solution (only meaningful if isUniform).
+ * 
+ * @return         Grid.
+ */
+template <typename T>
+const uniformGrid<T>& basicSolClass<T>::getGrid() {
+    return grid;
+}
+
+/**
+ * Returns the X values of the solution.
+ * 
+ * @return         2d array of X values; rows correspond to t values.
+ */
+template <typename T>
+const vector<vector<T>>& basicSolClass<T>::getX() {
+    // Read an out-of-core solution into memory the first time it is needed
+    if (spill && X.size() != spill->size()) {
+        X.clear();
+        X.reserve(spill->size());
+        forEachPoint([this](T, const vector<T> &Xi) {
+            X.push_back(Xi);
+        });
+    }
+
+    return X;
+}
+
+/**
+ * Returns the work counters of an adaptive solution.
+ * 
+ * @return         Numbers of RHS evaluations, accepted and rejected steps.
+ */
+template <typename T>
+solverStats basicSolClass<T>::getStats() {
+    return stats;
 }
 
 /**
@@ -80,11 +406,81 @@ void solClass::writeToCSV(int prec, string filename, vector<string> headings) {
  * @param tInput   t vector that the t member variable is to be set to.
  * @param XInput   X vector that the X member variable is to be set to.
  */
-solClass::solClass(vector<double> tInput, vector<vector<double>> XInput) {
+template <typename T>
+basicSolClass<T>::basicSolClass(vector<T> tInput, vector<vector<T>> XInput) {
     t = tInput;
     X = XInput;
 }
 
+/**
+ * Constructor for solClass from a solution on a uniform grid.
+ * 
+ * @param gridInput Time values of the solution.
+ * @param XInput   X vector that the X member variable is to be set to.
+ */
+template <typename T>
+basicSolClass<T>::basicSolClass(uniformGrid<T> gridInput, 
+vector<vector<T>> XInput) {
+    uniform = true;
+    grid = gridInput;
+    X = XInput;
+}
+
+/**
+ * Evaluates f, recorded as an "rhs" zone when detailed tracing is on.
+ * 
+ * @param f        Function that returns dX/dt from the arguments t, X and 
+ * params.
+ * @param t        Time value.
+ * @param X        X at t.
+ * @param params   Vector of parameter values.
+ * @return         dX/dt.
+ */
+template <typename T>
+vector<T> callRHS(vector<T>(*f)(T, vector<T>, vector<T>), T t, 
+const vector<T> &X, const vector<T> &params) {
+    TRACE_DETAIL_ZONE("rhs");
+    return f(t, X, params);
+}
+
+/**
+ * Applies Euler's method to solving the ODE:
+ * dX/dt = f(t, X, params)
+ * where X(t[0]) = X0, passing each point of the solution to sink instead of
+ * storing it.
+ * 
+ * @param f        Function that takes the arguments time value (scalar),
+ * corresponding X array and params and returns dX/dt. 
+ * @param X0       X at t[0].
+ * @param t        Vector of type T consisting of time values we want 
+ * the solution at, or a uniformGrid<T>.
+ * @param params   Vector of type T consisting of parameter values.
+ * @param sink     Called as sink(t[i], X at t[i]) for every i in order, 
+ * starting with (t[0], X0).
+ * @return         X at the last t value.
+ */
+template <typename T, typename Grid, typename Sink>
+vector<T> EulerStream(vector<T>(*f)(T, vector<T>, vector<T>), vector<T> X0, 
+const Grid &t, vector<T> params, Sink &&sink) {
+    TRACE_ZONE("Euler");
+    // Initializing variables
+    T dt;
+    long N = t.size()-1;
+    vector<T> X = X0;
+
+    // First entry should be X0
+    sink(t[0], X);
+
+    // Loop over time values
+    for (long i = 0; i < N; i++) {
+        dt = t[i+1]-t[i];
+        X = vecAdd(X, scalMult(dt, callRHS(f, t[i], X, params)));
+        sink(t[i+1], X);
+    }
+
+    return X;
+}
+
 /**
  * Applies Euler's method to solving the ODE:
  * dX/dt = f(t, X, params)
@@ -93,27 +489,60 @@ solClass::solClass(vector<double> tInput, vector<vector<double>> XInput) {
  * @param f        Function that takes the arguments time value (scalar),
  * corresponding X array and params and returns dX/dt. 
  * @param X0       X at t[0].
- * @param t        Vector of type double consisting of time values we want 
- * the solution at.
- * @param params   Vector of type double consisting of parameter values.
+ * @param t        Vector of type T consisting of time values we want 
+ * the solution at, or a uniformGrid<T>.
+ * @param params   Vector of type T consisting of parameter values.
  * @return         2d array of X values; rows correspond to different t values.
  */
-vector<vector<double>> Euler(vector<double>(*f)(double, vector<double>, 
-vector<double>), vector<double> X0, vector<double> t, vector<double> params) {
+template <typename T, typename Grid=vector<T>>
+vector<vector<T>> Euler(vector<T>(*f)(T, vector<T>, 
+vector<T>), vector<T> X0, const Grid &t, vector<T> params) {
+    vector<vector<T>> X;
+    X.reserve(t.size());
+    EulerStream(f, X0, t, params, [&X](T ti, const vector<T> &Xi) {
+        X.push_back(Xi);
+    });
+
+    return X;
+}
+
+/**
+ * Applies Modified Euler's method to solving the ODE:
+ * dX/dt = f(t, X, params)
+ * where X(t[0]) = X0, passing each point of the solution to sink instead of
+ * storing it.
+ * 
+ * @param f        Function that takes the arguments time value (scalar),
+ * corresponding X array and params and returns dX/dt. 
+ * @param X0       X at t[0].
+ * @param t        Vector of type T consisting of time values we want 
+ * the solution at, or a uniformGrid<T>.
+ * @param params   Vector of type T consisting of parameter values.
+ * @param sink     Called as sink(t[i], X at t[i]) for every i in order, 
+ * starting with (t[0], X0).
+ * @return         X at the last t value.
+ */
+template <typename T, typename Grid, typename Sink>
+vector<T> ModEulerStream(vector<T>(*f)(T, vector<T>, vector<T>), 
+vector<T> X0, const Grid &t, vector<T> params, Sink &&sink) {
+    TRACE_ZONE("ModEuler");
     // Initializing variables
-    double dt;
-    int N = t.size()-1;
-    vector<vector<double>> X;
-    vector<double> nextX;
+    T dt;
+    long N = t.size()-1;
+    int sysSize = X0.size();
+    vector<T> X = X0;
+    vector<T> k1(sysSize), k2(sysSize);
 
     // First entry should be X0
-    X.push_back(X0);
+    sink(t[0], X);
 
     // Loop over time values
-    for (int i = 0; i < N; i++) {
+    for (long i = 0; i < N; i++) {
         dt = t[i+1]-t[i];
-        nextX = vecAdd(X[i], scalMult(dt, f(t[i], X[i], params)));
-        X.push_back(nextX);
+        k1 = scalMult(dt, callRHS(f, t[i], X, params));
+        k2 = scalMult(dt, callRHS(f, t[i+1], vecAdd(X, k1), params));
+        X = vecAdd(X, scalMult(0.5, vecAdd(k1, k2)));
+        sink(t[i+1], X);
     }
 
     return X;
@@ -127,30 +556,65 @@ vector<double>), vector<double> X0, vector<double> t, vector<double> params) {
  * @param f        Function that takes the arguments time value (scalar),
  * corresponding X array and params and returns dX/dt. 
  * @param X0       X at t[0].
- * @param t        Vector of type double consisting of time values we want 
- * the solution at.
- * @param params   Vector of type double consisting of parameter values.
+ * @param t        Vector of type T consisting of time values we want 
+ * the solution at, or a uniformGrid<T>.
+ * @param params   Vector of type T consisting of parameter values.
  * @return         2d array of X values; rows correspond to different t values.
  */
-vector<vector<double>> ModEuler(vector<double>(*f)(double, vector<double>, 
-vector<double>), vector<double> X0, vector<double> t, vector<double> params) {
+template <typename T, typename Grid=vector<T>>
+vector<vector<T>> ModEuler(vector<T>(*f)(T, vector<T>, 
+vector<T>), vector<T> X0, const Grid &t, vector<T> params) {
+    vector<vector<T>> X;
+    X.reserve(t.size());
+    ModEulerStream(f, X0, t, params, [&X](T ti, const vector<T> &Xi) {
+        X.push_back(Xi);
+    });
+
+    return X;
+}
+
+/**
+ * Applies Runge-Kutta fourth-order method to solving the ODE:
+ * dX/dt = f(t, X, params)
+ * where X(t[0]) = X0, passing each point of the solution to sink instead of
+ * storing it.
+ * 
+ * @param f        Function that takes the arguments time value (scalar),
+ * corresponding X array and params and returns dX/dt. 
+ * @param X0       X at t[0].
+ * @param t        Vector of type T consisting of time values we want 
+ * the solution at, or a uniformGrid<T>.
+ * @param params   Vector of type T consisting of parameter values.
+ * @param sink     Called as sink(t[i], X at t[i]) for every i in order, 
+ * starting with (t[0], X0).
+ * @return         X at the last t value.
+ */
+template <typename T, typename Grid, typename Sink>
+vector<T> RK4Stream(vector<T>(*f)(T, vector<T>, vector<T>), vector<T> X0, 
+const Grid &t, vector<T> params, Sink &&sink) {
+    TRACE_ZONE("RK4");
     // Initializing variables
-    double dt;
-    int N = t.size()-1;
+    T dt;
+    long N = t.size()-1;
     int sysSize = X0.size();
-    vector<vector<double>> X;
-    vector<double> nextX(sysSize), k1(sysSize), k2(sysSize);
+    vector<T> X = X0;
+    vector<T> k1(sysSize), k2(sysSize), k3(sysSize), k4(sysSize);
 
     // First entry should be X0
-    X.push_back(X0);
+    sink(t[0], X);
 
     // Loop over time values
-    for (int i = 0; i < N; i++) {
+    for (long i = 0; i < N; i++) {
         dt = t[i+1]-t[i];
-        k1 = scalMult(dt, f(t[i], X[i], params));
-        k2 = scalMult(dt, f(t[i+1], vecAdd(X[i], k1), params));
-        nextX = vecAdd(X[i], scalMult(0.5, vecAdd(k1, k2)));
-        X.push_back(nextX);
+        k1 = scalMult(dt, callRHS(f, t[i], X, params));
+        k2 = scalMult(dt, callRHS(f, t[i]+dt/2, vecAdd(X, 
+        scalMult(0.5, k1)), params));
+        k3 = scalMult(dt, callRHS(f, t[i]+dt/2, vecAdd(X, 
+        scalMult(0.5, k2)), params));
+        k4 = scalMult(dt, callRHS(f, t[i]+dt, vecAdd(X, k3), params));
+        X = vecAdd(X, scalMult(T(1)/6, vecAdd(vecAdd(vecAdd(k1, 
+        scalMult(2, k2)), scalMult(2, k3)), k4)));
+        sink(t[i+1], X);
     }
 
     return X;
@@ -164,39 +628,169 @@ vector<double>), vector<double> X0, vector<double> t, vector<double> params) {
  * @param f        Function that takes the arguments time value (scalar),
  * corresponding X array and params and returns dX/dt. 
  * @param X0       X at t[0].
- * @param t        Vector of type double consisting of time values we want 
- * the solution at.
- * @param params   Vector of type double consisting of parameter values.
+ * @param t        Vector of type T consisting of time values we want 
+ * the solution at, or a uniformGrid<T>.
+ * @param params   Vector of type T consisting of parameter values.
  * @return         2d array of X values; rows correspond to different t values.
  */
-vector<vector<double>> RK4(vector<double>(*f)(double, vector<double>, 
-vector<double>), vector<double> X0, vector<double> t, vector<double> params) {
+template <typename T, typename Grid=vector<T>>
+vector<vector<T>> RK4(vector<T>(*f)(T, vector<T>, 
+vector<T>), vector<T> X0, const Grid &t, vector<T> params) {
+    vector<vector<T>> X;
+    X.reserve(t.size());
+    RK4Stream(f, X0, t, params, [&X](T ti, const vector<T> &Xi) {
+        X.push_back(Xi);
+    });
+
+    return X;
+}
+
+/**
+ * Applies the variable step Adams-Bashforth-Moulton predictor-corrector 
+ * method (in PECE mode, so two evaluations of f per step) to solving the 
+ * ODE:
+ * dX/dt = f(t, X, params)
+ * where X(t[0]) = X0, passing each point of the solution to sink instead of
+ * storing it. The first order-1 steps are taken with RK4 to fill the
+ * history.
+ * 
+ * @param f        Function that takes the arguments time value (scalar),
+ * corresponding X array and params and returns dX/dt. 
+ * @param X0       X at t[0].
+ * @param t        Vector of type T consisting of time values we want 
+ * the solution at (need not be evenly spaced), or a uniformGrid<T>.
+ * @param params   Vector of type T consisting of parameter values.
+ * @param sink     Called as sink(t[i], X at t[i]) for every i in order, 
+ * starting with (t[0], X0).
+ * @param order    Order of the predictor and corrector (1 to 6).
+ * @return         X at the last t value.
+ */
+template <typename T, typename Grid, typename Sink>
+vector<T> ABMStream(vector<T>(*f)(T, vector<T>, vector<T>), vector<T> X0, 
+const Grid &t, vector<T> params, Sink &&sink, int order=4) {
+    TRACE_ZONE("ABM");
     // Initializing variables
-    double dt;
-    int N = t.size()-1;
-    int sysSize = X0.size();
-    vector<vector<double>> X;
-    vector<double> nextX(sysSize), k1(sysSize), k2(sysSize), k3(sysSize);
-    vector<double> k4(sysSize);
+    T dt;
+    long N = t.size()-1;
+    vector<T> X = X0;
+    vector<T> k1, k2, k3, k4, XP, fP;
+    adamsHistory<T> hist(order);
 
     // First entry should be X0
-    X.push_back(X0);
+    sink(t[0], X);
+    hist.push(t[0], callRHS(f, t[0], X0, params));
 
     // Loop over time values
-    for (int i = 0; i < N; i++) {
+    for (long i = 0; i < N; i++) {
         dt = t[i+1]-t[i];
-        k1 = scalMult(dt, f(t[i], X[i], params));
-        k2 = scalMult(dt, f(t[i]+dt/2, vecAdd(X[i], scalMult(0.5, k1)), params));
-        k3 = scalMult(dt, f(t[i]+dt/2, vecAdd(X[i], scalMult(0.5, k2)), params));
-        k4 = scalMult(dt, f(t[i]+dt, vecAdd(X[i], k3), params));
-        nextX = vecAdd(X[i], scalMult(1.0/6.0, vecAdd(vecAdd(vecAdd(k1, 
-        scalMult(2, k2)), scalMult(2, k3)), k4)));
-        X.push_back(nextX);
+        if (i < order-1) {
+            // Bootstrap with RK4 until the history holds order points
+            k1 = scalMult(dt, hist.fAt(0));
+            k2 = scalMult(dt, callRHS(f, t[i]+dt/2, vecAdd(X, 
+            scalMult(0.5, k1)), params));
+            k3 = scalMult(dt, callRHS(f, t[i]+dt/2, vecAdd(X, 
+            scalMult(0.5, k2)), params));
+            k4 = scalMult(dt, callRHS(f, t[i]+dt, vecAdd(X, k3), params));
+            X = vecAdd(X, scalMult(T(1)/6, vecAdd(vecAdd(vecAdd(k1, 
+            scalMult(2, k2)), scalMult(2, k3)), k4)));
+        } else {
+            // Predict, evaluate, correct
+            XP = vecAdd(X, adamsBashforth(hist, order, t[i+1]));
+            fP = callRHS(f, t[i+1], XP, params);
+            X = vecAdd(X, adamsMoulton(hist, order, t[i+1], fP));
+        }
+        sink(t[i+1], X);
+
+        // Evaluate at the corrected value for the next step
+        hist.push(t[i+1], callRHS(f, t[i+1], X, params));
     }
 
     return X;
 }
 
+/**
+ * Applies the variable step Adams-Bashforth-Moulton predictor-corrector 
+ * method (in PECE mode, so two evaluations of f per step) to solving the 
+ * ODE:
+ * dX/dt = f(t, X, params)
+ * where X(t[0]) = X0. The first order-1 steps are taken with RK4 to fill the
+ * history.
+ * 
+ * @param f        Function that takes the arguments time value (scalar),
+ * corresponding X array and params and returns dX/dt. 
+ * @param X0       X at t[0].
+ * @param t        Vector of type T consisting of time values we want 
+ * the solution at (need not be evenly spaced), or a uniformGrid<T>.
+ * @param params   Vector of type T consisting of parameter values.
+ * @param order    Order of the predictor and corrector (1 to 6).
+ * @return         2d array of X values; rows correspond to different t values.
+ */
+template <typename T, typename Grid=vector<T>>
+vector<vector<T>> ABM(vector<T>(*f)(T, vector<T>, 
+vector<T>), vector<T> X0, const Grid &t, vector<T> params,
+int order=4) {
+    vector<vector<T>> X;
+    X.reserve(t.size());
+    ABMStream(f, X0, t, params, [&X](T ti, const vector<T> &Xi) {
+        X.push_back(Xi);
+    }, order);
+
+    return X;
+}
+
+/**
+ * Solves dX/dt = f(t, X, params) with a fixed step method, passing each
+ * point to sink instead of storing it.
+ *
+ * @param f        Function that returns dX/dt from the arguments t, X and
+ * params.
+ * @param X0       X at t[0].
+ * @param t        Time values (a vector or a uniformGrid).
+ * @param params   Vector of parameter values.
+ * @param method   "Euler", "ModEuler", "RK4" or "ABM".
+ * @param sink     Called as sink(t[i], X at t[i]) for every i.
+ * @return         X at the last t value.
+ */
+template <typename T, typename Grid, typename Sink>
+vector<T> fixedStepStream(vector<T>(*f)(T, vector<T>, vector<T>), 
+const vector<T> &X0, const Grid &t, const vector<T> &params, string method, 
+Sink &&sink) {
+    if (method == "Euler") {
+        return EulerStream(f, X0, t, params, sink);
+    } else if (method == "ModEuler") {
+        return ModEulerStream(f, X0, t, params, sink);
+    } else if (method == "RK4") {
+        return RK4Stream(f, X0, t, params, sink);
+    } else if (method == "ABM") {
+        return ABMStream(f, X0, t, params, sink, 4);
+    }
+    throw runtime_error("No fixed step method called " + method);
+}
+
+/**
+ * Returns whether fixedStepStream has a method called method, so that code
+ * running it on other threads can reject a bad name up front.
+ *
+ * @param method   Name of method.
+ * @return         True for "Euler", "ModEuler", "RK4" and "ABM".
+ */
+bool isFixedStepMethod(string method) {
+    return method == "Euler" || method == "ModEuler" || method == "RK4" ||
+    method == "ABM";
+}
+
+/**
+ * Returns whether the adaptive constructor of basicSolClass (and extendTo)
+ * has a method called method.
+ *
+ * @param method   Name of method.
+ * @return         True for "RKF45", "BulirschStoer", "ABM" and "auto".
+ */
+bool isAdaptiveMethod(string method) {
+    return method == "RKF45" || method == "BulirschStoer" || 
+    method == "ABM" || method == "auto";
+}
+
 /**
  * Applies the Runge-Kutta-Fehlberg 4/5th order method to solving the ODE:
  * dX/dt = f(t, X, params)
@@ -207,7 +801,7 @@ vector<double>), vector<double> X0, vector<double> t, vector<double> params) {
  * @param X0       X at t0.
  * @param t0       Starting t value.
  * @param tf       Final t value.
- * @param params   Vector of type double consisting of parameter values.
+ * @param params   Vector of type T consisting of parameter values.
  * @param tol      A double representing the error tolerance to be used 
  * (default=1e-9).
  * @param itMax    An integer representing the maximum number of iterations 
@@ -215,61 +809,154 @@ vector<double>), vector<double> X0, vector<double> t, vector<double> params) {
  * @param dtInit   Initial guess for dt. 
  * @return         Object of type solClass containing computed t and X values.
  */
-solClass RKF45(vector<double>(*f)(double, vector<double>, vector<double>), 
-vector<double> X0, double t0, double tf, vector<double> params, 
-double tol=1e-9, int itMax=1000000, double dtInit=1e-1) {
-    // Initialize required vectors
-    vector<double> t;
-    vector<vector<double>> X;
-    vector<double> k1, k2X, k2, k3X, k3, k4X, k4, k5X, k5, k6X, k6, X1, X2, RX;
+template <typename T>
+basicSolClass<T> RKF45(vector<T>(*f)(T, vector<T>, vector<T>), 
+vector<T> X0, sameType<T> t0, sameType<T> tf, vector<T> params, 
+double tol=1e-9, int itMax=1000000, sameType<T> dtInit=1e-1) {
+    // Write to solution object
+    basicSolClass<T> solution(f, X0, t0, tf, params, tol, itMax, dtInit, "RKF45");
 
-    // Add first entries to t and X
-    t.push_back(t0);
-    X.push_back(X0);
+    return solution;
+}
+
+/**
+ * Applies the Bulirsch-Stoer method (Gragg's modified midpoint rule with 
+ * polynomial extrapolation in the step size squared, adaptive in both order 
+ * and step size) to solving the ODE:
+ * dX/dt = f(t, X, params)
+ * where X(t0) = X0. Each step keeps the error in every component below 
+ * tol*(1+|X|), so tol acts as a relative tolerance for large components.
+ * 
+ * @param f        Function that takes the arguments time value (scalar),
+ * corresponding X array and params and returns dX/dt. 
+ * @param X0       X at t0.
+ * @param t0       Starting t value.
+ * @param tf       Final t value.
+ * @param params   Vector of type T consisting of parameter values.
+ * @param tol      A double representing the error tolerance to be used 
+ * (default=1e-12).
+ * @param itMax    An integer representing the maximum number of iterations 
+ * allowable.
+ * @param dtInit   Initial guess for dt. 
+ * @return         Object of type solClass containing computed t and X values.
+ */
+template <typename T>
+basicSolClass<T> BulirschStoer(vector<T>(*f)(T, vector<T>, 
+vector<T>), vector<T> X0, sameType<T> t0, sameType<T> tf, 
+vector<T> params, double tol=1e-12, int itMax=1000000, 
+sameType<T> dtInit=1e-1) {
+    // Write to solution object
+    basicSolClass<T> solution(f, X0, t0, tf, params, tol, itMax, dtInit, 
+    "BulirschStoer");
+
+    return solution;
+}
+
+/**
+ * Evaluates the right-hand side and counts the evaluation.
+ * 
+ * @param ti       Time value.
+ * @param Xi       State.
+ * @return         dX/dt.
+ */
+template <typename T>
+vector<T> basicSolClass<T>::evalRHS(T ti, const vector<T> &Xi) {
+    TRACE_DETAIL_ZONE("rhs");
+    stats.nfev++;
+
+    return rhs(ti, Xi, rhsParams);
+}
+
+/**
+ * Appends an accepted step to t and X, passes it to the step sink, evaluates 
+ * f there for the next step and writes a checkpoint if one is due.
+ * 
+ * @param ti       Time at the end of the step.
+ * @param Xi       State at the end of the step.
+ * @return         Nothing.
+ */
+template <typename T>
+void basicSolClass<T>::acceptStep(T ti, const vector<T> &Xi) {
+    if (spill) {
+        spill->push(ti, Xi);
+    } else {
+        t.push_back(ti);
+        X.push_back(Xi);
+    }
+    if (stepSink) {
+        stepSink(ti, Xi);
+    }
+    fLast = evalRHS(ti, Xi);
+    stats.nAccept++;
+    if (method == "ABM") {
+        hist.push(ti, fLast);
+    }
+
+    // Periodic checkpoint for long runs
+    if ((checkpointEvery > 0) && (stats.nAccept % checkpointEvery == 0)) {
+        writeCheckpoint(checkpointFile);
+    }
+}
+
+/**
+ * Continues the adaptive integration from the last accepted step up to tf, 
+ * appending the new steps to t and X. At most itMax steps are accepted per 
+ * call.
+ * 
+ * @param tf       Final t value.
+ * @return         Nothing.
+ */
+template <typename T>
+void basicSolClass<T>::extendTo(T tf) {
+    if (rhs == nullptr) {
+        throw runtime_error("extendTo requires a solution computed by an "
+        "adaptive method");
+    }
+
+    // Derivative at the last accepted step, unless the checkpoint had it
+    if (fLast.size() != lastX().size()) {
+        fLast = evalRHS(lastT(), lastX());
+    }
+
+    if (method == "RKF45") {
+        extendRKF45(tf);
+    } else if (method == "BulirschStoer") {
+        extendBulirschStoer(tf);
+    } else if (method == "ABM") {
+        extendABM(tf);
+    } else if (method == "auto") {
+        extendAuto(tf);
+    } else {
+        throw runtime_error("No adaptive method called " + method);
+    }
+}
+
+/**
+ * RKF45 part of extendTo.
+ * 
+ * @param tf       Final t value.
+ * @return         Nothing.
+ */
+template <typename T>
+void basicSolClass<T>::extendRKF45(T tf) {
+    TRACE_ZONE("RKF45");
+    // Initialize required vectors
+    vector<T> X1, k5X, f5;
+    vector<T> Xi = lastX();
+    T ti = lastT();
 
     // Initialize scalar variables
     double R;
     int i = 0;
     double s;
-    double dt = dtInit;
 
     // Loop over time until either t[i] = tf is reached or we exceed the 
     // maximum number of iterations.
-    while ( ( t[i] < tf ) && (i < itMax)) {
-        dt = std::min(dt, tf-t[i]);
-
-        // Predictor-correctors
-        k1 = scalMult(dt, f(t[i], X[i], params));
-        k2X = vecAdd(X[i], scalMult(1.0/4.0, k1));
-        k2 = scalMult(dt, f(t[i] + dt/4.0, k2X, params));
-        k3X = vecAdd(vecAdd(X[i], scalMult(3.0/32.0, k1)), 
-        scalMult(9.0/32.0, k2));
-        k3 = scalMult(dt, f(t[i] + 3.0*dt/8.0, k3X, params));
-        k4X = vecAdd(vecAdd(vecAdd(X[i], scalMult(1932.0/2197.0, k1)), 
-        scalMult(-7200.0/2197.0, k2)), scalMult(7296.0/2197.0, k3));
-        k4 = scalMult(dt, f(t[i] + 12.0*dt/13.0, k4X, params));
-        k5X = vecAdd(vecAdd(vecAdd(vecAdd(X[i], scalMult(439.0/216.0, k1)), 
-        scalMult(-8.0, k2)), scalMult(3680.0/513.0, k3)), 
-        scalMult(-845.0/4104.0, k4));
-        k5 = scalMult(dt, f(t[i]+dt, k5X, params));
-        k6X = vecAdd(vecAdd(vecAdd(vecAdd(vecAdd(X[i], 
-        scalMult(-8.0/27.0, k1)), scalMult(2.0, k2)), 
-        scalMult(-3544.0/2565.0, k3)), scalMult(1859.0/4104.0, k4)), 
-        scalMult(-11.0/40.0, k5));
-        k6 = scalMult(dt, f(t[i]+dt/2.0, k6X, params));
-
-        // 4th and 5th order approximation to X[i+1]
-        X1 = vecAdd(vecAdd(vecAdd(vecAdd(X[i], scalMult(25.0/216.0, k1)), 
-        scalMult(1408.0/2565.0, k3)), scalMult(2197.0/4104.0, k4)), 
-        scalMult(-1.0/5.0, k5));
-        X2 = vecAdd(vecAdd(vecAdd(vecAdd(vecAdd(X[i], 
-        scalMult(16.0/135.0, k1)), scalMult(6656.0/12825.0, k3)), 
-        scalMult(28561.0/56430.0, k4)), scalMult(-9.0/50.0, k5)), 
-        scalMult(2.0/55.0, k6));
-
-        // Measure of error in X1
-        RX = scalMult(pow(dt, -1), vecAbs(vecAdd(X1, scalMult(-1.0, X2))));
-        R = *max_element(RX.begin(), RX.end());
+    while ( ( ti < tf ) && (i < itMax)) {
+        // Whether this step has been cut short to land on tf
+        bool last = tf-ti <= dt;
+        dt = std::min(dt, tf-ti);
+        R = rkf45Step(ti, Xi, X1, k5X, f5);
 
         // Adjust step size scaling factor according to R
         if (R != 0) {
@@ -278,21 +965,709 @@ double tol=1e-9, int itMax=1000000, double dtInit=1e-1) {
             s = 1.0;
         }
 
+        // The step cut short to land on tf can leave so little of the 
+        // interval that the difference between the two solutions is at the 
+        // rounding level of X, which shrinking dt cannot reduce (it would be 
+        // rejected forever), so such a final step is accepted
+        if (last && R > tol && numeric_limits<T>::is_specialized) {
+            vector<T> absX = vecAbs(X1);
+            double roundoff = 8*double(numeric_limits<T>::epsilon())*
+            double(*max_element(absX.begin(), absX.end()))/double(dt);
+            if (R <= roundoff) {
+                R = tol;
+                s = 1.0;
+            }
+        }
+
         // If R is below error tolerance move on to next step
         if (R <= tol) {
-            t.push_back(t[i]+dt);
-            X.push_back(X1);
+            ti += dt;
+            Xi = X1;
             i++;
+        } else {
+            stats.nReject++;
         }
 
         // Adjust step size by scaling factor
         dt *= s;
+
+        if (R <= tol) {
+            acceptStep(ti, Xi);
+        }
     }
+}
 
-    // Write to solution object
-    solClass solution(t, X);
+/**
+ * Takes one RKF45 step of size dt from (ti, Xi), using fLast as f(ti, Xi).
+ * 
+ * @param ti       Time at the start of the step.
+ * @param Xi       State at the start of the step.
+ * @param X1       Set to the fourth order solution at ti+dt.
+ * @param k5X      Set to the state of the fifth stage, also at ti+dt.
+ * @param f5       Set to f at k5X.
+ * @return         Error measure max|X1 - X2|/dt, X2 being the fifth order 
+ * solution.
+ */
+template <typename T>
+double basicSolClass<T>::rkf45Step(T ti, const vector<T> &Xi, vector<T> &X1,
+vector<T> &k5X, vector<T> &f5) {
+    vector<T> k1, k2X, k2, k3X, k3, k4X, k4, k5, k6X, k6, X2, RX;
 
-    return solution;
+    // Predictor-correctors
+    k1 = scalMult(dt, fLast);
+    k2X = vecAdd(Xi, scalMult(T(1)/4, k1));
+    k2 = scalMult(dt, evalRHS(ti + dt/4.0, k2X));
+    k3X = vecAdd(vecAdd(Xi, scalMult(T(3)/32, k1)), 
+    scalMult(T(9)/32, k2));
+    k3 = scalMult(dt, evalRHS(ti + 3.0*dt/8.0, k3X));
+    k4X = vecAdd(vecAdd(vecAdd(Xi, scalMult(T(1932)/2197, k1)), 
+    scalMult(-T(7200)/2197, k2)), scalMult(T(7296)/2197, k3));
+    k4 = scalMult(dt, evalRHS(ti + 12.0*dt/13.0, k4X));
+    k5X = vecAdd(vecAdd(vecAdd(vecAdd(Xi, scalMult(T(439)/216, k1)), 
+    scalMult(-8.0, k2)), scalMult(T(3680)/513, k3)), 
+    scalMult(-T(845)/4104, k4));
+    f5 = evalRHS(ti+dt, k5X);
+    k5 = scalMult(dt, f5);
+    k6X = vecAdd(vecAdd(vecAdd(vecAdd(vecAdd(Xi, 
+    scalMult(-T(8)/27, k1)), scalMult(2.0, k2)), 
+    scalMult(-T(3544)/2565, k3)), scalMult(T(1859)/4104, k4)), 
+    scalMult(-T(11)/40, k5));
+    k6 = scalMult(dt, evalRHS(ti+dt/2.0, k6X));
+
+    // 4th and 5th order approximation to X[i+1]
+    X1 = vecAdd(vecAdd(vecAdd(vecAdd(Xi, scalMult(T(25)/216, k1)), 
+    scalMult(T(1408)/2565, k3)), scalMult(T(2197)/4104, k4)), 
+    scalMult(-T(1)/5, k5));
+    X2 = vecAdd(vecAdd(vecAdd(vecAdd(vecAdd(Xi, 
+    scalMult(T(16)/135, k1)), scalMult(T(6656)/12825, k3)), 
+    scalMult(T(28561)/56430, k4)), scalMult(-T(9)/50, k5)), 
+    scalMult(T(2)/55, k6));
+
+    // Measure of error in X1
+    RX = scalMult(T(1)/dt, vecAbs(vecAdd(X1, scalMult(-1.0, X2))));
+
+    return double(*max_element(RX.begin(), RX.end()));
+}
+
+/**
+ * Applies Gragg's modified midpoint rule with n substeps over [ti, ti+H], 
+ * starting from the derivative fLast at ti.
+ * 
+ * @param ti       Time at the start of the step.
+ * @param H        Step size.
+ * @param Xi       State at ti.
+ * @param n        Number of substeps (even).
+ * @return         Approximation to X(ti+H).
+ */
+template <typename T>
+vector<T> basicSolClass<T>::modifiedMidpoint(T ti, T H, 
+const vector<T> &Xi, int n) {
+    T h = H/n;
+    vector<T> zPrev = Xi;
+    vector<T> z = vecAdd(Xi, scalMult(h, fLast));
+    vector<T> zNext;
+
+    for (int m = 1; m < n; m++) {
+        zNext = vecAdd(zPrev, scalMult(2*h, evalRHS(ti + m*h, z)));
+        zPrev = z;
+        z = zNext;
+    }
+
+    // Gragg's smoothing step
+    return scalMult(0.5, vecAdd(vecAdd(z, zPrev), 
+    scalMult(h, evalRHS(ti + H, z))));
+}
+
+/**
+ * Bulirsch-Stoer part of extendTo. Each step builds the extrapolation 
+ * tableau from modified midpoint solutions with n_j = 2j substeps, accepting 
+ * once the difference between the last two diagonal entries is below 
+ * tol*(1+|X|). The number of columns and next step size are then chosen to 
+ * minimise the RHS evaluations per unit time (Hairer & Wanner's ODEX 
+ * strategy).
+ * 
+ * @param tf       Final t value.
+ * @return         Nothing.
+ */
+template <typename T>
+void basicSolClass<T>::extendBulirschStoer(T tf) {
+    TRACE_ZONE("BulirschStoer");
+    // Step number sequence n_j = 2j and work A_j to compute column j
+    const int kMax = 8;
+    vector<int> nSeq(kMax+1);
+    vector<T> work(kMax+1);
+    for (int j = 1; j <= kMax; j++) {
+        nSeq[j] = 2*j;
+        work[j] = (j == 1 ? 1 : work[j-1]) + nSeq[j];
+    }
+
+    // Initialize variables
+    vector<T> Xi = lastX();
+    T ti = lastT();
+    int i = 0;
+    vector<vector<T>> row, prevRow;
+    vector<T> dtNew(kMax+1);
+
+    while ( ( ti < tf ) && (i < itMax)) {
+        T H = std::min(dt, tf-ti);
+        int kAccept = 0;
+        int jLast = std::min(kTarget+1, kMax);
+
+        for (int j = 1; j <= jLast; j++) {
+            // Aitken-Neville extrapolation in H^2 of the midpoint solutions
+            row.assign(j, vector<T>());
+            row[0] = modifiedMidpoint(ti, H, Xi, nSeq[j]);
+            for (int k = 1; k < j; k++) {
+                T ratio = T(nSeq[j])/nSeq[j-k];
+                ratio = ratio*ratio - 1;
+                row[k] = vecAdd(row[k-1], scalMult(1/ratio, 
+                vecAdd(row[k-1], scalMult(-1.0, prevRow[k-1]))));
+            }
+            prevRow = row;
+            if (j == 1) {
+                continue;
+            }
+
+            // Scaled error estimate of column j and the step it suggests
+            double err = 0;
+            for (int c = 0; c < Xi.size(); c++) {
+                double sc = tol*(1 + double(std::max(abs(Xi[c]), 
+                abs(row[j-1][c]))));
+                err = std::max(err, double(abs(row[j-1][c] - row[j-2][c]))/sc);
+            }
+            double fac = 4.0;
+            if (err > 0) {
+                fac = 0.94*pow(0.65/err, 1.0/(2*j-1));
+                fac = std::min(4.0, std::max(0.02, fac));
+            }
+            dtNew[j] = H*fac;
+
+            // Only accept within one column of the target order
+            if (j >= kTarget-1 && err <= 1) {
+                kAccept = j;
+                break;
+            }
+        }
+
+        if (kAccept == 0) {
+            stats.nReject++;
+            dt = dtNew[jLast];
+            continue;
+        }
+        ti += H;
+        Xi = row[kAccept-1];
+        i++;
+
+        // Next order is the one with the least work per unit step
+        int kBest = 2;
+        for (int k = 3; k <= kAccept; k++) {
+            if (work[k]/dtNew[k] < work[kBest]/dtNew[kBest]) {
+                kBest = k;
+            }
+        }
+        dt = dtNew[kBest];
+        if (kBest == kAccept && kAccept < kMax-1) {
+            // Converged in the last column computed, so try one more
+            kBest++;
+            dt = dtNew[kAccept]*work[kBest]/work[kAccept];
+        }
+        kTarget = std::max(2, std::min(kBest, kMax-1));
+
+        acceptStep(ti, Xi);
+    }
+}
+
+/**
+ * Takes one RK4 step of size h from (ti, Xi), given f0 = f(ti, Xi).
+ * 
+ * @param ti       Time at the start of the step.
+ * @param h        Step size.
+ * @param Xi       State at ti.
+ * @param f0       f at (ti, Xi).
+ * @return         Approximation to X(ti+h).
+ */
+template <typename T>
+vector<T> basicSolClass<T>::rk4Step(T ti, T h, const vector<T> &Xi,
+const vector<T> &f0) {
+    vector<T> k1 = scalMult(h, f0);
+    vector<T> k2 = scalMult(h, evalRHS(ti+h/2, vecAdd(Xi, 
+    scalMult(0.5, k1))));
+    vector<T> k3 = scalMult(h, evalRHS(ti+h/2, vecAdd(Xi, 
+    scalMult(0.5, k2))));
+    vector<T> k4 = scalMult(h, evalRHS(ti+h, vecAdd(Xi, k3)));
+
+    return vecAdd(Xi, scalMult(T(1)/6, vecAdd(vecAdd(vecAdd(k1, 
+    scalMult(2, k2)), scalMult(2, k3)), k4)));
+}
+
+/**
+ * Adams-Bashforth-Moulton part of extendTo. The first three steps are RK4 
+ * steps whose error is estimated by step doubling; after that each step is a
+ * PECE step whose error is estimated with Milne's device. The orders either
+ * side of the current one are estimated from the same f values, and the 
+ * order allowing the largest next step is used (at most 5). Errors are kept 
+ * below tol*(1+|X|) in every component.
+ * 
+ * @param tf       Final t value.
+ * @return         Nothing.
+ */
+template <typename T>
+void basicSolClass<T>::extendABM(T tf) {
+    TRACE_ZONE("ABM");
+    // Initialize variables
+    const int kMax = 5;
+    const int nBoot = 4;
+    vector<T> Xi = lastX();
+    T ti = lastT();
+    int i = 0;
+
+    // Start a fresh history unless this continues an ABM integration
+    if (hist.capacity == 0) {
+        hist = adamsHistory<T>(kMax+1);
+        hist.push(ti, fLast);
+    }
+
+    // Scaled max-norm of the error estimate diff*factor
+    auto scaledErr = [&](const vector<T> &diff, 
+    const vector<T> &Xnew, double factor) {
+        double err = 0;
+        for (int c = 0; c < Xnew.size(); c++) {
+            double sc = tol*(1 + double(std::max(abs(Xi[c]), abs(Xnew[c]))));
+            err = std::max(err, factor*double(abs(diff[c]))/sc);
+        }
+        return err;
+    };
+
+    while ( ( ti < tf ) && (i < itMax)) {
+        T H = std::min(dt, tf-ti);
+        T tNew = ti + H;
+        vector<T> XNew;
+        double fac;
+
+        if (hist.size() < nBoot) {
+            // RK4 bootstrap, one step of H against two of H/2
+            vector<T> full = rk4Step(ti, H, Xi, fLast);
+            vector<T> half = rk4Step(ti, H/2, Xi, fLast);
+            half = rk4Step(ti+H/2, H/2, half, evalRHS(ti+H/2, half));
+            double err = scaledErr(vecAdd(half, scalMult(-1.0, full)), half,
+            1.0/15.0);
+            fac = err > 0 ? 0.9*pow(err, -0.2) : 4.0;
+            dt = H*std::min(4.0, std::max(0.2, fac));
+            if (err > 1) {
+                stats.nReject++;
+                continue;
+            }
+            XNew = half;
+            kTarget = nBoot;
+        } else {
+            // Predict and evaluate at orders k-1, k and k+1
+            int k = std::min(kTarget, hist.size());
+            int kHigh = std::min(std::min(k+1, kMax), hist.size());
+            vector<T> XP = vecAdd(Xi, adamsBashforth(hist, k, tNew));
+            vector<T> fP = evalRHS(tNew, XP);
+            double bestFac = 0;
+            int bestK = k;
+            double err = 0;
+            for (int j = std::max(1, k-1); j <= kHigh; j++) {
+                vector<T> XPj = j == k ? XP : 
+                vecAdd(Xi, adamsBashforth(hist, j, tNew));
+                vector<T> XCj = vecAdd(Xi, adamsMoulton(hist, j, tNew, 
+                fP));
+                double errj = scaledErr(vecAdd(XCj, scalMult(-1.0, XPj)), 
+                XCj, adamsMilneFactor(j));
+                double facj = errj > 0 ? 0.9*pow(errj, -1.0/(j+1)) : 2.0;
+                if (j == k) {
+                    err = errj;
+                    XNew = XCj;
+                    fac = facj;
+                }
+                if (facj > bestFac) {
+                    bestFac = facj;
+                    bestK = j;
+                }
+            }
+
+            // Correct, or retry with a smaller step at the same order
+            if (err > 1) {
+                stats.nReject++;
+                dt = H*std::max(0.2, fac);
+                continue;
+            }
+            kTarget = bestK;
+            dt = H*std::min(2.0, std::max(0.5, bestFac));
+        }
+
+        ti = tNew;
+        Xi = XNew;
+        i++;
+        acceptStep(ti, Xi);
+    }
+}
+
+/**
+ * Automatic part of extendTo, which switches between RKF45 and a fourth 
+ * order Rosenbrock method (Shampine's parameters, with an embedded third 
+ * order solution) according to stiffness, in the manner of LSODA. While 
+ * explicit, the spectral radius rho of df/dX is estimated from the last two 
+ * stages of each step, which are both at t+dt, and the problem is taken to 
+ * be stiff once dt*rho has been near the edge of RKF45's stability region 
+ * (|dt*rho| = 3.02 on the negative real axis) for 15 steps, i.e. stability 
+ * rather than accuracy limits the step. While implicit, rho is estimated by 
+ * power iteration on the Jacobian and the explicit method is resumed once 
+ * 15 steps in a row would have been stable for it.
+ * 
+ * @param tf       Final t value.
+ * @return         Nothing.
+ */
+template <typename T>
+void basicSolClass<T>::extendAuto(T tf) {
+    TRACE_ZONE("auto");
+    // dt*rho beyond which RKF45 is taken to be limited by stability
+    const double stabilityEdge = 0.9*3.02;
+    const int nSwitch = 15;
+    vector<T> X1, k5X, f5;
+    vector<vector<T>> J;
+    vector<T> Xi = lastX();
+    T ti = lastT();
+    int i = 0;
+    double R, s, hRho;
+
+    while ( ( ti < tf ) && (i < itMax)) {
+        dt = std::min(dt, tf-ti);
+        T h = dt;
+        if (ti + h == ti) {
+            // Rounding errors of about eps*|X| per step exceed tol*dt
+            throw runtime_error("auto: step size underflow, tol is too "
+            "small for the size of the solution");
+        }
+        if (!stiff) {
+            R = rkf45Step(ti, Xi, X1, k5X, f5);
+            s = pow(tol/(2.0*R), 0.25);
+        } else {
+            R = rosenbrockStep(ti, Xi, X1, J);
+            s = 0.9*pow(tol/R, 1.0/3);
+        }
+        // Steps change by at most a factor of 5 (NaN errors give 0.2), as 
+        // the step from one method can be far off for the other
+        dt *= (s > 0.2) ? std::min(s, 5.0) : 0.2;
+        if (!(R <= tol)) {
+            stats.nReject++;
+            continue;
+        }
+        ti += h;
+        Xi = X1;
+        i++;
+        acceptStep(ti, Xi);
+
+        // Stiffness indicator for the step just taken
+        if (!stiff) {
+            double num = 0, den = 0;
+            for (int c = 0; c < Xi.size(); c++) {
+                num = std::max(num, double(abs(fLast[c] - f5[c])));
+                den = std::max(den, double(abs(Xi[c] - k5X[c])));
+            }
+            hRho = (den > 0) ? double(h)*num/den : 0;
+        } else {
+            // Power iteration, taking the mean growth over the last two 
+            // products so that complex pairs are measured correctly
+            vector<T> v(Xi.size(), T(1)), w;
+            double growth = 0;
+            for (int k = 0; k < 10; k++) {
+                w = vector<T>(Xi.size(), T(0));
+                for (int r = 0; r < Xi.size(); r++) {
+                    for (int c = 0; c < Xi.size(); c++) {
+                        w[r] = w[r] + J[r][c]*v[c];
+                    }
+                }
+                double norm = 0;
+                for (int r = 0; r < Xi.size(); r++) {
+                    norm = std::max(norm, double(abs(w[r])));
+                }
+                if (norm == 0) {
+                    growth = 0;
+                    break;
+                }
+                growth = (k >= 8) ? growth*norm : norm;
+                v = scalMult(T(1.0/norm), w);
+            }
+            hRho = double(h)*sqrt(growth);
+        }
+
+        // Switch once the indicator has agreed for nSwitch steps
+        if (hRho > stabilityEdge) {
+            nonStiffCount = 0;
+            stiffCount++;
+        } else {
+            stiffCount = 0;
+            nonStiffCount++;
+        }
+        if (!stiff && stiffCount >= nSwitch) {
+            stiff = true;
+            stats.nSwitch++;
+            stiffCount = 0;
+        } else if (stiff && nonStiffCount >= nSwitch) {
+            stiff = false;
+            stats.nSwitch++;
+            nonStiffCount = 0;
+        }
+    }
+}
+
+/**
+ * Takes one step of size dt from (ti, Xi) with the fourth order Rosenbrock 
+ * method of Shampine (1982), using fLast as f(ti, Xi). Each step needs a 
+ * Jacobian, one LU decomposition and three further evaluations of f.
+ * 
+ * @param ti       Time at the start of the step.
+ * @param Xi       State at the start of the step.
+ * @param X1       Set to the solution at ti+dt.
+ * @param J        Set to the Jacobian at (ti, Xi).
+ * @return         Error measure max|X1 - X1hat|/dt, X1hat being the 
+ * embedded third order solution.
+ */
+template <typename T>
+double basicSolClass<T>::rosenbrockStep(T ti, const vector<T> &Xi, 
+vector<T> &X1, vector<vector<T>> &J) {
+    TRACE_ZONE("Rosenbrock step");
+    const T gam = T(1)/2, a21 = 2, a31 = T(48)/25, a32 = T(6)/25;
+    const T c21 = -8, c31 = T(372)/25, c32 = T(12)/5;
+    const T c41 = -T(112)/125, c42 = -T(54)/125, c43 = -T(2)/5;
+    const T b1 = T(19)/9, b2 = T(1)/2, b3 = T(25)/108, b4 = T(125)/108;
+    const T e1 = T(17)/54, e2 = T(7)/36, e4 = T(125)/108;
+    const T c1x = T(1)/2, c2x = -T(3)/2, c3x = T(121)/50, c4x = T(29)/250;
+    const T a2x = 1, a3x = T(3)/5;
+    int n = Xi.size();
+
+    // df/dt by a forward difference, and the matrix I/(gam dt) - J
+    J = jacobian(ti, Xi);
+    T delta = sqrt(numeric_limits<double>::epsilon())*
+    std::max(T(1), abs(ti));
+    vector<T> dfdt = scalMult(T(1)/delta, vecAdd(evalRHS(ti + delta, Xi), 
+    scalMult(-1.0, fLast)));
+    vector<vector<T>> A(n, vector<T>(n));
+    for (int r = 0; r < n; r++) {
+        for (int c = 0; c < n; c++) {
+            A[r][c] = -J[r][c];
+        }
+        A[r][r] = A[r][r] + T(1)/(gam*dt);
+    }
+    vector<int> perm;
+    luDecompose(A, perm);
+
+    // Stages
+    vector<T> g1 = luSolve(A, perm, vecAdd(fLast, scalMult(dt*c1x, dfdt)));
+    vector<T> f2 = evalRHS(ti + a2x*dt, vecAdd(Xi, scalMult(a21, g1)));
+    vector<T> g2 = luSolve(A, perm, vecAdd(vecAdd(f2, 
+    scalMult(dt*c2x, dfdt)), scalMult(c21/dt, g1)));
+    vector<T> f3 = evalRHS(ti + a3x*dt, vecAdd(vecAdd(Xi, 
+    scalMult(a31, g1)), scalMult(a32, g2)));
+    vector<T> g3 = luSolve(A, perm, vecAdd(vecAdd(f3, 
+    scalMult(dt*c3x, dfdt)), scalMult(T(1)/dt, vecAdd(scalMult(c31, g1), 
+    scalMult(c32, g2)))));
+    vector<T> g4 = luSolve(A, perm, vecAdd(vecAdd(f3, 
+    scalMult(dt*c4x, dfdt)), scalMult(T(1)/dt, vecAdd(vecAdd(
+    scalMult(c41, g1), scalMult(c42, g2)), scalMult(c43, g3)))));
+
+    X1 = vecAdd(vecAdd(vecAdd(vecAdd(Xi, scalMult(b1, g1)), 
+    scalMult(b2, g2)), scalMult(b3, g3)), scalMult(b4, g4));
+    vector<T> err = vecAdd(vecAdd(scalMult(e1, g1), scalMult(e2, g2)), 
+    scalMult(e4, g4));
+    double R = 0;
+    for (int c = 0; c < n; c++) {
+        R = std::max(R, double(abs(err[c])/dt));
+    }
+
+    return R;
+}
+
+/**
+ * Estimates the Jacobian df/dX at (ti, Xi) by forward differences, using 
+ * fLast as f(ti, Xi).
+ * 
+ * @param ti       Time value.
+ * @param Xi       State.
+ * @return         Jacobian; rows correspond to components of f.
+ */
+template <typename T>
+vector<vector<T>> basicSolClass<T>::jacobian(T ti, const vector<T> &Xi) {
+    int n = Xi.size();
+    vector<vector<T>> J(n, vector<T>(n));
+    vector<T> Xp = Xi;
+    for (int c = 0; c < n; c++) {
+        T delta = sqrt(numeric_limits<double>::epsilon())*
+        std::max(T(1), abs(Xi[c]));
+        Xp[c] = Xi[c] + delta;
+        vector<T> fp = evalRHS(ti, Xp);
+        for (int r = 0; r < n; r++) {
+            J[r][c] = (fp[r] - fLast[r])/delta;
+        }
+        Xp[c] = Xi[c];
+    }
+    stats.nJac++;
+
+    return J;
+}
+
+/**
+ * Writes the adaptive integrator state (method, t, X at the last accepted 
+ * step, next dt, tolerance, itMax, Bulirsch-Stoer order, work counters,
+ * cached derivative and params) to a binary file. The file is written to
+ * filename.tmp first and then renamed, so a run killed mid-write leaves the
+ * previous checkpoint intact.
+ * 
+ * @param filename Name of checkpoint file.
+ * @return         Nothing.
+ */
+template <typename T>
+void basicSolClass<T>::writeCheckpoint(string filename) {
+    TRACE_ZONE("writeCheckpoint");
+    // Counts are stored as 64-bit integers, the rest as T
+    vector<T> Xlast = lastX();
+    T tLast = lastT();
+    int64_t n = Xlast.size();
+    int64_t nParams = rhsParams.size();
+    int64_t nF = fLast.size();
+    int64_t itMax64 = itMax;
+    int64_t nMethod = method.size();
+    int64_t kTarget64 = kTarget;
+    int64_t autoState[3] = {stiff, stiffCount, nonStiffCount};
+    int64_t scalarSize = sizeof(T);
+    string tmpName = filename + ".tmp";
+
+    ofstream file(tmpName, ios::binary);
+    file.write("ODECKPT5", 8);
+    file.write((char*) &scalarSize, sizeof(scalarSize));
+    file.write((char*) &nMethod, sizeof(nMethod));
+    file.write(method.data(), nMethod);
+    file.write((char*) &n, sizeof(n));
+    file.write((char*) &tLast, sizeof(T));
+    file.write((char*) Xlast.data(), n*sizeof(T));
+    file.write((char*) &dt, sizeof(dt));
+    file.write((char*) &tol, sizeof(tol));
+    file.write((char*) &itMax64, sizeof(itMax64));
+    file.write((char*) &kTarget64, sizeof(kTarget64));
+    file.write((char*) autoState, sizeof(autoState));
+    file.write((char*) &stats, sizeof(stats));
+    file.write((char*) &nF, sizeof(nF));
+    file.write((char*) fLast.data(), nF*sizeof(T));
+    file.write((char*) &nParams, sizeof(nParams));
+    file.write((char*) rhsParams.data(), nParams*sizeof(T));
+
+    // Adams history, oldest first
+    int64_t nHist = hist.size();
+    int64_t capacity = hist.capacity;
+    file.write((char*) &capacity, sizeof(capacity));
+    file.write((char*) &nHist, sizeof(nHist));
+    for (int j = nHist-1; j >= 0; j--) {
+        T tj = hist.tAt(j);
+        file.write((char*) &tj, sizeof(tj));
+        file.write((char*) hist.fAt(j).data(), n*sizeof(T));
+    }
+    file.close();
+    if (!file || rename(tmpName.c_str(), filename.c_str()) != 0) {
+        throw runtime_error("Could not write checkpoint " + filename);
+    }
+}
+
+/**
+ * Makes extendTo write a checkpoint every so many accepted steps.
+ * 
+ * @param filename Name of checkpoint file.
+ * @param every    Number of accepted steps between checkpoints (0 disables
+ * auto-checkpointing).
+ * @return         Nothing.
+ */
+template <typename T>
+void basicSolClass<T>::setAutoCheckpoint(string filename, int every) {
+    checkpointFile = filename;
+    checkpointEvery = every;
+}
+
+/**
+ * Makes extendTo pass every step it accepts to sink as soon as it is taken, 
+ * so the solution can be streamed while it is computed. The points already 
+ * in the solution are not passed.
+ * 
+ * @param sink     Called as sink(t, X) for every accepted step (an empty 
+ * function turns this off).
+ * @return         Nothing.
+ */
+template <typename T>
+void basicSolClass<T>::setStepSink(function<void(T, const vector<T>&)> sink) {
+    stepSink = sink;
+}
+
+/**
+ * Constructor for solClass that restores the adaptive integrator state from a
+ * checkpoint written by writeCheckpoint. The solution starts out holding only
+ * the checkpointed step; call extendTo to continue the integration.
+ * 
+ * @param f        Function that returns dX/dt (the same function used for
+ * the checkpointed run).
+ * @param filename Name of checkpoint file.
+ * @return         N/A.
+ */
+template <typename T>
+basicSolClass<T>::basicSolClass(vector<T>(*f)(T, vector<T>, vector<T>),
+string filename) {
+    int64_t n, nF, nParams, itMax64, nMethod, kTarget64, scalarSize;
+    T t0;
+    char magic[8];
+
+    ifstream file(filename, ios::binary);
+    file.read(magic, 8);
+    if (!file || string(magic, 8) != "ODECKPT5") {
+        throw runtime_error(filename + " is not a solClass checkpoint");
+    }
+    file.read((char*) &scalarSize, sizeof(scalarSize));
+    if (scalarSize != sizeof(T)) {
+        throw runtime_error(filename + " was written with another scalar type");
+    }
+    file.read((char*) &nMethod, sizeof(nMethod));
+    method.resize(nMethod);
+    file.read(&method[0], nMethod);
+    file.read((char*) &n, sizeof(n));
+    file.read((char*) &t0, sizeof(t0));
+    vector<T> X0(n);
+    file.read((char*) X0.data(), n*sizeof(T));
+    file.read((char*) &dt, sizeof(dt));
+    file.read((char*) &tol, sizeof(tol));
+    file.read((char*) &itMax64, sizeof(itMax64));
+    file.read((char*) &kTarget64, sizeof(kTarget64));
+    int64_t autoState[3];
+    file.read((char*) autoState, sizeof(autoState));
+    stiff = autoState[0];
+    stiffCount = autoState[1];
+    nonStiffCount = autoState[2];
+    file.read((char*) &stats, sizeof(stats));
+    file.read((char*) &nF, sizeof(nF));
+    fLast.resize(nF);
+    file.read((char*) fLast.data(), nF*sizeof(T));
+    file.read((char*) &nParams, sizeof(nParams));
+    rhsParams.resize(nParams);
+    file.read((char*) rhsParams.data(), nParams*sizeof(T));
+
+    // Adams history, oldest first
+    int64_t nHist, capacity;
+    file.read((char*) &capacity, sizeof(capacity));
+    file.read((char*) &nHist, sizeof(nHist));
+    hist = adamsHistory<T>(capacity);
+    for (int j = 0; j < nHist; j++) {
+        T tj;
+        vector<T> fj(n);
+        file.read((char*) &tj, sizeof(tj));
+        file.read((char*) fj.data(), n*sizeof(T));
+        hist.push(tj, fj);
+    }
+    if (!file) {
+        throw runtime_error(filename + " is truncated");
+    }
+
+    rhs = f;
+    itMax = itMax64;
+    kTarget = kTarget64;
+    t.push_back(t0);
+    X.push_back(X0);
 }
 
 /**
@@ -303,15 +1678,16 @@ double tol=1e-9, int itMax=1000000, double dtInit=1e-1) {
  * @param f        Function that takes the arguments time value (scalar),
  * corresponding X array and params and returns dX/dt. 
  * @param X0       X at tInput[0].
- * @param tInput   Vector of type double consisting of time values we want 
+ * @param tInput   Vector of type T consisting of time values we want 
  * the solution at.
- * @param params   Vector of type double consisting of parameter values.
+ * @param params   Vector of type T consisting of parameter values.
  * @param method   Non-adaptive method to be used to integrate ODE. Accepted
+ * values are "RK4" (default), "Euler", "ModEuler" and "ABM".
  * @return         N/A.
  */
-solClass::solClass(vector<double>(*f)(double, vector<double>, vector<double>), 
-vector<double> X0, vector<double> tInput, vector<double> params, 
-string method="RK4") {
+template <typename T>
+basicSolClass<T>::basicSolClass(vector<T>(*f)(T, vector<T>, vector<T>), 
+vector<T> X0, vector<T> tInput, vector<T> params, string method) {
     t = tInput;
     if (method == "RK4") {
         X = RK4(f, X0, tInput, params);
@@ -319,6 +1695,8 @@ string method="RK4") {
         X = Euler(f, X0, tInput, params);
     } else if (method == "ModEuler") {
         X = ModEuler(f, X0, tInput, params);
+    } else if (method == "ABM") {
+        X = ABM(f, X0, tInput, params);
     } else {
         cout << "No method called " << method << " is callable by this";
         cout << " constructor." << endl;
@@ -326,30 +1704,206 @@ string method="RK4") {
 }
 
 /**
- * Constructor for solClass that uses RKF45 to initialize t and X.
+ * Constructor for solClass that uses specified method to solve ODE on a 
+ * uniform grid. The grid is kept as t0, dt and N rather than as a vector of
+ * t values (see getT, size and tAt).
+ * 
+ * @param f        Function that takes the arguments time value (scalar),
+ * corresponding X array and params and returns dX/dt. 
+ * @param X0       X at gridInput[0].
+ * @param gridInput Time values we want the solution at.
+ * @param params   Vector of type T consisting of parameter values.
+ * @param method   Non-adaptive method to be used to integrate ODE. Accepted
+ * values are "RK4" (default), "Euler", "ModEuler" and "ABM".
+ * @return         N/A.
+ */
+template <typename T>
+basicSolClass<T>::basicSolClass(vector<T>(*f)(T, vector<T>, vector<T>), 
+vector<T> X0, uniformGrid<T> gridInput, vector<T> params, string method) {
+    uniform = true;
+    grid = gridInput;
+    if (method == "RK4") {
+        X = RK4(f, X0, grid, params);
+    } else if (method == "Euler") {
+        X = Euler(f, X0, grid, params);
+    } else if (method == "ModEuler") {
+        X = ModEuler(f, X0, grid, params);
+    } else if (method == "ABM") {
+        X = ABM(f, X0, grid, params);
+    } else {
+        cout << "No method called " << method << " is callable by this";
+        cout << " constructor." << endl;
+    }
+}
+
+/**
+ * Constructor for solClass that uses an adaptive method (RKF45 or 
+ * Bulirsch-Stoer) to initialize t and X.
  * 
  * @param f        Function that takes the arguments time value (scalar),
  * corresponding X array and params and returns dX/dt. 
  * @param X0       X at t0.
  * @param t0       Starting t value.
  * @param tf       Final t value.
- * @param params   Vector of type double consisting of parameter values.
+ * @param params   Vector of type T consisting of parameter values.
  * @param tol      A double representing the error tolerance to be used 
  * (default=1e-9).
  * @param itMax    An integer representing the maximum number of iterations 
  * allowable.
  * @param dtInit   Initial guess for dt. 
+ * @param method   Adaptive method to be used, "RKF45" (default), 
+ * "BulirschStoer", "ABM" or "auto" (RKF45 or a Rosenbrock method, 
+ * switching according to stiffness).
  * @return         N/A.
  */
-solClass::solClass(vector<double>(*f)(double, vector<double>, vector<double>), 
-vector<double> X0, double t0, double tf, vector<double> params, 
-double tol=1e-9, int itMax=1000000, double dtInit=1e-1) {
-    *this = RKF45(f, X0, t0, tf, params, tol, itMax, dtInit);
+template <typename T>
+basicSolClass<T>::basicSolClass(vector<T>(*f)(T, vector<T>, vector<T>), 
+vector<T> X0, T t0, T tf, vector<T> params, double tol, int itMax, 
+T dtInit, string method) {
+    // Add first entries to t and X
+    t.push_back(t0);
+    X.push_back(X0);
+
+    // Store what extendTo needs to continue the integration
+    this->method = method;
+    rhs = f;
+    rhsParams = params;
+    this->tol = tol;
+    this->itMax = itMax;
+    dt = dtInit;
+
+    extendTo(tf);
+}
+
+/**
+ * Returns the cache key of a solve, a hash of the problem name, the version
+ * tag of its right-hand side and every input that determines the solution.
+ * The right-hand side itself cannot be hashed, so the entries of a problem
+ * must be invalidated by changing version whenever its RHS is edited (the
+ * default, ODE_SYSTEM_VERSION, changes whenever the program does).
+ * 
+ * @param prob     String containing problem name.
+ * @param version  Version tag of the right-hand side.
+ * @param X0       Initial condition.
+ * @param t0       Initial time.
+ * @param tf       Final time.
+ * @param params   A vector of parameters for f.
+ * @param method   Name of method ("Euler", "ModEuler", "RK4" or "RKF45").
+ * @param N        Number of steps (ignored by RKF45, 0 for other adaptive 
+ * methods).
+ * @param tol      Error tolerance (ignored by the fixed step methods).
+ * @param dtInit   First step tried by the adaptive methods.
+ * @param itMax    Largest number of steps of the adaptive methods.
+ * @return         Key as a string of 16 hexadecimal digits.
+ */
+string solveKey(string prob, string version, vector<double> X0, double t0,
+double tf, vector<double> params, string method, int N, double tol,
+double dtInit=1e-1, long itMax=1000000) {
+    // Only hash inputs the method actually uses
+    if (method == "RKF45" || N == 0) {
+        N = 0;
+    } else {
+        tol = dtInit = 0;
+        itMax = 0;
+    }
+
+    uint64_t h = fnv1a(prob.data(), prob.size());
+    h = fnv1a(version.data(), version.size(), h);
+    h = fnv1a(method.data(), method.size(), h);
+    h = fnv1a(X0.data(), X0.size()*sizeof(double), h);
+    h = fnv1a(params.data(), params.size()*sizeof(double), h);
+    h = fnv1a(&t0, sizeof(t0), h);
+    h = fnv1a(&tf, sizeof(tf), h);
+    h = fnv1a(&N, sizeof(N), h);
+    h = fnv1a(&tol, sizeof(tol), h);
+    h = fnv1a(&dtInit, sizeof(dtInit), h);
+    h = fnv1a(&itMax, sizeof(itMax), h);
+
+    stringstream key;
+    key << hex << setw(16) << setfill('0') << h;
+
+    return key.str();
+}
+
+/**
+ * Returns the solution computed by method, from cache if possible; solutions
+ * that had to be computed are added to the cache. If out is given, every 
+ * point of the solution is also passed to it, as it is computed for the 
+ * fixed step methods.
+ * 
+ * @param f        Function that returns dX/dt from the arguments t, X and 
+ * params.
+ * @param X0       Initial condition.
+ * @param t0       Initial time.
+ * @param tf       Final time.
+ * @param tol      Error tolerance.
+ * @param N        Number of steps.
+ * @param params   A vector of parameters for f.
+ * @param prob     String containing problem name.
+ * @param version  Version tag of f (see solveKey).
+ * @param method   Name of method ("Euler", "ModEuler", "RK4" or "RKF45").
+ * @param cache    Cache to look the solution up in.
+ * @param key      Set to the cache key of the solution.
+ * @param out      CSV writer the solution is passed to (or nullptr).
+ * @return         Solution object.
+ */
+solClass cachedSolve(vector<double> (*f)(double, vector<double>, 
+vector<double>), vector<double> X0, double t0, double tf, double tol, int N, 
+vector<double> params, string prob, string version, string method,
+solCache &cache, string &key, asyncCSVWriter<double> *out=nullptr) {
+    TRACE_ZONE("cachedSolve");
+    key = solveKey(prob, version, X0, t0, tf, params, method, N, tol);
+    vector<double> t;
+    vector<vector<double>> X;
+    solCacheEntry entry;
+    if (cache.load(key, entry)) {
+        t.resize(entry.size());
+        X.resize(entry.size());
+        for (size_t i = 0; i < entry.size(); i++) {
+            t[i] = entry.tAt(i);
+            X[i].assign(entry.XAt(i), entry.XAt(i) + entry.nCols());
+            if (out != nullptr) {
+                (*out)(t[i], X[i]);
+            }
+        }
+        return solClass(t, X);
+    }
+
+    // Cache miss, so solve the problem
+    if (method == "RKF45") {
+        solClass solution(f, X0, t0, tf, params, tol);
+        cache.store(key, solution.getT(), solution.getX());
+        for (size_t i = 0; out != nullptr && i < solution.size(); i++) {
+            (*out)(solution.tAt(i), solution.getX()[i]);
+        }
+        return solution;
+    }
+    // This makes t equivalent to np.linspace(t0, tf, num=N+1), without 
+    // storing it
+    uniformGrid<double> grid(t0, tf, N);
+    X.reserve(grid.size());
+    fixedStepStream(f, X0, grid, params, method, 
+    [&](double ti, const vector<double> &Xi) {
+        X.push_back(Xi);
+        if (out != nullptr) {
+            (*out)(ti, Xi);
+        }
+    });
+    cache.store(key, grid, X);
+
+    return solClass(grid, X);
 }
 
 /**
  * Solve the ODE using the four algorithms implemented in ODE.h and produce
- * plots in SVG using Python's Matplotlib.
+ * plots in SVG using Python's Matplotlib. Solutions are looked up in (and 
+ * added to) the on-disk cache in .odecache, and the CSV and error files are
+ * only rewritten if they do not already hold these solutions, so a repeated
+ * run only reads ODE_cache.txt. CSV files are written by a thread per file
+ * while the solutions are computed, so writing overlaps with the solves and
+ * the error analysis. The errors of Euler, 
+ * ModEuler and RK4 against RKF45 are written to ODE_errors.csv, with 
+ * downsampled error curves in ODE_<method>_error.csv.
  * 
  * @param f        Function that returns dX/dt from the arguments t, X and 
  * params.
@@ -364,26 +1918,115 @@ double tol=1e-9, int itMax=1000000, double dtInit=1e-1) {
  * @param prob     String containing problem name.
  * @param headings Vector of headings to be used in CSV file.
  * @param pyScript Python script file name (including file extension).
+ * @param version  Version tag of f, hashed into the cache keys; change it
+ * whenever f is edited (the default changes whenever the program does).
  * @return         Nothing.
  */
 void solveProblem(vector<double> (*f)(double, vector<double>, vector<double>), 
 vector<double> X0, double t0, double tf, double tol, int N, int prec, 
-vector<double> params, string prob, vector<string> headings, string pyScript) {
-    // This makes t equivalent to np.linspace(t0, tf, num=N+1)
-    vector<double> t = linspace(t0, tf, N);
-
-    // Initialize solution objects
-    solClass EulerSol(f, X0, t, params, "Euler");
-    solClass ModEulerSol(f, X0, t, params, "ModEuler");
-    solClass RK4Sol(f, X0, t, params, "RK4");
-    solClass solution(f, X0, t0, tf, params, tol);
-
-    // Write solution data to CSV file (easiest to import into Python)
-    EulerSol.writeToCSV(prec, "ODE_Euler.csv", headings);
-    ModEulerSol.writeToCSV(prec, "ODE_ModEuler.csv", headings);
-    RK4Sol.writeToCSV(prec, "ODE_RK4.csv", headings);
-    solution.writeToCSV(prec, "ODE_RKF45.csv", headings);
+vector<double> params, string prob, vector<string> headings, string pyScript,
+string version=ODE_SYSTEM_VERSION) {
+    TRACE_ZONE("solveProblem");
+    // Initialize variables
+    solCache cache;
+    vector<string> methods {"Euler", "ModEuler", "RK4", "RKF45"};
+    vector<string> keys(methods.size());
+    stringstream stamp, errorStamp;
+    for (int i = 0; i < methods.size(); i++) {
+        keys[i] = solveKey(prob, version, X0, t0, tf, params, methods[i], N,
+        tol);
+        stamp << keys[i] << " ";
+        errorStamp << keys[i] << " ";
+    }
+    stamp << prec;
+    for (int i = 0; i < headings.size(); i++) {
+        stamp << " " << headings[i];
+        errorStamp << " " << headings[i];
+    }
+
+    // The CSV files (easiest to import into Python) and the error files need
+    // only be written if the files from the last run do not already hold 
+    // these solutions
+    string lastStamp, lastErrorStamp;
+    ifstream stampFile("ODE_cache.txt");
+    getline(stampFile, lastStamp);
+    getline(stampFile, lastErrorStamp);
+    stampFile.close();
+    bool csvsExist = true;
+    bool errorsExist = ifstream("ODE_errors.csv").good();
+    for (int i = 0; i < methods.size(); i++) {
+        csvsExist = csvsExist && ifstream("ODE_" + methods[i] + ".csv").good();
+        if (i+1 < methods.size()) {
+            errorsExist = errorsExist && 
+            ifstream("ODE_" + methods[i] + "_error.csv").good();
+        }
+    }
+    bool writeCSVs = !csvsExist || lastStamp != stamp.str();
+    bool writeErrors = !errorsExist || lastErrorStamp != errorStamp.str();
+
+    // Initialize solution objects, each passing its points to a writer 
+    // thread for its CSV file as they are computed. The error analysis needs
+    // the solutions in memory; without it, cache hits are written straight
+    // from the mapped entries
+    vector<solClass> solutions;
+    vector<unique_ptr<asyncCSVWriter<double>>> writers;
+    for (int i = 0; (writeCSVs || writeErrors) && i < methods.size(); i++) {
+        asyncCSVWriter<double> *out = nullptr;
+        if (writeCSVs) {
+            writers.push_back(unique_ptr<asyncCSVWriter<double>>(
+            new asyncCSVWriter<double>("ODE_" + methods[i] + ".csv", headings,
+            prec)));
+            out = writers.back().get();
+        }
+        solCacheEntry entry;
+        if (!writeErrors && cache.load(keys[i], entry)) {
+            vector<double> Xi(entry.nCols());
+            for (size_t j = 0; j < entry.size(); j++) {
+                copy(entry.XAt(j), entry.XAt(j) + entry.nCols(), Xi.begin());
+                (*out)(entry.tAt(j), Xi);
+            }
+            continue;
+        }
+        solutions.push_back(cachedSolve(f, X0, t0, tf, tol, N, params, prob, 
+        version, methods[i], cache, keys[i], out));
+    }
     
+    // Errors of the fixed step methods against RKF45, so that the Python
+    // scripts need not interpolate the solutions onto a common grid
+    if (writeErrors) {
+        TRACE_ZONE("error analysis");
+        solClass &ref = solutions.back();
+        hermiteInterpolant<double> refInterp(ref.getT(), ref.getX(), f, 
+        params);
+        vector<errorSummary> summaries;
+        for (int i = 0; i+1 < methods.size(); i++) {
+            string curveFile = "ODE_" + methods[i] + "_error.csv";
+            if (solutions[i].isUniform()) {
+                summaries.push_back(compareSolutions(solutions[i].getGrid(), 
+                solutions[i].getX(), refInterp, curveFile, headings));
+            } else {
+                summaries.push_back(compareSolutions(solutions[i].getT(), 
+                solutions[i].getX(), refInterp, curveFile, headings));
+            }
+        }
+        vector<string> names(headings.begin()+1, headings.end());
+        writeErrorSummaries("ODE_errors.csv", vector<string>(methods.begin(),
+        methods.end()-1), summaries, names);
+    }
+
+    // Wait for the CSV files before recording what the files hold
+    if (writeCSVs || writeErrors) {
+        TRACE_ZONE("write CSVs");
+        for (int i = 0; i < writers.size(); i++) {
+            writers[i]->close();
+        }
+        ofstream file;
+        file.open("ODE_cache.txt");
+        file << stamp.str() << endl;
+        file << errorStamp.str() << endl;
+        file.close();
+    }
+
     // Write prob to file so Python script can use it
     ofstream file;
     file.open("ODE_prob.txt");
@@ -391,6 +2034,7 @@ vector<double> params, string prob, vector<string> headings, string pyScript) {
     file.close();
 
     // Use Python to generate relevant plots and save as svgs
+    TRACE_ZONE("python plots");
     stringstream cmd;
     cmd << "python ";
     cmd << pyScript;
@@ -408,4 +2052,6 @@ void writeTol(double tol) {
     file.open("ODE_tolerance.txt");
     file << tol << endl;
     file.close();
-}
\ No newline at end of file
+}
+
+#endif
@@ -0,0 +1,106 @@
+// Written to compare the adaptive methods on the orbit problems
+#include <ODE.h>
+
+/**
+ * Returns the right-hand side of our ODE (currently the orbit of the Earth
+ * or the Moon, depending on params).
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> ODE(double t, vector<double> X, vector<double> params) {
+    // Extract dependent variables from X vector
+    double r = X[0];
+    double dr = X[1];
+    double theta = X[2];
+    
+    // Constants
+    double G = 6.674e-11; // Gravitational constant
+    double M = params[0]; // Mass of the central body (kg)
+    double c = params[1]; // r^2 theta dot = angular momentum/orbiting mass
+    
+    vector<double> dX {
+    	dr,                               // dr/dt
+    	pow(c,2)/pow(r,3)-G*M/pow(r,2),   // d^2r/dt^2
+        c/pow(r,2)                        // dtheta/dt
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the largest error of X relative to Xref, relative to the size of 
+ * each component.
+ *
+ * @param X        Approximate solution at tf.
+ * @param Xref     Reference solution at tf.
+ * @return         max |X - Xref|/(1 + |Xref|).
+ */
+double relErr(vector<double> X, vector<double> Xref) {
+    double err = 0;
+    for (int i = 0; i < X.size(); i++) {
+        err = max(err, abs(X[i]-Xref[i])/(1+abs(Xref[i])));
+    }
+
+    return err;
+}
+
+/**
+ * Prints work-precision numbers (RHS evaluations against error at tf) of 
+ * RKF45, Bulirsch-Stoer and Adams-Bashforth-Moulton for one orbit problem.
+ *
+ * @param prob     Problem name.
+ * @param X0       Initial condition.
+ * @param tf       Final time.
+ * @param params   Mass of the central body and specific angular momentum.
+ * @param rkfTols  Tolerances to run RKF45 at.
+ * @return         Nothing.
+ */
+void workPrecision(string prob, vector<double> X0, double tf, 
+vector<double> params, vector<double> rkfTols) {
+    // Reference solution at the tightest tolerance double allows
+    solClass ref = BulirschStoer(ODE, X0, 0, tf, params, 1e-15);
+    vector<double> Xref = ref.getX().back();
+    vector<double> bsTols {1e-6, 1e-8, 1e-10, 1e-12, 1e-13};
+
+    cout << prob << endl;
+    cout << setw(14) << "method" << setw(10) << "tol" << setw(10) << "nfev";
+    cout << setw(10) << "steps" << setw(14) << "error" << endl;
+    for (int i = 0; i < rkfTols.size(); i++) {
+        solClass sol = RKF45(ODE, X0, 0, tf, params, rkfTols[i], 10000000);
+        cout << setw(14) << "RKF45" << setw(10) << rkfTols[i];
+        cout << setw(10) << sol.getStats().nfev; 
+        cout << setw(10) << sol.getStats().nAccept; 
+        cout << setw(14) << relErr(sol.getX().back(), Xref) << endl;
+    }
+    for (int i = 0; i < bsTols.size(); i++) {
+        solClass sol = BulirschStoer(ODE, X0, 0, tf, params, bsTols[i]);
+        cout << setw(14) << "BulirschStoer" << setw(10) << bsTols[i];
+        cout << setw(10) << sol.getStats().nfev; 
+        cout << setw(10) << sol.getStats().nAccept; 
+        cout << setw(14) << relErr(sol.getX().back(), Xref) << endl;
+    }
+    for (int i = 0; i < bsTols.size(); i++) {
+        solClass sol(ODE, X0, 0, tf, params, bsTols[i], 1000000, 1e-1, "ABM");
+        cout << setw(14) << "ABM" << setw(10) << bsTols[i];
+        cout << setw(10) << sol.getStats().nfev; 
+        cout << setw(10) << sol.getStats().nAccept; 
+        cout << setw(14) << relErr(sol.getX().back(), Xref) << endl;
+    }
+    cout << endl;
+}
+
+/**
+ * Main function, prints work-precision tables for the EarthOrbit and 
+ * MoonOrbit problems (with the initial conditions and tf of EarthOrbit.cpp 
+ * and MoonOrbit.cpp).
+ */
+int main() {
+    cout << setprecision(3);
+    workPrecision("EarthOrbit", {149.6e9, 310, 0}, 6.32e7, 
+    {1.9885e30, 4.4407e15}, {1e-3, 1e-5, 1e-7, 1e-8});
+    workPrecision("MoonOrbit", {385e6, 56.6, 0}, 1e7, 
+    {5.97237e24, 3.900453e11}, {1e-5, 1e-7, 1e-9, 1e-10});
+}
@@ -0,0 +1,96 @@
+// Written to compare a long Lorenz solution kept in memory with the same
+// solution kept out of core in chunks spilled to disk
+#include <sys/resource.h>
+#include <chrono>
+#include <ODE.h>
+
+/**
+ * Returns the right-hand side of the Lorenz system.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> lorenz(double t, vector<double> X, vector<double> params) {
+    vector<double> dX {
+        params[0]*(X[1]-X[0]),
+        X[0]*(params[1]-X[2])-X[1],
+        X[0]*X[1]-params[2]*X[2]
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the peak resident set size of the process.
+ *
+ * @return         Peak resident memory in MB.
+ */
+double peakMB() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_maxrss/1024.0;
+}
+
+/**
+ * Returns the number of seconds since start.
+ *
+ * @param start    Start time.
+ * @return         Elapsed seconds.
+ */
+double since(chrono::steady_clock::time_point start) {
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    return elapsed.count();
+}
+
+/**
+ * Main function. Solves the Lorenz system with RKF45 up to tf (the first
+ * argument, default 2000) either in memory or out of core (the second
+ * argument, "memory" or "disk", default disk), writes the solution to a CSV
+ * file and finds the largest z value in an analysis pass. Running both modes
+ * and comparing the CSV files and peak memory shows the rows are the same
+ * and only the out-of-core run has bounded memory.
+ */
+int main(int argc, char *argv[]) {
+    double tf = (argc > 1) ? atof(argv[1]) : 2000;
+    string mode = (argc > 2) ? argv[2] : "disk";
+    vector<string> headings {"t", "x", "y", "z"};
+    cout << setprecision(4);
+
+    auto start = chrono::steady_clock::now();
+    solClass solution(lorenz, {1.0, 1.0, 1.0}, 0.0, 0.0,
+    {10.0, 28.0, 8.0/3.0}, 1e-9, 100000000);
+    if (mode == "disk") {
+        // 2^16 rows of 4 doubles per chunk, 2 MB each
+        solution.setOutOfCore(65536, 4);
+    }
+    solution.extendTo(tf);
+    double solveTime = since(start);
+
+    start = chrono::steady_clock::now();
+    solution.writeToCSV(15, "OutOfCore_" + mode + ".csv", headings);
+    double writeTime = since(start);
+
+    start = chrono::steady_clock::now();
+    double zMax = 0;
+    double tMax = 0;
+    solution.forEachPoint([&](double t, const vector<double> &X) {
+        if (X[2] > zMax) {
+            zMax = X[2];
+            tMax = t;
+        }
+    });
+    double passTime = since(start);
+
+    cout << mode << ": " << solution.size() << " rows, ";
+    cout << solution.getStats().nfev << " evaluations" << endl;
+    cout << "    solve " << solveTime << " s, writeToCSV " << writeTime;
+    cout << " s, analysis pass " << passTime << " s" << endl;
+    cout << "    largest z " << setprecision(10) << zMax << " at t = ";
+    cout << tMax << setprecision(4) << endl;
+    cout << "    rows take " << solution.size()*4*sizeof(double)/1048576.0;
+    cout << " MB, peak resident memory " << peakMB() << " MB" << endl;
+}
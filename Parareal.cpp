@@ -0,0 +1,127 @@
+// Written to compare Parareal with serial RKF45 on long integrations of the
+// Earth's orbit and the simple pendulum
+#include <chrono>
+#include <parareal.h>
+
+/**
+ * Returns the right-hand side of the orbit of the Earth about the Sun in
+ * polar coordinates.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> orbit(double t, vector<double> X, vector<double> params) {
+    double r = X[0];
+    double dr = X[1];
+
+    double G = 6.674e-11;
+    double M = params[0];
+    double c = params[1];
+
+    vector<double> dX {
+        dr,
+        pow(c,2)/pow(r,3)-G*M/pow(r,2),
+        c/pow(r,2)
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of the simple pendulum.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> pendulum(double t, vector<double> X, vector<double> params) {
+    double theta = X[0];
+    double dtheta = X[1];
+
+    double g = params[0];
+    double l = params[1];
+
+    vector<double> dX {
+        dtheta,
+        - g/l * cos(theta)
+    };
+
+    return dX;
+}
+
+/**
+ * Solves a problem with serial RKF45 and with Parareal, and prints the
+ * iteration count, the largest relative difference from the serial solution
+ * at tf, the measured speedup and the speedup that one core per slice would
+ * give (serial evaluations over critical path evaluations).
+ *
+ * @param name        Name of the problem.
+ * @param f           Right-hand side.
+ * @param X0          Initial condition.
+ * @param tf          Final time.
+ * @param params      Vector of parameter values.
+ * @param tol         Error tolerance of the fine propagator.
+ * @param nSlices     Number of time slices.
+ * @param coarseSteps Number of coarse RK4 steps per slice.
+ * @param convTol     Relative change at which Parareal stops.
+ * @param nThreads    Number of threads.
+ * @return            Nothing.
+ */
+void compare(string name, vector<double>(*f)(double, vector<double>,
+vector<double>), vector<double> X0, double tf, vector<double> params,
+double tol, int nSlices, int coarseSteps, double convTol, int nThreads) {
+    auto start = chrono::steady_clock::now();
+    solClass serial(f, X0, 0.0, tf, params, tol, 100000000,
+    tf/nSlices/coarseSteps);
+    chrono::duration<double> serialTime = chrono::steady_clock::now() - start;
+
+    start = chrono::steady_clock::now();
+    pararealResult result = parareal(f, X0, 0.0, tf, params, nSlices,
+    coarseSteps, tol, convTol, 0, nThreads);
+    chrono::duration<double> pararealTime = chrono::steady_clock::now() -
+    start;
+
+    double serialEvals = serial.getStats().nfev;
+    cout << name << ": " << nSlices << " slices of " << coarseSteps;
+    cout << " coarse steps, " << nThreads << " threads" << endl;
+    cout << "    iterations " << result.iterations << " (";
+    cout << (result.converged ? "converged" : "not converged");
+    cout << "), corrections";
+    for (int k = 0; k < result.corrections.size(); k++) {
+        cout << " " << result.corrections[k];
+    }
+    cout << endl;
+    cout << "    difference from serial RKF45 at tf ";
+    cout << pararealChange(result.X.back(), serial.getX().back()) << endl;
+    cout << "    RKF45 " << serialTime.count() << " s, Parareal ";
+    cout << pararealTime.count() << " s, speedup ";
+    cout << serialTime.count()/pararealTime.count() << endl;
+    cout << "    evaluations: serial " << serialEvals << ", fine ";
+    cout << result.fineEvals << ", coarse " << result.coarseEvals;
+    cout << ", critical path " << result.criticalEvals << endl;
+    cout << "    speedup with one core per slice ";
+    cout << serialEvals/result.criticalEvals << ", parallel efficiency ";
+    cout << serialEvals/result.criticalEvals/nSlices << endl;
+}
+
+/**
+ * Main function, integrates the Earth's orbit over a century and the simple
+ * pendulum over 1000 s with serial RKF45 and with Parareal. The number of
+ * threads can be given as the first argument (default one per core).
+ */
+int main(int argc, char *argv[]) {
+    int nThreads = (argc > 1) ? atoi(argv[1]) : 0;
+    if (nThreads <= 0) {
+        nThreads = max(1u, thread::hardware_concurrency());
+    }
+    cout << setprecision(4);
+
+    // One slice per year, the coarse propagator takes monthly steps
+    compare("EarthOrbit", orbit, {149.6e9, 310, 0}, 100*3.156e7,
+    {1.9885e30, 4.4407e15}, 1e-8, 100, 12, 1e-7, nThreads);
+    compare("SimplePendulum", pendulum, {0.0, 0.0}, 1000, {9.8, 1.0}, 1e-11,
+    100, 200, 1e-7, nThreads);
+}
@@ -0,0 +1,310 @@
+// Written to find the limit cycle of the Van der Pol oscillator and a
+// bursting orbit of the Hindmarsh-Rose model by multiple shooting, and to
+// compare with finding them by long transient integrations
+#include <chrono>
+#include <periodicOrbit.h>
+
+/**
+ * Returns the right-hand side of the Van der Pol oscillator.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> vanderPol(double t, vector<double> X, vector<double> params) {
+    vector<double> dX {
+        X[1],
+        params[0]*(1-pow(X[0],2))*X[1] - X[0]
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the Jacobian of the Van der Pol oscillator.
+ *
+ * @param t        Time value.
+ * @param X        State.
+ * @param params   Vector of parameter values.
+ * @return         Jacobian, row i holds the derivatives of dX[i]/dt.
+ */
+vector<vector<double>> vanderPolJacobian(double t, vector<double> X,
+vector<double> params) {
+    vector<vector<double>> J {
+        {0, 1},
+        {-2*params[0]*X[0]*X[1] - 1, params[0]*(1-pow(X[0],2))}
+    };
+
+    return J;
+}
+
+/**
+ * Returns the right-hand side of the Van der Pol oscillator with time
+ * reversed, whose limit cycle is unstable.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> reversedVanderPol(double t, vector<double> X,
+vector<double> params) {
+    return scalMult(-1.0, vanderPol(t, X, params));
+}
+
+/**
+ * Returns the Jacobian of the Van der Pol oscillator with time reversed.
+ *
+ * @param t        Time value.
+ * @param X        State.
+ * @param params   Vector of parameter values.
+ * @return         Jacobian, row i holds the derivatives of dX[i]/dt.
+ */
+vector<vector<double>> reversedVanderPolJacobian(double t, vector<double> X,
+vector<double> params) {
+    vector<vector<double>> J = vanderPolJacobian(t, X, params);
+    for (size_t i = 0; i < J.size(); i++) {
+        J[i] = scalMult(-1.0, J[i]);
+    }
+
+    return J;
+}
+
+/**
+ * Returns the right-hand side of the Hindmarsh-Rose model.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> hindmarshRose(double t, vector<double> X,
+vector<double> params) {
+    double x = X[0];
+    double y = X[1];
+    double z = X[2];
+
+    vector<double> dX {
+        y-params[0]*pow(x,3)+params[1]*pow(x,2)-z+params[7],
+        params[2]-params[3]*pow(x,2)-y,
+        params[4]*(params[5]*(x-params[6])-z)
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the Jacobian of the Hindmarsh-Rose model.
+ *
+ * @param t        Time value.
+ * @param X        State.
+ * @param params   Vector of parameter values.
+ * @return         Jacobian, row i holds the derivatives of dX[i]/dt.
+ */
+vector<vector<double>> hindmarshRoseJacobian(double t, vector<double> X,
+vector<double> params) {
+    double x = X[0];
+    vector<vector<double>> J {
+        {-3*params[0]*pow(x,2)+2*params[1]*x, 1, -1},
+        {-2*params[3]*x, -1, 0},
+        {params[4]*params[5], 0, -params[4]}
+    };
+
+    return J;
+}
+
+/**
+ * Finds the times at which component c of a solution crosses level upwards,
+ * for the steps from index first on. Each crossing is located by bisection
+ * of the cubic Hermite interpolant of the step, which is accurate to the
+ * order of the solution rather than that of linear interpolation.
+ *
+ * @param f        Right-hand side.
+ * @param sol      Solution.
+ * @param first    Index of the first step to look at.
+ * @param c        Component.
+ * @param level    Level crossed.
+ * @param params   Vector of parameter values.
+ * @return         Crossing times.
+ */
+vector<double> crossings(vector<double>(*f)(double, vector<double>,
+vector<double>), solClass &sol, size_t first, int c, double level,
+vector<double> params) {
+    vector<double> times;
+    for (size_t i = first; i + 1 < sol.size(); i++) {
+        vector<double> Xa = sol.XAt(i), Xb = sol.XAt(i+1);
+        if (!(Xa[c] < level && Xb[c] >= level)) {
+            continue;
+        }
+        double ta = sol.tAt(i), h = sol.tAt(i+1) - ta;
+        double da = h*f(ta, Xa, params)[c], db = h*f(ta + h, Xb, params)[c];
+        // Hermite basis in s = (t - ta)/h
+        auto p = [&](double s) {
+            return (2*s*s*s - 3*s*s + 1)*Xa[c] + (s*s*s - 2*s*s + s)*da +
+            (-2*s*s*s + 3*s*s)*Xb[c] + (s*s*s - s*s)*db - level;
+        };
+        double lo = 0, hi = 1;
+        for (int k = 0; k < 60; k++) {
+            double mid = (lo + hi)/2;
+            (p(mid) < 0 ? lo : hi) = mid;
+        }
+        times.push_back(ta + h*(lo + hi)/2);
+    }
+
+    return times;
+}
+
+/**
+ * Finds the period the way it would be done without a periodic orbit
+ * solver: integrates with RKF45 (tol 1e-10) one period guess at a time
+ * until two successive periods between upward crossings of X[c] = level
+ * agree to 1e-9, or until tMax.
+ *
+ * @param f        Right-hand side.
+ * @param X0       Initial condition.
+ * @param params   Vector of parameter values.
+ * @param c        Component whose crossings are timed.
+ * @param level    Level crossed.
+ * @param T0       Period guess, the length of each integration.
+ * @param tMax     Time at which to give up.
+ * @param evals    Set to the number of evaluations of f.
+ * @param tEnd     Set to the time integrated to.
+ * @return         Period, 0 if it did not settle.
+ */
+double transientPeriod(vector<double>(*f)(double, vector<double>,
+vector<double>), vector<double> X0, vector<double> params, int c,
+double level, double T0, double tMax, long &evals, double &tEnd) {
+    solClass sol(f, X0, 0.0, 0.0, params, 1e-10, 100000000);
+    vector<double> times;
+    size_t scanned = 0;
+    double period = 0;
+    for (tEnd = T0; tEnd <= tMax; tEnd += T0) {
+        sol.extendTo(tEnd);
+        vector<double> found = crossings(f, sol, scanned, c, level, params);
+        times.insert(times.end(), found.begin(), found.end());
+        scanned = sol.size() - 1;
+        size_t k = times.size();
+        if (k >= 3) {
+            double last = times[k-1] - times[k-2];
+            double before = times[k-2] - times[k-3];
+            if (abs(last - before) <= 1e-9*last) {
+                period = last;
+                break;
+            }
+        }
+        if (!isfinite(sol.XAt(sol.size() - 1)[0])) {
+            break;
+        }
+    }
+    evals = sol.getStats().nfev;
+
+    return period;
+}
+
+/**
+ * Finds a periodic orbit by multiple shooting and by transient integration,
+ * and prints the periods, the cost of each and the Floquet multipliers.
+ * The shooting starts from the state after a transient of length tGuess,
+ * taken at the last upward crossing of the level with the time between the
+ * last two crossings as the period guess; T0 is used when there are fewer
+ * than two crossings.
+ *
+ * @param name       Name of the problem.
+ * @param f          Right-hand side.
+ * @param jac        Jacobian of f.
+ * @param X0         Initial condition.
+ * @param params     Vector of parameter values.
+ * @param c          Component whose crossings are timed.
+ * @param level      Level crossed.
+ * @param T0         Period guess.
+ * @param tGuess     Length of the transient before shooting (0 for none).
+ * @param tMax       Longest transient integration.
+ * @param nSegments  Number of shooting segments.
+ * @param steps      Number of RK4 steps per segment.
+ * @return           Nothing.
+ */
+void compare(string name, vector<double>(*f)(double, vector<double>,
+vector<double>), vector<vector<double>>(*jac)(double, vector<double>,
+vector<double>), vector<double> X0, vector<double> params, int c,
+double level, double T0, double tGuess, double tMax, int nSegments,
+int steps) {
+    cout << name << endl;
+    long evals;
+    double tEnd;
+    auto start = chrono::steady_clock::now();
+    double period = transientPeriod(f, X0, params, c, level, T0, tMax,
+    evals, tEnd);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    cout << "    transient RKF45: ";
+    if (period > 0) {
+        cout << "T = " << setprecision(12) << period;
+    } else {
+        cout << "no settled period";
+    }
+    cout << setprecision(4) << " after t = " << tEnd << ", " << evals;
+    cout << " evaluations, " << elapsed.count() << " s" << endl;
+
+    // Guess the state and period from the last two crossings of a short,
+    // loose transient, so that the orbit is entered at the section
+    start = chrono::steady_clock::now();
+    vector<double> Xguess = X0;
+    if (tGuess > 0) {
+        solClass transient(f, X0, 0.0, tGuess, params, 1e-6);
+        vector<double> times = crossings(f, transient, 0, c, level, params);
+        size_t k = times.size();
+        Xguess = transient.XAt(transient.size() - 1);
+        if (k >= 2) {
+            T0 = times[k-1] - times[k-2];
+            size_t i = 0;
+            while (transient.tAt(i) < times[k-1]) {
+                i++;
+            }
+            Xguess = transient.XAt(i);
+        }
+    }
+    periodicOrbitResult orbit = periodicOrbit(f, jac, Xguess, T0, params,
+    nSegments, steps);
+    elapsed = chrono::steady_clock::now() - start;
+    cout << "    multiple shooting: T = " << setprecision(12) << orbit.T;
+    cout << setprecision(4) << " (" << nSegments << " x " << steps;
+    cout << " RK4 steps), " << orbit.iterations << " Newton iterations, ";
+    cout << orbit.rhsEvals << " + " << orbit.jacEvals << " Jacobian ";
+    cout << "evaluations, " << elapsed.count() << " s" << endl;
+    cout << "    residuals";
+    for (size_t k = 0; k < orbit.residuals.size(); k++) {
+        cout << " " << orbit.residuals[k];
+    }
+    cout << (orbit.converged ? "" : " (not converged)") << endl;
+    cout << "    Floquet multipliers";
+    for (size_t k = 0; k < orbit.multipliers.size(); k++) {
+        cout << " " << setprecision(10) << orbit.multipliers[k].real();
+        if (orbit.multipliers[k].imag() != 0) {
+            cout << showpos << orbit.multipliers[k].imag() << "i";
+            cout << noshowpos;
+        }
+    }
+    cout << setprecision(4) << endl;
+}
+
+/**
+ * Main function, finds the limit cycle of the Van der Pol oscillator for
+ * mu = 1 and mu = 0.05 (weakly attracting), the unstable cycle of the
+ * oscillator with time reversed, and a bursting orbit of the Hindmarsh-Rose
+ * model (nine spikes per burst), by multiple shooting and by integrating
+ * until the period settles.
+ */
+int main() {
+    cout << setprecision(4);
+    compare("Van der Pol, mu = 1", vanderPol, vanderPolJacobian, {2.0, 0.0},
+    {1.0}, 0, 0.0, 6.6, 0, 1000, 20, 100);
+    compare("Van der Pol, mu = 0.05", vanderPol, vanderPolJacobian,
+    {1.0, 0.0}, {0.05}, 0, 0.0, 6.3, 0, 5000, 20, 100);
+    // Transient integration drifts away from an unstable cycle
+    compare("Van der Pol reversed in time, mu = 1", reversedVanderPol,
+    reversedVanderPolJacobian, {2.0, 0.0}, {1.0}, 0, 0.0, 6.6, 0, 1000, 20,
+    100);
+    compare("Hindmarsh-Rose bursting, r = 0.001, I = 2", hindmarshRose,
+    hindmarshRoseJacobian, {-1.0, 0.0, 2.0}, {1.0, 3.0, 1.0, 5.0, 1e-3,
+    4.0, -1.6, 2.0}, 2, 1.93, 430, 1000, 20000, 100, 500);
+}
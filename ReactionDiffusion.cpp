@@ -0,0 +1,289 @@
+// Written to integrate large method of lines systems with rkWorkspace.h.
+// Compile with -O3 -march=native -pthread so that the AVX2/AVX-512 kernels
+// are used.
+#include <rkWorkspace.h>
+#include <chrono>
+
+/**
+ * Evaluates one species of the Gray-Scott reaction-diffusion system
+ *   u_t = Du lap(u) - u v^2 + F (1 - u),
+ *   v_t = Dv lap(v) + u v^2 - (F + k) v,
+ * discretised on an M x M periodic grid with the five point Laplacian, at
+ * columns j0 to j1-1 of grid row i. X holds u (row-major) followed by v.
+ *
+ * @param X        u and v at the grid points.
+ * @param dX       Set to du/dt or dv/dt at the requested points.
+ * @param M        Number of grid points per side.
+ * @param i        Grid row.
+ * @param j0       First column.
+ * @param j1       One past the last column.
+ * @param isV      Whether to evaluate v (otherwise u).
+ * @param params   Du, Dv, F, k and the grid spacing h.
+ * @return         Nothing.
+ */
+void grayScottRow(const double *X, double *dX, size_t M, size_t i, size_t j0,
+size_t j1, bool isV, const vector<double> &params) {
+    // Parameters
+    double D = isV ? params[1] : params[0];
+    double F = params[2];
+    double k = params[3];
+    double h = params[4];
+    double c = D/(h*h);
+
+    // Row i of u and v, and rows i-1, i and i+1 of the diffusing species
+    const double *u = X + i*M;
+    const double *v = X + M*M + i*M;
+    const double *w = isV ? X + M*M : X;
+    const double *wUp = w + ((i+M-1) % M)*M;
+    const double *wRow = w + i*M;
+    const double *wDown = w + ((i+1) % M)*M;
+    double *dw = dX + (isV ? M*M : 0) + i*M;
+
+    auto point = [&](size_t j, size_t left, size_t right) {
+        double lap = wUp[j] + wDown[j] + wRow[left] + wRow[right] -
+        4*wRow[j];
+        double uvv = u[j]*v[j]*v[j];
+        dw[j] = c*lap + (isV ? uvv - (F + k)*v[j] : F*(1 - u[j]) - uvv);
+    };
+
+    // Only the first and last columns wrap around, so the interior loop
+    // has no index arithmetic and vectorizes
+    if (j0 == 0) {
+        point(0, M-1, 1);
+    }
+    for (size_t j = max(j0, size_t (1)); j < min(j1, M-1); j++) {
+        point(j, j-1, j+1);
+    }
+    if (j1 == M) {
+        point(M-1, M-2, 0);
+    }
+}
+
+/**
+ * Returns components begin to end-1 of the right-hand side of the
+ * Gray-Scott system (see grayScottRow) on an M x M periodic grid.
+ *
+ * @param t        Time value.
+ * @param X        u and v at the grid points.
+ * @param dX       Components begin to end-1 set to those of dX/dt.
+ * @param n        Number of states (2 M^2).
+ * @param begin    First component to be evaluated.
+ * @param end      One past the last component to be evaluated.
+ * @param params   Du, Dv, F, k and the grid spacing h.
+ */
+void grayScott(double t, const double *X, double *dX, size_t n, size_t begin,
+size_t end, const vector<double> &params) {
+    size_t M = size_t (sqrt(n/2.0) + 0.5);
+
+    // Split [begin, end) into pieces of grid rows
+    for (size_t p = begin; p < end; ) {
+        bool isV = p >= M*M;
+        size_t cell = p - (isV ? M*M : 0);
+        size_t i = cell/M;
+        size_t j0 = cell % M;
+        size_t j1 = min(M, j0 + (end - p));
+        grayScottRow(X, dX, M, i, j0, j1, isV, params);
+        p += j1 - j0;
+    }
+}
+
+/**
+ * Returns components begin to end-1 of the right-hand side of the Lorenz-96
+ * model, dX_i/dt = (X_{i+1} - X_{i-2}) X_{i-1} - X_i + F, with periodic
+ * indices.
+ *
+ * @param t        Time value.
+ * @param X        State.
+ * @param dX       Components begin to end-1 set to those of dX/dt.
+ * @param n        Number of states (at least 4).
+ * @param begin    First component to be evaluated.
+ * @param end      One past the last component to be evaluated.
+ * @param params   Forcing F.
+ */
+void lorenz96(double t, const double *X, double *dX, size_t n, size_t begin,
+size_t end, const vector<double> &params) {
+    double F = params[0];
+    auto wrapped = [&](size_t i) {
+        dX[i] = (X[(i+1) % n] - X[(i+n-2) % n])*X[(i+n-1) % n] - X[i] + F;
+    };
+
+    // Wrap around at both ends, the interior loop vectorizes
+    size_t lo = min(max(begin, size_t (2)), end);
+    size_t hi = max(min(end, n-1), lo);
+    for (size_t i = begin; i < lo; i++) {
+        wrapped(i);
+    }
+    for (size_t i = lo; i < hi; i++) {
+        dX[i] = (X[i+1] - X[i-2])*X[i-1] - X[i] + F;
+    }
+    for (size_t i = hi; i < end; i++) {
+        wrapped(i);
+    }
+}
+
+/**
+ * Runs kernel reps times and returns the bandwidth of the fastest run.
+ *
+ * @param kernel   Function to be timed.
+ * @param bytes    Bytes read and written by one run of kernel.
+ * @param reps     Number of runs.
+ * @return         Bandwidth in GB/s.
+ */
+template <typename F>
+double bandwidth(F kernel, double bytes, int reps=5) {
+    double best = 1e300;
+    for (int r = 0; r < reps; r++) {
+        auto start = chrono::steady_clock::now();
+        kernel();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+
+    return bytes/best/1e9;
+}
+
+/**
+ * Prints the throughput of the stage update and error norm kernels on
+ * vectors too large for the caches, next to a STREAM triad (taken as the
+ * attainable memory bandwidth) and the equivalent vecOps.h code. Byte counts
+ * include the read of a written array into the cache (write-allocate) unless
+ * it is also an input.
+ *
+ * @param n        Length of the vectors.
+ * @return         Nothing.
+ */
+void kernelReport(size_t n) {
+    const int m = 5;
+    alignedVec x(n, 1.0), y(n), k[m];
+    const double *kp[m];
+    double coeffs[m] = {0.1, -0.2, 0.3, -0.4, 0.5};
+    for (int j = 0; j < m; j++) {
+        k[j].assign(n, 0.01*(j+1));
+        kp[j] = k[j].data();
+    }
+    double R = 0;
+
+    // Triad a = b + s c, the usual measure of attainable bandwidth
+    double peak = bandwidth([&]() {
+        double *yp = y.data();
+        const double *xp = x.data(), *k0 = kp[0];
+        for (size_t i = 0; i < n; i++) {
+            yp[i] = xp[i] + 0.5*k0[i];
+        }
+    }, 4.0*8*n);
+    double axpy = bandwidth([&]() {
+        simdAxpy(n, 0.5, x.data(), y.data());
+    }, 3.0*8*n);
+    double linComb = bandwidth([&]() {
+        simdLinComb(n, y.data(), x.data(), m, coeffs, kp);
+    }, (m+3.0)*8*n);
+    double maxNorm = bandwidth([&]() {
+        R = simdMax(R, simdMaxScaledComb(n, x.data(), m, coeffs, kp));
+    }, (m+1.0)*8*n);
+
+    // The same stage update written with vecOps.h
+    vector<double> xv(n, 1.0), yv;
+    vector<vector<double>> kv(m);
+    for (int j = 0; j < m; j++) {
+        kv[j].assign(n, 0.01*(j+1));
+    }
+    double vecOpsComb = bandwidth([&]() {
+        yv = xv;
+        for (int j = 0; j < m; j++) {
+            yv = vecAdd(yv, scalMult(coeffs[j], kv[j]));
+        }
+    }, (m+3.0)*8*n, 2);
+
+    cout << "Kernels on " << n << " doubles (" << simdLevel() << ")" << endl;
+    cout << setw(34) << "kernel" << setw(10) << "GB/s";
+    cout << setw(12) << "% of triad" << endl;
+    vector<string> names {"triad (memory peak)", "simdAxpy",
+    "simdLinComb, 5 terms", "simdMaxScaledComb, 5 terms",
+    "vecAdd/scalMult, 5 terms"};
+    vector<double> rates {peak, axpy, linComb, maxNorm, vecOpsComb};
+    for (int i = 0; i < names.size(); i++) {
+        cout << setw(34) << names[i] << setw(10) << setprecision(3);
+        cout << rates[i] << setw(12) << 100*rates[i]/peak << endl;
+    }
+    // Print a value so the work cannot be optimized away
+    cout << "(max norm " << R << ", y[0] " << y[0] << ")" << endl << endl;
+}
+
+/**
+ * Writes an M x M field to a CSV file, one grid row per line.
+ *
+ * @param filename Name of the file.
+ * @param field    Field values (row-major).
+ * @param M        Number of grid points per side.
+ * @return         Nothing.
+ */
+void writeField(string filename, const double *field, size_t M) {
+    ofstream file(filename);
+    file << setprecision(6);
+    for (size_t i = 0; i < M; i++) {
+        for (size_t j = 0; j < M; j++) {
+            file << field[i*M+j] << (j+1 < M ? "," : "\n");
+        }
+    }
+    file.close();
+}
+
+/**
+ * Main function, reports the kernel throughput, integrates Gray-Scott on a
+ * 512 x 512 grid with adaptive RKF45, then times RK4 on Lorenz-96 with ten
+ * million states for increasing numbers of threads.
+ */
+int main() {
+    kernelReport(size_t (1e7));
+
+    // Gray-Scott with Pearson's parameters, seeded with a perturbed square
+    size_t M = 512;
+    double L = 2.5;
+    vector<double> params {2e-5, 1e-5, 0.04, 0.06, L/M};
+    alignedVec X(2*M*M);
+    for (size_t i = 0; i < M; i++) {
+        for (size_t j = 0; j < M; j++) {
+            bool seeded = (i > 7*M/16 && i < 9*M/16 && j > 7*M/16 &&
+            j < 9*M/16);
+            double noise = 0.01*sin(12.9898*i + 78.233*j);
+            X[i*M+j] = (seeded ? 0.5 : 1.0) + noise;
+            X[M*M + i*M+j] = (seeded ? 0.25 : 0.0) + noise*seeded;
+        }
+    }
+    rkWorkspace gs(grayScott, X.size(), params);
+    auto start = chrono::steady_clock::now();
+    gs.rkf45(X, 0, 200, 1e-6, 0.1);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    solverStats stats = gs.getStats();
+    cout << "Gray-Scott, " << X.size() << " states, RKF45 to t = 200 on ";
+    cout << gs.getThreads() << " threads: " << stats.nAccept << " steps, ";
+    cout << stats.nReject << " rejected, " << stats.nfev;
+    cout << " RHS evaluations, " << elapsed.count() << " s" << endl << endl;
+    writeField("GrayScott_v.csv", X.data() + M*M, M);
+
+    // Lorenz-96 (chaotic for F = 8), 1, 2, 4, ... threads up to one per core
+    size_t n = 10000000;
+    int nSteps = 10;
+    int maxThreads = max(1u, thread::hardware_concurrency());
+    alignedVec Y0(n, 8.0), Yserial;
+    Y0[0] += 0.01;
+    double tSerial = 0;
+    cout << "Lorenz-96, " << n << " states, " << nSteps << " RK4 steps";
+    cout << endl << setw(10) << "threads" << setw(14) << "ms per step";
+    cout << setw(10) << "speedup" << setw(12) << "identical" << endl;
+    for (int nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+        alignedVec Y = Y0;
+        rkWorkspace l96(lorenz96, n, {8.0}, nThreads);
+        start = chrono::steady_clock::now();
+        l96.rk4(Y, 0, 0.01*nSteps, nSteps);
+        elapsed = chrono::steady_clock::now() - start;
+        if (nThreads == 1) {
+            tSerial = elapsed.count();
+            Yserial = Y;
+        }
+        cout << setw(10) << nThreads << setw(14);
+        cout << elapsed.count()/nSteps*1e3 << setw(10);
+        cout << tSerial/elapsed.count() << setw(12);
+        cout << (Y == Yserial ? "yes" : "no") << endl;
+    }
+}
@@ -0,0 +1,185 @@
+// Written to compare the cost and accuracy of the scalar types the solvers
+// can be instantiated with
+#include <ODE.h>
+#include <doubleDouble.h>
+#include <chrono>
+
+/**
+ * Returns the right-hand side of the Lorenz-96 model,
+ * dX_i/dt = (X_{i+1} - X_{i-2}) X_{i-1} - X_i + F, with periodic indices.
+ *
+ * @param t        Time value.
+ * @param X        Vector of the dependent variables.
+ * @param params   Forcing F.
+ * @return         Vector of dX/dt values.
+ */
+template <typename T>
+vector<T> lorenz96(T t, vector<T> X, vector<T> params) {
+    int n = X.size();
+    T F = params[0];
+    vector<T> dX(n);
+    for (int i = 0; i < n; i++) {
+        dX[i] = (X[(i+1) % n] - X[(i+n-2) % n])*X[(i+n-1) % n] - X[i] + F;
+    }
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of the orbit problem of EarthOrbit.cpp, with
+ * the powers written as products so that it only needs +, -, * and /.
+ *
+ * @param t        Time value.
+ * @param X        r, dr/dt and theta.
+ * @param params   Mass of the central body and specific angular momentum.
+ * @return         Vector of dX/dt values.
+ */
+template <typename T>
+vector<T> orbit(T t, vector<T> X, vector<T> params) {
+    // Extract dependent variables from X vector
+    T r = X[0];
+    T dr = X[1];
+
+    // Constants
+    T G = 6.674e-11; // Gravitational constant
+    T M = params[0]; // Mass of the central body (kg)
+    T c = params[1]; // r^2 theta dot = angular momentum/orbiting mass
+
+    vector<T> dX {
+        dr,                          // dr/dt
+        c*c/(r*r*r) - G*M/(r*r),     // d^2r/dt^2
+        c/(r*r)                      // dtheta/dt
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the energy per unit orbiting mass, dr^2/2 + c^2/(2r^2) - GM/r,
+ * which the exact solution of the orbit problem conserves.
+ *
+ * @param X        r, dr/dt and theta.
+ * @param params   Mass of the central body and specific angular momentum.
+ * @return         Energy per unit mass.
+ */
+template <typename T>
+T orbitEnergy(const vector<T> &X, const vector<T> &params) {
+    T G = 6.674e-11;
+    T r = X[0];
+
+    return X[1]*X[1]/2 + params[1]*params[1]/(2*r*r) - G*params[0]/r;
+}
+
+/**
+ * Converts x to double-double without losing digits.
+ *
+ * @param x        Value to be converted.
+ * @return         x as a double-double.
+ */
+ddouble toDDouble(double x) {
+    return ddouble(x);
+}
+
+ddouble toDDouble(long double x) {
+    double hi = double(x);
+
+    return ddouble(hi, double(x - hi));
+}
+
+ddouble toDDouble(ddouble x) {
+    return x;
+}
+
+/**
+ * Times N RK4 steps of Lorenz-96 with n variables in scalar type T.
+ *
+ * @param n        Number of variables.
+ * @param N        Number of steps.
+ * @return         Seconds taken.
+ */
+template <typename T>
+double timeLorenz96(int n, int N) {
+    vector<T> X0(n, T(8));
+    X0[0] += T(0.01);
+    vector<T> params {T(8)};
+    vector<T> t = linspace<T>(0, 0.05*N, N);
+
+    auto start = chrono::steady_clock::now();
+    vector<vector<T>> X = RK4(lorenz96<T>, X0, t, params);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    // Print a value so the work cannot be optimized away
+    cout << "  (X_0(tf) = " << X.back()[0] << ")" << endl;
+
+    return elapsed.count();
+}
+
+/**
+ * Solves the Earth orbit problem over two years with Bulirsch-Stoer in
+ * scalar type T and prints the cost, the relative energy drift and the
+ * relative error of r(tf) against a reference value.
+ *
+ * @param name     Name of T to print.
+ * @param tol      Error tolerance.
+ * @param rRef     Reference r(tf) (in double-double).
+ * @return         Nothing.
+ */
+template <typename T>
+void orbitAccuracy(string name, double tol, ddouble rRef) {
+    vector<T> X0 {T(149.6e9), T(310), T(0)};
+    vector<T> params {T(1.9885e30), T(4.4407e15)};
+
+    auto start = chrono::steady_clock::now();
+    basicSolClass<T> sol = BulirschStoer(orbit<T>, X0, 0, 6.32e7, params, tol);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    // Differences are formed in double-double so they are not rounded away
+    vector<T> Xf = sol.getX().back();
+    ddouble E0 = toDDouble(orbitEnergy(X0, params));
+    ddouble Ef = toDDouble(orbitEnergy(Xf, params));
+    ddouble rf = toDDouble(Xf[0]);
+    double drift = double(abs((Ef - E0)/E0));
+    double err = double(abs((rf - rRef)/rRef));
+
+    cout << setw(12) << name << setw(10) << tol;
+    cout << setw(10) << sol.getStats().nfev << setw(12) << elapsed.count();
+    cout << setw(14) << drift << setw(14) << err << endl;
+}
+
+/**
+ * Main function, times RK4 on a large Lorenz-96 system in float and double,
+ * then compares double, long double and double-double solutions of the
+ * Earth orbit problem.
+ */
+int main() {
+    // float against double on a memory-bound problem
+    int n = 1 << 16;
+    int N = 20;
+    cout << "RK4 on Lorenz-96, " << n << " variables, " << N << " steps";
+    cout << endl;
+    double tFloat = timeLorenz96<float>(n, N);
+    double tDouble = timeLorenz96<double>(n, N);
+    cout << "float:  " << tFloat << " s" << endl;
+    cout << "double: " << tDouble << " s" << endl;
+    cout << "double/float: " << tDouble/tFloat << endl << endl;
+
+    // Reference from double-double at a tolerance well below double's
+    vector<ddouble> X0 {ddouble(149.6e9), ddouble(310), ddouble(0)};
+    vector<ddouble> params {ddouble(1.9885e30), ddouble(4.4407e15)};
+    basicSolClass<ddouble> ref = BulirschStoer(orbit<ddouble>, X0, 0, 6.32e7,
+    params, 1e-26);
+    ddouble rRef = ref.getX().back()[0];
+    cout << setprecision(32) << "Reference r(tf) = " << rRef << endl;
+    cout << setprecision(3);
+
+    cout << "Bulirsch-Stoer on the Earth orbit" << endl;
+    cout << setw(12) << "type" << setw(10) << "tol" << setw(10) << "nfev";
+    cout << setw(12) << "seconds" << setw(14) << "energy drift";
+    cout << setw(14) << "error r(tf)" << endl;
+    orbitAccuracy<double>("double", 1e-13, rRef);
+    orbitAccuracy<long double>("long double", 1e-13, rRef);
+    orbitAccuracy<long double>("long double", 1e-16, rRef);
+    orbitAccuracy<ddouble>("ddouble", 1e-13, rRef);
+    orbitAccuracy<ddouble>("ddouble", 1e-16, rRef);
+    orbitAccuracy<ddouble>("ddouble", 1e-20, rRef);
+}
@@ -0,0 +1,130 @@
+// Written to run Lyapunov sweeps through the work queue in workQueue.h
+#include <sys/wait.h>
+#include <Lyapunov.h>
+#include <workQueue.h>
+
+/**
+ * Returns the right-hand side of our ODE (currently the Lorenz system).
+ * 
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> ODE(double t, vector<double> X, vector<double> params) {
+    // Dependent variables
+    double x = X[0];
+    double y = X[1];
+    double z = X[2];
+
+    // Parameters
+    double sigma = params[0];
+    double rho = params[1];
+    double beta = params[2];
+
+    // dX/dt
+    vector<double> dX {
+        sigma*(y-x), // dx/dt
+        x*(rho-z)-y, // dy/dt
+        x*y-beta*z   // dz/dt
+    };
+
+    return dX;
+}
+
+/**
+ * Computes the Lyapunov spectra for one shard of the rho grid.
+ * 
+ * @param shard    Shard index.
+ * @param nShards  Number of shards the grid is split into.
+ * @return         CSV rows (rho, lambda1, lambda2, lambda3) of the shard.
+ */
+string runShard(int shard, int nShards) {
+    // Grid and integration settings
+    int nRho = 64;
+    vector<double> rho = linspace(20.0, 220.0, nRho-1);
+    vector<double> X0 {1.0, 1.0, 1.0};
+    double t0 = 0;
+    double tf = 100;
+    double tTrans = 20;
+    int N = int (1e4);
+
+    // Contiguous block of the grid belonging to this shard
+    int first = shard*nRho/nShards;
+    int last = (shard+1)*nRho/nShards;
+    vector<vector<double>> paramSets;
+    for (int i = first; i < last; i++) {
+        paramSets.push_back({10.0, rho[i], 8.0/3.0});
+    }
+    vector<vector<double>> spectra = lyapunovSweep(ODE, nullptr, X0, t0, tf, 
+    N, paramSets, 10, tTrans, 1);
+
+    stringstream rows;
+    rows << setprecision(15);
+    for (int i = first; i < last; i++) {
+        rows << rho[i];
+        for (int j = 0; j < 3; j++) {
+            rows << "," << spectra[i-first][j];
+        }
+        rows << endl;
+    }
+
+    return rows.str();
+}
+
+/**
+ * Main function. Usage:
+ *   ShardedSweep.out init DIR NSHARDS   create a queue in DIR
+ *   ShardedSweep.out work DIR [LEASE]   work on the queue in DIR until done
+ *   ShardedSweep.out merge DIR FILE     merge the results into FILE
+ *   ShardedSweep.out local NWORKERS     run NWORKERS local worker processes
+ *                                       against a temporary directory and
+ *                                       merge into Lyapunov_sweep.csv
+ * Workers on other hosts only need DIR to be on a shared filesystem.
+ */
+int main(int argc, char *argv[]) {
+    string mode = argc > 1 ? argv[1] : "local";
+    string header = "rho,lambda1,lambda2,lambda3";
+
+    if (mode == "init" && argc > 3) {
+        workQueue queue(argv[2]);
+        queue.create(stoi(argv[3]));
+    } else if (mode == "work" && argc > 2) {
+        double lease = argc > 3 ? stod(argv[3]) : 60;
+        workQueue queue(argv[2], lease);
+        ifstream file(string(argv[2]) + "/nTasks");
+        int nShards;
+        file >> nShards;
+        queue.runWorker([nShards](int i) { return runShard(i, nShards); });
+    } else if (mode == "merge" && argc > 3) {
+        workQueue queue(argv[2]);
+        queue.merge(argv[3], header);
+    } else if (mode == "local") {
+        int nWorkers = argc > 2 ? stoi(argv[2]) : 4;
+        int nShards = 4*nWorkers;
+        char dirTemplate[] = "/tmp/ShardedSweepXXXXXX";
+        string dir = mkdtemp(dirTemplate);
+        workQueue queue(dir, 5);
+        queue.create(nShards);
+
+        // Each child process is an independent worker
+        for (int w = 0; w < nWorkers; w++) {
+            if (fork() == 0) {
+                queue.runWorker([nShards](int i) { 
+                    return runShard(i, nShards); });
+                _exit(0);
+            }
+        }
+        while (wait(nullptr) > 0) {
+        }
+        queue.merge("Lyapunov_sweep.csv", header);
+        cout << "Merged " << nShards << " shards from " << dir;
+        cout << " into Lyapunov_sweep.csv" << endl;
+    } else {
+        cout << "Usage: " << argv[0] << " init DIR NSHARDS | work DIR [LEASE]";
+        cout << " | merge DIR FILE | local NWORKERS" << endl;
+        return 1;
+    }
+
+    return 0;
+}
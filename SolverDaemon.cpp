@@ -0,0 +1,258 @@
+// Written to run the bundled systems from a resident solver daemon, and to
+// measure the latency of solves sent to it
+#include <signal.h>
+#include <chrono>
+#include <solverDaemon.h>
+
+/**
+ * Returns the right-hand side of the Lorenz system.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> lorenz(double t, vector<double> X, vector<double> params) {
+    vector<double> dX {
+        params[0]*(X[1]-X[0]),
+        X[0]*(params[1]-X[2])-X[1],
+        X[0]*X[1]-params[2]*X[2]
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of the Rossler system.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> rossler(double t, vector<double> X, vector<double> params) {
+    vector<double> dX {
+        - X[1] - X[2],
+        X[0] + params[0] * X[1],
+        params[1] + X[2] * (X[0]-params[2])
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of the Van der Pol oscillator.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> vanderPol(double t, vector<double> X, vector<double> params) {
+    vector<double> dX {
+        X[1],
+        params[0]*(1-pow(X[0],2))*X[1] - X[0]
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of the Hindmarsh-Rose model.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> hindmarshRose(double t, vector<double> X,
+vector<double> params) {
+    double x = X[0];
+    double y = X[1];
+    double z = X[2];
+
+    vector<double> dX {
+        y-params[0]*pow(x,3)+params[1]*pow(x,2)-z+params[7],
+        params[2]-params[3]*pow(x,2)-y,
+        params[4]*(params[5]*(x-params[6])-z)
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of the simple pendulum.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> pendulum(double t, vector<double> X, vector<double> params) {
+    vector<double> dX {
+        X[1],
+        - params[0]/params[1] * cos(X[0])
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of the orbit of the Earth about the Sun in
+ * polar coordinates.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> orbit(double t, vector<double> X, vector<double> params) {
+    double G = 6.674e-11;
+    double r = X[0];
+    vector<double> dX {
+        X[1],
+        pow(params[1],2)/pow(r,3)-G*params[0]/pow(r,2),
+        params[1]/pow(r,2)
+    };
+
+    return dX;
+}
+
+/**
+ * Registers the bundled systems with a daemon.
+ *
+ * @param daemon   Daemon.
+ * @return         Nothing.
+ */
+void registerBuiltins(solverDaemon &daemon) {
+    daemon.registerSystem("Lorenz", lorenz, 3, 3);
+    daemon.registerSystem("Rossler", rossler, 3, 3);
+    daemon.registerSystem("VanderPol", vanderPol, 2, 1);
+    daemon.registerSystem("HindmarshRose", hindmarshRose, 3, 8);
+    daemon.registerSystem("SimplePendulum", pendulum, 2, 2);
+    daemon.registerSystem("EarthOrbit", orbit, 3, 2);
+}
+
+/**
+ * Sends the same request n times and prints the median and 99th percentile
+ * latency (time from sending the request to receiving the last row).
+ *
+ * @param name     Name of the measurement.
+ * @param client   Connection to the daemon.
+ * @param request  Request.
+ * @param n        Number of times to send it.
+ * @return         Nothing.
+ */
+void latency(string name, solverClient &client, const solveRequest &request,
+int n) {
+    vector<double> micros;
+    long rows = 0;
+    for (int i = 0; i < n; i++) {
+        rows = 0;
+        auto start = chrono::steady_clock::now();
+        client.solve(request, [&](double, const vector<double>&) {
+            rows++;
+        });
+        chrono::duration<double, micro> elapsed = chrono::steady_clock::now()
+        - start;
+        micros.push_back(elapsed.count());
+    }
+    sort(micros.begin(), micros.end());
+    cout << setw(30) << name << setw(10) << rows << setw(12);
+    cout << micros[n/2] << setw(12) << micros[min(n-1, n*99/100)];
+    cout << setw(8) << (client.fromCache ? "yes" : "no") << endl;
+}
+
+/**
+ * Main function. "SolverDaemon serve [socket]" runs a daemon with the
+ * bundled systems until it is interrupted. "SolverDaemon bench" (the
+ * default) starts one in this process and measures the latency of small
+ * solves, with and without the cache, and the rate rows are streamed at.
+ */
+int main(int argc, char *argv[]) {
+    string mode = (argc > 1) ? argv[1] : "bench";
+    string socketPath = (argc > 2) ? argv[2] : "/tmp/odesolver.sock";
+
+    if (mode == "serve") {
+        // Signals are taken by sigwait below, so block them in every thread
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+        solverDaemon daemon(socketPath);
+        registerBuiltins(daemon);
+        daemon.start();
+        cout << "Listening on " << socketPath << endl;
+        int sig;
+        sigwait(&signals, &sig);
+        daemon.stop();
+        cout << "Served " << daemon.served << " requests, ";
+        cout << daemon.cacheHits << " from the cache" << endl;
+        return 0;
+    }
+
+    solCache(".odedaemon").clear();
+    solverDaemon daemon(socketPath, 0, ".odedaemon");
+    registerBuiltins(daemon);
+    daemon.start();
+    solverClient client(socketPath);
+
+    cout << setprecision(4);
+    cout << setw(30) << "request" << setw(10) << "rows" << setw(12);
+    cout << "median us" << setw(12) << "p99 us" << setw(8) << "cached";
+    cout << endl;
+    solveRequest request;
+    request.system = "Lorenz";
+    request.method = "RK4";
+    request.t0 = 0;
+    request.tf = 1;
+    request.N = 100;
+    request.X0 = {1.0, 1.0, 1.0};
+    request.params = {10.0, 28.0, 8.0/3.0};
+    request.useCache = false;
+    latency("Lorenz RK4 N=100", client, request, 2000);
+    request.useCache = true;
+    latency("Lorenz RK4 N=100", client, request, 2000);
+    request.N = 10000;
+    request.useCache = false;
+    latency("Lorenz RK4 N=10^4", client, request, 200);
+    request.useCache = true;
+    latency("Lorenz RK4 N=10^4", client, request, 200);
+
+    request.system = "VanderPol";
+    request.method = "RKF45";
+    request.tf = 10;
+    request.N = 0;
+    request.tol = 1e-6;
+    request.X0 = {2.0, 0.0};
+    request.params = {1.0};
+    request.useCache = false;
+    latency("VanderPol RKF45 tf=10", client, request, 500);
+
+    // Throughput of a large streamed solve
+    request.system = "Lorenz";
+    request.method = "RK4";
+    request.tf = 100;
+    request.N = 1000000;
+    request.X0 = {1.0, 1.0, 1.0};
+    request.params = {10.0, 28.0, 8.0/3.0};
+    request.useCache = false;
+    long rows = 0;
+    auto start = chrono::steady_clock::now();
+    client.solve(request, [&](double, const vector<double>&) {
+        rows++;
+    });
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    cout << "Streamed " << rows << " rows in " << elapsed.count() << " s (";
+    cout << rows/elapsed.count() << " rows/s)" << endl;
+
+    // Errors come back as exceptions
+    request.system = "Lorentz";
+    try {
+        client.solve(request);
+    } catch (const runtime_error &e) {
+        cout << "Bad request: " << e.what() << endl;
+    }
+    solCache(".odedaemon").clear();
+}
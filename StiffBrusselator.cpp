@@ -0,0 +1,278 @@
+// Written to show implicit solves of method of lines systems with the sparse
+// and banded Jacobians of sparseJacobian.h
+#include <sparseJacobian.h>
+#include <chrono>
+
+/**
+ * Returns the right-hand side of the Brusselator reaction-diffusion system
+ *   u_t = 1 + u^2 v - 4u + alpha u_xx,
+ *   v_t = 3u - u^2 v + alpha v_xx,
+ * on [0, 1] with u = 1, v = 3 at both ends, discretised at N interior
+ * points. X holds (u_1, v_1, u_2, v_2, ...), so the Jacobian is banded with
+ * two sub- and superdiagonals.
+ *
+ * @param t        Time value.
+ * @param X        u and v at the grid points (interleaved).
+ * @param dX       Set to du/dt and dv/dt at the grid points.
+ * @param n        Number of states (2N).
+ * @param params   alpha.
+ */
+void brusselator1D(double t, const double *X, double *dX, size_t n,
+const vector<double> &params) {
+    size_t N = n/2;
+    double c = params[0]*(N+1)*(N+1);
+
+    for (size_t i = 0; i < N; i++) {
+        double u = X[2*i];
+        double v = X[2*i+1];
+        double uLeft = (i > 0) ? X[2*i-2] : 1.0;
+        double vLeft = (i > 0) ? X[2*i-1] : 3.0;
+        double uRight = (i+1 < N) ? X[2*i+2] : 1.0;
+        double vRight = (i+1 < N) ? X[2*i+3] : 3.0;
+        dX[2*i] = 1 + u*u*v - 4*u + c*(uLeft - 2*u + uRight);
+        dX[2*i+1] = 3*u - u*u*v + c*(vLeft - 2*v + vRight);
+    }
+}
+
+/**
+ * Returns the right-hand side of the Brusselator on [0, 1]^2 with u = 1,
+ * v = 3 on the boundary, discretised at M x M interior points with the five
+ * point Laplacian. X holds (u, v) of each grid point, row by row.
+ *
+ * @param t        Time value.
+ * @param X        u and v at the grid points (interleaved).
+ * @param dX       Set to du/dt and dv/dt at the grid points.
+ * @param n        Number of states (2 M^2).
+ * @param params   alpha.
+ */
+void brusselator2D(double t, const double *X, double *dX, size_t n,
+const vector<double> &params) {
+    size_t M = size_t (sqrt(n/2.0) + 0.5);
+    double c = params[0]*(M+1)*(M+1);
+    // Value of species s at grid point (i, j), or its boundary value
+    auto at = [&](long i, long j, int s) {
+        if (i < 0 || j < 0 || i >= long (M) || j >= long (M)) {
+            return s == 0 ? 1.0 : 3.0;
+        }
+        return X[2*(i*M+j) + s];
+    };
+
+    for (long i = 0; i < long (M); i++) {
+        for (long j = 0; j < long (M); j++) {
+            double u = at(i, j, 0);
+            double v = at(i, j, 1);
+            double lapU = at(i-1, j, 0) + at(i+1, j, 0) + at(i, j-1, 0) +
+            at(i, j+1, 0) - 4*u;
+            double lapV = at(i-1, j, 1) + at(i+1, j, 1) + at(i, j-1, 1) +
+            at(i, j+1, 1) - 4*v;
+            dX[2*(i*M+j)] = 1 + u*u*v - 4*u + c*lapU;
+            dX[2*(i*M+j)+1] = 3*u - u*u*v + c*lapV;
+        }
+    }
+}
+
+/**
+ * Returns the sparsity pattern of the 2D Brusselator's Jacobian: u and v
+ * of a grid point depend on u and v at that point and on the same species
+ * at its four neighbours.
+ *
+ * @param M        Number of grid points per side.
+ * @return         Sparsity pattern.
+ */
+sparsityPattern brusselator2DPattern(size_t M) {
+    vector<pair<size_t, size_t>> entries;
+    for (size_t i = 0; i < M; i++) {
+        for (size_t j = 0; j < M; j++) {
+            size_t p = i*M + j;
+            for (int s = 0; s < 2; s++) {
+                entries.push_back({2*p+s, 2*p});
+                entries.push_back({2*p+s, 2*p+1});
+                if (i > 0) {
+                    entries.push_back({2*p+s, 2*(p-M)+s});
+                }
+                if (i+1 < M) {
+                    entries.push_back({2*p+s, 2*(p+M)+s});
+                }
+                if (j > 0) {
+                    entries.push_back({2*p+s, 2*(p-1)+s});
+                }
+                if (j+1 < M) {
+                    entries.push_back({2*p+s, 2*(p+1)+s});
+                }
+            }
+        }
+    }
+
+    return sparsityPattern(2*M*M, entries);
+}
+
+// Factor I - h J with either kind of LU
+void factorIteration(bandedLU &lu, const csrMatrix &M) {
+    lu.factor(bandedMatrix(M));
+}
+
+void factorIteration(sparseLU &lu, const csrMatrix &M) {
+    lu.factor(M);
+}
+
+/**
+ * Integrates from t0 to tf with N steps of backward Euler, solving each step
+ * by simplified Newton iterations with the matrix I - h J. The Jacobian is
+ * estimated with column coloring and I - h J is factored only when Newton
+ * converges slowly, so one factorization usually serves many steps.
+ *
+ * @param f        Function that writes dX/dt into its third argument.
+ * @param X        State at t0, overwritten with the state at tf.
+ * @param t0       Initial time.
+ * @param tf       Final time.
+ * @param N        Number of steps.
+ * @param params   Vector of parameter values.
+ * @param pattern  Sparsity pattern of the Jacobian.
+ * @param lu       LU factorization to use (bandedLU or sparseLU, analyzed
+ * already in the latter case).
+ * @param stats    nfev counts RHS evaluations (including those for
+ * Jacobians), nAccept steps and nReject the Jacobian/factorization updates.
+ * @return         Nothing.
+ */
+template <typename LU>
+void backwardEuler(inPlaceRHS f, vector<double> &X, double t0, double tf,
+int N, const vector<double> &params, const sparsityPattern &pattern, LU &lu,
+solverStats &stats) {
+    size_t n = X.size();
+    double h = (tf-t0)/N;
+    int nColors;
+    vector<int> colors = colorColumns(pattern, nColors);
+    csrMatrix J(pattern);
+    vector<double> fX(n), Z(n), fZ(n), r(n);
+    bool refresh = true;
+
+    for (int step = 0; step < N; step++) {
+        double t = t0 + step*h;
+        bool converged = false;
+        for (int attempt = 0; attempt < 2 && !converged; attempt++) {
+            if (refresh) {
+                f(t, X.data(), fX.data(), n, params);
+                stats.nfev += 1 + estimateJacobian(f, t, X.data(), fX.data(),
+                params, colors, nColors, J);
+                factorIteration(lu, iterationMatrix(J, h));
+                stats.nReject++;
+                refresh = false;
+            }
+
+            // Newton iterations for Z = X + h f(t+h, Z)
+            Z = X;
+            int it;
+            for (it = 1; it <= 8 && !converged; it++) {
+                f(t + h, Z.data(), fZ.data(), n, params);
+                stats.nfev++;
+                for (size_t i = 0; i < n; i++) {
+                    r[i] = X[i] + h*fZ[i] - Z[i];
+                }
+                lu.solve(r.data());
+                double norm = 0;
+                for (size_t i = 0; i < n; i++) {
+                    Z[i] += r[i];
+                    norm = max(norm, abs(r[i])/(1 + abs(Z[i])));
+                }
+                converged = norm < 1e-8;
+            }
+            // Slow convergence means the Jacobian is out of date
+            if (!converged || it > 5) {
+                refresh = true;
+            }
+        }
+        if (!converged) {
+            throw runtime_error("backwardEuler: Newton iterations failed");
+        }
+        X = Z;
+        stats.nAccept++;
+    }
+}
+
+/**
+ * Prints a summary of a backward Euler run.
+ *
+ * @param name     Description of the run.
+ * @param n        Number of states.
+ * @param stats    Counts from backwardEuler.
+ * @param seconds  Time taken.
+ * @return         Nothing.
+ */
+void report(string name, size_t n, solverStats stats, double seconds) {
+    cout << setw(22) << name << setw(8) << stats.nAccept << setw(8);
+    cout << stats.nReject << setw(10) << stats.nfev << setw(14);
+    cout << stats.nReject*n << setw(10) << setprecision(3) << seconds << endl;
+}
+
+/**
+ * Main function, solves the 1D Brusselator with banded and sparse LU and
+ * the 2D Brusselator with sparse LU, by backward Euler.
+ */
+int main() {
+    vector<double> params {1.0/50};
+    int nColors;
+
+    // 1D problem, 1000 grid points
+    size_t N = 1000;
+    vector<double> X0(2*N);
+    for (size_t i = 0; i < N; i++) {
+        X0[2*i] = 1 + sin(2*M_PI*(i+1)/(N+1));
+        X0[2*i+1] = 3;
+    }
+    sparsityPattern band = sparsityPattern::banded(2*N, 2, 2);
+    colorColumns(band, nColors);
+    cout << "1D Brusselator: " << 2*N << " states, " << band.nnz();
+    cout << " Jacobian nonzeros, " << nColors << " colors" << endl;
+    cout << setw(22) << "run" << setw(8) << "steps" << setw(8) << "jacs";
+    cout << setw(10) << "nfev" << setw(14) << "nfev (dense)";
+    cout << setw(10) << "seconds" << endl;
+
+    vector<double> XBand = X0, XSparse = X0;
+    solverStats bandStats, sparseStats;
+    bandedLU bandLU;
+    auto start = chrono::steady_clock::now();
+    backwardEuler(brusselator1D, XBand, 0, 10, 1000, params, band, bandLU,
+    bandStats);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    report("banded LU", 2*N, bandStats, elapsed.count());
+
+    sparseLU spLU;
+    start = chrono::steady_clock::now();
+    spLU.analyze(band);
+    backwardEuler(brusselator1D, XSparse, 0, 10, 1000, params, band, spLU,
+    sparseStats);
+    elapsed = chrono::steady_clock::now() - start;
+    report("sparse LU", 2*N, sparseStats, elapsed.count());
+    double diff = 0;
+    for (size_t i = 0; i < 2*N; i++) {
+        diff = max(diff, abs(XBand[i] - XSparse[i]));
+    }
+    cout << "max |banded - sparse| at t = 10: " << diff << endl;
+    cout << "u(0.5, 10) = " << setprecision(8) << XBand[N-1] << endl << endl;
+
+    // 2D problem, 64 x 64 grid points
+    size_t M = 64;
+    vector<double> Y(2*M*M);
+    for (size_t i = 0; i < M; i++) {
+        for (size_t j = 0; j < M; j++) {
+            double x = (i+1.0)/(M+1), y = (j+1.0)/(M+1);
+            Y[2*(i*M+j)] = 1 + sin(2*M_PI*x)*sin(2*M_PI*y);
+            Y[2*(i*M+j)+1] = 3;
+        }
+    }
+    sparsityPattern grid = brusselator2DPattern(M);
+    colorColumns(grid, nColors);
+    solverStats gridStats;
+    sparseLU gridLU;
+    start = chrono::steady_clock::now();
+    gridLU.analyze(grid);
+    backwardEuler(brusselator2D, Y, 0, 10, 200, params, grid, gridLU,
+    gridStats);
+    elapsed = chrono::steady_clock::now() - start;
+    cout << "2D Brusselator: " << 2*M*M << " states, " << grid.nnz();
+    cout << " Jacobian nonzeros, " << nColors << " colors, ";
+    cout << gridLU.nnz() << " entries in L and U" << endl;
+    report("sparse LU", 2*M*M, gridStats, elapsed.count());
+    cout << "u(0.5, 0.5, 10) = " << setprecision(8);
+    cout << Y[2*((M/2)*M + M/2)] << endl;
+}
@@ -0,0 +1,198 @@
+// Written to compute ensemble statistics of noisy versions of the
+// Hindmarsh-Rose model and the simple pendulum with sde.h
+#include <chrono>
+#include <sde.h>
+
+/**
+ * Returns the drift of the Ornstein-Uhlenbeck process.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our SDE.
+ * @param params   An array of parameter values (as doubles) for our SDE.
+ * @return         Vector of drift values.
+ */
+vector<double> ouDrift(double t, vector<double> X, vector<double> params) {
+    vector<double> dX {
+        -params[0]*X[0]
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the (additive) diffusion of the Ornstein-Uhlenbeck process.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our SDE.
+ * @param params   An array of parameter values (as doubles) for our SDE.
+ * @return         Vector of diffusion values.
+ */
+vector<double> ouDiffusion(double t, vector<double> X, vector<double> params) {
+    vector<double> dW {
+        params[1]
+    };
+
+    return dW;
+}
+
+/**
+ * Returns the drift of the Hindmarsh-Rose model.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our SDE.
+ * @param params   An array of parameter values (as doubles) for our SDE.
+ * @return         Vector of drift values.
+ */
+vector<double> hindmarshRose(double t, vector<double> X,
+vector<double> params) {
+    double x = X[0];
+    double y = X[1];
+    double z = X[2];
+
+    double a = params[0];
+    double b = params[1];
+    double c = params[2];
+    double d = params[3];
+    double r = params[4];
+    double s = params[5];
+    double xR = params[6];
+    double I = params[7];
+
+    vector<double> dX {
+        y-a*pow(x,3)+b*pow(x,2)-z+I,
+        c-d*pow(x,2)-y,
+        r*(s*(x-xR)-z)
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the diffusion of the Hindmarsh-Rose model, additive noise of
+ * strength params[8] in the membrane potential x.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our SDE.
+ * @param params   An array of parameter values (as doubles) for our SDE.
+ * @return         Vector of diffusion values.
+ */
+vector<double> hindmarshRoseNoise(double t, vector<double> X,
+vector<double> params) {
+    vector<double> dW {
+        params[8],
+        0,
+        0
+    };
+
+    return dW;
+}
+
+/**
+ * Returns the drift of the simple pendulum.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our SDE.
+ * @param params   An array of parameter values (as doubles) for our SDE.
+ * @return         Vector of drift values.
+ */
+vector<double> pendulum(double t, vector<double> X, vector<double> params) {
+    double theta = X[0];
+    double dtheta = X[1];
+
+    double g = params[0];
+    double l = params[1];
+
+    vector<double> dX {
+        dtheta,
+        - g/l * cos(theta)
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the diffusion of the simple pendulum, multiplicative noise of
+ * relative strength params[2] in the angular velocity.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our SDE.
+ * @param params   An array of parameter values (as doubles) for our SDE.
+ * @return         Vector of diffusion values.
+ */
+vector<double> pendulumNoise(double t, vector<double> X,
+vector<double> params) {
+    vector<double> dW {
+        0,
+        params[2]*X[1]
+    };
+
+    return dW;
+}
+
+/**
+ * Runs an ensemble, writes its statistics to name_stats.csv and prints the
+ * mean and variance at the final time and the number of steps per second.
+ *
+ * @param name     Name of the run (also used for the CSV file).
+ * @param f        Drift.
+ * @param g        Diffusion.
+ * @param X0       Initial condition of every path.
+ * @param tf       Final time.
+ * @param N        Number of steps of each path.
+ * @param params   Vector of parameter values.
+ * @param nPaths   Number of paths.
+ * @param method   "EulerMaruyama" or "Milstein".
+ * @param headings Names of the components.
+ * @return         Statistics of the ensemble.
+ */
+welfordStats runEnsemble(string name, vector<double>(*f)(double,
+vector<double>, vector<double>), vector<double>(*g)(double, vector<double>,
+vector<double>), vector<double> X0, double tf, long N, vector<double> params,
+long nPaths, string method, vector<string> headings) {
+    int nSamples = 100;
+    auto start = chrono::steady_clock::now();
+    welfordStats stats = sdeEnsemble(f, g, X0, 0.0, tf, N, params, nPaths,
+    2021, nSamples, method);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    vector<double> t;
+    for (int k = 0; k <= nSamples; k++) {
+        t.push_back(k*tf/nSamples);
+    }
+    stats.writeCSV(name + "_stats.csv", t, headings);
+    vector<double> var = stats.variance(nSamples);
+    cout << name << " (" << method << ", " << nPaths << " paths), at t = ";
+    cout << tf << ":" << endl;
+    for (int j = 0; j < headings.size(); j++) {
+        cout << "    " << setw(10) << headings[j] << " mean " << setw(12);
+        cout << stats.mean[size_t (nSamples)*X0.size() + j] << ", variance ";
+        cout << setw(12) << var[j] << endl;
+    }
+    cout << "    " << nPaths*N/elapsed.count() << " steps per second" << endl;
+
+    return stats;
+}
+
+/**
+ * Main function, checks the ensemble statistics of the Ornstein-Uhlenbeck
+ * process against its exact mean and variance, then runs the noisy
+ * Hindmarsh-Rose model and the noisy simple pendulum. The number of paths
+ * can be given as the first argument (default 10^4).
+ */
+int main(int argc, char *argv[]) {
+    long nPaths = (argc > 1) ? atol(argv[1]) : 10000;
+    cout << setprecision(6);
+
+    // dX = -theta X dt + sigma dW has mean X0 e^(-theta t) and variance
+    // sigma^2 (1 - e^(-2 theta t))/(2 theta)
+    runEnsemble("OrnsteinUhlenbeck", ouDrift, ouDiffusion, {1.0}, 2.0, 2000,
+    {1.0, 0.5}, nPaths, "EulerMaruyama", {"x"});
+    cout << "    exact mean " << exp(-2.0) << ", exact variance ";
+    cout << 0.125*(1 - exp(-4.0)) << endl;
+
+    runEnsemble("HindmarshRose", hindmarshRose, hindmarshRoseNoise,
+    {1.0, 1.0, 1.0}, 100.0, 10000, {1.0, 3.0, 1.0, 5.0, 1e-3, 4.0, -1.6, 3.25,
+    0.1}, nPaths, "EulerMaruyama", {"x", "y", "z"});
+    runEnsemble("SimplePendulum", pendulum, pendulumNoise, {0.0, 0.0}, 10.0,
+    10000, {9.8, 1.0, 0.2}, nPaths, "Milstein", {"theta", "thetaDot"});
+}
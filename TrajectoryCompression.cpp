@@ -0,0 +1,227 @@
+// Written to measure the compressed trajectory format of trajectoryCodec.h
+// on the bundled systems
+#include <chrono>
+#include <ODE.h>
+#include <trajectoryCodec.h>
+
+/**
+ * Returns the right-hand side of the Lorenz system.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> lorenz(double t, vector<double> X, vector<double> params) {
+    vector<double> dX {
+        params[0]*(X[1]-X[0]),
+        X[0]*(params[1]-X[2])-X[1],
+        X[0]*X[1]-params[2]*X[2]
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of the Chen system.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> chen(double t, vector<double> X, vector<double> params) {
+    double a = params[0], b = params[1], c = params[2];
+    vector<double> dX {
+        a*(X[1]-X[0]),
+        X[0]*(c-a-X[2])+c*X[1],
+        X[0]*X[1]-b*X[2]
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of the Rossler system.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> rossler(double t, vector<double> X, vector<double> params) {
+    vector<double> dX {
+        - X[1] - X[2],
+        X[0] + params[0] * X[1],
+        params[1] + X[2] * (X[0]-params[2])
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of Thomas' cyclically symmetric system.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> thomas(double t, vector<double> X, vector<double> params) {
+    vector<double> dX {
+        sin(X[1])-params[0]*X[0],
+        sin(X[2])-params[0]*X[1],
+        sin(X[0])-params[0]*X[2]
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of the Van der Pol oscillator.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> vanderPol(double t, vector<double> X, vector<double> params) {
+    vector<double> dX {
+        X[1],
+        params[0]*(1-pow(X[0],2))*X[1] - X[0]
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the right-hand side of the orbit of the Earth about the Sun in
+ * polar coordinates.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> orbit(double t, vector<double> X, vector<double> params) {
+    double G = 6.674e-11;
+    double r = X[0];
+    vector<double> dX {
+        X[1],
+        pow(params[1],2)/pow(r,3)-G*params[0]/pow(r,2),
+        params[1]/pow(r,2)
+    };
+
+    return dX;
+}
+
+/**
+ * Returns the size of a file in bytes.
+ *
+ * @param filename Name of the file.
+ * @return         Size in bytes.
+ */
+double fileSize(string filename) {
+    struct stat info;
+    stat(filename.c_str(), &info);
+
+    return info.st_size;
+}
+
+/**
+ * Writes a solution as CSV (precision 15) and in the compressed format,
+ * decodes every column again and prints the sizes, the encode and decode
+ * speeds (in GB of raw doubles per second) and whether the round trip was
+ * exact.
+ *
+ * @param name     Name of the run.
+ * @param t        t values of the solution (a vector or a uniformGrid).
+ * @param X        X values of the solution.
+ * @return         Nothing.
+ */
+template <typename Grid>
+void report(string name, const Grid &t, const vector<vector<double>> &X) {
+    vector<string> headings {"t"};
+    for (int j = 0; j < X[0].size(); j++) {
+        headings.push_back("x" + to_string(j+1));
+    }
+    double raw = double (t.size())*headings.size()*sizeof(double);
+
+    {
+        asyncCSVWriter<double> csv("compress_test.csv", headings, 15);
+        for (size_t i = 0; i < t.size(); i++) {
+            csv(t[i], X[i]);
+        }
+    }
+    double csvBytes = fileSize("compress_test.csv");
+    unlink("compress_test.csv");
+
+    auto start = chrono::steady_clock::now();
+    double bytes = writeTrajectory("compress_test.trj", t, X, headings);
+    chrono::duration<double> encode = chrono::steady_clock::now() - start;
+
+    // Decode column by column, which is what the format is laid out for
+    vector<vector<double>> cols(headings.size());
+    start = chrono::steady_clock::now();
+    {
+        trajectoryReader reader("compress_test.trj");
+        for (size_t b = 0; b < reader.nBlocks(); b++) {
+            for (int c = 0; c < cols.size(); c++) {
+                reader.readColumn(b, c, cols[c]);
+            }
+        }
+    }
+    chrono::duration<double> decode = chrono::steady_clock::now() - start;
+    unlink("compress_test.trj");
+
+    // Lossless means bit for bit
+    bool exact = cols[0].size() == t.size();
+    for (size_t i = 0; exact && i < t.size(); i++) {
+        double ti = t[i];
+        exact = memcmp(&ti, &cols[0][i], sizeof(double)) == 0;
+        for (int j = 0; exact && j < X[i].size(); j++) {
+            exact = memcmp(&X[i][j], &cols[j+1][i], sizeof(double)) == 0;
+        }
+    }
+
+    cout << setw(16) << name << setw(10) << t.size() << setprecision(3);
+    cout << setw(10) << 8*bytes/(raw/sizeof(double)) << setw(10);
+    cout << csvBytes/bytes << setw(10) << raw/bytes << setw(10);
+    cout << raw/encode.count()/1e9 << setw(10) << raw/decode.count()/1e9;
+    cout << setw(8) << (exact ? "yes" : "NO") << endl;
+}
+
+/**
+ * Main function, solves each bundled system with RK4 on a uniform grid (and
+ * the Lorenz system also with RKF45) and reports how well the solutions
+ * compress. The number of steps can be given as the first argument
+ * (default 1e6).
+ */
+int main(int argc, char *argv[]) {
+    long N = (argc > 1) ? atol(argv[1]) : 1000000;
+
+    cout << setw(16) << "system" << setw(10) << "rows" << setw(10);
+    cout << "bits/val" << setw(10) << "vs CSV" << setw(10) << "vs raw";
+    cout << setw(10) << "enc GB/s" << setw(10) << "dec GB/s" << setw(8);
+    cout << "exact" << endl;
+
+    uniformGrid<double> grid(0, 100, N);
+    report("Lorenz RK4", grid, RK4(lorenz, {1.0, 1.0, 1.0}, grid,
+    {10.0, 28.0, 8.0/3.0}));
+    report("Chen RK4", grid, RK4(chen, {-0.1, 0.5, -0.6}, grid,
+    {40.0, 3.0, 28.0}));
+    report("Rossler RK4", grid, RK4(rossler, {-0.1, 0.5, -0.6}, grid,
+    {0.1, 0.1, 14.0}));
+    grid = uniformGrid<double>(0, 1000, N);
+    report("Thomas RK4", grid, RK4(thomas, {-0.5, -1.0, -2.0}, grid,
+    {0.1998}));
+    grid = uniformGrid<double>(0, 100, N);
+    report("VanderPol RK4", grid, RK4(vanderPol, {1.0, 1.0}, grid, {1.0}));
+    grid = uniformGrid<double>(0, 3.16e7, N);
+    report("EarthOrbit RK4", grid, RK4(orbit, {149.6e9, 310, 0}, grid,
+    {1.9885e30, 4.4407e15}));
+
+    solClass solution(lorenz, {1.0, 1.0, 1.0}, 0.0, 100.0,
+    {10.0, 28.0, 8.0/3.0}, 1e-9);
+    report("Lorenz RKF45", solution.getT(), solution.getX());
+}
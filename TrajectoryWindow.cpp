@@ -0,0 +1,173 @@
+// Written to read time windows out of long stored trajectories, and to
+// compare seeking in a compressed trajectory file with scanning a CSV file
+#include <chrono>
+#include <ODE.h>
+#include <trajectoryCodec.h>
+
+/**
+ * Returns the right-hand side of the Lorenz system.
+ *
+ * @param t        A double pertaining to the value of time in our system.
+ * @param X        An array of values of the dependent variables for our ODE.
+ * @param params   An array of parameter values (as doubles) for our ODE.
+ * @return         Vector of dX/dt values.
+ */
+vector<double> lorenz(double t, vector<double> X, vector<double> params) {
+    vector<double> dX {
+        params[0]*(X[1]-X[0]),
+        X[0]*(params[1]-X[2])-X[1],
+        X[0]*X[1]-params[2]*X[2]
+    };
+
+    return dX;
+}
+
+/**
+ * Reads the rows of a CSV file written by writeToCSV whose t value lies in
+ * [t1, t2], the only way without an index: scanning from the beginning
+ * until t passes t2.
+ *
+ * @param filename Name of the CSV file.
+ * @param t1       Start of the window.
+ * @param t2       End of the window.
+ * @param t        Set to the t values in the window.
+ * @param X        Set to the X values in the window.
+ * @return         Nothing.
+ */
+void scanCSV(string filename, double t1, double t2, vector<double> &t,
+vector<vector<double>> &X) {
+    t.clear();
+    X.clear();
+    ifstream file(filename);
+    string line;
+    getline(file, line);
+    while (getline(file, line)) {
+        char *end;
+        double ti = strtod(line.c_str(), &end);
+        if (ti > t2) {
+            break;
+        }
+        if (ti >= t1) {
+            t.push_back(ti);
+            X.push_back(vector<double>());
+            while (*end == ',') {
+                X.back().push_back(strtod(end + 1, &end));
+            }
+        }
+    }
+}
+
+/**
+ * Returns the number of seconds since start.
+ *
+ * @param start    Start time.
+ * @return         Elapsed seconds.
+ */
+double since(chrono::steady_clock::time_point start) {
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    return elapsed.count();
+}
+
+/**
+ * Writes the rows of a trajectory file in [t1, t2] to standard output as
+ * CSV, like writeToCSV with precision 15.
+ *
+ * @param filename Name of the trajectory file.
+ * @param t1       Start of the window.
+ * @param t2       End of the window.
+ * @param stride   Keep every stride-th row.
+ * @return         Nothing.
+ */
+void printWindow(string filename, double t1, double t2, long stride) {
+    trajectoryReader reader(filename);
+    vector<double> t;
+    vector<vector<double>> X;
+    reader.readWindow(t1, t2, t, X, stride);
+    for (size_t c = 0; c < reader.headings.size(); c++) {
+        cout << reader.headings[c];
+        cout << ((c + 1 < reader.headings.size()) ? "," : "\n");
+    }
+    cout << setprecision(15);
+    for (size_t i = 0; i < t.size(); i++) {
+        cout << t[i];
+        for (size_t j = 0; j < X[i].size(); j++) {
+            cout << "," << X[i][j];
+        }
+        cout << "\n";
+    }
+}
+
+/**
+ * Main function. "TrajectoryWindow window file t1 t2 [stride]" writes the
+ * rows of a trajectory file with t in [t1, t2] (every stride-th one) to
+ * standard output as CSV, which is how plotTools.importWindow loads a
+ * slice. "TrajectoryWindow bench [N]" (the default) writes N RK4 steps
+ * (default 2e6) of the Lorenz system over [0, 2000] as CSV and as a
+ * trajectory file and times reading windows from each.
+ */
+int main(int argc, char *argv[]) {
+    string mode = (argc > 1) ? argv[1] : "bench";
+    if (mode == "window") {
+        if (argc < 5) {
+            cerr << "Usage: TrajectoryWindow window file t1 t2 [stride]";
+            cerr << endl;
+            return 1;
+        }
+        printWindow(argv[2], atof(argv[3]), atof(argv[4]),
+        (argc > 5) ? atol(argv[5]) : 1);
+        return 0;
+    }
+
+    long N = (argc > 2) ? atol(argv[2]) : 2000000;
+    vector<string> headings {"t", "x", "y", "z"};
+    {
+        asyncCSVWriter<double> csv("window_test.csv", headings, 15);
+        trajectoryWriter trajectory("window_test.trj", headings);
+        RK4Stream(lorenz, {1.0, 1.0, 1.0}, uniformGrid<double>(0, 2000, N),
+        {10.0, 28.0, 8.0/3.0}, [&](double ti, const vector<double> &Xi) {
+            csv(ti, Xi);
+            trajectory(ti, Xi);
+        });
+    }
+
+    trajectoryReader reader("window_test.trj");
+    cout << N + 1 << " rows in " << reader.nBlocks() << " blocks" << endl;
+    cout << setw(20) << "window" << setw(8) << "stride" << setw(10);
+    cout << "rows" << setw(12) << "CSV scan s" << setw(12) << "seek s";
+    cout << setw(10) << "speedup" << setw(8) << "match" << endl;
+    double windows[][3] = {{1, 2, 1}, {1000, 1001, 1}, {1990, 2000, 1},
+    {0, 2000, 1000}};
+    for (int w = 0; w < 4; w++) {
+        double t1 = windows[w][0], t2 = windows[w][1];
+        long stride = windows[w][2];
+        vector<double> tCSV, tTrj;
+        vector<vector<double>> XCSV, XTrj;
+
+        auto start = chrono::steady_clock::now();
+        scanCSV("window_test.csv", t1, t2, tCSV, XCSV);
+        double scanTime = since(start);
+
+        start = chrono::steady_clock::now();
+        reader.readWindow(t1, t2, tTrj, XTrj, stride);
+        double seekTime = since(start);
+
+        // The CSV holds 15 digits, so compare to that precision
+        bool match = (tCSV.size() + stride - 1)/stride == tTrj.size();
+        for (size_t i = 0; match && i < tTrj.size(); i++) {
+            match = abs(tTrj[i] - tCSV[i*stride]) <= 1e-12*max(t2, 1.0);
+            for (size_t j = 0; match && j < XTrj[i].size(); j++) {
+                match = abs(XTrj[i][j] - XCSV[i*stride][j]) <=
+                1e-13*max(abs(XTrj[i][j]), 1.0);
+            }
+        }
+
+        cout << setw(20) << "[" + to_string(int(t1)) + ", " +
+        to_string(int(t2)) + "]" << setw(8) << stride << setw(10);
+        cout << tTrj.size() << setprecision(4) << setw(12) << scanTime;
+        cout << setw(12) << seekTime << setw(10) << scanTime/seekTime;
+        cout << setw(8) << (match ? "yes" : "NO") << endl;
+    }
+    unlink("window_test.csv");
+    unlink("window_test.trj");
+}
@@ -0,0 +1,357 @@
+#ifndef ASYNCOUTPUT_H
+#define ASYNCOUTPUT_H
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <trace.h>
+
+using namespace std;
+
+/**
+ * Lock-free ring buffer for one producer thread and one consumer thread.
+ * The producer only writes tail and the consumer only writes head, so each
+ * side needs a single atomic store per element; they are padded a cache
+ * line apart so the two threads do not contend for one. Padding is used
+ * rather than alignas(64), which would make the ring (and any class holding
+ * one) over-aligned, and plain new ignores that before C++17.
+ */
+template <typename T>
+class spscRing {
+    public:
+        // Constructor, capacity is rounded up to a power of two
+        spscRing(size_t capacity=64);
+        // Appends x unless the ring is full (producer only)
+        bool tryPush(const T&);
+        // Removes the oldest element into x unless the ring is empty
+        // (consumer only)
+        bool tryPop(T&);
+
+        spscRing(const spscRing&) = delete;
+        spscRing& operator=(const spscRing&) = delete;
+
+    private:
+        vector<T> data;
+        size_t mask;
+        atomic<size_t> head;
+        char padding[64];
+        atomic<size_t> tail;
+};
+
+/**
+ * Constructor for spscRing.
+ *
+ * @param capacity Smallest number of elements the ring must hold.
+ * @return         N/A.
+ */
+template <typename T>
+spscRing<T>::spscRing(size_t capacity) : head(0), tail(0) {
+    size_t size = 1;
+    while (size < capacity) {
+        size *= 2;
+    }
+    data.resize(size);
+    mask = size - 1;
+}
+
+/**
+ * Appends x to the ring, called by the producer.
+ *
+ * @param x        Element.
+ * @return         Whether there was room for x.
+ */
+template <typename T>
+bool spscRing<T>::tryPush(const T &x) {
+    size_t t = tail.load(memory_order_relaxed);
+    if (t - head.load(memory_order_acquire) > mask) {
+        return false;
+    }
+    data[t & mask] = x;
+    tail.store(t + 1, memory_order_release);
+
+    return true;
+}
+
+/**
+ * Removes the oldest element of the ring, called by the consumer.
+ *
+ * @param x        Set to the element.
+ * @return         Whether there was an element.
+ */
+template <typename T>
+bool spscRing<T>::tryPop(T &x) {
+    size_t h = head.load(memory_order_relaxed);
+    if (h == tail.load(memory_order_acquire)) {
+        return false;
+    }
+    x = data[h & mask];
+    head.store(h + 1, memory_order_release);
+
+    return true;
+}
+
+/**
+ * Writes a solution to a CSV file (in the same format as
+ * basicSolClass::writeToCSV) on a thread of its own while it is being
+ * computed. Points are passed in with operator(), so the writer can be used
+ * as the sink of the streaming solvers. They are copied into batches of
+ * rows; full batches go to the writer thread through one ring and come back
+ * empty through another, so no memory is allocated once running. If the
+ * writer falls behind, the producer waits for an empty batch, which bounds
+ * memory to nBatches batches. A thread that finds its ring empty tries it a
+ * few more times and then sleeps on a condition variable until the other
+ * thread hands over a batch, so neither takes CPU time from the other while
+ * it waits (which matters on a single core).
+ */
+template <typename T=double>
+class asyncCSVWriter {
+    public:
+        // Constructor, opens the file and starts the writer thread
+        asyncCSVWriter(string, vector<string>, int, int batchRowsInput=4096,
+        int nBatches=16);
+        // Destructor, finishes writing
+        ~asyncCSVWriter();
+        // Queues the point (t, X)
+        void operator()(T, const vector<T>&);
+        // Writes the remaining points, closes the file and stops the thread
+        void close();
+        // Number of times the producer had to wait for the writer
+        long stalls = 0;
+
+        asyncCSVWriter(const asyncCSVWriter&) = delete;
+        asyncCSVWriter& operator=(const asyncCSVWriter&) = delete;
+
+    private:
+        ofstream file;
+        int prec;
+        int nCols;
+        int batchRows;
+        // Rows of t followed by the nCols values of X
+        vector<vector<T>> batches;
+        // Number of rows in each batch
+        vector<int> batchSize;
+        // Batch being filled by the producer (-1 for none)
+        int current = -1;
+        spscRing<int> full;
+        spscRing<int> empty;
+        // Wakes the writer when a batch is full or close is called, and the
+        // producer when a batch has been written
+        mutex waitLock;
+        condition_variable batchFull;
+        condition_variable batchEmpty;
+        atomic<bool> done;
+        bool firstRow = true;
+        thread writer;
+        // Body of the writer thread
+        void writerLoop();
+        // Hands the current batch over to the writer thread
+        void submit();
+        // Pops an index from ring, sleeping on ready until one arrives or
+        // until stop returns true
+        template <typename Stop>
+        bool waitPop(spscRing<int>&, condition_variable&, int&, Stop);
+};
+
+// Number of times a thread retries an empty ring before it sleeps
+const int asyncSpins = 64;
+
+/**
+ * Constructor for asyncCSVWriter, writes the headings.
+ *
+ * @param filename Filename (including file extension) of file that solution
+ * is to be written to.
+ * @param headings Vector containing headings for t and each variable.
+ * @param precInput Precision the solution is written at.
+ * @param batchRowsInput Number of rows per batch.
+ * @param nBatches Number of batches, which bounds the rows in flight.
+ * @return         N/A.
+ */
+template <typename T>
+asyncCSVWriter<T>::asyncCSVWriter(string filename, vector<string> headings,
+int precInput, int batchRowsInput, int nBatches) : full(max(nBatches, 2)),
+empty(max(nBatches, 2)), done(false) {
+    if (headings.size() < 2) {
+        throw runtime_error("asyncCSVWriter: there should be a heading for t "
+        "and each variable");
+    }
+    file.open(filename);
+    if (!file) {
+        throw runtime_error("asyncCSVWriter: could not open " + filename);
+    }
+    prec = precInput;
+    nCols = headings.size() - 1;
+    batchRows = max(batchRowsInput, 1);
+    nBatches = max(nBatches, 2);
+    batches.assign(nBatches, vector<T>(size_t (batchRows)*(nCols+1)));
+    batchSize.assign(nBatches, 0);
+    for (int b = 0; b < nBatches; b++) {
+        empty.tryPush(b);
+    }
+
+    // Write headings to file
+    for (int i = 0 ; i < headings.size(); i++) {
+        if (i != headings.size()-1) {
+            file << headings[i] << ",";
+        } else {
+            file << headings[i] << endl;
+        }
+    }
+
+    writer = thread(&asyncCSVWriter<T>::writerLoop, this);
+}
+
+/**
+ * Destructor for asyncCSVWriter, writes whatever is still queued.
+ *
+ * @return         N/A.
+ */
+template <typename T>
+asyncCSVWriter<T>::~asyncCSVWriter() {
+    close();
+}
+
+/**
+ * Queues the point (ti, Xi) to be written.
+ *
+ * @param ti       Time value.
+ * @param Xi       State at ti.
+ * @return         Nothing.
+ */
+template <typename T>
+void asyncCSVWriter<T>::operator()(T ti, const vector<T> &Xi) {
+    if (Xi.size() != nCols) {
+        throw runtime_error("asyncCSVWriter: there should be a heading for "
+        "t and each variable");
+    }
+    if (current < 0) {
+        // Backpressure: wait for the writer to hand back a batch
+        if (!empty.tryPop(current)) {
+            stalls++;
+            waitPop(empty, batchEmpty, current, []() {return false;});
+        }
+        batchSize[current] = 0;
+    }
+    T *row = batches[current].data() + size_t (batchSize[current])*(nCols+1);
+    row[0] = ti;
+    for (int j = 0; j < nCols; j++) {
+        row[j+1] = Xi[j];
+    }
+    if (++batchSize[current] == batchRows) {
+        submit();
+    }
+}
+
+/**
+ * Passes the batch being filled to the writer thread.
+ *
+ * @return         Nothing.
+ */
+template <typename T>
+void asyncCSVWriter<T>::submit() {
+    // There are as many slots as batches, so this cannot fail
+    full.tryPush(current);
+    current = -1;
+    // Taking the lock orders the push before a sleeping writer's check
+    {
+        lock_guard<mutex> guard(waitLock);
+    }
+    batchFull.notify_one();
+}
+
+/**
+ * Pops an index from ring, first retrying a few times and then sleeping on
+ * ready, which the other thread notifies after each push while holding
+ * waitLock (so a push cannot slip in between the check and the sleep).
+ *
+ * @param ring     Ring to pop from.
+ * @param ready    Condition variable notified after pushes to ring.
+ * @param x        Set to the index popped.
+ * @param stop     Returns true if waiting should end without an index.
+ * @return         Whether an index was popped.
+ */
+template <typename T>
+template <typename Stop>
+bool asyncCSVWriter<T>::waitPop(spscRing<int> &ring, condition_variable &ready,
+int &x, Stop stop) {
+    for (int i = 0; i < asyncSpins; i++) {
+        if (ring.tryPop(x)) {
+            return true;
+        }
+    }
+    unique_lock<mutex> lock(waitLock);
+    bool popped = false;
+    ready.wait(lock, [&]() {
+        popped = ring.tryPop(x);
+        return popped || stop();
+    });
+
+    return popped;
+}
+
+/**
+ * Writes full batches as they arrive, until close is called and the last
+ * batch has been written.
+ *
+ * @return         Nothing.
+ */
+template <typename T>
+void asyncCSVWriter<T>::writerLoop() {
+    int b;
+    // done is only set after the last batch was queued, so once it is set
+    // an empty ring means there is nothing left
+    auto finished = [&]() {return done.load(memory_order_acquire);};
+    while (waitPop(full, batchFull, b, finished)) {
+        TRACE_ZONE("write batch");
+        const T *row = batches[b].data();
+        for (int i = 0; i < batchSize[b]; i++, row += nCols+1) {
+            // As in writeToCSV, the first t is written at the default
+            // precision
+            file << row[0];
+            if (firstRow) {
+                file << setprecision(prec);
+                firstRow = false;
+            }
+            file << ",";
+            for (int j = 1; j < nCols; j++) {
+                file << row[j] << ",";
+            }
+            file << row[nCols] << "\n";
+        }
+        empty.tryPush(b);
+        {
+            lock_guard<mutex> guard(waitLock);
+        }
+        batchEmpty.notify_one();
+    }
+}
+
+/**
+ * Writes the remaining points, then closes the file and stops the writer
+ * thread. Further calls do nothing.
+ *
+ * @return         Nothing.
+ */
+template <typename T>
+void asyncCSVWriter<T>::close() {
+    if (!writer.joinable()) {
+        return;
+    }
+    if (current >= 0) {
+        submit();
+    }
+    {
+        lock_guard<mutex> guard(waitLock);
+        done.store(true, memory_order_release);
+    }
+    batchFull.notify_one();
+    writer.join();
+    file.close();
+}
+
+#endif
@@ -0,0 +1,359 @@
+#ifndef ATTRACTORDENSITY_H
+#define ATTRACTORDENSITY_H
+
+// Required for running trajectories over several threads
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <cstdint>
+#include <ODE.h>
+
+/**
+ * Histogram of the states visited by a trajectory over a regular 2D or 3D
+ * grid of cells, which estimates the density of the attractor's invariant
+ * measure. Only the counts are stored, so memory is fixed by the number of
+ * cells however many steps are taken.
+ */
+class densityHistogram {
+    public:
+        // Constructor
+        densityHistogram(vector<int>, vector<double>, vector<double>,
+        vector<int>);
+        // Counts a state
+        void add(const vector<double>&);
+        // Adds the counts of a histogram over the same grid
+        void merge(const densityHistogram&);
+        // Sums over the remaining axis of a 3D histogram
+        densityHistogram projection(int, int) const;
+        // Writes the cell centres, counts and densities to a CSV file
+        void writeCSV(string, const vector<string>&) const;
+        // Number of bytes taken by the counts
+        size_t bytes() const;
+        // Components of X along each axis
+        vector<int> axes;
+        // Range and number of cells of each axis
+        vector<double> lo;
+        vector<double> hi;
+        vector<int> bins;
+        // Counts of each cell, last axis varying fastest
+        vector<uint64_t> counts;
+        // Number of states counted, and how many fell outside the grid
+        uint64_t total = 0;
+        uint64_t outside = 0;
+
+    private:
+        // Cells per unit length along each axis
+        vector<double> scale;
+};
+
+/**
+ * Constructor for densityHistogram.
+ *
+ * @param axesInput Components of the state along each axis (2 or 3 of them).
+ * @param loInput   Lower bound of each axis.
+ * @param hiInput   Upper bound of each axis.
+ * @param binsInput Number of cells along each axis.
+ * @return          N/A.
+ */
+densityHistogram::densityHistogram(vector<int> axesInput,
+vector<double> loInput, vector<double> hiInput, vector<int> binsInput) {
+    int dim = axesInput.size();
+    if (dim < 2 || dim > 3 || loInput.size() != dim ||
+    hiInput.size() != dim || binsInput.size() != dim) {
+        throw runtime_error("densityHistogram: there should be 2 or 3 axes, "
+        "each with a range and number of cells");
+    }
+    axes = axesInput;
+    lo = loInput;
+    hi = hiInput;
+    bins = binsInput;
+    size_t nCells = 1;
+    for (int k = 0; k < dim; k++) {
+        if (!(hi[k] > lo[k]) || bins[k] < 1) {
+            throw runtime_error("densityHistogram: each axis needs hi > lo "
+            "and at least one cell");
+        }
+        scale.push_back(bins[k]/(hi[k] - lo[k]));
+        nCells *= bins[k];
+    }
+    counts.assign(nCells, 0);
+}
+
+/**
+ * Counts the state X in the cell containing it. States outside the grid are
+ * only counted in total and outside.
+ *
+ * @param X        State.
+ * @return         Nothing.
+ */
+void densityHistogram::add(const vector<double> &X) {
+    total++;
+    size_t cell = 0;
+    for (size_t k = 0; k < axes.size(); k++) {
+        double x = X[axes[k]];
+        // Also catches NaN
+        if (!(x >= lo[k] && x < hi[k])) {
+            outside++;
+            return;
+        }
+        // Rounding can put x just below hi in cell bins
+        int i = min(int ((x - lo[k])*scale[k]), bins[k] - 1);
+        cell = cell*bins[k] + i;
+    }
+    counts[cell]++;
+}
+
+/**
+ * Adds the counts of another histogram over the same grid to this one.
+ *
+ * @param other    Histogram to be merged in.
+ * @return         Nothing.
+ */
+void densityHistogram::merge(const densityHistogram &other) {
+    if (other.axes != axes || other.lo != lo || other.hi != hi ||
+    other.bins != bins) {
+        throw runtime_error("densityHistogram: only histograms over the same "
+        "grid can be merged");
+    }
+    for (size_t c = 0; c < counts.size(); c++) {
+        counts[c] += other.counts[c];
+    }
+    total += other.total;
+    outside += other.outside;
+}
+
+/**
+ * Projects a 3D histogram onto two of its axes by summing over the third.
+ *
+ * @param a        Index (0, 1 or 2) of the axis that becomes the first axis.
+ * @param b        Index of the axis that becomes the second axis.
+ * @return         2D histogram.
+ */
+densityHistogram densityHistogram::projection(int a, int b) const {
+    if (axes.size() != 3 || a == b || a < 0 || b < 0 || a > 2 || b > 2) {
+        throw runtime_error("densityHistogram: projections are onto two "
+        "different axes of a 3D histogram");
+    }
+    densityHistogram proj({axes[a], axes[b]}, {lo[a], lo[b]}, {hi[a], hi[b]},
+    {bins[a], bins[b]});
+    proj.total = total;
+    proj.outside = outside;
+    int i[3];
+    size_t cell = 0;
+    for (i[0] = 0; i[0] < bins[0]; i[0]++) {
+        for (i[1] = 0; i[1] < bins[1]; i[1]++) {
+            for (i[2] = 0; i[2] < bins[2]; i[2]++) {
+                proj.counts[size_t (i[a])*bins[b] + i[b]] += counts[cell++];
+            }
+        }
+    }
+
+    return proj;
+}
+
+/**
+ * Writes one row per cell to a CSV file: the coordinates of the cell's
+ * centre, its count and the density (count/(total cell volume)), so the
+ * density integrates to the fraction of states inside the grid.
+ *
+ * @param filename Name of the file.
+ * @param headings Names of the components along each axis.
+ * @return         Nothing.
+ */
+void densityHistogram::writeCSV(string filename,
+const vector<string> &headings) const {
+    TRACE_ZONE("write density");
+    int dim = axes.size();
+    if (headings.size() != dim) {
+        throw runtime_error("densityHistogram: there should be a heading for "
+        "each axis");
+    }
+    double volume = 1;
+    for (int k = 0; k < dim; k++) {
+        volume /= scale[k];
+    }
+    double norm = (total > 0) ? 1/(total*volume) : 0;
+
+    ofstream file(filename);
+    file << setprecision(8);
+    for (int k = 0; k < dim; k++) {
+        file << headings[k] << ",";
+    }
+    file << "count,density\n";
+    vector<int> i(dim, 0);
+    for (size_t cell = 0; cell < counts.size(); cell++) {
+        for (int k = 0; k < dim; k++) {
+            file << lo[k] + (i[k] + 0.5)/scale[k] << ",";
+        }
+        file << counts[cell] << "," << counts[cell]*norm << "\n";
+        // Next cell, last axis fastest
+        for (int k = dim-1; k >= 0 && ++i[k] == bins[k]; k--) {
+            i[k] = 0;
+        }
+    }
+}
+
+/**
+ * Returns the number of bytes taken by the counts.
+ *
+ * @return         Bytes.
+ */
+size_t densityHistogram::bytes() const {
+    return counts.size()*sizeof(uint64_t);
+}
+
+/**
+ * Accumulates the density of an attractor over an ensemble of trajectories,
+ * one per initial condition, spread over nThreads threads. Each thread
+ * counts into its own copy of prototype and the copies are merged at the
+ * end, so memory is nThreads histograms whatever the number of steps.
+ *
+ * @param f          Function that returns dX/dt from the arguments t, X and
+ * params.
+ * @param X0s        Initial condition of each trajectory.
+ * @param t0         Initial time.
+ * @param tf         Final time.
+ * @param N          Number of steps of each trajectory.
+ * @param params     Vector of parameter values.
+ * @param prototype  Empty histogram defining the grid.
+ * @param tTrans     Length of the transient left out of the counts.
+ * @param method     "Euler", "ModEuler", "RK4" or "ABM".
+ * @param nThreads   Number of threads to use (0 means one per core).
+ * @return           Histogram of every trajectory after its transient.
+ * Errors of the solver (or of f) are rethrown once every thread has
+ * finished.
+ */
+densityHistogram densityEnsemble(vector<double>(*f)(double, vector<double>,
+vector<double>), vector<vector<double>> X0s, double t0, double tf, long N,
+vector<double> params, const densityHistogram &prototype, double tTrans=0,
+string method="RK4", int nThreads=0) {
+    TRACE_ZONE("densityEnsemble");
+    if (!isFixedStepMethod(method)) {
+        throw runtime_error("densityEnsemble: no fixed step method called " +
+        method);
+    }
+
+    // Initialize variables
+    int nTraj = X0s.size();
+    uniformGrid<double> t(t0, tf, N);
+    atomic<int> next(0);
+    exception_ptr error;
+    mutex errorLock;
+    if (nThreads <= 0) {
+        nThreads = max(1u, thread::hardware_concurrency());
+    }
+    nThreads = min(nThreads, max(nTraj, 1));
+    vector<densityHistogram> local(nThreads, prototype);
+
+    // Each worker takes the next unclaimed trajectory until none remain
+    auto worker = [&](int w) {
+        densityHistogram &hist = local[w];
+        for (int k = next++; k < nTraj; k = next++) {
+            try {
+                fixedStepStream(f, X0s[k], t, params, method,
+                [&](double ti, const vector<double> &Xi) {
+                    if (ti >= t0 + tTrans) {
+                        hist.add(Xi);
+                    }
+                });
+            } catch (...) {
+                lock_guard<mutex> guard(errorLock);
+                error = current_exception();
+            }
+        }
+    };
+    vector<thread> threads;
+    for (int i = 0; i < nThreads; i++) {
+        threads.push_back(thread(worker, i));
+    }
+    for (int i = 0; i < nThreads; i++) {
+        threads[i].join();
+    }
+
+    if (error) {
+        rethrow_exception(error);
+    }
+
+    // Merge the per thread histograms
+    densityHistogram hist = prototype;
+    for (int i = 0; i < nThreads; i++) {
+        hist.merge(local[i]);
+    }
+
+    return hist;
+}
+
+/**
+ * Accumulates the density of an attractor for each parameter set in
+ * paramSets, distributing the parameter sets over nThreads threads.
+ *
+ * @param f          Function that returns dX/dt from the arguments t, X and
+ * params.
+ * @param X0         Initial condition (shared by every parameter set).
+ * @param t0         Initial time.
+ * @param tf         Final time.
+ * @param N          Number of steps between t0 and tf.
+ * @param paramSets  Vector of parameter vectors.
+ * @param prototype  Empty histogram defining the grid.
+ * @param tTrans     Length of the transient left out of the counts.
+ * @param method     "Euler", "ModEuler", "RK4" or "ABM".
+ * @param nThreads   Number of threads to use (0 means one per core).
+ * @return           Histogram for each entry of paramSets. Errors of the
+ * solver (or of f) are rethrown once every thread has finished.
+ */
+vector<densityHistogram> densitySweep(vector<double>(*f)(double,
+vector<double>, vector<double>), vector<double> X0, double t0, double tf,
+long N, vector<vector<double>> paramSets, const densityHistogram &prototype,
+double tTrans=0, string method="RK4", int nThreads=0) {
+    TRACE_ZONE("densitySweep");
+    if (!isFixedStepMethod(method)) {
+        throw runtime_error("densitySweep: no fixed step method called " +
+        method);
+    }
+
+    // Initialize variables
+    int nSets = paramSets.size();
+    uniformGrid<double> t(t0, tf, N);
+    vector<densityHistogram> hists(nSets, prototype);
+    atomic<int> next(0);
+    exception_ptr error;
+    mutex errorLock;
+    if (nThreads <= 0) {
+        nThreads = max(1u, thread::hardware_concurrency());
+    }
+    nThreads = min(nThreads, max(nSets, 1));
+
+    // Each worker takes the next unclaimed parameter set until none remain
+    auto worker = [&]() {
+        for (int k = next++; k < nSets; k = next++) {
+            densityHistogram &hist = hists[k];
+            try {
+                fixedStepStream(f, X0, t, paramSets[k], method,
+                [&](double ti, const vector<double> &Xi) {
+                    if (ti >= t0 + tTrans) {
+                        hist.add(Xi);
+                    }
+                });
+            } catch (...) {
+                lock_guard<mutex> guard(errorLock);
+                error = current_exception();
+            }
+        }
+    };
+    vector<thread> threads;
+    for (int i = 0; i < nThreads; i++) {
+        threads.push_back(thread(worker));
+    }
+    for (int i = 0; i < nThreads; i++) {
+        threads[i].join();
+    }
+
+    if (error) {
+        rethrow_exception(error);
+    }
+
+    return hists;
+}
+
+#endif
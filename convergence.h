@@ -0,0 +1,315 @@
+#ifndef CONVERGENCE_H
+#define CONVERGENCE_H
+
+// Required for running the grids over several threads
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <ODE.h>
+
+/**
+ * One fixed step run of a convergence study.
+ */
+class convergenceRun {
+    public:
+        string method;
+        int N = 0;
+        // Number of RHS evaluations
+        long nfev = 0;
+        // Largest relative error at the nodes of the coarsest grid
+        double err = 0;
+        double seconds = 0;
+};
+
+/**
+ * Observed convergence of one method, from a least squares fit of
+ * err = C N^-order to its runs.
+ */
+class convergenceFit {
+    public:
+        string method;
+        // Order of the method in theory, and as observed
+        int nominalOrder = 0;
+        double order = 0;
+        double C = 0;
+        // Number of runs used in the fit, and the smallest N among them
+        int nFit = 0;
+        int NMin = 0;
+        vector<convergenceRun> runs;
+};
+
+/**
+ * Returns the theoretical order of a fixed step method.
+ *
+ * @param method   "Euler", "ModEuler", "RK4" or "ABM" (fourth order).
+ * @return         Order.
+ */
+int nominalOrder(string method) {
+    if (method == "Euler") {
+        return 1;
+    } else if (method == "ModEuler") {
+        return 2;
+    } else if (method == "RK4" || method == "ABM") {
+        return 4;
+    }
+    throw runtime_error("No fixed step method called " + method);
+}
+
+/**
+ * Returns the number of RHS evaluations per step of a fixed step method.
+ *
+ * @param method   "Euler", "ModEuler", "RK4" or "ABM".
+ * @return         RHS evaluations per step.
+ */
+int stagesPerStep(string method) {
+    if (method == "Euler") {
+        return 1;
+    } else if (method == "ModEuler" || method == "ABM") {
+        return 2;
+    } else if (method == "RK4") {
+        return 4;
+    }
+    throw runtime_error("No fixed step method called " + method);
+}
+
+/**
+ * Solves dX/dt = f(t, X, params) on a grid with a fixed step method.
+ *
+ * @param f        Function that returns dX/dt from the arguments t, X and
+ * params.
+ * @param X0       X at t[0].
+ * @param t        Uniform grid of time values.
+ * @param params   Vector of parameter values.
+ * @param method   "Euler", "ModEuler", "RK4" or "ABM".
+ * @return         2d array of X values; rows correspond to t values.
+ */
+vector<vector<double>> fixedStepSolve(vector<double>(*f)(double,
+vector<double>, vector<double>), const vector<double> &X0,
+const uniformGrid<double> &t, const vector<double> &params, string method) {
+    if (method == "Euler") {
+        return Euler(f, X0, t, params);
+    } else if (method == "ModEuler") {
+        return ModEuler(f, X0, t, params);
+    } else if (method == "RK4") {
+        return RK4(f, X0, t, params);
+    } else if (method == "ABM") {
+        return ABM(f, X0, t, params, 4);
+    }
+    throw runtime_error("No fixed step method called " + method);
+}
+
+/**
+ * Returns a high accuracy solution at the given times, from Bulirsch-Stoer
+ * stopped exactly at each of them (so no interpolation error is added).
+ *
+ * @param f        Function that returns dX/dt from the arguments t, X and
+ * params.
+ * @param X0       X at t[0].
+ * @param t        Increasing time values.
+ * @param params   Vector of parameter values.
+ * @param tol      Error tolerance of Bulirsch-Stoer.
+ * @return         2d array of X values; rows correspond to t values.
+ */
+vector<vector<double>> referenceAtNodes(vector<double>(*f)(double,
+vector<double>, vector<double>), const vector<double> &X0,
+const vector<double> &t, const vector<double> &params, double tol=1e-13) {
+    vector<vector<double>> Xref {X0};
+    solClass solution = BulirschStoer(f, X0, t[0], t[1], params, tol);
+    Xref.push_back(solution.getX().back());
+    for (int i = 2; i < t.size(); i++) {
+        solution.extendTo(t[i]);
+        Xref.push_back(solution.getX().back());
+    }
+
+    return Xref;
+}
+
+/**
+ * Returns the largest relative error of a solution at the nodes of a grid
+ * coarser by a factor stride.
+ *
+ * @param X        Solution; rows correspond to t values.
+ * @param Xref     Reference at the coarse nodes.
+ * @param stride   Number of steps of X per coarse step.
+ * @return         max |X - Xref|/(1 + |Xref|).
+ */
+double coarseNodeError(const vector<vector<double>> &X,
+const vector<vector<double>> &Xref, int stride) {
+    double err = 0;
+    for (int i = 0; i < Xref.size(); i++) {
+        for (int j = 0; j < Xref[i].size(); j++) {
+            err = max(err, abs(X[i*stride][j] - Xref[i][j])/
+            (1 + abs(Xref[i][j])));
+        }
+    }
+
+    return err;
+}
+
+/**
+ * Runs each method on grids of N0, 2 N0, 4 N0, ... (nLevels grids) steps
+ * between t0 and tf, over nThreads threads, and fits the observed order of
+ * each method. Errors are measured at the nodes of the coarsest grid, which
+ * every grid contains, against either a Bulirsch-Stoer solution stopped at
+ * those nodes or, if richardson is set, a Richardson extrapolation of the
+ * method's own two finest runs (no other solver needed, but the finest run's
+ * error is then only an estimate). Runs with errors above 0.1 (not yet in
+ * the asymptotic regime) are left out of the fit, as is every run from the
+ * first one whose error fell by less than 2^(order/2) (rounding errors or
+ * the reference's own error have taken over).
+ *
+ * @param f          Function that returns dX/dt from the arguments t, X and
+ * params.
+ * @param X0         Initial condition.
+ * @param t0         Initial time.
+ * @param tf         Final time.
+ * @param params     Vector of parameter values.
+ * @param methods    Methods to study ("Euler", "ModEuler", "RK4", "ABM").
+ * @param N0         Number of steps of the coarsest grid.
+ * @param nLevels    Number of grids.
+ * @param richardson Whether to use Richardson extrapolation as reference.
+ * @param nThreads   Number of threads to use (0 means one per core).
+ * @return           Fit and runs of each method.
+ */
+vector<convergenceFit> convergenceStudy(vector<double>(*f)(double,
+vector<double>, vector<double>), vector<double> X0, double t0, double tf,
+vector<double> params, vector<string> methods, int N0, int nLevels,
+bool richardson=false, int nThreads=0) {
+    TRACE_ZONE("convergenceStudy");
+    // Initialize variables
+    int nMethods = methods.size();
+    int nRuns = nMethods*nLevels;
+    vector<convergenceFit> fits(nMethods);
+    for (int m = 0; m < nMethods; m++) {
+        fits[m].method = methods[m];
+        fits[m].nominalOrder = nominalOrder(methods[m]);
+        fits[m].runs.resize(nLevels);
+    }
+    // Solution of each run at the coarse nodes
+    vector<vector<vector<double>>> nodes(nRuns);
+
+    // Most expensive runs first, so that the threads finish together
+    vector<pair<long, int>> order;
+    for (int k = 0; k < nRuns; k++) {
+        int m = k / nLevels, level = k % nLevels;
+        order.push_back({-(long (stagesPerStep(methods[m])) << level), k});
+    }
+    sort(order.begin(), order.end());
+
+    atomic<int> next(0);
+    if (nThreads <= 0) {
+        nThreads = max(1u, thread::hardware_concurrency());
+    }
+    nThreads = min(nThreads, max(nRuns, 1));
+
+    // Each worker takes the next unclaimed run until none remain
+    auto worker = [&]() {
+        for (int i = next++; i < nRuns; i = next++) {
+            int k = order[i].second;
+            int m = k / nLevels, level = k % nLevels;
+            convergenceRun &run = fits[m].runs[level];
+            run.method = methods[m];
+            run.N = N0 << level;
+            run.nfev = long (stagesPerStep(methods[m]))*run.N;
+            auto start = chrono::steady_clock::now();
+            vector<vector<double>> X = fixedStepSolve(f, X0,
+            uniformGrid<double>(t0, tf, run.N), params, methods[m]);
+            chrono::duration<double> elapsed = chrono::steady_clock::now() -
+            start;
+            run.seconds = elapsed.count();
+            for (int j = 0; j <= N0; j++) {
+                nodes[k].push_back(X[j << level]);
+            }
+        }
+    };
+    vector<thread> threads;
+    for (int i = 0; i < nThreads; i++) {
+        threads.push_back(thread(worker));
+    }
+    for (int i = 0; i < nThreads; i++) {
+        threads[i].join();
+    }
+
+    // Errors against the reference
+    vector<vector<double>> Xref;
+    if (!richardson) {
+        Xref = referenceAtNodes(f, X0, linspace(t0, tf, N0), params);
+    }
+    for (int m = 0; m < nMethods; m++) {
+        if (richardson) {
+            if (nLevels < 2) {
+                throw runtime_error("convergenceStudy: Richardson "
+                "extrapolation needs at least two grids");
+            }
+            // X + (X - Xcoarse)/(2^p - 1) cancels the leading error term
+            const vector<vector<double>> &fine = nodes[m*nLevels + nLevels-1];
+            const vector<vector<double>> &coarse =
+            nodes[m*nLevels + nLevels-2];
+            double factor = 1.0/((1 << fits[m].nominalOrder) - 1);
+            Xref = fine;
+            for (int j = 0; j <= N0; j++) {
+                for (int c = 0; c < X0.size(); c++) {
+                    Xref[j][c] += factor*(fine[j][c] - coarse[j][c]);
+                }
+            }
+        }
+
+        // Least squares fit of log(err) against log(N), over the runs
+        // before the error stops falling at close to the nominal rate
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        int n = 0;
+        bool floorReached = false;
+        double minRatio = pow(2.0, 0.5*fits[m].nominalOrder);
+        for (int level = 0; level < nLevels; level++) {
+            convergenceRun &run = fits[m].runs[level];
+            run.err = coarseNodeError(nodes[m*nLevels + level], Xref, 1);
+            if (level > 0 && run.err*minRatio > fits[m].runs[level-1].err) {
+                floorReached = floorReached || n > 0;
+            }
+            if (floorReached || run.err > 0.1 || run.err < 1e-14) {
+                continue;
+            }
+            if (n == 0) {
+                fits[m].NMin = run.N;
+            }
+            double x = log(double (run.N)), y = log(run.err);
+            sx += x;
+            sy += y;
+            sxx += x*x;
+            sxy += x*y;
+            n++;
+        }
+        fits[m].nFit = n;
+        if (n >= 2) {
+            double slope = (n*sxy - sx*sy)/(n*sxx - sx*sx);
+            fits[m].order = -slope;
+            fits[m].C = exp((sy - slope*sx)/n);
+        } else {
+            fits[m].order = NAN;
+            fits[m].C = NAN;
+        }
+    }
+
+    return fits;
+}
+
+/**
+ * Returns the number of RHS evaluations a method needs to reach a relative
+ * error of target, from its fitted convergence. The fit says nothing about
+ * grids coarser than those it was made from, so at least NMin steps are
+ * taken.
+ *
+ * @param fit      Fit from convergenceStudy.
+ * @param target   Error wanted.
+ * @return         Predicted RHS evaluations (infinity if there is no fit).
+ */
+double costForError(const convergenceFit &fit, double target) {
+    if (fit.nFit < 2 || !(fit.order > 0)) {
+        return INFINITY;
+    }
+    double N = max(double (fit.NMin), pow(fit.C/target, 1/fit.order));
+
+    return ceil(N)*stagesPerStep(fit.method);
+}
+
+#endif
@@ -0,0 +1,263 @@
+#ifndef DOUBLEDOUBLE_H
+#define DOUBLEDOUBLE_H
+
+// Used for fma, floor, log10 and sqrt
+#include <cmath>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+/**
+ * Double-double number, the unevaluated sum hi + lo of two doubles with
+ * |lo| <= ulp(hi)/2, giving about 32 significant digits at roughly ten times
+ * the cost of double arithmetic. Uses the algorithms of Dekker and of Hida,
+ * Li and Bailey's QD library.
+ */
+class ddouble {
+    public:
+        double hi;
+        double lo;
+
+        // Constructors
+        ddouble(double hiInput=0.0) : hi(hiInput), lo(0.0) {}
+        ddouble(double hiInput, double loInput) : hi(hiInput), lo(loInput) {}
+        // Rounds to the nearest double
+        explicit operator double() const {
+            return hi + lo;
+        }
+
+        ddouble& operator+=(const ddouble&);
+        ddouble& operator-=(const ddouble&);
+        ddouble& operator*=(const ddouble&);
+        ddouble& operator/=(const ddouble&);
+};
+
+/**
+ * Returns s = fl(a+b) and the rounding error e, so that a+b = s+e exactly.
+ *
+ * @param a        First summand.
+ * @param b        Second summand.
+ * @param e        Set to the rounding error.
+ * @return         fl(a+b).
+ */
+inline double twoSum(double a, double b, double &e) {
+    double s = a + b;
+    double bb = s - a;
+    e = (a - (s - bb)) + (b - bb);
+
+    return s;
+}
+
+/**
+ * Same as twoSum but only valid if |a| >= |b|.
+ *
+ * @param a        Larger summand.
+ * @param b        Smaller summand.
+ * @param e        Set to the rounding error.
+ * @return         fl(a+b).
+ */
+inline double quickTwoSum(double a, double b, double &e) {
+    double s = a + b;
+    e = b - (s - a);
+
+    return s;
+}
+
+/**
+ * Returns p = fl(a*b) and the rounding error e, so that a*b = p+e exactly.
+ *
+ * @param a        First factor.
+ * @param b        Second factor.
+ * @param e        Set to the rounding error.
+ * @return         fl(a*b).
+ */
+inline double twoProd(double a, double b, double &e) {
+    double p = a * b;
+    e = fma(a, b, -p);
+
+    return p;
+}
+
+inline ddouble operator+(const ddouble &x, const ddouble &y) {
+    double e, f;
+    double s = twoSum(x.hi, y.hi, e);
+    double t = twoSum(x.lo, y.lo, f);
+    e += t;
+    s = quickTwoSum(s, e, e);
+    e += f;
+    s = quickTwoSum(s, e, e);
+
+    return ddouble(s, e);
+}
+
+inline ddouble operator-(const ddouble &x) {
+    return ddouble(-x.hi, -x.lo);
+}
+
+inline ddouble operator-(const ddouble &x, const ddouble &y) {
+    return x + (-y);
+}
+
+inline ddouble operator*(const ddouble &x, const ddouble &y) {
+    double e;
+    double p = twoProd(x.hi, y.hi, e);
+    e += x.hi*y.lo + x.lo*y.hi;
+    p = quickTwoSum(p, e, e);
+
+    return ddouble(p, e);
+}
+
+inline ddouble operator/(const ddouble &x, const ddouble &y) {
+    // Long division, one double's worth of quotient at a time
+    double q1 = x.hi/y.hi;
+    ddouble r = x - q1*y;
+    double q2 = r.hi/y.hi;
+    r = r - q2*y;
+    double q3 = r.hi/y.hi;
+    double e;
+    q1 = quickTwoSum(q1, q2, e);
+
+    return ddouble(q1, e) + ddouble(q3);
+}
+
+inline ddouble& ddouble::operator+=(const ddouble &y) {
+    return *this = *this + y;
+}
+
+inline ddouble& ddouble::operator-=(const ddouble &y) {
+    return *this = *this - y;
+}
+
+inline ddouble& ddouble::operator*=(const ddouble &y) {
+    return *this = *this * y;
+}
+
+inline ddouble& ddouble::operator/=(const ddouble &y) {
+    return *this = *this / y;
+}
+
+inline bool operator<(const ddouble &x, const ddouble &y) {
+    return x.hi < y.hi || (x.hi == y.hi && x.lo < y.lo);
+}
+
+inline bool operator>(const ddouble &x, const ddouble &y) {
+    return y < x;
+}
+
+inline bool operator<=(const ddouble &x, const ddouble &y) {
+    return !(y < x);
+}
+
+inline bool operator>=(const ddouble &x, const ddouble &y) {
+    return !(x < y);
+}
+
+inline bool operator==(const ddouble &x, const ddouble &y) {
+    return x.hi == y.hi && x.lo == y.lo;
+}
+
+inline bool operator!=(const ddouble &x, const ddouble &y) {
+    return !(x == y);
+}
+
+inline ddouble abs(const ddouble &x) {
+    return x.hi < 0 ? -x : x;
+}
+
+/**
+ * Square root by one Newton step from the double square root.
+ *
+ * @param x        Non-negative double-double.
+ * @return         sqrt(x).
+ */
+inline ddouble sqrt(const ddouble &x) {
+    if (x.hi <= 0) {
+        return ddouble(0.0);
+    }
+    ddouble q(std::sqrt(x.hi));
+
+    return q + (x - q*q)/(2.0*q);
+}
+
+/**
+ * Integer power by repeated squaring.
+ *
+ * @param x        Base.
+ * @param n        Exponent.
+ * @return         x^n.
+ */
+inline ddouble pow(const ddouble &x, int n) {
+    ddouble result(1.0);
+    ddouble base = x;
+    for (int m = n < 0 ? -n : n; m > 0; m /= 2) {
+        if (m % 2 == 1) {
+            result *= base;
+        }
+        base *= base;
+    }
+
+    return n < 0 ? ddouble(1.0)/result : result;
+}
+
+/**
+ * Writes x in scientific notation with the stream's precision (at most 32
+ * significant digits).
+ *
+ * @param os       Output stream.
+ * @param x        Number to be written.
+ * @return         os.
+ */
+inline ostream& operator<<(ostream &os, const ddouble &x) {
+    int prec = std::max(1, std::min(int (os.precision()), 32));
+    if (x.hi == 0 || !std::isfinite(x.hi)) {
+        return os << x.hi;
+    }
+
+    // Scale |x| into [1, 10)
+    ddouble y = abs(x);
+    int e = int (std::floor(std::log10(y.hi)));
+    y = y/pow(ddouble(10.0), e);
+    if (y.hi >= 10) {
+        y = y/10.0;
+        e++;
+    } else if (y.hi < 1) {
+        y = y*10.0;
+        e--;
+    }
+
+    // Extract one more digit than needed, then round
+    string digits;
+    for (int i = 0; i <= prec; i++) {
+        int d = std::min(9, std::max(0, int (std::floor(double(y)))));
+        digits += char('0' + d);
+        y = (y - double(d))*10.0;
+    }
+    bool roundUp = digits[prec] >= '5';
+    digits.resize(prec);
+    for (int i = prec-1; roundUp && i >= 0; i--) {
+        if (digits[i] == '9') {
+            digits[i] = '0';
+        } else {
+            digits[i]++;
+            roundUp = false;
+        }
+    }
+    if (roundUp) {
+        digits = "1" + digits.substr(0, prec-1);
+        e++;
+    }
+
+    if (x.hi < 0) {
+        os << '-';
+    }
+    os << digits[0];
+    if (prec > 1) {
+        os << '.' << digits.substr(1);
+    }
+    os << 'e' << (e < 0 ? '-' : '+') << (e < 0 ? -e : e);
+
+    return os;
+}
+
+#endif
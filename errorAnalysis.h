@@ -0,0 +1,356 @@
+#ifndef ERRORANALYSIS_H
+#define ERRORANALYSIS_H
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <trace.h>
+
+using namespace std;
+
+/**
+ * Piecewise cubic Hermite interpolant of a solution, matching X and dX/dt at
+ * every t. With the exact derivatives f(t, X) this is the usual dense output
+ * of a one-step method and is accurate to O(h^4), so a reference solution
+ * can be evaluated anywhere without resolving it onto another grid.
+ */
+template <typename T>
+class hermiteInterpolant {
+    public:
+        // Constructor using f for the derivatives
+        hermiteInterpolant(const vector<T>&, const vector<vector<T>>&,
+        vector<T>(*f)(T, vector<T>, vector<T>), const vector<T>&);
+        // Constructor estimating the derivatives by finite differences
+        hermiteInterpolant(const vector<T>&, const vector<vector<T>>&);
+        // Sets Xi to the interpolated state at ti
+        void evaluate(T, vector<T>&);
+        // Range of t covered
+        T tStart();
+        T tEnd();
+
+    private:
+        vector<T> t;
+        vector<vector<T>> X;
+        vector<vector<T>> dX;
+        // Interval of the last evaluation, so that increasing times are found
+        // without a search
+        size_t last = 0;
+        // Checks the input
+        void check();
+};
+
+/**
+ * Errors of a solution against a reference: the largest absolute error, the
+ * L2 error (root mean square over time, by the trapezoidal rule) and the
+ * error at the final time, per component and overall. Overall values are
+ * the largest over the components, except the L2 error which is the root
+ * mean square of the Euclidean norm of the error.
+ */
+class errorSummary {
+    public:
+        vector<double> maxErr;
+        vector<double> l2Err;
+        vector<double> finalErr;
+        double maxNorm = 0;
+        double l2Norm = 0;
+        double finalNorm = 0;
+        // Time at which the largest error occurred
+        double tMax = 0;
+        // Number of solution points compared
+        long nPoints = 0;
+};
+
+/**
+ * Constructor for hermiteInterpolant, with the derivatives from f.
+ *
+ * @param tInput   Increasing t values of the solution.
+ * @param XInput   X values of the solution; rows correspond to t values.
+ * @param f        Function that returns dX/dt from the arguments t, X and
+ * params.
+ * @param params   Vector of parameter values.
+ * @return         N/A.
+ */
+template <typename T>
+hermiteInterpolant<T>::hermiteInterpolant(const vector<T> &tInput,
+const vector<vector<T>> &XInput, vector<T>(*f)(T, vector<T>, vector<T>),
+const vector<T> &params) {
+    t = tInput;
+    X = XInput;
+    check();
+    dX.resize(t.size());
+    for (size_t k = 0; k < t.size(); k++) {
+        dX[k] = f(t[k], X[k], params);
+    }
+}
+
+/**
+ * Constructor for hermiteInterpolant, for solutions whose f is not at hand.
+ * The derivatives are estimated by the three point formula for unequal
+ * spacing (one sided at the ends), which makes the interpolant O(h^3).
+ *
+ * @param tInput   Increasing t values of the solution.
+ * @param XInput   X values of the solution; rows correspond to t values.
+ * @return         N/A.
+ */
+template <typename T>
+hermiteInterpolant<T>::hermiteInterpolant(const vector<T> &tInput,
+const vector<vector<T>> &XInput) {
+    t = tInput;
+    X = XInput;
+    check();
+    size_t N = t.size(), n = X[0].size();
+    dX.assign(N, vector<T>(n, T(0)));
+    if (N == 1) {
+        return;
+    }
+    if (N == 2) {
+        for (size_t j = 0; j < n; j++) {
+            dX[0][j] = dX[1][j] = (X[1][j] - X[0][j])/(t[1] - t[0]);
+        }
+        return;
+    }
+    for (size_t k = 0; k < N; k++) {
+        // Points c-1, c and c+1, with c = k except at the ends
+        size_t c = min(max(k, size_t (1)), N-2);
+        for (size_t j = 0; j < n; j++) {
+            T h0 = t[c] - t[c-1], h1 = t[c+1] - t[c];
+            T d0 = (X[c][j] - X[c-1][j])/h0;
+            T d1 = (X[c+1][j] - X[c][j])/h1;
+            if (k < c) {
+                dX[k][j] = d0 - h0*(d1 - d0)/(h0 + h1);
+            } else if (k > c) {
+                dX[k][j] = d1 + h1*(d1 - d0)/(h0 + h1);
+            } else {
+                dX[k][j] = (h1*d0 + h0*d1)/(h0 + h1);
+            }
+        }
+    }
+}
+
+/**
+ * Checks that the solution is nonempty with nondecreasing t.
+ *
+ * @return         Nothing.
+ */
+template <typename T>
+void hermiteInterpolant<T>::check() {
+    if (t.empty() || t.size() != X.size()) {
+        throw runtime_error("hermiteInterpolant: t and X must be nonempty "
+        "and of the same length");
+    }
+    for (size_t k = 1; k < t.size(); k++) {
+        if (t[k] < t[k-1]) {
+            throw runtime_error("hermiteInterpolant: t must be "
+            "nondecreasing");
+        }
+    }
+}
+
+/**
+ * Returns the first t value.
+ *
+ * @return         t[0].
+ */
+template <typename T>
+T hermiteInterpolant<T>::tStart() {
+    return t[0];
+}
+
+/**
+ * Returns the last t value.
+ *
+ * @return         Last element of t.
+ */
+template <typename T>
+T hermiteInterpolant<T>::tEnd() {
+    return t.back();
+}
+
+/**
+ * Evaluates the interpolant (values outside [tStart, tEnd] come from the
+ * cubic of the nearest interval). Evaluating at increasing times costs O(1)
+ * per call; other orders need a binary search.
+ *
+ * @param ti       Time value.
+ * @param Xi       Set to the interpolated state.
+ * @return         Nothing.
+ */
+template <typename T>
+void hermiteInterpolant<T>::evaluate(T ti, vector<T> &Xi) {
+    size_t n = X[0].size();
+    Xi.resize(n);
+    if (t.size() == 1) {
+        Xi = X[0];
+        return;
+    }
+
+    // Find k with t[k] <= ti <= t[k+1]
+    size_t k = last;
+    if (ti < t[k]) {
+        k = upper_bound(t.begin(), t.end(), ti) - t.begin();
+        k = (k > 0) ? k-1 : 0;
+    }
+    while (k+2 < t.size() && t[k+1] < ti) {
+        k++;
+    }
+    last = k;
+
+    T h = t[k+1] - t[k];
+    if (h == T(0)) {
+        Xi = X[k+1];
+        return;
+    }
+    T s = (ti - t[k])/h;
+    T h00 = (1 + 2*s)*(1 - s)*(1 - s);
+    T h10 = s*(1 - s)*(1 - s)*h;
+    T h01 = s*s*(3 - 2*s);
+    T h11 = s*s*(s - 1)*h;
+    for (size_t j = 0; j < n; j++) {
+        Xi[j] = h00*X[k][j] + h10*dX[k][j] + h01*X[k+1][j] +
+        h11*dX[k+1][j];
+    }
+}
+
+/**
+ * Compares a solution with a reference interpolant at every solution point
+ * in the reference's t range, in one pass. Only the summary is kept in
+ * memory; if curveFile is given, an error curve downsampled to at most
+ * nCurve rows is streamed to it. Each row covers a run of consecutive points
+ * and holds the largest error of each component over the run, with the time
+ * at which the run's largest error occurred, so peaks are not lost.
+ *
+ * @param t        t values of the solution (a vector or a uniformGrid).
+ * @param X        X values of the solution; rows correspond to t values.
+ * @param ref      Reference solution.
+ * @param curveFile CSV file for the error curve ("" for none).
+ * @param headings Headings of t and each component in the curve file.
+ * @param nCurve   Maximum number of rows in the curve file.
+ * @return         Error summary.
+ */
+template <typename T, typename Grid>
+errorSummary compareSolutions(const Grid &t, const vector<vector<T>> &X,
+hermiteInterpolant<T> &ref, string curveFile="",
+vector<string> headings=vector<string>(), int nCurve=1000) {
+    TRACE_ZONE("compareSolutions");
+    errorSummary summary;
+    if (t.size() == 0) {
+        return summary;
+    }
+    size_t n = X[0].size();
+    summary.maxErr.assign(n, 0.0);
+    summary.l2Err.assign(n, 0.0);
+    summary.finalErr.assign(n, 0.0);
+
+    // Points inside the reference's range
+    size_t first = 0, end = t.size();
+    while (first < end && t[first] < ref.tStart()) {
+        first++;
+    }
+    while (end > first && t[end-1] > ref.tEnd()) {
+        end--;
+    }
+    if (first >= end) {
+        throw runtime_error("compareSolutions: the solution and reference "
+        "do not overlap");
+    }
+    size_t bucket = (end - first + nCurve - 1)/max(nCurve, 1);
+
+    ofstream file;
+    if (curveFile != "") {
+        if (headings.size() != n + 1) {
+            throw runtime_error("compareSolutions: there should be a "
+            "heading for t and each component");
+        }
+        file.open(curveFile);
+        file << setprecision(8);
+        for (size_t j = 0; j <= n; j++) {
+            file << headings[j] << (j < n ? "," : "\n");
+        }
+    }
+
+    // Error at the previous point (for the trapezoidal rule) and the
+    // current run of the curve
+    vector<T> refX;
+    vector<double> err(n), prevErr(n), runMax(n, 0.0);
+    double prevT = 0, runNorm = -1, runT = 0;
+    for (size_t k = first; k < end; k++) {
+        ref.evaluate(t[k], refX);
+        double norm = 0;
+        for (size_t j = 0; j < n; j++) {
+            err[j] = abs(double (X[k][j] - refX[j]));
+            norm = max(norm, err[j]);
+            summary.maxErr[j] = max(summary.maxErr[j], err[j]);
+            runMax[j] = max(runMax[j], err[j]);
+            if (k > first) {
+                summary.l2Err[j] += 0.5*(double (t[k]) - prevT)*
+                (err[j]*err[j] + prevErr[j]*prevErr[j]);
+            }
+        }
+        if (norm > summary.maxNorm || k == first) {
+            summary.maxNorm = norm;
+            summary.tMax = double (t[k]);
+        }
+        if (norm > runNorm) {
+            runNorm = norm;
+            runT = double (t[k]);
+        }
+        prevErr = err;
+        prevT = double (t[k]);
+
+        // End of a run of the curve
+        if (file.is_open() && ((k - first + 1) % bucket == 0 || k+1 == end)) {
+            file << runT;
+            for (size_t j = 0; j < n; j++) {
+                file << "," << runMax[j];
+                runMax[j] = 0;
+            }
+            file << "\n";
+            runNorm = -1;
+        }
+    }
+    summary.nPoints = end - first;
+    summary.finalErr = err;
+    summary.finalNorm = *max_element(err.begin(), err.end());
+
+    // Mean over time, or the error itself if there is a single point
+    double span = prevT - double (t[first]);
+    for (size_t j = 0; j < n; j++) {
+        summary.l2Err[j] = (span > 0) ? sqrt(summary.l2Err[j]/span) : err[j];
+        summary.l2Norm += summary.l2Err[j]*summary.l2Err[j];
+    }
+    summary.l2Norm = sqrt(summary.l2Norm);
+
+    return summary;
+}
+
+/**
+ * Writes error summaries to a CSV file, one row per method and component
+ * plus an "all" row per method with the overall values.
+ *
+ * @param filename Name of the file.
+ * @param methods  Names of the methods.
+ * @param summaries Summary of each method.
+ * @param names    Names of the components.
+ * @return         Nothing.
+ */
+void writeErrorSummaries(string filename, const vector<string> &methods,
+const vector<errorSummary> &summaries, const vector<string> &names) {
+    ofstream file(filename);
+    file << setprecision(8);
+    file << "method,variable,max,L2,final,tMax" << endl;
+    for (size_t i = 0; i < methods.size(); i++) {
+        const errorSummary &s = summaries[i];
+        for (size_t j = 0; j < s.maxErr.size(); j++) {
+            file << methods[i] << "," << names[j] << "," << s.maxErr[j];
+            file << "," << s.l2Err[j] << "," << s.finalErr[j] << "," << endl;
+        }
+        file << methods[i] << ",all," << s.maxNorm << "," << s.l2Norm << ",";
+        file << s.finalNorm << "," << s.tMax << endl;
+    }
+}
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef INPUT_H
+#define INPUT_H
+
 #include <iostream>
 
 using namespace std;
@@ -44,4 +47,6 @@ double getTol() {
     cin >> tol;
 
     return tol;
-}
\ No newline at end of file
+}
+
+#endif
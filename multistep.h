@@ -0,0 +1,209 @@
+#ifndef MULTISTEP_H
+#define MULTISTEP_H
+
+#include <vecOps.h>
+
+using namespace std;
+
+/**
+ * Ring buffer holding the last few (t, f(t, X)) pairs, as needed by the
+ * Adams-Bashforth-Moulton methods. Pushing onto a full buffer overwrites
+ * the oldest entry.
+ */
+template <typename T>
+class adamsHistory {
+    public:
+        // Constructor
+        adamsHistory(int capacityInput=0);
+        // Add the newest pair
+        void push(T, const vector<T>&);
+        // Number of pairs held
+        int size();
+        // jth most recent pair (j=0 is the newest)
+        T tAt(int);
+        const vector<T>& fAt(int);
+
+        // Storage, public so that checkpoints can write it out
+        int capacity;
+        int head = 0;
+        int count = 0;
+        vector<T> times;
+        vector<vector<T>> values;
+};
+
+/**
+ * Constructor for adamsHistory.
+ *
+ * @param capacityInput Number of pairs the buffer can hold.
+ * @return              N/A.
+ */
+template <typename T>
+adamsHistory<T>::adamsHistory(int capacityInput) {
+    capacity = capacityInput;
+    times.resize(capacity);
+    values.resize(capacity);
+}
+
+/**
+ * Adds the newest (t, f) pair, overwriting the oldest if the buffer is full.
+ *
+ * @param ti       Time value.
+ * @param fi       f at ti.
+ * @return         Nothing.
+ */
+template <typename T>
+void adamsHistory<T>::push(T ti, const vector<T> &fi) {
+    head = (head + 1) % capacity;
+    times[head] = ti;
+    values[head] = fi;
+    count = min(count + 1, capacity);
+}
+
+/**
+ * Returns the number of pairs held.
+ *
+ * @return         Number of pairs.
+ */
+template <typename T>
+int adamsHistory<T>::size() {
+    return count;
+}
+
+/**
+ * Returns the time of the jth most recent pair.
+ *
+ * @param j        Age of the pair (0 is the newest).
+ * @return         Time value.
+ */
+template <typename T>
+T adamsHistory<T>::tAt(int j) {
+    return times[(head - j + capacity) % capacity];
+}
+
+/**
+ * Returns f of the jth most recent pair.
+ *
+ * @param j        Age of the pair (0 is the newest).
+ * @return         f value.
+ */
+template <typename T>
+const vector<T>& adamsHistory<T>::fAt(int j) {
+    return values[(head - j + capacity) % capacity];
+}
+
+/**
+ * Integrates the polynomial interpolating (nodes[j], values[j]) from a to b,
+ * i.e. returns sum_j w_j values[j] with w_j the integral of the jth Lagrange
+ * basis polynomial. Each basis polynomial is expanded in powers of (s-a) and
+ * integrated exactly in T arithmetic, so any step size sequence is allowed.
+ *
+ * @param nodes    Interpolation nodes (distinct).
+ * @param values   Vectors to be interpolated.
+ * @param a        Lower limit of integration.
+ * @param b        Upper limit of integration.
+ * @return         Integral of the interpolating polynomial.
+ */
+template <typename T>
+vector<T> adamsIntegrate(const vector<T> &nodes,
+const vector<const vector<T>*> &values, T a, T b) {
+    int k = nodes.size();
+    int n = values[0]->size();
+    T h = b - a;
+    vector<T> sum(n, T(0));
+
+    for (int j = 0; j < k; j++) {
+        // Coefficients of the jth basis polynomial in powers of u = s-a
+        vector<T> coeffs(1, T(1));
+        for (int m = 0; m < k; m++) {
+            if (m == j) {
+                continue;
+            }
+            T shift = nodes[m] - a;
+            T denom = nodes[j] - nodes[m];
+            vector<T> next(coeffs.size()+1, T(0));
+            for (int p = 0; p < coeffs.size(); p++) {
+                next[p+1] += coeffs[p]/denom;
+                next[p] -= coeffs[p]*shift/denom;
+            }
+            coeffs = next;
+        }
+
+        // Integral from u = 0 to h
+        T w = 0;
+        T hPow = h;
+        for (int p = 0; p < coeffs.size(); p++) {
+            w += coeffs[p]*hPow/(p+1);
+            hPow *= h;
+        }
+        for (int i = 0; i < n; i++) {
+            sum[i] += w*(*values[j])[i];
+        }
+    }
+
+    return sum;
+}
+
+/**
+ * Adams-Bashforth (explicit) increment of order k over [tn, tNew], using
+ * the k most recent pairs in hist (the newest must be at tn).
+ *
+ * @param hist     History of (t, f) pairs.
+ * @param k        Order.
+ * @param tNew     End of the step.
+ * @return         Increment to be added to X(tn).
+ */
+template <typename T>
+vector<T> adamsBashforth(adamsHistory<T> &hist, int k, T tNew) {
+    vector<T> nodes(k);
+    vector<const vector<T>*> values(k);
+    for (int j = 0; j < k; j++) {
+        nodes[j] = hist.tAt(j);
+        values[j] = &hist.fAt(j);
+    }
+
+    return adamsIntegrate(nodes, values, hist.tAt(0), tNew);
+}
+
+/**
+ * Adams-Moulton (implicit) increment of order k over [tn, tNew], using
+ * fNew at tNew and the k-1 most recent pairs in hist.
+ *
+ * @param hist     History of (t, f) pairs.
+ * @param k        Order.
+ * @param tNew     End of the step.
+ * @param fNew     f at tNew (from the predictor in PECE mode).
+ * @return         Increment to be added to X(tn).
+ */
+template <typename T>
+vector<T> adamsMoulton(adamsHistory<T> &hist, int k, T tNew,
+const vector<T> &fNew) {
+    vector<T> nodes(k);
+    vector<const vector<T>*> values(k);
+    nodes[0] = tNew;
+    values[0] = &fNew;
+    for (int j = 1; j < k; j++) {
+        nodes[j] = hist.tAt(j-1);
+        values[j] = &hist.fAt(j-1);
+    }
+
+    return adamsIntegrate(nodes, values, hist.tAt(0), tNew);
+}
+
+/**
+ * Error constants of the k-step Adams-Bashforth method and the order k
+ * Adams-Moulton method; Milne's device estimates the corrector error as
+ * adamsMilneFactor(k)*|corrected - predicted|.
+ *
+ * @param k        Order (1 to 6).
+ * @return         |C_AM|/(|C_AB| + |C_AM|).
+ */
+double adamsMilneFactor(int k) {
+    const double cAB[7] = {0, 1.0/2, 5.0/12, 3.0/8, 251.0/720, 95.0/288,
+    19087.0/60480};
+    const double cAM[7] = {0, 1.0/2, 1.0/12, 1.0/24, 19.0/720, 3.0/160,
+    863.0/60480};
+
+    return cAM[k]/(cAB[k] + cAM[k]);
+}
+
+#endif
@@ -0,0 +1,443 @@
+#ifndef NEWTONBASINS_H
+#define NEWTONBASINS_H
+
+// Required for sharing the tiles of the grid out over threads
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <simdOps.h>
+#include <threadPool.h>
+#include <trace.h>
+
+using namespace std;
+
+/**
+ * System F(X, params) = 0 of dim equations, evaluated with its Jacobian at
+ * a batch of n points stored component by component, so that the loops over
+ * the points can be vectorized. Written like fgJacob in Newtons.cpp, but
+ * with a loop over i around the body.
+ *
+ * @param n        Number of points.
+ * @param X        X[j][i] is component j of point i.
+ * @param params   Vector of parameter values.
+ * @param F        F[j][i] is set to F_j at point i.
+ * @param J        J[j*dim+k][i] is set to dF_j/dX_k at point i.
+ */
+typedef void (*newtonBatchFunc)(size_t n, const double *const *X,
+const vector<double> &params, double *const *F, double *const *J);
+
+// Number of points in each tile of the grid handed to a thread (a tile is
+// newtonTileSize x newtonTileSize points)
+const int newtonTileSize = 64;
+
+/**
+ * Basins of attraction of Newton's method over a grid of starting points:
+ * the distinct roots found, and for every starting point the root it
+ * converged to and the number of iterations it took.
+ */
+class basinMap {
+    public:
+        // Number of columns (x) and rows (y) of the grid
+        int nx = 0;
+        int ny = 0;
+        // Distinct roots, in lexicographic order
+        vector<vector<double>> roots;
+        // Row-major index into roots of the root each starting point
+        // converged to, -1 if it did not converge; row 0 is the largest y
+        vector<int16_t> labels;
+        // Newton iterations taken from each starting point
+        vector<uint8_t> iterations;
+        // Numbers of starting points that converged and that did not, and
+        // Newton iterations over all of them
+        long converged = 0;
+        long failed = 0;
+        long totalIterations = 0;
+        // Writes the map as a binary PPM image
+        void writePPM(string);
+        // Writes the map as a binary grid of labels
+        void writeGrid(string);
+};
+
+/**
+ * Writes the map as a binary (P6) PPM image. Each root gets its own hue,
+ * shaded darker the more iterations a point took, and points that did not
+ * converge are black.
+ *
+ * @param filename Name of the image file.
+ * @return         Nothing.
+ */
+void basinMap::writePPM(string filename) {
+    ofstream file(filename, ios::binary);
+    if (!file) {
+        throw runtime_error("basinMap: could not open " + filename);
+    }
+    file << "P6\n" << nx << " " << ny << "\n255\n";
+    vector<unsigned char> palette;
+    for (size_t r = 0; r < roots.size(); r++) {
+        // Hues spread around the colour wheel by the golden angle
+        double hue = fmod(r*0.618033988749895, 1.0)*6;
+        int sector = int (hue);
+        double frac = hue - sector;
+        double rgb[6][3] = {{1, frac, 0}, {1 - frac, 1, 0}, {0, 1, frac},
+        {0, 1 - frac, 1}, {frac, 0, 1}, {1, 0, 1 - frac}};
+        for (int c = 0; c < 3; c++) {
+            palette.push_back(55 + 200*rgb[sector][c]);
+        }
+    }
+    vector<unsigned char> row(3*nx);
+    for (int y = 0; y < ny; y++) {
+        for (int x = 0; x < nx; x++) {
+            size_t p = size_t (y)*nx + x;
+            double shade = 0;
+            if (labels[p] >= 0) {
+                shade = max(0.25, 1 - iterations[p]/40.0);
+            }
+            for (int c = 0; c < 3; c++) {
+                row[3*x + c] = (labels[p] >= 0) ?
+                palette[3*labels[p] + c]*shade : 0;
+            }
+        }
+        file.write((const char*) row.data(), row.size());
+    }
+}
+
+/**
+ * Writes the map as a binary grid: the marker "ODEBSN01", nx, ny, the
+ * number of roots and the dimension of X (as int64), the roots (as
+ * doubles), then the labels (int16, row-major) and the iteration counts
+ * (uint8, row-major).
+ *
+ * @param filename Name of the file.
+ * @return         Nothing.
+ */
+void basinMap::writeGrid(string filename) {
+    ofstream file(filename, ios::binary);
+    if (!file) {
+        throw runtime_error("basinMap: could not open " + filename);
+    }
+    int64_t header[4] = {nx, ny, int64_t (roots.size()),
+    int64_t (roots.empty() ? 0 : roots[0].size())};
+    file.write("ODEBSN01", 8);
+    file.write((const char*) header, sizeof(header));
+    for (size_t r = 0; r < roots.size(); r++) {
+        file.write((const char*) roots[r].data(),
+        roots[r].size()*sizeof(double));
+    }
+    file.write((const char*) labels.data(), labels.size()*sizeof(int16_t));
+    file.write((const char*) iterations.data(), iterations.size());
+}
+
+/**
+ * Returns the index of root in roots, adding it if no root is within
+ * rootTol of it (relative to its size, absolute below one).
+ *
+ * @param roots    Distinct roots found so far.
+ * @param root     Root.
+ * @param rootTol  Distance below which two roots are the same.
+ * @return         Index of root in roots.
+ */
+int newtonRootIndex(vector<vector<double>> &roots,
+const vector<double> &root, double rootTol) {
+    for (size_t r = 0; r < roots.size(); r++) {
+        bool same = true;
+        for (size_t j = 0; same && j < root.size(); j++) {
+            same = abs(root[j] - roots[r][j]) <=
+            rootTol*max(abs(roots[r][j]), 1.0);
+        }
+        if (same) {
+            return r;
+        }
+    }
+    roots.push_back(root);
+
+    return roots.size() - 1;
+}
+
+/**
+ * Solves J d = F in place for the first n points of a batch by Gaussian
+ * elimination with partial pivoting, leaving d in F. The matrices are
+ * stored like those of a newtonBatchFunc; the rows of each point are
+ * swapped on their own, and the elimination itself runs over all points at
+ * once so that it vectorizes. 2 x 2 systems are solved by Cramer's rule,
+ * as in Newtons.cpp.
+ *
+ * @param n        Number of points.
+ * @param dim      Number of equations.
+ * @param F        Right-hand sides, overwritten with the solutions.
+ * @param J        Matrices, overwritten.
+ * @param mult     Scratch space for n multipliers.
+ * @return         Nothing.
+ */
+void newtonBatchSolve(size_t n, int dim, double *const *F, double *const *J,
+double *mult) {
+    if (dim == 2) {
+        double *F0 = F[0], *F1 = F[1];
+        const double *J0 = J[0], *J1 = J[1], *J2 = J[2], *J3 = J[3];
+        for (size_t i = 0; i < n; i++) {
+            double detm = J0[i]*J3[i] - J1[i]*J2[i];
+            double d0 = (F0[i]*J3[i] - F1[i]*J1[i])/detm;
+            double d1 = (F1[i]*J0[i] - F0[i]*J2[i])/detm;
+            F0[i] = d0;
+            F1[i] = d1;
+        }
+        return;
+    }
+    for (int k = 0; k < dim; k++) {
+        // Pivot rows, point by point
+        for (size_t i = 0; i < n; i++) {
+            int p = k;
+            for (int r = k + 1; r < dim; r++) {
+                if (abs(J[r*dim + k][i]) > abs(J[p*dim + k][i])) {
+                    p = r;
+                }
+            }
+            if (p != k) {
+                for (int c = k; c < dim; c++) {
+                    swap(J[k*dim + c][i], J[p*dim + c][i]);
+                }
+                swap(F[k][i], F[p][i]);
+            }
+        }
+        // Eliminate below the pivot, over every point at once
+        for (int r = k + 1; r < dim; r++) {
+            const double *Jkk = J[k*dim + k], *Jrk = J[r*dim + k];
+            for (size_t i = 0; i < n; i++) {
+                mult[i] = Jrk[i]/Jkk[i];
+            }
+            for (int c = k + 1; c < dim; c++) {
+                double *Jrc = J[r*dim + c];
+                const double *Jkc = J[k*dim + c];
+                for (size_t i = 0; i < n; i++) {
+                    Jrc[i] -= mult[i]*Jkc[i];
+                }
+            }
+            double *Fr = F[r];
+            const double *Fk = F[k];
+            for (size_t i = 0; i < n; i++) {
+                Fr[i] -= mult[i]*Fk[i];
+            }
+        }
+    }
+    // Back substitution
+    for (int k = dim - 1; k >= 0; k--) {
+        double *Fk = F[k];
+        for (int c = k + 1; c < dim; c++) {
+            const double *Jkc = J[k*dim + c], *Fc = F[c];
+            for (size_t i = 0; i < n; i++) {
+                Fk[i] -= Jkc[i]*Fc[i];
+            }
+        }
+        const double *Jkk = J[k*dim + k];
+        for (size_t i = 0; i < n; i++) {
+            Fk[i] /= Jkk[i];
+        }
+    }
+}
+
+/**
+ * Maps the basins of attraction of Newton's method for F(X, params) = 0
+ * over an nx x ny grid of starting points. The starting points are base
+ * with components ix and iy replaced by the grid values, x in [xMin, xMax]
+ * across and y in [yMax, yMin] down. Like newtons in Newtons.cpp, each
+ * iteration evaluates F and stops if max|F_j| < tol, otherwise takes a
+ * Newton step; a point fails if F stops being finite or itMax steps are
+ * taken.
+ *
+ * The grid is split into tiles shared out over threads, and each tile is
+ * solved in batches of up to batch points stored component by component,
+ * so f and the linear solves vectorize across points. Points that have
+ * converged or failed are masked out of the batch by compacting the ones
+ * still iterating to its front, so each iteration only costs as much as the
+ * points left. Each tile deduplicates the roots it finds, then the roots of
+ * all tiles are merged and sorted, so the map does not depend on the number
+ * of threads.
+ *
+ * @param f        Batched system and Jacobian.
+ * @param dim      Number of equations (and components of X).
+ * @param params   Vector of parameter values.
+ * @param base     Starting point the grid varies two components of.
+ * @param ix       Component varied across the grid.
+ * @param iy       Component varied down the grid.
+ * @param xMin     Smallest x.
+ * @param xMax     Largest x.
+ * @param yMin     Smallest y.
+ * @param yMax     Largest y.
+ * @param nx       Number of columns.
+ * @param ny       Number of rows.
+ * @param tol      Tolerance on max|F_j|.
+ * @param itMax    Largest number of Newton steps (at most 255).
+ * @param rootTol  Distance below which two roots are the same.
+ * @param nThreads Number of threads to use (0 means one per core).
+ * @param batch    Number of points solved together.
+ * @return         Basin map.
+ */
+basinMap newtonBasins(newtonBatchFunc f, int dim, vector<double> params,
+vector<double> base, int ix, int iy, double xMin, double xMax, double yMin,
+double yMax, int nx, int ny, double tol=1e-10, int itMax=50,
+double rootTol=1e-6, int nThreads=0, int batch=256) {
+    TRACE_ZONE("newtonBasins");
+    if (dim < 1 || base.size() != dim || ix < 0 || ix >= dim || iy < 0 ||
+    iy >= dim || nx < 1 || ny < 1) {
+        throw runtime_error("newtonBasins: base should have dim components "
+        "and ix and iy should be components of it");
+    }
+    itMax = min(max(itMax, 1), 255);
+    batch = max(batch, 1);
+    basinMap result;
+    result.nx = nx;
+    result.ny = ny;
+    result.labels.assign(size_t (nx)*ny, -1);
+    result.iterations.assign(size_t (nx)*ny, 0);
+    int tilesX = (nx + newtonTileSize - 1)/newtonTileSize;
+    int tilesY = (ny + newtonTileSize - 1)/newtonTileSize;
+    int nTiles = tilesX*tilesY;
+    // Roots found by each tile, with the labels of its points indexing them
+    vector<vector<vector<double>>> tileRoots(nTiles);
+    double dx = (nx > 1) ? (xMax - xMin)/(nx - 1) : 0;
+    double dy = (ny > 1) ? (yMax - yMin)/(ny - 1) : 0;
+
+    threadPool pool(nThreads);
+    atomic<int> next(0);
+    pool.run([&](int) {
+        // Batch storage, one aligned array of batch values per component
+        alignedVec Xs(dim*batch), Fs(dim*batch), Js(dim*dim*batch);
+        alignedVec mult(batch);
+        vector<double*> X(dim), F(dim), J(dim*dim);
+        for (int j = 0; j < dim; j++) {
+            X[j] = Xs.data() + j*batch;
+            F[j] = Fs.data() + j*batch;
+        }
+        for (int j = 0; j < dim*dim; j++) {
+            J[j] = Js.data() + j*batch;
+        }
+        // Grid index of the point in each slot of the batch
+        vector<size_t> point(batch);
+        vector<double> root(dim);
+
+        for (int tile = next++; tile < nTiles; tile = next++) {
+            TRACE_ZONE("newtonBasins tile");
+            int x0 = (tile % tilesX)*newtonTileSize;
+            int y0 = (tile/tilesX)*newtonTileSize;
+            int x1 = min(x0 + newtonTileSize, nx);
+            int y1 = min(y0 + newtonTileSize, ny);
+            size_t tilePoints = size_t (x1 - x0)*(y1 - y0);
+            vector<vector<double>> &roots = tileRoots[tile];
+            for (size_t first = 0; first < tilePoints; first += batch) {
+                size_t n = min(size_t (batch), tilePoints - first);
+                for (size_t i = 0; i < n; i++) {
+                    int x = x0 + (first + i) % (x1 - x0);
+                    int y = y0 + (first + i)/(x1 - x0);
+                    point[i] = size_t (y)*nx + x;
+                    for (int j = 0; j < dim; j++) {
+                        X[j][i] = base[j];
+                    }
+                    X[ix][i] = xMin + x*dx;
+                    X[iy][i] = yMax - y*dy;
+                }
+                for (int it = 0; n > 0; it++) {
+                    f(n, X.data(), params, F.data(), J.data());
+                    // Take the points that have converged or failed out of
+                    // the batch, moving the rest to the front
+                    size_t kept = 0;
+                    for (size_t i = 0; i < n; i++) {
+                        double r = 0;
+                        for (int j = 0; j < dim; j++) {
+                            double a = abs(F[j][i]);
+                            // Written so that NaN is kept
+                            if (!(a <= r)) {
+                                r = a;
+                            }
+                        }
+                        if (r < tol) {
+                            for (int j = 0; j < dim; j++) {
+                                root[j] = X[j][i];
+                            }
+                            result.labels[point[i]] = newtonRootIndex(roots,
+                            root, rootTol);
+                            result.iterations[point[i]] = it;
+                            continue;
+                        }
+                        if (!isfinite(r) || it == itMax) {
+                            result.iterations[point[i]] = it;
+                            continue;
+                        }
+                        if (kept != i) {
+                            point[kept] = point[i];
+                            for (int j = 0; j < dim; j++) {
+                                X[j][kept] = X[j][i];
+                                F[j][kept] = F[j][i];
+                            }
+                            for (int j = 0; j < dim*dim; j++) {
+                                J[j][kept] = J[j][i];
+                            }
+                        }
+                        kept++;
+                    }
+                    n = kept;
+
+                    // Newton step for the points left
+                    newtonBatchSolve(n, dim, F.data(), J.data(), mult.data());
+                    for (int j = 0; j < dim; j++) {
+                        double *Xj = X[j];
+                        const double *Fj = F[j];
+                        for (size_t i = 0; i < n; i++) {
+                            Xj[i] -= Fj[i];
+                        }
+                    }
+                }
+            }
+        }
+    });
+
+    // Merge the roots of the tiles, then sort them so the labels do not
+    // depend on which tile found a root first
+    vector<vector<int>> tileMap(nTiles);
+    vector<vector<double>> merged;
+    for (int tile = 0; tile < nTiles; tile++) {
+        for (size_t r = 0; r < tileRoots[tile].size(); r++) {
+            tileMap[tile].push_back(newtonRootIndex(merged,
+            tileRoots[tile][r], rootTol));
+        }
+    }
+    vector<int> order(merged.size());
+    for (size_t r = 0; r < order.size(); r++) {
+        order[r] = r;
+    }
+    sort(order.begin(), order.end(), [&merged](int a, int b) {
+        return merged[a] < merged[b];
+    });
+    vector<int> rank(merged.size());
+    for (size_t r = 0; r < order.size(); r++) {
+        rank[order[r]] = r;
+        result.roots.push_back(merged[order[r]]);
+    }
+    for (int tile = 0; tile < nTiles; tile++) {
+        for (size_t r = 0; r < tileMap[tile].size(); r++) {
+            tileMap[tile][r] = rank[tileMap[tile][r]];
+        }
+        int x0 = (tile % tilesX)*newtonTileSize;
+        int y0 = (tile/tilesX)*newtonTileSize;
+        for (int y = y0; y < min(y0 + newtonTileSize, ny); y++) {
+            for (int x = x0; x < min(x0 + newtonTileSize, nx); x++) {
+                size_t p = size_t (y)*nx + x;
+                int16_t &label = result.labels[p];
+                result.totalIterations += result.iterations[p];
+                if (label >= 0) {
+                    label = tileMap[tile][label];
+                    result.converged++;
+                } else {
+                    result.failed++;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+#endif
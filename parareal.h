@@ -0,0 +1,184 @@
+#ifndef PARAREAL_H
+#define PARAREAL_H
+
+// Required for running the fine propagator over several threads
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <ODE.h>
+#include <threadPool.h>
+
+/**
+ * Solution of a Parareal solve at the time slice boundaries, and how the
+ * iteration went.
+ */
+class pararealResult {
+    public:
+        // Slice boundaries and the solution at them
+        vector<double> t;
+        vector<vector<double>> X;
+        int iterations = 0;
+        bool converged = false;
+        // Largest relative change of the boundary values in each iteration
+        vector<double> corrections;
+        // Right-hand side evaluations of the coarse and fine propagators
+        long coarseEvals = 0;
+        long fineEvals = 0;
+        // Evaluations on the critical path with one thread per slice: the
+        // coarse sweeps plus, for each iteration, the most expensive fine
+        // slice
+        long criticalEvals = 0;
+};
+
+/**
+ * Largest change between two states, relative to the size of each
+ * component (absolute for components smaller than one).
+ *
+ * @param a        New state.
+ * @param b        Old state.
+ * @return         max_j |a_j - b_j|/max(|b_j|, 1).
+ */
+inline double pararealChange(const vector<double> &a,
+const vector<double> &b) {
+    double change = 0;
+    for (size_t j = 0; j < a.size(); j++) {
+        change = max(change, abs(a[j] - b[j])/max(abs(b[j]), 1.0));
+    }
+
+    return change;
+}
+
+/**
+ * Solves the ODE dX/dt = f(t, X, params), X(t0) = X0, with the Parareal
+ * algorithm (Lions, Maday and Turinici 2001). [t0, tf] is split into
+ * nSlices time slices. A coarse propagator (RK4 with coarseSteps steps per
+ * slice) runs serially over the slices, and an accurate fine propagator
+ * (the adaptive solClass method) runs every slice in parallel from the
+ * current boundary values. Each iteration corrects the boundaries with
+ * U[n+1] = G(U[n]) + F(U_old[n]) - G(U_old[n]), until they change by less
+ * than convTol. After k iterations the first k slices agree with the serial
+ * fine solution, so at most nSlices iterations are needed, and slices that
+ * have converged are not solved again.
+ *
+ * @param f          Function that returns dX/dt from the arguments t, X and
+ * params.
+ * @param X0         Initial condition.
+ * @param t0         Initial time.
+ * @param tf         Final time.
+ * @param params     Vector of parameter values.
+ * @param nSlices    Number of time slices.
+ * @param coarseSteps Number of RK4 steps per slice of the coarse propagator.
+ * @param tol        Error tolerance of the fine propagator.
+ * @param convTol    Relative change of the boundary values below which the
+ * iteration stops.
+ * @param maxIter    Largest number of iterations (0 means nSlices).
+ * @param nThreads   Number of threads to use (0 means one per core).
+ * @param fineMethod Adaptive method of the fine propagator ("RKF45",
+ * "BulirschStoer", "ABM" or "auto").
+ * @return           Solution at the slice boundaries and iteration history.
+ * Errors of the fine propagator are rethrown once every thread has finished
+ * the iteration.
+ */
+pararealResult parareal(vector<double>(*f)(double, vector<double>,
+vector<double>), vector<double> X0, double t0, double tf,
+vector<double> params, int nSlices, int coarseSteps=1, double tol=1e-9,
+double convTol=1e-8, int maxIter=0, int nThreads=0,
+string fineMethod="RKF45") {
+    TRACE_ZONE("parareal");
+    if (nSlices < 1 || coarseSteps < 1) {
+        throw runtime_error("parareal: there should be at least one slice "
+        "and one coarse step per slice");
+    }
+    if (!isAdaptiveMethod(fineMethod)) {
+        throw runtime_error("parareal: no adaptive method called " +
+        fineMethod);
+    }
+    if (maxIter <= 0 || maxIter > nSlices) {
+        maxIter = nSlices;
+    }
+    pararealResult result;
+    vector<double> &ts = result.t;
+    vector<vector<double>> &U = result.X;
+    for (int n = 0; n <= nSlices; n++) {
+        ts.push_back((n == nSlices) ? tf : t0 + n*(tf - t0)/nSlices);
+    }
+
+    // Coarse propagator over slice n
+    auto coarse = [&](int n, const vector<double> &Un) {
+        TRACE_ZONE("parareal coarse");
+        result.coarseEvals += 4*coarseSteps;
+        result.criticalEvals += 4*coarseSteps;
+        return RK4Stream(f, Un, uniformGrid<double>(ts[n], ts[n+1],
+        coarseSteps), params, [](double, const vector<double>&) {});
+    };
+
+    // Initial boundary values from a serial coarse sweep
+    vector<vector<double>> G(nSlices), F(nSlices);
+    vector<long> fineCost(nSlices, 0);
+    U.push_back(X0);
+    for (int n = 0; n < nSlices; n++) {
+        G[n] = coarse(n, U[n]);
+        U.push_back(G[n]);
+    }
+
+    threadPool pool(nThreads);
+    atomic<int> next(0);
+    exception_ptr error;
+    mutex errorLock;
+    for (int k = 0; k < maxIter; k++) {
+        // Fine propagator over the slices that have not converged, in
+        // parallel
+        next = k;
+        pool.run([&](int) {
+            for (int n = next++; n < nSlices; n = next++) {
+                TRACE_ZONE("parareal fine");
+                try {
+                    basicSolClass<double> fine(f, U[n], ts[n], ts[n+1],
+                    params, tol, 1000000, (ts[n+1] - ts[n])/coarseSteps,
+                    fineMethod);
+                    F[n] = fine.getX().back();
+                    fineCost[n] = fine.getStats().nfev;
+                } catch (...) {
+                    lock_guard<mutex> guard(errorLock);
+                    error = current_exception();
+                }
+            }
+        });
+        if (error) {
+            rethrow_exception(error);
+        }
+        long slowest = 0;
+        for (int n = k; n < nSlices; n++) {
+            result.fineEvals += fineCost[n];
+            slowest = max(slowest, fineCost[n]);
+        }
+        result.criticalEvals += slowest;
+
+        // Serial correction sweep; U[k] is already exact, so U[k+1] = F[k]
+        double change = 0;
+        for (int n = k; n < nSlices; n++) {
+            vector<double> Gn = (n == k) ? G[n] : coarse(n, U[n]);
+            vector<double> Un(Gn.size());
+            for (size_t j = 0; j < Gn.size(); j++) {
+                Un[j] = Gn[j] + F[n][j] - G[n][j];
+            }
+            change = max(change, pararealChange(Un, U[n+1]));
+            U[n+1] = Un;
+            G[n] = Gn;
+        }
+        result.corrections.push_back(change);
+        result.iterations = k+1;
+        if (change <= convTol) {
+            result.converged = true;
+            break;
+        }
+    }
+    // Every slice has been propagated finely from its exact start
+    if (result.iterations == nSlices) {
+        result.converged = true;
+    }
+
+    return result;
+}
+
+#endif
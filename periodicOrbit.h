@@ -0,0 +1,340 @@
+#ifndef PERIODICORBIT_H
+#define PERIODICORBIT_H
+
+// Required for integrating the segments over several threads
+#include <atomic>
+#include <complex>
+#include <Lyapunov.h>
+#include <threadPool.h>
+
+/**
+ * Periodic orbit found by multiple shooting, and how the Newton iteration
+ * went.
+ */
+class periodicOrbitResult {
+    public:
+        // Period
+        double T = 0;
+        // State at the start of each segment (X0[0] is on the orbit at
+        // t = 0)
+        vector<vector<double>> X0;
+        // One period of the orbit, at every RK4 step
+        vector<double> t;
+        vector<vector<double>> X;
+        // Monodromy matrix (the Jacobian of the flow over one period) and
+        // its eigenvalues, the Floquet multipliers, largest modulus first
+        vector<vector<double>> monodromy;
+        vector<complex<double>> multipliers;
+        int iterations = 0;
+        bool converged = false;
+        // Largest relative residual of the matching conditions before each
+        // Newton step
+        vector<double> residuals;
+        // Evaluations of f and of the Jacobian
+        long rhsEvals = 0;
+        long jacEvals = 0;
+};
+
+/**
+ * Integrates dX/dt = f(t, X, params) and its variational equations
+ * dPhi/dt = J Phi, Phi(0) = I, with RK4 over [0, tau] from x, giving the end
+ * state and the Jacobian Phi of the end state with respect to x. With an
+ * analytic Jacobian the stages are formed in preallocated storage, so the
+ * only allocations are those of f and jac; otherwise tangentRK4Step is used
+ * with finite difference Jacobian-vector products.
+ *
+ * @param f        Function that returns dX/dt from the arguments t, X and
+ * params.
+ * @param jac      Function that returns the Jacobian df/dX or nullptr to use
+ * finite differences.
+ * @param x        Initial state, overwritten with the end state.
+ * @param tau      Length of the segment.
+ * @param steps    Number of RK4 steps.
+ * @param params   Vector of parameter values.
+ * @param Phi      Set to the Jacobian of the end state (row i holds the
+ * derivatives of component i).
+ * @return         Nothing.
+ */
+void shootSegment(vector<double>(*f)(double, vector<double>,
+vector<double>), vector<vector<double>>(*jac)(double, vector<double>,
+vector<double>), vector<double> &x, double tau, int steps,
+const vector<double> &params, vector<vector<double>> &Phi) {
+    TRACE_ZONE("shoot segment");
+    int n = x.size();
+    double dt = tau/steps;
+    Phi.assign(n, vector<double>(n, 0.0));
+    for (int i = 0; i < n; i++) {
+        Phi[i][i] = 1.0;
+    }
+    if (jac == nullptr) {
+        // Tangent vectors V[j] are the columns of Phi
+        vector<vector<double>> V = Phi;
+        for (int s = 0; s < steps; s++) {
+            tangentRK4Step(f, jac, s*dt, dt, x, V, params);
+        }
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                Phi[i][j] = V[j][i];
+            }
+        }
+        return;
+    }
+
+    // Nodes and weights of the classical RK4 tableau
+    const double c[4] = {0.0, 0.5, 0.5, 1.0};
+    const double w[4] = {1.0/6.0, 1.0/3.0, 1.0/3.0, 1.0/6.0};
+    vector<double> Xs(n), nextX(n), kX(n);
+    vector<vector<double>> Ps = Phi, nextP = Phi, kP = Phi, J;
+    for (int s = 0; s < steps; s++) {
+        double t = s*dt;
+        nextX = x;
+        nextP = Phi;
+        for (int stage = 0; stage < 4; stage++) {
+            // Stage values are built from the previous stage's slopes
+            for (int i = 0; i < n; i++) {
+                Xs[i] = x[i] + c[stage]*dt*kX[i];
+                for (int j = 0; j < n; j++) {
+                    Ps[i][j] = Phi[i][j] + c[stage]*dt*kP[i][j];
+                }
+            }
+            kX = f(t + c[stage]*dt, Xs, params);
+            J = jac(t + c[stage]*dt, Xs, params);
+            for (int i = 0; i < n; i++) {
+                for (int j = 0; j < n; j++) {
+                    double sum = 0;
+                    for (int l = 0; l < n; l++) {
+                        sum += J[i][l]*Ps[l][j];
+                    }
+                    kP[i][j] = sum;
+                }
+            }
+            for (int i = 0; i < n; i++) {
+                nextX[i] += w[stage]*dt*kX[i];
+                for (int j = 0; j < n; j++) {
+                    nextP[i][j] += w[stage]*dt*kP[i][j];
+                }
+            }
+        }
+        x.swap(nextX);
+        Phi.swap(nextP);
+    }
+}
+
+/**
+ * Finds a periodic orbit of the autonomous system dX/dt = f(X, params) by
+ * multiple shooting. One period is split into nSegments segments, and the
+ * unknowns are the state at the start of each segment and the period T.
+ * The segments are integrated with RK4 (stepsPerSegment steps each) and
+ * their variational equations, all at once over threads. Newton's method
+ * then solves the matching conditions (the end of each segment is the start
+ * of the next, and the end of the last is the start of the first) with the
+ * phase condition that the first state only moves across the flow, using
+ * the Jacobians of the segments and f at their ends for the dense Jacobian
+ * of the conditions. Steps that would increase the sum of squares of the
+ * residuals are halved.
+ *
+ * The initial guess is the integration of one period guess T0 from X0, so
+ * X0 should be near the orbit (e.g. after a short transient). The result
+ * includes the Floquet multipliers, the eigenvalues of the monodromy
+ * matrix: one is 1 (along the orbit), and the orbit is stable if the others
+ * lie inside the unit circle.
+ *
+ * @param f               Function that returns dX/dt from the arguments t,
+ * X and params.
+ * @param jac             Function that returns the Jacobian df/dX or
+ * nullptr to use finite differences.
+ * @param X0              State near the orbit.
+ * @param T0              Guess of the period.
+ * @param params          Vector of parameter values.
+ * @param nSegments       Number of shooting segments.
+ * @param stepsPerSegment Number of RK4 steps per segment.
+ * @param tol             Largest relative residual of the matching
+ * conditions at convergence.
+ * @param maxIter         Largest number of Newton iterations.
+ * @param nThreads        Number of threads to use (0 means one per core).
+ * @return                Orbit, period, Floquet multipliers and iteration
+ * history.
+ */
+periodicOrbitResult periodicOrbit(vector<double>(*f)(double, vector<double>,
+vector<double>), vector<vector<double>>(*jac)(double, vector<double>,
+vector<double>), vector<double> X0, double T0, vector<double> params,
+int nSegments=20, int stepsPerSegment=100, double tol=1e-10,
+int maxIter=30, int nThreads=0) {
+    TRACE_ZONE("periodicOrbit");
+    int n = X0.size();
+    int m = nSegments;
+    if (m < 1 || stepsPerSegment < 1 || !(T0 > 0)) {
+        throw runtime_error("periodicOrbit: there should be at least one "
+        "segment and one step per segment, and T0 should be positive");
+    }
+    periodicOrbitResult result;
+    // Evaluations per RK4 step of a segment and its variational equations
+    long rhsPerStep = (jac != nullptr) ? 4 : 4*(1 + n);
+    long jacPerStep = (jac != nullptr) ? 4 : 0;
+
+    // Initial segment states along one period guess from X0
+    vector<vector<double>> x(m);
+    vector<vector<double>> noTangents;
+    x[0] = X0;
+    for (int k = 1; k < m; k++) {
+        x[k] = x[k-1];
+        double dt = T0/m/stepsPerSegment;
+        for (int s = 0; s < stepsPerSegment; s++) {
+            tangentRK4Step(f, jac, s*dt, dt, x[k], noTangents, params);
+        }
+    }
+    result.rhsEvals += 4L*(m - 1)*stepsPerSegment;
+    double T = T0;
+
+    threadPool pool(nThreads);
+    vector<vector<double>> ends(m), fEnds(m);
+    vector<vector<vector<double>>> Phi(m);
+    // Integrates every segment from x over T/m and returns the largest
+    // relative residual of the matching conditions, setting merit to the
+    // sum of their squares
+    double merit = 0;
+    auto shoot = [&](const vector<vector<double>> &xs, double Ts) {
+        atomic<int> next(0);
+        pool.run([&](int) {
+            for (int k = next++; k < m; k = next++) {
+                ends[k] = xs[k];
+                shootSegment(f, jac, ends[k], Ts/m, stepsPerSegment, params,
+                Phi[k]);
+                fEnds[k] = f(0, ends[k], params);
+            }
+        });
+        result.rhsEvals += m*(rhsPerStep*stepsPerSegment + 1);
+        result.jacEvals += m*jacPerStep*stepsPerSegment;
+        double residual = 0;
+        merit = 0;
+        for (int k = 0; k < m; k++) {
+            const vector<double> &xNext = xs[(k + 1) % m];
+            for (int i = 0; i < n; i++) {
+                double r = abs(ends[k][i] - xNext[i])/max(abs(xNext[i]),
+                1.0);
+                // Written so that NaN is kept
+                if (!(r <= residual)) {
+                    residual = r;
+                }
+                merit += r*r;
+            }
+        }
+        if (!isfinite(residual)) {
+            residual = numeric_limits<double>::infinity();
+            merit = residual;
+        }
+
+        return residual;
+    };
+
+    double residual = shoot(x, T);
+    int N = m*n + 1;
+    for (int iter = 0; iter < maxIter; iter++) {
+        result.residuals.push_back(residual);
+        if (residual <= tol) {
+            result.converged = true;
+            break;
+        }
+        // Dense Jacobian of the matching and phase conditions; the
+        // unknowns are x[0], ..., x[m-1] and T
+        vector<vector<double>> A(N, vector<double>(N, 0.0));
+        vector<double> b(N, 0.0);
+        for (int k = 0; k < m; k++) {
+            int next = (k + 1) % m;
+            for (int i = 0; i < n; i++) {
+                int row = k*n + i;
+                for (int j = 0; j < n; j++) {
+                    A[row][k*n + j] = Phi[k][i][j];
+                }
+                A[row][next*n + i] -= 1;
+                A[row][N-1] = fEnds[k][i]/m;
+                b[row] = x[next][i] - ends[k][i];
+            }
+        }
+        vector<double> f0 = f(0, x[0], params);
+        result.rhsEvals++;
+        for (int j = 0; j < n; j++) {
+            A[N-1][j] = f0[j];
+        }
+        vector<int> perm;
+        luDecompose(A, perm);
+        vector<double> delta = luSolve(A, perm, b);
+
+        // Damped Newton step: the Newton direction decreases the sum of
+        // squares of the residuals if the step is short enough
+        vector<vector<double>> xTrial(m);
+        double TTrial = T;
+        double trial = numeric_limits<double>::infinity();
+        double oldMerit = merit;
+        for (double lambda = 1; lambda >= 1.0/1024; lambda /= 2) {
+            for (int k = 0; k < m; k++) {
+                xTrial[k] = x[k];
+                for (int i = 0; i < n; i++) {
+                    xTrial[k][i] += lambda*delta[k*n + i];
+                }
+            }
+            TTrial = T + lambda*delta[N-1];
+            if (TTrial > 0) {
+                trial = shoot(xTrial, TTrial);
+            } else {
+                merit = numeric_limits<double>::infinity();
+            }
+            if (merit < oldMerit) {
+                break;
+            }
+        }
+        if (!(merit < oldMerit)) {
+            // No progress along the Newton direction; shoot from x again so
+            // that the monodromy matrix below is that of x
+            shoot(x, T);
+            break;
+        }
+        x = xTrial;
+        T = TTrial;
+        residual = trial;
+        result.iterations = iter + 1;
+    }
+    if (!result.converged) {
+        result.residuals.push_back(residual);
+        result.converged = residual <= tol;
+    }
+
+    // Monodromy matrix Phi[m-1] ... Phi[0] and its eigenvalues
+    vector<vector<double>> M(n, vector<double>(n, 0.0));
+    for (int i = 0; i < n; i++) {
+        M[i][i] = 1.0;
+    }
+    for (int k = 0; k < m; k++) {
+        vector<vector<double>> PM(n, vector<double>(n, 0.0));
+        for (int i = 0; i < n; i++) {
+            for (int l = 0; l < n; l++) {
+                for (int j = 0; j < n; j++) {
+                    PM[i][j] += Phi[k][i][l]*M[l][j];
+                }
+            }
+        }
+        M = PM;
+    }
+    result.monodromy = M;
+    result.multipliers = eigenvalues(M);
+
+    // One period of the orbit, segment by segment
+    result.T = T;
+    result.X0 = x;
+    double dt = T/m/stepsPerSegment;
+    for (int k = 0; k < m; k++) {
+        vector<double> X = x[k];
+        for (int s = 0; s < stepsPerSegment; s++) {
+            result.t.push_back((k*stepsPerSegment + s)*dt);
+            result.X.push_back(X);
+            tangentRK4Step(f, jac, s*dt, dt, X, noTangents, params);
+        }
+    }
+    result.t.push_back(T);
+    result.X.push_back(x[0]);
+    result.rhsEvals += 4L*m*stepsPerSegment;
+
+    return result;
+}
+
+#endif
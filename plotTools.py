@@ -1,5 +1,7 @@
 #!/usr/bin/env python3
 # Written in May 2021 by Brenton Horne
+import io
+import subprocess
 import matplotlib.pyplot as plt
 import pandas as pd
 import scipy.interpolate as sci
@@ -62,4 +64,78 @@ def spline(x0, y0, xp):
     tck = sci.splrep(x0, y0)
     yp = sci.splev(xp, tck)
 
-    return yp
\ No newline at end of file
+    return yp
+
+def importErrors(str):
+    """
+    Returns data frames of the error curves of the Euler, Modified Euler and 
+    RK4 solutions against the RKF45 solution, as written by solveProblem.
+
+    Parameters
+    ----------
+    str : string.
+        Prefix CSV files have.
+
+    Returns
+    -------
+    Euler, Modified Euler and RK4 error data frames. Each row holds the 
+    largest error of each variable over a run of time steps.
+    """
+    dfEul = pd.read_csv(str + "_Euler_error.csv")
+    dfMEul = pd.read_csv(str + "_ModEuler_error.csv")
+    dfRK4 = pd.read_csv(str + "_RK4_error.csv")
+
+    return dfEul, dfMEul, dfRK4
+
+def plotErrors(dfErrs, var, varLabel):
+    """
+    Plots the error of one variable against t on a log scale for the Euler, 
+    Modified Euler and RK4 solutions, in the current figure.
+
+    Parameters
+    ----------
+    dfErrs : list of Data Frames.
+        Euler, Modified Euler and RK4 error data frames from importErrors.
+    var : string.
+        Heading of the variable.
+    varLabel : string.
+        Name of the variable to be used in the legend.
+    """
+    labels = ["Euler", "Modified Euler", "Runge-Kutta 4th order"]
+    for i in range(len(dfErrs)):
+        plt.semilogy(dfErrs[i].t, dfErrs[i][var], 
+        label="{} ({})".format(varLabel, labels[i]))
+    plt.xlabel("$t$")
+    plt.ylabel("Absolute error")
+
+def importWindow(filename, t1, t2, stride=1,
+                 program="./TrajectoryWindow.out"):
+    """
+    Returns a data frame of the rows of a trajectory file (written by 
+    trajectoryWriter) whose t values lie in [t1, t2]. Only the blocks of the 
+    file that overlap the window are decoded, by the TrajectoryWindow 
+    program (compiled from TrajectoryWindow.cpp), so plotting a slice of a 
+    long solution does not mean reading all of it.
+
+    Parameters
+    ----------
+    filename : string.
+        Name of the trajectory file.
+    t1 : float.
+        Start of the window.
+    t2 : float.
+        End of the window.
+    stride : int.
+        Keep every stride-th row of the window.
+    program : string.
+        Path of the compiled TrajectoryWindow program (the compile script
+        builds it as TrajectoryWindow.out).
+
+    Returns
+    -------
+    Data frame of the window, with the same headings as writeToCSV gives.
+    """
+    out = subprocess.run([program, "window", filename, repr(t1), repr(t2),
+    str(stride)], stdout=subprocess.PIPE, check=True, text=True).stdout
+
+    return pd.read_csv(io.StringIO(out))
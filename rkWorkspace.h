@@ -0,0 +1,406 @@
+#ifndef RKWORKSPACE_H
+#define RKWORKSPACE_H
+
+#include <ODE.h>
+#include <simdOps.h>
+#include <threadPool.h>
+#include <memory>
+
+using namespace std;
+
+/**
+ * Right-hand side of a large system, written into dX in place instead of
+ * returned, so that no vectors are allocated per evaluation.
+ *
+ * @param t        Time value.
+ * @param X        State (n values).
+ * @param dX       Set to dX/dt (n values).
+ * @param n        Number of states.
+ * @param params   Vector of parameter values.
+ */
+typedef void (*inPlaceRHS)(double t, const double *X, double *dX, size_t n,
+const vector<double> &params);
+
+/**
+ * Right-hand side that can be evaluated one block of components at a time,
+ * so that threads can share the evaluation. Only dX[begin], ...,
+ * dX[end-1] are written, but all of X may be read.
+ *
+ * @param t        Time value.
+ * @param X        State (n values).
+ * @param dX       Components begin to end-1 set to those of dX/dt.
+ * @param n        Number of states.
+ * @param begin    First component to be evaluated.
+ * @param end      One past the last component to be evaluated.
+ * @param params   Vector of parameter values.
+ */
+typedef void (*inPlaceBlockRHS)(double t, const double *X, double *dX,
+size_t n, size_t begin, size_t end, const vector<double> &params);
+
+// Number of components in each block the state is partitioned into (256 KB
+// of doubles, so a block of X and of dX fit in a core's L2 cache)
+const size_t rkBlockSize = 32768;
+
+/**
+ * Preallocated workspace for integrating systems with very many states
+ * (e.g. method of lines discretisations of PDEs). Unlike solClass only the
+ * current state is kept, every array is aligned and the stage updates and
+ * error norms use the fused kernels of simdOps.h, so each stage is a single
+ * pass over memory.
+ *
+ * The state is partitioned into blocks of rkBlockSize components and each
+ * thread of a persistent pool owns a contiguous run of blocks. Every thread
+ * evaluates the RHS (if given as an inPlaceBlockRHS) and does the stage
+ * arithmetic on its own blocks, so the same thread touches the same memory
+ * in every phase of a step, and the RKF45 error norm is a parallel
+ * max-reduction. The results do not depend on the number of threads.
+ */
+class rkWorkspace {
+    public:
+        // Constructors
+        rkWorkspace(inPlaceRHS, size_t, vector<double>, int nThreads=0);
+        rkWorkspace(inPlaceBlockRHS, size_t, vector<double>, int nThreads=0);
+        // N classical RK4 steps from t0 to tf
+        void rk4(alignedVec&, double, double, int);
+        // Adaptive RKF45 from t0 to tf
+        void rkf45(alignedVec&, double, double, double, double dtInit=1e-3,
+        int itMax=1000000);
+        // Work done so far
+        solverStats getStats();
+        // Last step size taken by rkf45
+        double getDt();
+        // Number of threads used
+        int getThreads();
+
+    private:
+        inPlaceRHS f = nullptr;
+        inPlaceBlockRHS fBlock = nullptr;
+        size_t n;
+        vector<double> params;
+        solverStats stats;
+        double dt = 0;
+        // Stage derivatives and stage state
+        alignedVec k[6];
+        alignedVec Xs;
+        // Threads and the first component owned by each (plus n at the end)
+        unique_ptr<threadPool> pool;
+        vector<size_t> bounds;
+        // Per thread maxima of the error norm, one cache line apart
+        alignedVec partialR;
+        // Allocate arrays and partition the state
+        void setup(size_t, vector<double>, int);
+        // Evaluate f, counting evaluations
+        void evalRHS(double, const double*, double*);
+        // Parallel versions of the simdOps.h kernels
+        void linComb(double*, const double*, int, const double*,
+        const double *const *);
+        double maxScaledComb(const double*, int, const double*,
+        const double *const *);
+};
+
+/**
+ * Constructor for rkWorkspace with a RHS evaluated by a single thread (the
+ * stage arithmetic is still shared by nThreads threads).
+ *
+ * @param fInput      Function that writes dX/dt into its third argument.
+ * @param nInput      Number of states.
+ * @param paramsInput Vector of parameter values.
+ * @param nThreads    Number of threads (0 means one per core).
+ * @return            N/A.
+ */
+rkWorkspace::rkWorkspace(inPlaceRHS fInput, size_t nInput,
+vector<double> paramsInput, int nThreads) {
+    f = fInput;
+    setup(nInput, paramsInput, nThreads);
+}
+
+/**
+ * Constructor for rkWorkspace with a RHS evaluated block by block, each
+ * thread evaluating the blocks it owns.
+ *
+ * @param fInput      Function that writes components begin to end-1 of
+ * dX/dt into its third argument.
+ * @param nInput      Number of states.
+ * @param paramsInput Vector of parameter values.
+ * @param nThreads    Number of threads (0 means one per core).
+ * @return            N/A.
+ */
+rkWorkspace::rkWorkspace(inPlaceBlockRHS fInput, size_t nInput,
+vector<double> paramsInput, int nThreads) {
+    fBlock = fInput;
+    setup(nInput, paramsInput, nThreads);
+}
+
+/**
+ * Allocates the stage arrays, starts the threads and gives each thread a
+ * contiguous run of blocks.
+ *
+ * @param nInput      Number of states.
+ * @param paramsInput Vector of parameter values.
+ * @param nThreads    Number of threads (0 means one per core).
+ * @return            Nothing.
+ */
+void rkWorkspace::setup(size_t nInput, vector<double> paramsInput,
+int nThreads) {
+    n = nInput;
+    params = paramsInput;
+    for (int j = 0; j < 6; j++) {
+        k[j].resize(n);
+    }
+    Xs.resize(n);
+
+    // More threads than blocks would leave threads idle
+    size_t nBlocks = (n + rkBlockSize - 1)/rkBlockSize;
+    if (nThreads <= 0) {
+        nThreads = max(1u, thread::hardware_concurrency());
+    }
+    int nUsed = min(size_t (nThreads), max(nBlocks, size_t (1)));
+    pool.reset(new threadPool(nUsed));
+    partialR.assign(nUsed*simdWidth, 0.0);
+
+    // Block boundaries are multiples of rkBlockSize, so every thread's part
+    // of an aligned array is aligned
+    bounds.resize(nUsed+1);
+    for (int i = 0; i <= nUsed; i++) {
+        bounds[i] = min(n, (nBlocks*i/nUsed)*rkBlockSize);
+    }
+}
+
+/**
+ * Evaluates the right-hand side and counts the evaluation. A block RHS is
+ * evaluated by every thread on its own blocks, one block at a time.
+ *
+ * @param ti       Time value.
+ * @param Xi       State.
+ * @param dX       Set to dX/dt.
+ * @return         Nothing.
+ */
+void rkWorkspace::evalRHS(double ti, const double *Xi, double *dX) {
+    stats.nfev++;
+    if (fBlock == nullptr) {
+        TRACE_ZONE("rhs");
+        f(ti, Xi, dX, n, params);
+        return;
+    }
+    pool->run([&](int id) {
+        TRACE_ZONE("rhs");
+        for (size_t b = bounds[id]; b < bounds[id+1]; b += rkBlockSize) {
+            fBlock(ti, Xi, dX, n, b, min(b + rkBlockSize, bounds[id+1]),
+            params);
+        }
+    });
+}
+
+/**
+ * Computes y = x + sum_j coeffs[j]*kj[j], each thread on its own part.
+ *
+ * @param y        Aligned output array (may be x).
+ * @param x        Aligned input array.
+ * @param m        Number of terms.
+ * @param coeffs   Coefficients of the terms.
+ * @param kj       Aligned arrays of the terms.
+ * @return         Nothing.
+ */
+void rkWorkspace::linComb(double *y, const double *x, int m,
+const double *coeffs, const double *const *kj) {
+    pool->run([&](int id) {
+        TRACE_ZONE("stage update");
+        size_t begin = bounds[id];
+        const double *kOffset[16];
+        for (int j = 0; j < m; j++) {
+            kOffset[j] = kj[j] + begin;
+        }
+        simdLinComb(bounds[id+1] - begin, y + begin, x + begin, m, coeffs,
+        kOffset);
+    });
+}
+
+/**
+ * Computes max_i |sum_j coeffs[j]*kj[j][i]|/(1 + |x[i]|) by a parallel
+ * max-reduction.
+ *
+ * @param x        Aligned array the error is scaled by.
+ * @param m        Number of terms.
+ * @param coeffs   Coefficients of the terms.
+ * @param kj       Aligned arrays of the terms.
+ * @return         Scaled max-norm of the combination.
+ */
+double rkWorkspace::maxScaledComb(const double *x, int m,
+const double *coeffs, const double *const *kj) {
+    pool->run([&](int id) {
+        TRACE_ZONE("error norm");
+        size_t begin = bounds[id];
+        const double *kOffset[16];
+        for (int j = 0; j < m; j++) {
+            kOffset[j] = kj[j] + begin;
+        }
+        partialR[id*simdWidth] = simdMaxScaledComb(bounds[id+1] - begin,
+        x + begin, m, coeffs, kOffset);
+    });
+
+    double R = 0;
+    for (int id = 0; id < pool->size(); id++) {
+        R = simdMax(R, partialR[id*simdWidth]);
+    }
+
+    return R;
+}
+
+/**
+ * Returns the work done by the workspace so far.
+ *
+ * @return         Counts of RHS evaluations and accepted/rejected steps.
+ */
+solverStats rkWorkspace::getStats() {
+    return stats;
+}
+
+/**
+ * Returns the step size rkf45 would try next.
+ *
+ * @return         Step size.
+ */
+double rkWorkspace::getDt() {
+    return dt;
+}
+
+/**
+ * Returns the number of threads the workspace uses.
+ *
+ * @return         Number of threads.
+ */
+int rkWorkspace::getThreads() {
+    return pool->size();
+}
+
+/**
+ * Takes N steps of the classical fourth-order Runge-Kutta method from t0 to
+ * tf.
+ *
+ * @param X        State at t0, overwritten with the state at tf.
+ * @param t0       Initial time.
+ * @param tf       Final time.
+ * @param N        Number of steps.
+ * @return         Nothing.
+ */
+void rkWorkspace::rk4(alignedVec &X, double t0, double tf, int N) {
+    TRACE_ZONE("rkWorkspace::rk4");
+    assert(X.size() == n);
+    double h = (tf-t0)/N;
+    const double *kp[4] = {k[0].data(), k[1].data(), k[2].data(),
+    k[3].data()};
+
+    for (int i = 0; i < N; i++) {
+        double ti = t0 + i*h;
+        double c;
+        evalRHS(ti, X.data(), k[0].data());
+        c = h/2;
+        linComb(Xs.data(), X.data(), 1, &c, kp);
+        evalRHS(ti + h/2, Xs.data(), k[1].data());
+        linComb(Xs.data(), X.data(), 1, &c, kp + 1);
+        evalRHS(ti + h/2, Xs.data(), k[2].data());
+        c = h;
+        linComb(Xs.data(), X.data(), 1, &c, kp + 2);
+        evalRHS(ti + h, Xs.data(), k[3].data());
+
+        // X += h/6 (k1 + 2k2 + 2k3 + k4) in a single pass
+        double b[4] = {h/6, h/3, h/3, h/6};
+        linComb(X.data(), X.data(), 4, b, kp);
+        stats.nAccept++;
+    }
+}
+
+/**
+ * Integrates from t0 to tf with the Runge-Kutta-Fehlberg method, using the
+ * same tableau and step size control as RKF45 in ODE.h, except that the
+ * error is measured relative to the size of each state (as in
+ * Bulirsch-Stoer), which suits states of very different magnitudes. A step
+ * whose error estimate is NaN is rejected and dt shrunk; a runtime_error is
+ * thrown if dt shrinks until it no longer advances t.
+ *
+ * @param X        State at t0, overwritten with the state at tf.
+ * @param t0       Initial time.
+ * @param tf       Final time.
+ * @param tol      Error tolerance.
+ * @param dtInit   Initial guess for dt (ignored if a previous call left a
+ * step size).
+ * @param itMax    Maximum number of steps.
+ * @return         Nothing.
+ */
+void rkWorkspace::rkf45(alignedVec &X, double t0, double tf, double tol,
+double dtInit, int itMax) {
+    TRACE_ZONE("rkWorkspace::rkf45");
+    assert(X.size() == n);
+    // Fehlberg tableau; row s gives the coefficients of k1..ks in stage s+1
+    const double a[5][5] = {
+        {1.0/4},
+        {3.0/32, 9.0/32},
+        {1932.0/2197, -7200.0/2197, 7296.0/2197},
+        {439.0/216, -8.0, 3680.0/513, -845.0/4104},
+        {-8.0/27, 2.0, -3544.0/2565, 1859.0/4104, -11.0/40}
+    };
+    const double c[6] = {0, 1.0/4, 3.0/8, 12.0/13, 1, 1.0/2};
+    // Fourth order weights and the difference to the fifth order weights
+    const double b4[6] = {25.0/216, 0, 1408.0/2565, 2197.0/4104, -1.0/5, 0};
+    const double bErr[6] = {25.0/216 - 16.0/135, 0, 1408.0/2565 - 6656.0/12825,
+    2197.0/4104 - 28561.0/56430, -1.0/5 + 9.0/50, -2.0/55};
+    const double *kp[6];
+    for (int j = 0; j < 6; j++) {
+        kp[j] = k[j].data();
+    }
+    if (dt == 0) {
+        dt = dtInit;
+    }
+
+    double ti = t0;
+    double coeffs[6];
+    int i = 0;
+    evalRHS(ti, X.data(), k[0].data());
+    while (ti < tf && i < itMax) {
+        dt = std::min(dt, tf-ti);
+
+        // Stages
+        for (int s = 1; s < 6; s++) {
+            for (int j = 0; j < s; j++) {
+                coeffs[j] = dt*a[s-1][j];
+            }
+            linComb(Xs.data(), X.data(), s, coeffs, kp);
+            evalRHS(ti + c[s]*dt, Xs.data(), k[s].data());
+        }
+
+        // Measure of error in the fourth order solution, per unit time as
+        // in RKF45
+        double R = maxScaledComb(X.data(), 6, bErr, kp);
+
+        // Adjust step size scaling factor according to R (a NaN R, from a
+        // step that overflowed, rejects the step)
+        double s = (R != 0) ? pow(tol/(2.0*R), 0.25) : 1.0;
+        if (std::isnan(R)) {
+            s = 0.2;
+        }
+
+        if (R <= tol) {
+            for (int j = 0; j < 6; j++) {
+                coeffs[j] = dt*b4[j];
+            }
+            linComb(X.data(), X.data(), 6, coeffs, kp);
+            ti += dt;
+            i++;
+            stats.nAccept++;
+            if (ti < tf) {
+                evalRHS(ti, X.data(), k[0].data());
+            }
+        } else {
+            stats.nReject++;
+        }
+
+        // Adjust step size by scaling factor
+        dt *= s;
+        if (ti < tf && !(ti + dt > ti)) {
+            throw runtime_error("rkWorkspace::rkf45: step size underflow at "
+            "t = " + to_string(ti));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,530 @@
+#ifndef SDE_H
+#define SDE_H
+
+// Required for running paths over several threads
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <cstdint>
+#include <ODE.h>
+
+/**
+ * Philox4x32-10 counter-based random number generator (Salmon et al. 2011).
+ * Each block of four 32-bit outputs is a pure function of (seed, stream,
+ * counter), so every path gets its own stream and its draws are the same
+ * whichever thread, or in whatever order, the paths are run.
+ */
+class philoxRNG {
+    public:
+        // Constructor
+        philoxRNG(uint64_t, uint64_t stream=0);
+        // Random bits for a given counter
+        void block(uint64_t, uint32_t[4]) const;
+        // Next standard normal variate of the stream
+        double normal();
+        // Next uniform variate in (0, 1] of the stream
+        double uniform();
+        // Number of blocks drawn so far
+        uint64_t counter = 0;
+
+    private:
+        // Maps 53 of the bits of hi and lo to a uniform variate in (0, 1]
+        static double toUnit(uint32_t, uint32_t);
+        uint32_t key[2];
+        uint64_t stream;
+        // Second variate of the last Box-Muller pair
+        double spare;
+        bool hasSpare = false;
+};
+
+/**
+ * Constructor for philoxRNG.
+ *
+ * @param seed     Key of the generator, shared by every stream of a run.
+ * @param streamInput Index of the stream (e.g. the path number).
+ * @return         N/A.
+ */
+philoxRNG::philoxRNG(uint64_t seed, uint64_t streamInput) {
+    key[0] = uint32_t (seed);
+    key[1] = uint32_t (seed >> 32);
+    stream = streamInput;
+}
+
+/**
+ * Computes the block of random bits for counter ctr of the stream, which
+ * is ten rounds of the Philox bijection applied to (ctr, stream).
+ *
+ * @param ctr      Counter.
+ * @param out      Set to the four 32-bit outputs.
+ * @return         Nothing.
+ */
+void philoxRNG::block(uint64_t ctr, uint32_t out[4]) const {
+    uint32_t c[4] = {uint32_t (ctr), uint32_t (ctr >> 32), uint32_t (stream),
+    uint32_t (stream >> 32)};
+    uint32_t k[2] = {key[0], key[1]};
+    for (int round = 0; round < 10; round++) {
+        uint64_t p0 = uint64_t (0xD2511F53u)*c[0];
+        uint64_t p1 = uint64_t (0xCD9E8D57u)*c[2];
+        uint32_t next[4] = {uint32_t (p1 >> 32) ^ c[1] ^ k[0], uint32_t (p1),
+        uint32_t (p0 >> 32) ^ c[3] ^ k[1], uint32_t (p0)};
+        for (int j = 0; j < 4; j++) {
+            c[j] = next[j];
+        }
+        k[0] += 0x9E3779B9u;
+        k[1] += 0xBB67AE85u;
+    }
+    for (int j = 0; j < 4; j++) {
+        out[j] = c[j];
+    }
+}
+
+/**
+ * Maps the 32 bits of hi and the top 21 bits of lo to a uniform variate in
+ * (0, 1], which is never zero so its logarithm is finite.
+ *
+ * @param hi       Random bits.
+ * @param lo       Random bits.
+ * @return         Uniform variate.
+ */
+double philoxRNG::toUnit(uint32_t hi, uint32_t lo) {
+    uint64_t bits = (uint64_t (hi) << 21) | (lo >> 11);
+
+    return (bits + 1)/9007199254740992.0;
+}
+
+/**
+ * Returns the next uniform variate in (0, 1] of the stream. Each call uses
+ * a block of its own.
+ *
+ * @return         Uniform variate.
+ */
+double philoxRNG::uniform() {
+    uint32_t r[4];
+    block(counter++, r);
+
+    return toUnit(r[0], r[1]);
+}
+
+/**
+ * Returns the next standard normal variate of the stream. Each block gives
+ * two uniforms, which the Box-Muller transform turns into two normals.
+ *
+ * @return         Normal variate.
+ */
+double philoxRNG::normal() {
+    if (hasSpare) {
+        hasSpare = false;
+        return spare;
+    }
+    uint32_t r[4];
+    block(counter++, r);
+    double u1 = toUnit(r[0], r[1]);
+    double u2 = toUnit(r[2], r[3]);
+    double rad = sqrt(-2*log(u1));
+    spare = rad*sin(2*M_PI*u2);
+    hasSpare = true;
+
+    return rad*cos(2*M_PI*u2);
+}
+
+/**
+ * Applies the Euler-Maruyama method to solving the SDE with diagonal noise:
+ * dX_j = f_j(t, X, params) dt + g_j(t, X, params) dW_j
+ * where X(t[0]) = X0 and the W_j are independent Wiener processes, passing
+ * each point of the path to sink instead of storing it. Strong order 1/2,
+ * weak order 1.
+ *
+ * @param f        Drift, takes the arguments t, X and params.
+ * @param g        Diffusion, same arguments as f. Additive noise is a g
+ * that does not depend on X, multiplicative noise one that does.
+ * @param X0       X at t[0].
+ * @param t        Vector of time values, or a uniformGrid<T>.
+ * @param params   Vector of parameter values.
+ * @param rng      Random stream of the path.
+ * @param sink     Called as sink(t[i], X at t[i]) for every i in order,
+ * starting with (t[0], X0).
+ * @return         X at the last t value.
+ */
+template <typename T, typename Grid, typename Sink>
+vector<T> EulerMaruyamaStream(vector<T>(*f)(T, vector<T>, vector<T>),
+vector<T>(*g)(T, vector<T>, vector<T>), vector<T> X0, const Grid &t,
+vector<T> params, philoxRNG &rng, Sink &&sink) {
+    TRACE_ZONE("EulerMaruyama");
+    // Initializing variables
+    T dt, sqdt;
+    long N = t.size()-1;
+    int n = X0.size();
+    vector<T> X = X0, drift, diff;
+
+    // First entry should be X0
+    sink(t[0], X);
+
+    // Loop over time values
+    for (long i = 0; i < N; i++) {
+        dt = t[i+1]-t[i];
+        sqdt = sqrt(dt);
+        drift = callRHS(f, t[i], X, params);
+        diff = callRHS(g, t[i], X, params);
+        for (int j = 0; j < n; j++) {
+            X[j] += drift[j]*dt + diff[j]*sqdt*T(rng.normal());
+        }
+        sink(t[i+1], X);
+    }
+
+    return X;
+}
+
+/**
+ * Applies Milstein's method, in the derivative-free form of Platen, to
+ * solving the SDE with diagonal noise:
+ * dX_j = f_j(t, X, params) dt + g_j(t, X, params) dW_j
+ * where X(t[0]) = X0, passing each point of the path to sink instead of
+ * storing it. The correction term g_j dg_j/dX_j (dW_j^2 - dt)/2 is
+ * approximated with a second evaluation of g at a supporting value, which
+ * keeps strong order 1 without derivatives of g. With additive noise it is
+ * the same as Euler-Maruyama.
+ *
+ * @param f        Drift, takes the arguments t, X and params.
+ * @param g        Diffusion, same arguments as f. g_j may only depend on
+ * X_j for the method to be of strong order 1.
+ * @param X0       X at t[0].
+ * @param t        Vector of time values, or a uniformGrid<T>.
+ * @param params   Vector of parameter values.
+ * @param rng      Random stream of the path.
+ * @param sink     Called as sink(t[i], X at t[i]) for every i in order,
+ * starting with (t[0], X0).
+ * @return         X at the last t value.
+ */
+template <typename T, typename Grid, typename Sink>
+vector<T> MilsteinStream(vector<T>(*f)(T, vector<T>, vector<T>),
+vector<T>(*g)(T, vector<T>, vector<T>), vector<T> X0, const Grid &t,
+vector<T> params, philoxRNG &rng, Sink &&sink) {
+    TRACE_ZONE("Milstein");
+    // Initializing variables
+    T dt, sqdt, dW;
+    long N = t.size()-1;
+    int n = X0.size();
+    vector<T> X = X0, Xs(n), drift, diff, diffs;
+
+    // First entry should be X0
+    sink(t[0], X);
+
+    // Loop over time values
+    for (long i = 0; i < N; i++) {
+        dt = t[i+1]-t[i];
+        sqdt = sqrt(dt);
+        drift = callRHS(f, t[i], X, params);
+        diff = callRHS(g, t[i], X, params);
+        // Supporting value
+        for (int j = 0; j < n; j++) {
+            Xs[j] = X[j] + drift[j]*dt + diff[j]*sqdt;
+        }
+        diffs = callRHS(g, t[i], Xs, params);
+        for (int j = 0; j < n; j++) {
+            dW = sqdt*T(rng.normal());
+            X[j] += drift[j]*dt + diff[j]*dW +
+            (diffs[j] - diff[j])*(dW*dW - dt)/(2*sqdt);
+        }
+        sink(t[i+1], X);
+    }
+
+    return X;
+}
+
+/**
+ * Solves the SDE dX = f dt + g dW with the stochastic method named by
+ * method, passing each point to sink.
+ *
+ * @param f        Drift.
+ * @param g        Diffusion (diagonal noise).
+ * @param X0       X at t[0].
+ * @param t        Time values (a vector or a uniformGrid).
+ * @param params   Vector of parameter values.
+ * @param method   "EulerMaruyama" or "Milstein".
+ * @param rng      Random stream of the path.
+ * @param sink     Called as sink(t[i], X at t[i]) for every i.
+ * @return         X at the last t value.
+ */
+template <typename T, typename Grid, typename Sink>
+vector<T> sdeStream(vector<T>(*f)(T, vector<T>, vector<T>),
+vector<T>(*g)(T, vector<T>, vector<T>), vector<T> X0, const Grid &t,
+vector<T> params, string method, philoxRNG &rng, Sink &&sink) {
+    if (method == "EulerMaruyama") {
+        return EulerMaruyamaStream(f, g, X0, t, params, rng, sink);
+    } else if (method == "Milstein") {
+        return MilsteinStream(f, g, X0, t, params, rng, sink);
+    }
+    throw runtime_error("sdeStream: unknown method " + method);
+}
+
+/**
+ * Solves the SDE dX = f dt + g dW for a single path, which is path number
+ * path of the run with the given seed.
+ *
+ * @param f        Drift.
+ * @param g        Diffusion (diagonal noise).
+ * @param X0       X at t[0].
+ * @param t        Time values (a vector or a uniformGrid).
+ * @param params   Vector of parameter values.
+ * @param seed     Seed of the run.
+ * @param path     Path number, which selects the random stream.
+ * @param method   "EulerMaruyama" or "Milstein".
+ * @return         2d array of X values; rows correspond to different t values.
+ */
+template <typename T, typename Grid=vector<T>>
+vector<vector<T>> sdePath(vector<T>(*f)(T, vector<T>, vector<T>),
+vector<T>(*g)(T, vector<T>, vector<T>), vector<T> X0, const Grid &t,
+vector<T> params, uint64_t seed, uint64_t path=0,
+string method="EulerMaruyama") {
+    vector<vector<T>> X;
+    X.reserve(t.size());
+    philoxRNG rng(seed, path);
+    sdeStream(f, g, X0, t, params, method, rng, [&X](T ti,
+    const vector<T> &Xi) {
+        X.push_back(Xi);
+    });
+
+    return X;
+}
+
+/**
+ * Streaming mean and variance of each component of the state at each of a
+ * set of sample times, by Welford's algorithm. Accumulators over disjoint
+ * sets of paths are combined with the pairwise formula of Chan et al.
+ */
+class welfordStats {
+    public:
+        // Constructor
+        welfordStats(int nTimesInput=0, int dimInput=0);
+        // Adds the state of one path at sample time k
+        void add(int, const vector<double>&);
+        // Combines the statistics of another set of paths
+        void merge(const welfordStats&);
+        // Sample variance of each component at sample time k
+        vector<double> variance(int) const;
+        // Writes t, the mean and the variance of each component to CSV
+        void writeCSV(string, const vector<double>&,
+        const vector<string>&) const;
+        int nTimes;
+        int dim;
+        // Number of paths added at each sample time
+        vector<long> count;
+        // Running mean and sum of squared deviations, dim values per time
+        vector<double> mean;
+        vector<double> m2;
+};
+
+/**
+ * Constructor for welfordStats.
+ *
+ * @param nTimesInput Number of sample times.
+ * @param dimInput Number of components of the state.
+ * @return         N/A.
+ */
+welfordStats::welfordStats(int nTimesInput, int dimInput) {
+    nTimes = nTimesInput;
+    dim = dimInput;
+    count.assign(nTimes, 0);
+    mean.assign(size_t (nTimes)*dim, 0);
+    m2.assign(size_t (nTimes)*dim, 0);
+}
+
+/**
+ * Adds the state X of one path at sample time k.
+ *
+ * @param k        Index of the sample time.
+ * @param X        State.
+ * @return         Nothing.
+ */
+void welfordStats::add(int k, const vector<double> &X) {
+    double n = ++count[k];
+    double *mu = &mean[size_t (k)*dim];
+    double *s = &m2[size_t (k)*dim];
+    for (int j = 0; j < dim; j++) {
+        double delta = X[j] - mu[j];
+        mu[j] += delta/n;
+        s[j] += delta*(X[j] - mu[j]);
+    }
+}
+
+/**
+ * Combines the statistics of another set of paths with these.
+ *
+ * @param other    Statistics over the same sample times.
+ * @return         Nothing.
+ */
+void welfordStats::merge(const welfordStats &other) {
+    if (other.nTimes != nTimes || other.dim != dim) {
+        throw runtime_error("welfordStats: only statistics with the same "
+        "sample times and dimension can be merged");
+    }
+    for (int k = 0; k < nTimes; k++) {
+        double na = count[k], nb = other.count[k];
+        if (nb == 0) {
+            continue;
+        }
+        double n = na + nb;
+        for (size_t i = size_t (k)*dim; i < size_t (k+1)*dim; i++) {
+            double delta = other.mean[i] - mean[i];
+            mean[i] += delta*nb/n;
+            m2[i] += other.m2[i] + delta*delta*na*nb/n;
+        }
+        count[k] += other.count[k];
+    }
+}
+
+/**
+ * Returns the sample variance of each component at sample time k.
+ *
+ * @param k        Index of the sample time.
+ * @return         Variances (zero with fewer than two paths).
+ */
+vector<double> welfordStats::variance(int k) const {
+    vector<double> var(dim, 0);
+    if (count[k] > 1) {
+        for (int j = 0; j < dim; j++) {
+            var[j] = m2[size_t (k)*dim + j]/(count[k] - 1);
+        }
+    }
+
+    return var;
+}
+
+/**
+ * Writes one row per sample time to a CSV file: t, then the mean of each
+ * component, then the variance of each component.
+ *
+ * @param filename Name of the file.
+ * @param t        Sample times.
+ * @param headings Names of the components.
+ * @return         Nothing.
+ */
+void welfordStats::writeCSV(string filename, const vector<double> &t,
+const vector<string> &headings) const {
+    if (t.size() != nTimes || headings.size() != dim) {
+        throw runtime_error("welfordStats: there should be a time for each "
+        "sample and a heading for each component");
+    }
+    ofstream file(filename);
+    file << setprecision(15) << "t";
+    for (int j = 0; j < dim; j++) {
+        file << ",mean_" << headings[j];
+    }
+    for (int j = 0; j < dim; j++) {
+        file << ",var_" << headings[j];
+    }
+    file << "\n";
+    for (int k = 0; k < nTimes; k++) {
+        vector<double> var = variance(k);
+        file << t[k];
+        for (int j = 0; j < dim; j++) {
+            file << "," << mean[size_t (k)*dim + j];
+        }
+        for (int j = 0; j < dim; j++) {
+            file << "," << var[j];
+        }
+        file << "\n";
+    }
+}
+
+/**
+ * Runs nPaths realisations of the SDE dX = f dt + g dW over nThreads threads
+ * and returns the mean and variance of X at nSamples+1 evenly spaced times,
+ * without storing any path. Path p uses random stream p of the seed. The
+ * paths are split into a fixed number of chunks, each with its own
+ * accumulator, which are merged in order at the end, so the result is the
+ * same for any number of threads.
+ *
+ * @param f        Drift.
+ * @param g        Diffusion (diagonal noise).
+ * @param X0       Initial condition of every path.
+ * @param t0       Initial time.
+ * @param tf       Final time.
+ * @param N        Number of steps of each path.
+ * @param params   Vector of parameter values.
+ * @param nPaths   Number of paths.
+ * @param seed     Seed of the run.
+ * @param nSamples Number of intervals between sample times (N should be a
+ * multiple of it).
+ * @param method   "EulerMaruyama" or "Milstein".
+ * @param nThreads Number of threads to use (0 means one per core).
+ * @return         Statistics at t0 + k*(tf-t0)/nSamples, k = 0..nSamples.
+ * Errors of f or g are rethrown once every thread has finished.
+ */
+welfordStats sdeEnsemble(vector<double>(*f)(double, vector<double>,
+vector<double>), vector<double>(*g)(double, vector<double>, vector<double>),
+vector<double> X0, double t0, double tf, long N, vector<double> params,
+long nPaths, uint64_t seed, int nSamples=100, string method="EulerMaruyama",
+int nThreads=0) {
+    TRACE_ZONE("sdeEnsemble");
+    // Initialize variables
+    if (nSamples < 1 || N % nSamples != 0) {
+        throw runtime_error("sdeEnsemble: the number of steps should be a "
+        "multiple of the number of samples");
+    }
+    if (method != "EulerMaruyama" && method != "Milstein") {
+        throw runtime_error("sdeEnsemble: unknown method " + method);
+    }
+    if (nPaths < 0) {
+        throw runtime_error("sdeEnsemble: the number of paths should not be "
+        "negative");
+    }
+    long stride = N/nSamples;
+    int dim = X0.size();
+    uniformGrid<double> t(t0, tf, N);
+    const long nChunks = min(nPaths, 64L);
+    vector<welfordStats> chunks(nChunks, welfordStats(nSamples+1, dim));
+    atomic<long> next(0);
+    exception_ptr error;
+    mutex errorLock;
+    if (nThreads <= 0) {
+        nThreads = max(1u, thread::hardware_concurrency());
+    }
+    nThreads = int (min(long (nThreads), max(nChunks, 1L)));
+
+    // Each worker takes the next unclaimed chunk of paths until none remain
+    auto worker = [&]() {
+        for (long c = next++; c < nChunks; c = next++) {
+            welfordStats &stats = chunks[c];
+            try {
+                for (long p = c*nPaths/nChunks; p < (c+1)*nPaths/nChunks; 
+                p++) {
+                    philoxRNG rng(seed, p);
+                    long i = 0;
+                    sdeStream(f, g, X0, t, params, method, rng,
+                    [&](double ti, const vector<double> &Xi) {
+                        if (i % stride == 0) {
+                            stats.add(int (i/stride), Xi);
+                        }
+                        i++;
+                    });
+                }
+            } catch (...) {
+                lock_guard<mutex> guard(errorLock);
+                error = current_exception();
+            }
+        }
+    };
+    vector<thread> threads;
+    for (int i = 0; i < nThreads; i++) {
+        threads.push_back(thread(worker));
+    }
+    for (int i = 0; i < nThreads; i++) {
+        threads[i].join();
+    }
+
+    if (error) {
+        rethrow_exception(error);
+    }
+
+    // Merge the chunks in order
+    welfordStats stats(nSamples+1, dim);
+    for (long c = 0; c < nChunks; c++) {
+        stats.merge(chunks[c]);
+    }
+
+    return stats;
+}
+
+#endif
@@ -0,0 +1,305 @@
+#ifndef SIMDOPS_H
+#define SIMDOPS_H
+
+// Intrinsics are only used when the compiler targets AVX2 or AVX-512
+// (e.g. with -march=native), otherwise the scalar loops below are used.
+// AVX2 without FMA (-mavx2 alone) multiplies and adds separately.
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+// Required for posix_memalign
+#include <stdlib.h>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+using namespace std;
+
+// Alignment of alignedVec storage in bytes (one cache line, one AVX-512
+// register)
+const size_t simdAlignment = 64;
+// Number of doubles per simdAlignment bytes; kernels called on part of a
+// vector must start at a multiple of this
+const size_t simdWidth = simdAlignment/sizeof(double);
+
+/**
+ * Allocator returning simdAlignment-byte aligned storage, so that the
+ * kernels below can use aligned loads and stores.
+ */
+template <typename T>
+class alignedAllocator {
+    public:
+        typedef T value_type;
+
+        alignedAllocator() {}
+        template <typename U>
+        alignedAllocator(const alignedAllocator<U>&) {}
+
+        T* allocate(size_t n) {
+            void *p = nullptr;
+            if (posix_memalign(&p, simdAlignment, n*sizeof(T)) != 0) {
+                throw bad_alloc();
+            }
+            return (T*) p;
+        }
+        void deallocate(T *p, size_t) {
+            free(p);
+        }
+};
+
+template <typename T, typename U>
+bool operator==(const alignedAllocator<T>&, const alignedAllocator<U>&) {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const alignedAllocator<T>&, const alignedAllocator<U>&) {
+    return false;
+}
+
+// Vector of doubles the SIMD kernels operate on
+typedef vector<double, alignedAllocator<double>> alignedVec;
+
+/**
+ * Returns the instruction set the kernels were compiled for.
+ *
+ * @return         "AVX-512", "AVX2" or "scalar".
+ */
+inline const char* simdLevel() {
+#if defined(__AVX512F__)
+    return "AVX-512";
+#elif defined(__AVX2__)
+    return "AVX2";
+#else
+    return "scalar";
+#endif
+}
+
+#if defined(__AVX2__) && !defined(__AVX512F__)
+/**
+ * Computes a*b + c, fused if the compiler targets FMA.
+ *
+ * @param a        First factor.
+ * @param b        Second factor.
+ * @param c        Term added.
+ * @return         a*b + c.
+ */
+inline __m256d simdFmadd(__m256d a, __m256d b, __m256d c) {
+#if defined(__FMA__)
+    return _mm256_fmadd_pd(a, b, c);
+#else
+    return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+#endif
+}
+#endif
+
+/**
+ * Returns the larger of a and b, or NaN if either is NaN (std::max drops a
+ * NaN in its second argument), so that a NaN error estimate is never
+ * mistaken for a small one.
+ *
+ * @param a        First value.
+ * @param b        Second value.
+ * @return         max(a, b), propagating NaN.
+ */
+inline double simdMax(double a, double b) {
+    return (b > a || std::isnan(b)) ? b : a;
+}
+
+/**
+ * Checks that p is simdAlignment-byte aligned.
+ *
+ * @param p        Pointer to be checked.
+ * @return         Whether p is aligned.
+ */
+inline bool simdAligned(const double *p) {
+    return ((uintptr_t) p) % simdAlignment == 0;
+}
+
+/**
+ * Computes y += a*x.
+ *
+ * @param n        Length of x and y.
+ * @param a        Scalar.
+ * @param x        Aligned input array.
+ * @param y        Aligned array, overwritten with y + a*x.
+ * @return         Nothing.
+ */
+inline void simdAxpy(size_t n, double a, const double *x, double *y) {
+    assert(simdAligned(x) && simdAligned(y));
+    size_t i = 0;
+#if defined(__AVX512F__)
+    __m512d va = _mm512_set1_pd(a);
+    for (; i + 8 <= n; i += 8) {
+        __m512d vy = _mm512_load_pd(y + i);
+        _mm512_store_pd(y + i, _mm512_fmadd_pd(va, _mm512_load_pd(x + i), vy));
+    }
+#elif defined(__AVX2__)
+    __m256d va = _mm256_set1_pd(a);
+    for (; i + 4 <= n; i += 4) {
+        __m256d vy = _mm256_load_pd(y + i);
+        _mm256_store_pd(y + i, simdFmadd(va, _mm256_load_pd(x + i), vy));
+    }
+#endif
+    for (; i < n; i++) {
+        y[i] += a*x[i];
+    }
+}
+
+/**
+ * Computes y = x + sum_j coeffs[j]*k[j] in a single pass, as needed for the
+ * stage values and updates of a Runge-Kutta method. Terms with a zero
+ * coefficient are skipped, so they cost no memory traffic.
+ *
+ * @param n        Length of the arrays.
+ * @param y        Aligned output array (may be x).
+ * @param x        Aligned input array.
+ * @param m        Number of terms.
+ * @param coeffs   Coefficients of the terms.
+ * @param k        Aligned arrays of the terms.
+ * @return         Nothing.
+ */
+inline void simdLinComb(size_t n, double *y, const double *x, int m,
+const double *coeffs, const double *const *k) {
+    // Drop the terms with zero coefficients
+    double c[16];
+    const double *kk[16];
+    int mm = 0;
+    assert(m <= 16);
+    for (int j = 0; j < m; j++) {
+        if (coeffs[j] != 0) {
+            assert(simdAligned(k[j]));
+            c[mm] = coeffs[j];
+            kk[mm++] = k[j];
+        }
+    }
+    assert(simdAligned(x) && simdAligned(y));
+
+    size_t i = 0;
+#if defined(__AVX512F__)
+    __m512d vc[16];
+    for (int j = 0; j < mm; j++) {
+        vc[j] = _mm512_set1_pd(c[j]);
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m512d acc = _mm512_load_pd(x + i);
+        for (int j = 0; j < mm; j++) {
+            acc = _mm512_fmadd_pd(vc[j], _mm512_load_pd(kk[j] + i), acc);
+        }
+        _mm512_store_pd(y + i, acc);
+    }
+#elif defined(__AVX2__)
+    __m256d vc[16];
+    for (int j = 0; j < mm; j++) {
+        vc[j] = _mm256_set1_pd(c[j]);
+    }
+    for (; i + 4 <= n; i += 4) {
+        __m256d acc = _mm256_load_pd(x + i);
+        for (int j = 0; j < mm; j++) {
+            acc = simdFmadd(vc[j], _mm256_load_pd(kk[j] + i), acc);
+        }
+        _mm256_store_pd(y + i, acc);
+    }
+#endif
+    for (; i < n; i++) {
+        double acc = x[i];
+        for (int j = 0; j < mm; j++) {
+            acc += c[j]*kk[j][i];
+        }
+        y[i] = acc;
+    }
+}
+
+/**
+ * Computes max_i |sum_j coeffs[j]*k[j][i]|/(1 + |x[i]|) in a single pass,
+ * i.e. the max-norm of an embedded error estimate relative to the size of
+ * the solution, without storing the error estimate. The result is NaN if any
+ * term is, so that a step with a NaN error estimate is rejected.
+ *
+ * @param n        Length of the arrays.
+ * @param x        Aligned array the error is scaled by.
+ * @param m        Number of terms.
+ * @param coeffs   Coefficients of the terms.
+ * @param k        Aligned arrays of the terms.
+ * @return         Scaled max-norm of the combination.
+ */
+inline double simdMaxScaledComb(size_t n, const double *x, int m,
+const double *coeffs, const double *const *k) {
+    double c[16];
+    const double *kk[16];
+    int mm = 0;
+    assert(m <= 16);
+    for (int j = 0; j < m; j++) {
+        if (coeffs[j] != 0) {
+            assert(simdAligned(k[j]));
+            c[mm] = coeffs[j];
+            kk[mm++] = k[j];
+        }
+    }
+    assert(simdAligned(x));
+
+    double R = 0;
+    size_t i = 0;
+#if defined(__AVX512F__)
+    __m512d vc[16];
+    for (int j = 0; j < mm; j++) {
+        vc[j] = _mm512_set1_pd(c[j]);
+    }
+    __m512d one = _mm512_set1_pd(1.0);
+    __m512d vR = _mm512_setzero_pd();
+    // max_pd drops NaNs, so they are tracked separately
+    __mmask8 nan = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d e = _mm512_setzero_pd();
+        for (int j = 0; j < mm; j++) {
+            e = _mm512_fmadd_pd(vc[j], _mm512_load_pd(kk[j] + i), e);
+        }
+        __m512d scale = _mm512_add_pd(one,
+        _mm512_abs_pd(_mm512_load_pd(x + i)));
+        __m512d q = _mm512_div_pd(_mm512_abs_pd(e), scale);
+        nan |= _mm512_cmp_pd_mask(q, q, _CMP_UNORD_Q);
+        vR = _mm512_max_pd(vR, q);
+    }
+    R = nan ? NAN : _mm512_reduce_max_pd(vR);
+#elif defined(__AVX2__)
+    __m256d vc[16];
+    for (int j = 0; j < mm; j++) {
+        vc[j] = _mm256_set1_pd(c[j]);
+    }
+    __m256d one = _mm256_set1_pd(1.0);
+    __m256d signMask = _mm256_set1_pd(-0.0);
+    __m256d vR = _mm256_setzero_pd();
+    // max_pd drops NaNs, so they are tracked separately
+    __m256d nan = _mm256_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        __m256d e = _mm256_setzero_pd();
+        for (int j = 0; j < mm; j++) {
+            e = simdFmadd(vc[j], _mm256_load_pd(kk[j] + i), e);
+        }
+        __m256d scale = _mm256_add_pd(one,
+        _mm256_andnot_pd(signMask, _mm256_load_pd(x + i)));
+        __m256d q = _mm256_div_pd(_mm256_andnot_pd(signMask, e), scale);
+        nan = _mm256_or_pd(nan, _mm256_cmp_pd(q, q, _CMP_UNORD_Q));
+        vR = _mm256_max_pd(vR, q);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, vR);
+    R = max(max(lanes[0], lanes[1]), max(lanes[2], lanes[3]));
+    if (_mm256_movemask_pd(nan) != 0) {
+        R = NAN;
+    }
+#endif
+    for (; i < n; i++) {
+        double e = 0;
+        for (int j = 0; j < mm; j++) {
+            e += c[j]*kk[j][i];
+        }
+        R = simdMax(R, abs(e)/(1 + abs(x[i])));
+    }
+
+    return R;
+}
+
+#endif
@@ -0,0 +1,362 @@
+#ifndef SOLCACHE_H
+#define SOLCACHE_H
+
+// POSIX calls used for the cache directory and memory mapping
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <trace.h>
+
+using namespace std;
+
+/**
+ * Incrementally hashes size bytes at data with 64-bit FNV-1a.
+ *
+ * @param data     Pointer to the bytes to be hashed.
+ * @param size     Number of bytes.
+ * @param h        Hash of everything hashed so far.
+ * @return         Updated hash.
+ */
+uint64_t fnv1a(const void *data, size_t size,
+uint64_t h=14695981039346656037ULL) {
+    const unsigned char *bytes = (const unsigned char*) data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+/**
+ * Returns a hash of the executable of the running program, computed once.
+ * Builds of the same sources are identical, so the hash only changes when
+ * the program (and so possibly a right-hand side) does. If the executable
+ * cannot be read, the tag is unique to this process, so nothing cached by
+ * it is ever served to another run.
+ *
+ * @return         Tag as a string of 16 hexadecimal digits.
+ */
+string programVersion() {
+    static const string version = [] {
+        uint64_t h = fnv1a(nullptr, 0);
+        ifstream exe("/proc/self/exe", ios::binary);
+        if (!exe) {
+            long salt[2] = {long (getpid()), long (time(nullptr))};
+            h = fnv1a(salt, sizeof(salt), h);
+        }
+        vector<char> block(1 << 16);
+        while (exe) {
+            exe.read(block.data(), block.size());
+            h = fnv1a(block.data(), exe.gcount(), h);
+        }
+        char tag[17];
+        snprintf(tag, sizeof(tag), "%016llx", (unsigned long long) h);
+        return string(tag);
+    }();
+
+    return version;
+}
+
+// Tag identifying the right-hand sides a program was built with, hashed into
+// every cache key. It defaults to a hash of the executable, so that editing
+// a right-hand side and rebuilding can never be served a stale solution,
+// while rebuilding unchanged sources keeps the cache. Define it before
+// including ODE.h (e.g. with -DODE_SYSTEM_VERSION='"lorenz-2"') to keep
+// cached solutions across other changes to the program; it must then be
+// changed whenever a right-hand side is, or the cache cleared.
+#ifndef ODE_SYSTEM_VERSION
+#define ODE_SYSTEM_VERSION programVersion()
+#endif
+
+/**
+ * Memory-mapped cache entry, whose rows are read straight out of the mapping
+ * rather than copied. The mapping stays valid if the entry is replaced or
+ * evicted in the meantime, as the file is only unlinked.
+ */
+class solCacheEntry {
+    public:
+        // Constructor, makes an empty entry
+        solCacheEntry() {}
+        // Destructor, unmaps the entry
+        ~solCacheEntry();
+        solCacheEntry(const solCacheEntry&) = delete;
+        solCacheEntry& operator=(const solCacheEntry&) = delete;
+        // Number of rows and of X components
+        size_t size() const {return nRows;}
+        size_t nCols() const {return cols;}
+        // t value and X values of row i
+        double tAt(size_t i) const {return t[i];}
+        const double *XAt(size_t i) const {return X + i*cols;}
+        // Unmaps the entry, leaving it empty
+        void release();
+
+    private:
+        friend class solCache;
+        void *mapped = nullptr;
+        size_t bytes = 0;
+        size_t nRows = 0;
+        size_t cols = 0;
+        const double *t = nullptr;
+        const double *X = nullptr;
+};
+
+/**
+ * Destructor for solCacheEntry.
+ *
+ * @return         N/A.
+ */
+solCacheEntry::~solCacheEntry() {
+    release();
+}
+
+/**
+ * Unmaps the entry, leaving it empty.
+ *
+ * @return         Nothing.
+ */
+void solCacheEntry::release() {
+    if (mapped != nullptr) {
+        munmap(mapped, bytes);
+    }
+    mapped = nullptr;
+    bytes = nRows = cols = 0;
+    t = X = nullptr;
+}
+
+/**
+ * On-disk cache of solutions, keyed by a hash of everything that determines
+ * the solution. Each entry is one binary file in dir; hits are served from a
+ * memory mapping of the file. Entries are evicted least recently used first
+ * (using file modification times, which are refreshed on every hit) once
+ * the cache exceeds maxBytes.
+ */
+class solCache {
+    public:
+        // Constructor
+        solCache(string dirInput=".odecache",
+        uint64_t maxBytesInput=uint64_t(1) << 30);
+        // Look up key, mapping the entry on a hit
+        bool load(string, solCacheEntry&);
+        // Store a solution under key (t a vector or a uniformGrid)
+        template <typename Grid>
+        void store(string, const Grid&, const vector<vector<double>>&);
+        // Remove a single entry
+        void invalidate(string);
+        // Remove every entry
+        void clear();
+
+    private:
+        string dir;
+        uint64_t maxBytes;
+        // File an entry is stored in
+        string path(string);
+        // Evict least recently used entries until the cache fits in maxBytes
+        void evict();
+};
+
+/**
+ * Constructor for solCache, creates the cache directory if need be.
+ *
+ * @param dirInput      Directory cache entries are stored in.
+ * @param maxBytesInput Maximum total size of cache entries in bytes.
+ * @return              N/A.
+ */
+solCache::solCache(string dirInput, uint64_t maxBytesInput) {
+    dir = dirInput;
+    maxBytes = maxBytesInput;
+    mkdir(dir.c_str(), 0755);
+}
+
+/**
+ * Returns the name of the file the entry with key is stored in.
+ *
+ * @param key      Cache key.
+ * @return         File name.
+ */
+string solCache::path(string key) {
+    return dir + "/" + key + ".sol";
+}
+
+/**
+ * Looks up key and, on a hit, maps the entry into entry, so that its rows
+ * are read without being copied. Needs no lock against other threads or
+ * processes using the same directory.
+ *
+ * @param key      Cache key.
+ * @param entry    Set to the stored solution on a hit.
+ * @return         Whether key was found.
+ */
+bool solCache::load(string key, solCacheEntry &entry) {
+    TRACE_ZONE("cache load");
+    entry.release();
+    string filename = path(key);
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    fstat(fd, &info);
+    size_t size = info.st_size;
+    size_t headerSize = 8 + 2*sizeof(int64_t);
+    if (size < headerSize) {
+        close(fd);
+        return false;
+    }
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+
+    // Header is the magic number followed by the numbers of rows and columns
+    const char *bytes = (const char*) mapped;
+    int64_t nRows, nCols;
+    memcpy(&nRows, bytes + 8, sizeof(nRows));
+    memcpy(&nCols, bytes + 8 + sizeof(nRows), sizeof(nCols));
+    bool valid = (memcmp(bytes, "SOLCACH1", 8) == 0) && nRows >= 0 &&
+    nCols >= 0 && (size == headerSize + nRows*(nCols+1)*sizeof(double));
+    if (!valid) {
+        munmap(mapped, size);
+        return false;
+    }
+    entry.mapped = mapped;
+    entry.bytes = size;
+    entry.nRows = nRows;
+    entry.cols = nCols;
+    entry.t = (const double*) (bytes + headerSize);
+    entry.X = entry.t + nRows;
+
+    // Mark the entry as recently used
+    utime(filename.c_str(), nullptr);
+
+    return true;
+}
+
+/**
+ * Stores a solution under key and evicts old entries if the cache is full.
+ *
+ * @param key      Cache key.
+ * @param t        t values of the solution (a vector or a uniformGrid).
+ * @param X        X values of the solution.
+ * @return         Nothing.
+ */
+template <typename Grid>
+void solCache::store(string key, const Grid &t,
+const vector<vector<double>> &X) {
+    TRACE_ZONE("cache store");
+    int64_t nRows = t.size();
+    int64_t nCols = X.empty() ? 0 : X[0].size();
+    string filename = path(key);
+    // Unique to the process and thread, as others may store the same key
+    string tmpName = filename + ".tmp." + to_string(getpid()) + "." +
+    to_string(hash<thread::id>()(this_thread::get_id()));
+
+    // Write to a temporary file and rename so readers never see half an entry
+    ofstream file(tmpName, ios::binary);
+    file.write("SOLCACH1", 8);
+    file.write((char*) &nRows, sizeof(nRows));
+    file.write((char*) &nCols, sizeof(nCols));
+    // t goes through a small buffer, so a uniformGrid is never expanded
+    vector<double> block;
+    for (int64_t i = 0; i < nRows; i += 4096) {
+        block.clear();
+        for (int64_t j = i; j < min(nRows, i+4096); j++) {
+            block.push_back(t[j]);
+        }
+        file.write((char*) block.data(), block.size()*sizeof(double));
+    }
+    for (int64_t i = 0; i < nRows; i++) {
+        file.write((char*) X[i].data(), nCols*sizeof(double));
+    }
+    file.close();
+    if (!file || rename(tmpName.c_str(), filename.c_str()) != 0) {
+        unlink(tmpName.c_str());
+        return;
+    }
+
+    evict();
+}
+
+/**
+ * Removes the entry with the specified key, if there is one.
+ *
+ * @param key      Cache key.
+ * @return         Nothing.
+ */
+void solCache::invalidate(string key) {
+    unlink(path(key).c_str());
+}
+
+/**
+ * Removes every entry from the cache, along with any temporary files.
+ *
+ * @return         Nothing.
+ */
+void solCache::clear() {
+    DIR *d = opendir(dir.c_str());
+    if (d == nullptr) {
+        return;
+    }
+    vector<string> names;
+    for (dirent *entry = readdir(d); entry != nullptr; entry = readdir(d)) {
+        string name = entry->d_name;
+        // Temporary files left by interrupted stores go too
+        if ((name.size() > 4 && name.substr(name.size()-4) == ".sol") ||
+        name.find(".sol.tmp.") != string::npos) {
+            names.push_back(name);
+        }
+    }
+    closedir(d);
+    for (int i = 0; i < names.size(); i++) {
+        unlink((dir + "/" + names[i]).c_str());
+    }
+}
+
+/**
+ * Deletes entries, least recently used first, until the total size of the
+ * cache is at most maxBytes.
+ *
+ * @return         Nothing.
+ */
+void solCache::evict() {
+    DIR *d = opendir(dir.c_str());
+    if (d == nullptr) {
+        return;
+    }
+
+    // Collect (last use, size, name) of every entry
+    vector<pair<pair<time_t, uint64_t>, string>> entries;
+    uint64_t total = 0;
+    for (dirent *entry = readdir(d); entry != nullptr; entry = readdir(d)) {
+        string name = entry->d_name;
+        struct stat info;
+        if (name.size() > 4 && name.substr(name.size()-4) == ".sol" &&
+        stat((dir + "/" + name).c_str(), &info) == 0) {
+            entries.push_back({{info.st_mtime, (uint64_t) info.st_size}, name});
+            total += info.st_size;
+        }
+    }
+    closedir(d);
+
+    sort(entries.begin(), entries.end());
+    for (int i = 0; i < entries.size() && total > maxBytes; i++) {
+        unlink((dir + "/" + entries[i].second).c_str());
+        total -= entries[i].first.second;
+    }
+}
+
+#endif
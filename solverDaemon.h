@@ -0,0 +1,822 @@
+#ifndef SOLVERDAEMON_H
+#define SOLVERDAEMON_H
+
+// POSIX calls used for the Unix domain socket
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <ODE.h>
+
+/**
+ * Buffer a message of the daemon's protocol is built up in or read out of.
+ * Every field is a native-endian int64, double, length-prefixed string or
+ * length-prefixed vector of doubles, which is enough as both ends run on
+ * the same machine.
+ */
+class wireBuffer {
+    public:
+        // Append a field
+        void putInt(int64_t);
+        void putDouble(double);
+        void putString(const string&);
+        void putVec(const vector<double>&);
+        // Read the next field
+        int64_t getInt();
+        double getDouble();
+        string getString();
+        vector<double> getVec();
+        vector<char> bytes;
+        // Position of the next field to be read
+        size_t pos = 0;
+
+    private:
+        // Copies the next size bytes to dest, checking they are there
+        void get(void*, size_t);
+};
+
+/**
+ * Appends an int64 to the buffer.
+ *
+ * @param x        Value.
+ * @return         Nothing.
+ */
+void wireBuffer::putInt(int64_t x) {
+    const char *p = (const char*) &x;
+    bytes.insert(bytes.end(), p, p + sizeof(x));
+}
+
+/**
+ * Appends a double to the buffer.
+ *
+ * @param x        Value.
+ * @return         Nothing.
+ */
+void wireBuffer::putDouble(double x) {
+    const char *p = (const char*) &x;
+    bytes.insert(bytes.end(), p, p + sizeof(x));
+}
+
+/**
+ * Appends a string (its length, then its characters) to the buffer.
+ *
+ * @param s        String.
+ * @return         Nothing.
+ */
+void wireBuffer::putString(const string &s) {
+    putInt(s.size());
+    bytes.insert(bytes.end(), s.begin(), s.end());
+}
+
+/**
+ * Appends a vector of doubles (its length, then its elements) to the
+ * buffer.
+ *
+ * @param v        Vector.
+ * @return         Nothing.
+ */
+void wireBuffer::putVec(const vector<double> &v) {
+    putInt(v.size());
+    const char *p = (const char*) v.data();
+    bytes.insert(bytes.end(), p, p + v.size()*sizeof(double));
+}
+
+/**
+ * Copies the next size bytes of the buffer to dest.
+ *
+ * @param dest     Destination.
+ * @param size     Number of bytes.
+ * @return         Nothing.
+ */
+void wireBuffer::get(void *dest, size_t size) {
+    if (size > bytes.size() - pos) {
+        throw runtime_error("wireBuffer: message is too short");
+    }
+    memcpy(dest, bytes.data() + pos, size);
+    pos += size;
+}
+
+/**
+ * Reads the next int64 of the buffer.
+ *
+ * @return         Value.
+ */
+int64_t wireBuffer::getInt() {
+    int64_t x;
+    get(&x, sizeof(x));
+
+    return x;
+}
+
+/**
+ * Reads the next double of the buffer.
+ *
+ * @return         Value.
+ */
+double wireBuffer::getDouble() {
+    double x;
+    get(&x, sizeof(x));
+
+    return x;
+}
+
+/**
+ * Reads the next string of the buffer.
+ *
+ * @return         String.
+ */
+string wireBuffer::getString() {
+    int64_t n = getInt();
+    if (n < 0 || n > int64_t (bytes.size() - pos)) {
+        throw runtime_error("wireBuffer: bad string length");
+    }
+    string s(bytes.data() + pos, n);
+    pos += n;
+
+    return s;
+}
+
+/**
+ * Reads the next vector of doubles of the buffer.
+ *
+ * @return         Vector.
+ */
+vector<double> wireBuffer::getVec() {
+    int64_t n = getInt();
+    if (n < 0 || n > int64_t ((bytes.size() - pos)/sizeof(double))) {
+        throw runtime_error("wireBuffer: bad vector length");
+    }
+    vector<double> v(n);
+    get(v.data(), n*sizeof(double));
+
+    return v;
+}
+
+// Message types of the protocol. A client sends REQUEST messages; the
+// daemon answers each with HEADER, any number of ROWS and DONE, or with
+// ERROR (which can also come after some ROWS).
+const int64_t daemonRequest = 1;
+const int64_t daemonHeader = 2;
+const int64_t daemonRows = 3;
+const int64_t daemonDone = 4;
+const int64_t daemonError = 5;
+// Largest message either end accepts, in bytes
+const int64_t daemonMaxMessage = int64_t (1) << 28;
+
+/**
+ * Writes size bytes to a socket, retrying short writes. Uses MSG_NOSIGNAL so
+ * a peer that has gone away gives an error rather than SIGPIPE.
+ *
+ * @param fd       Socket.
+ * @param data     Bytes to be written.
+ * @param size     Number of bytes.
+ * @return         Whether every byte was written.
+ */
+bool sendAll(int fd, const void *data, size_t size) {
+    const char *p = (const char*) data;
+    while (size > 0) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+/**
+ * Reads exactly size bytes from a socket.
+ *
+ * @param fd       Socket.
+ * @param data     Destination.
+ * @param size     Number of bytes.
+ * @return         Whether every byte was read (false at end of stream).
+ */
+bool recvAll(int fd, void *data, size_t size) {
+    char *p = (char*) data;
+    while (size > 0) {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+/**
+ * Sends a message: its type, its length and its payload.
+ *
+ * @param fd       Socket.
+ * @param type     Message type.
+ * @param msg      Payload.
+ * @return         Whether the message was sent.
+ */
+bool sendMessage(int fd, int64_t type, const wireBuffer &msg) {
+    int64_t header[2] = {type, int64_t (msg.bytes.size())};
+
+    return sendAll(fd, header, sizeof(header)) &&
+    sendAll(fd, msg.bytes.data(), msg.bytes.size());
+}
+
+/**
+ * Receives a message.
+ *
+ * @param fd       Socket.
+ * @param type     Set to the message type.
+ * @param msg      Set to the payload, ready to be read.
+ * @return         Whether a whole message was received.
+ */
+bool recvMessage(int fd, int64_t &type, wireBuffer &msg) {
+    int64_t header[2];
+    if (!recvAll(fd, header, sizeof(header)) || header[1] < 0 ||
+    header[1] > daemonMaxMessage) {
+        return false;
+    }
+    type = header[0];
+    msg.bytes.resize(header[1]);
+    msg.pos = 0;
+
+    return recvAll(fd, msg.bytes.data(), header[1]);
+}
+
+/**
+ * A solve to be run by the daemon. The fixed step methods ("Euler",
+ * "ModEuler", "RK4", "ABM") are used when N > 0 and the adaptive ones
+ * ("RKF45", "BulirschStoer", "ABM", "auto") when N = 0.
+ */
+class solveRequest {
+    public:
+        // Name the system was registered under
+        string system;
+        string method = "RK4";
+        double t0 = 0;
+        double tf = 1;
+        // Number of steps of the fixed step methods
+        long N = 1000;
+        // Error tolerance of the adaptive methods
+        double tol = 1e-9;
+        // First step tried by the adaptive methods (0 means (tf - t0)/100)
+        // and the largest number of steps they may take
+        double dtInit = 0;
+        long itMax = 1000000;
+        vector<double> X0;
+        vector<double> params;
+        // Whether the solution may come from, and goes into, the cache
+        bool useCache = true;
+        // Write to, or read from, a message payload
+        void encode(wireBuffer&) const;
+        void decode(wireBuffer&);
+};
+
+/**
+ * Writes the request to a message payload.
+ *
+ * @param msg      Payload.
+ * @return         Nothing.
+ */
+void solveRequest::encode(wireBuffer &msg) const {
+    msg.putString(system);
+    msg.putString(method);
+    msg.putDouble(t0);
+    msg.putDouble(tf);
+    msg.putInt(N);
+    msg.putDouble(tol);
+    msg.putDouble(dtInit);
+    msg.putInt(itMax);
+    msg.putVec(X0);
+    msg.putVec(params);
+    msg.putInt(useCache);
+}
+
+/**
+ * Reads the request from a message payload.
+ *
+ * @param msg      Payload.
+ * @return         Nothing.
+ */
+void solveRequest::decode(wireBuffer &msg) {
+    system = msg.getString();
+    method = msg.getString();
+    t0 = msg.getDouble();
+    tf = msg.getDouble();
+    N = msg.getInt();
+    tol = msg.getDouble();
+    dtInit = msg.getDouble();
+    itMax = msg.getInt();
+    X0 = msg.getVec();
+    params = msg.getVec();
+    useCache = msg.getInt() != 0;
+}
+
+/**
+ * Long-lived solver process serving solve requests over a Unix domain
+ * socket. Systems are registered by name before the daemon is started.
+ * A fixed set of worker threads is started once and each serves one
+ * connection at a time, for as many requests as the client sends, so a
+ * solve costs no process start, compilation or thread creation. Solutions
+ * are streamed back in batches of rows as they are computed, and are looked
+ * up in, and added to, an on-disk solCache.
+ */
+class solverDaemon {
+    public:
+        // Constructor
+        solverDaemon(string, int nWorkersInput=0,
+        string cacheDir=".odecache");
+        // Destructor, stops the daemon
+        ~solverDaemon();
+        // Makes a system available to clients
+        void registerSystem(string, vector<double>(*f)(double,
+        vector<double>, vector<double>), int, int,
+        string version=ODE_SYSTEM_VERSION);
+        // Binds the socket and starts the workers
+        void start();
+        // Stops accepting connections, closes open ones and joins workers
+        void stop();
+        // Numbers of requests served and answered from the cache
+        atomic<long> served;
+        atomic<long> cacheHits;
+
+        solverDaemon(const solverDaemon&) = delete;
+        solverDaemon& operator=(const solverDaemon&) = delete;
+
+    private:
+        // Right-hand side of a registered system and the sizes of X and
+        // params it expects
+        class registeredSystem {
+            public:
+                vector<double>(*f)(double, vector<double>, vector<double>);
+                int dim;
+                int nParams;
+                // Version tag hashed into cache keys
+                string version;
+        };
+        map<string, registeredSystem> systems;
+        string socketPath;
+        int nWorkers;
+        int listenFd = -1;
+        vector<thread> workers;
+        solCache cache;
+        mutex cacheLock;
+        // Connections being served, so stop can close them
+        set<int> clients;
+        mutex clientsLock;
+        atomic<bool> stopping;
+        // Thrown by the row sink to end a solve once the client has gone or
+        // the daemon is stopping
+        class solveAborted {};
+        // Body of each worker thread
+        void workerLoop();
+        // Serves the requests of one connection until it is closed
+        void serveClient(int);
+        // Runs one request, streaming the solution to the client
+        bool solve(int, solveRequest&, vector<double>&);
+};
+
+/**
+ * Constructor for solverDaemon.
+ *
+ * @param socketPathInput Path of the Unix domain socket.
+ * @param nWorkersInput   Number of worker threads, i.e. of clients served
+ * at once (0 means one per core).
+ * @param cacheDir        Directory of the solution cache.
+ * @return                N/A.
+ */
+solverDaemon::solverDaemon(string socketPathInput, int nWorkersInput,
+string cacheDir) : served(0), cacheHits(0), cache(cacheDir), stopping(false) {
+    socketPath = socketPathInput;
+    nWorkers = nWorkersInput;
+    if (nWorkers <= 0) {
+        nWorkers = max(1u, thread::hardware_concurrency());
+    }
+}
+
+/**
+ * Destructor for solverDaemon.
+ *
+ * @return         N/A.
+ */
+solverDaemon::~solverDaemon() {
+    stop();
+}
+
+/**
+ * Registers a system under name, so clients can solve it. Must be called
+ * before start.
+ *
+ * @param name     Name clients refer to the system by.
+ * @param f        Function that returns dX/dt from the arguments t, X and
+ * params.
+ * @param dim      Number of components of X.
+ * @param nParams  Number of parameters f expects.
+ * @param version  Version tag of f for the cache keys (see solveKey); change
+ * it whenever f is edited.
+ * @return         Nothing.
+ */
+void solverDaemon::registerSystem(string name, vector<double>(*f)(double,
+vector<double>, vector<double>), int dim, int nParams, string version) {
+    if (listenFd >= 0) {
+        throw runtime_error("solverDaemon: systems must be registered before "
+        "the daemon is started");
+    }
+    registeredSystem sys;
+    sys.f = f;
+    sys.dim = dim;
+    sys.nParams = nParams;
+    sys.version = version;
+    systems[name] = sys;
+}
+
+/**
+ * Creates and binds the socket (replacing a stale one at the same path) and
+ * starts the worker threads.
+ *
+ * @return         Nothing.
+ */
+void solverDaemon::start() {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        throw runtime_error("solverDaemon: socket path is too long");
+    }
+    strcpy(addr.sun_path, socketPath.c_str());
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        throw runtime_error("solverDaemon: could not create a socket");
+    }
+    unlink(socketPath.c_str());
+    if (bind(listenFd, (sockaddr*) &addr, sizeof(addr)) != 0 ||
+    listen(listenFd, 64) != 0) {
+        close(listenFd);
+        listenFd = -1;
+        throw runtime_error("solverDaemon: could not listen on " + socketPath);
+    }
+    for (int i = 0; i < nWorkers; i++) {
+        workers.push_back(thread(&solverDaemon::workerLoop, this));
+    }
+}
+
+/**
+ * Stops the daemon: wakes the workers waiting for a connection, closes the
+ * connections being served and joins the workers. Solves in progress are
+ * ended at their next batch of rows, so stopping does not wait for them to
+ * finish.
+ *
+ * @return         Nothing.
+ */
+void solverDaemon::stop() {
+    if (listenFd < 0) {
+        return;
+    }
+    stopping = true;
+    shutdown(listenFd, SHUT_RDWR);
+    {
+        lock_guard<mutex> guard(clientsLock);
+        for (int fd : clients) {
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+    for (int i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    workers.clear();
+    close(listenFd);
+    listenFd = -1;
+    unlink(socketPath.c_str());
+}
+
+/**
+ * Accepts connections and serves them one at a time until the daemon is
+ * stopped.
+ *
+ * @return         Nothing.
+ */
+void solverDaemon::workerLoop() {
+    while (!stopping) {
+        // Wait with a timeout, so a stop is noticed even if shutdown of the
+        // listening socket does not wake accept
+        pollfd p = {listenFd, POLLIN, 0};
+        if (poll(&p, 1, 100) <= 0 || stopping) {
+            continue;
+        }
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        {
+            lock_guard<mutex> guard(clientsLock);
+            clients.insert(fd);
+        }
+        serveClient(fd);
+        {
+            lock_guard<mutex> guard(clientsLock);
+            clients.erase(fd);
+        }
+        close(fd);
+    }
+}
+
+/**
+ * Reads requests from a connection and answers them until the client
+ * closes it or sends something that is not a request.
+ *
+ * @param fd       Connected socket.
+ * @return         Nothing.
+ */
+void solverDaemon::serveClient(int fd) {
+    // Kept for the life of the connection, so batches of rows are not
+    // reallocated for every request
+    vector<double> rows;
+    wireBuffer msg;
+    int64_t type;
+    while (!stopping && recvMessage(fd, type, msg) && type == daemonRequest) {
+        solveRequest request;
+        bool sent;
+        try {
+            request.decode(msg);
+            sent = solve(fd, request, rows);
+        } catch (const solveAborted&) {
+            sent = false;
+        } catch (const exception &e) {
+            wireBuffer err;
+            err.putString(e.what());
+            sent = sendMessage(fd, daemonError, err);
+        }
+        served++;
+        if (!sent) {
+            return;
+        }
+    }
+}
+
+/**
+ * Runs a request and streams the solution to the client: HEADER (number of
+ * columns and whether the solution came from the cache), ROWS messages of
+ * up to 4096 rows of t followed by X, then DONE with the solver statistics.
+ *
+ * @param fd       Connected socket.
+ * @param request  Request.
+ * @param rows     Buffer the rows are batched in.
+ * @return         Whether everything was sent. A solve whose rows cannot be
+ * sent, or that is still running when the daemon stops, is ended by
+ * throwing solveAborted out of the row sink.
+ */
+bool solverDaemon::solve(int fd, solveRequest &request,
+vector<double> &rows) {
+    TRACE_ZONE("daemon solve");
+    auto it = systems.find(request.system);
+    if (it == systems.end()) {
+        throw runtime_error("no system called " + request.system);
+    }
+    const registeredSystem &sys = it->second;
+    if (request.X0.size() != sys.dim || request.params.size() != sys.nParams) {
+        throw runtime_error(request.system + " takes " +
+        to_string(sys.dim) + " initial values and " + to_string(sys.nParams) +
+        " parameters");
+    }
+    if (request.N < 0 || !(request.tf > request.t0)) {
+        throw runtime_error("there should be tf > t0 and N >= 0");
+    }
+    if (request.N > 0 && !isFixedStepMethod(request.method)) {
+        throw runtime_error("No fixed step method called " + request.method);
+    }
+    if (request.N == 0 && !isAdaptiveMethod(request.method)) {
+        throw runtime_error("No adaptive method called " + request.method);
+    }
+    if (request.N == 0 && (request.dtInit < 0 || request.itMax < 1 ||
+    request.itMax > INT_MAX)) {
+        throw runtime_error("there should be dtInit >= 0 and itMax in 1.." +
+        to_string(INT_MAX));
+    }
+    double dtInit = (request.dtInit > 0) ? request.dtInit :
+    (request.tf - request.t0)/100;
+
+    // Solution is sent in batches of rows as it is computed. Once a batch
+    // cannot be sent, or the daemon is stopping, the solve is ended by
+    // throwing out of the sink
+    const size_t batchRows = 4096;
+    size_t nCols = sys.dim + 1;
+    rows.clear();
+    rows.reserve(batchRows*nCols);
+    auto flush = [&]() {
+        bool sent = true;
+        if (!rows.empty()) {
+            wireBuffer batch;
+            batch.putVec(rows);
+            sent = sendMessage(fd, daemonRows, batch);
+        }
+        rows.clear();
+        if (!sent || stopping) {
+            throw solveAborted();
+        }
+    };
+    auto sink = [&](double ti, const vector<double> &Xi) {
+        rows.push_back(ti);
+        rows.insert(rows.end(), Xi.begin(), Xi.end());
+        if (rows.size() >= batchRows*nCols) {
+            flush();
+        }
+    };
+
+    // Cache lookup
+    string key = solveKey(request.system, sys.version, request.X0,
+    request.t0, request.tf, request.params, request.method, request.N,
+    request.tol, dtInit, request.itMax);
+    vector<vector<double>> X;
+    solCacheEntry entry;
+    bool hit = false;
+    // Lookups only map a file, so they need no lock and a large hit does not
+    // hold up the other workers
+    if (request.useCache) {
+        hit = cache.load(key, entry);
+    }
+    wireBuffer header;
+    header.putInt(nCols);
+    header.putInt(hit);
+    if (!sendMessage(fd, daemonHeader, header)) {
+        return false;
+    }
+
+    solverStats stats;
+    if (hit) {
+        cacheHits++;
+        vector<double> Xi(entry.nCols());
+        for (size_t i = 0; i < entry.size(); i++) {
+            Xi.assign(entry.XAt(i), entry.XAt(i) + entry.nCols());
+            sink(entry.tAt(i), Xi);
+        }
+    } else if (request.N > 0) {
+        uniformGrid<double> grid(request.t0, request.tf, request.N);
+        fixedStepStream(sys.f, request.X0, grid, request.params,
+        request.method, [&](double ti, const vector<double> &Xi) {
+            sink(ti, Xi);
+            if (request.useCache) {
+                X.push_back(Xi);
+            }
+        });
+        if (request.useCache) {
+            lock_guard<mutex> guard(cacheLock);
+            cache.store(key, grid, X);
+        }
+    } else {
+        // Start with an empty interval, so that the steps can be streamed
+        // by extendTo as they are accepted
+        solClass solution(sys.f, request.X0, request.t0, request.t0,
+        request.params, request.tol, int (request.itMax), dtInit,
+        request.method);
+        sink(request.t0, request.X0);
+        solution.setStepSink(sink);
+        solution.extendTo(request.tf);
+        stats = solution.getStats();
+        if (request.useCache) {
+            lock_guard<mutex> guard(cacheLock);
+            cache.store(key, solution.getT(), solution.getX());
+        }
+    }
+    flush();
+
+    wireBuffer done;
+    done.putInt(stats.nfev);
+    done.putInt(stats.nAccept);
+    done.putInt(stats.nReject);
+
+    return sendMessage(fd, daemonDone, done);
+}
+
+/**
+ * Connection to a solverDaemon, which can send any number of requests.
+ */
+class solverClient {
+    public:
+        // Constructor, connects to the daemon
+        solverClient(string);
+        // Destructor, closes the connection
+        ~solverClient();
+        // Solves a problem, passing each point to sink as it arrives
+        template <typename Sink>
+        solverStats solve(const solveRequest&, Sink&&);
+        // Solves a problem and returns the whole solution
+        solClass solve(const solveRequest&);
+        // Whether the last solution came from the daemon's cache
+        bool fromCache = false;
+
+        solverClient(const solverClient&) = delete;
+        solverClient& operator=(const solverClient&) = delete;
+
+    private:
+        int fd;
+};
+
+/**
+ * Constructor for solverClient.
+ *
+ * @param socketPath Path of the daemon's socket.
+ * @return           N/A.
+ */
+solverClient::solverClient(string socketPath) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        throw runtime_error("solverClient: socket path is too long");
+    }
+    strcpy(addr.sun_path, socketPath.c_str());
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr*) &addr, sizeof(addr)) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        throw runtime_error("solverClient: could not connect to " +
+        socketPath);
+    }
+}
+
+/**
+ * Destructor for solverClient.
+ *
+ * @return         N/A.
+ */
+solverClient::~solverClient() {
+    close(fd);
+}
+
+/**
+ * Sends a request and passes each point of the solution to sink as the
+ * batches of rows arrive.
+ *
+ * @param request  Request.
+ * @param sink     Called as sink(t, X) for every point in order.
+ * @return         Solver statistics (zero for fixed step methods and cache
+ * hits).
+ */
+template <typename Sink>
+solverStats solverClient::solve(const solveRequest &request, Sink &&sink) {
+    wireBuffer msg;
+    request.encode(msg);
+    if (!sendMessage(fd, daemonRequest, msg)) {
+        throw runtime_error("solverClient: the daemon has gone away");
+    }
+    int64_t type, nCols = 0;
+    vector<double> X;
+    while (recvMessage(fd, type, msg)) {
+        if (type == daemonHeader) {
+            nCols = msg.getInt();
+            fromCache = msg.getInt() != 0;
+            X.resize(nCols - 1);
+        } else if (type == daemonRows) {
+            vector<double> rows = msg.getVec();
+            for (size_t i = 0; i + nCols <= rows.size(); i += nCols) {
+                copy(rows.begin() + i + 1, rows.begin() + i + nCols,
+                X.begin());
+                sink(rows[i], X);
+            }
+        } else if (type == daemonDone) {
+            solverStats stats;
+            stats.nfev = msg.getInt();
+            stats.nAccept = msg.getInt();
+            stats.nReject = msg.getInt();
+            return stats;
+        } else if (type == daemonError) {
+            throw runtime_error("solverDaemon: " + msg.getString());
+        }
+    }
+    throw runtime_error("solverClient: the daemon has gone away");
+}
+
+/**
+ * Sends a request and returns the whole solution.
+ *
+ * @param request  Request.
+ * @return         Solution object.
+ */
+solClass solverClient::solve(const solveRequest &request) {
+    vector<double> t;
+    vector<vector<double>> X;
+    solve(request, [&](double ti, const vector<double> &Xi) {
+        t.push_back(ti);
+        X.push_back(Xi);
+    });
+
+    return solClass(t, X);
+}
+
+#endif
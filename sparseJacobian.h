@@ -0,0 +1,702 @@
+#ifndef SPARSEJACOBIAN_H
+#define SPARSEJACOBIAN_H
+
+#include <rkWorkspace.h>
+#include <queue>
+
+using namespace std;
+
+/**
+ * Positions of the nonzero entries of an n x n matrix in compressed sparse
+ * row (CSR) form: the columns of row i are colIdx[rowPtr[i]], ...,
+ * colIdx[rowPtr[i+1]-1], in increasing order. The diagonal is always
+ * included, since implicit methods factor I - gamma J.
+ */
+class sparsityPattern {
+    public:
+        // Constructors
+        sparsityPattern(size_t nInput=0);
+        sparsityPattern(size_t, vector<pair<size_t, size_t>>);
+        // Pattern of a band matrix
+        static sparsityPattern banded(size_t, size_t, size_t);
+        // Number of nonzero entries
+        size_t nnz() const;
+        // Lower and upper bandwidths
+        size_t lowerBandwidth() const;
+        size_t upperBandwidth() const;
+
+        size_t n;
+        vector<size_t> rowPtr;
+        vector<size_t> colIdx;
+};
+
+/**
+ * Sparse matrix in CSR form.
+ */
+class csrMatrix {
+    public:
+        // Constructor, all entries zero
+        csrMatrix(const sparsityPattern &patternInput=sparsityPattern());
+        // Computes y = A x
+        void multiply(const double*, double*) const;
+
+        sparsityPattern pattern;
+        vector<double> values;
+};
+
+/**
+ * Band matrix with kl subdiagonals and ku superdiagonals, stored by rows
+ * with room for the kl extra superdiagonals that partial pivoting fills
+ * in, so that a bandedLU can factor a copy in place.
+ */
+class bandedMatrix {
+    public:
+        // Constructors
+        bandedMatrix(size_t nInput=0, size_t klInput=0, size_t kuInput=0);
+        bandedMatrix(const csrMatrix&);
+        // Entry (i, j), which must satisfy -kl <= j-i <= ku+kl
+        double& at(size_t, size_t);
+        double at(size_t, size_t) const;
+
+        size_t n;
+        size_t kl;
+        size_t ku;
+        vector<double> data;
+};
+
+/**
+ * Sparsity pattern constructor for an n x n matrix with only a diagonal.
+ *
+ * @param nInput   Matrix size.
+ * @return         N/A.
+ */
+sparsityPattern::sparsityPattern(size_t nInput) {
+    n = nInput;
+    rowPtr.resize(n+1);
+    colIdx.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        rowPtr[i] = i;
+        colIdx[i] = i;
+    }
+    rowPtr[n] = n;
+}
+
+/**
+ * Sparsity pattern constructor from a list of nonzero entries (duplicates
+ * are allowed, the diagonal is added).
+ *
+ * @param nInput   Matrix size.
+ * @param entries  (row, column) pairs of the nonzero entries.
+ * @return         N/A.
+ */
+sparsityPattern::sparsityPattern(size_t nInput,
+vector<pair<size_t, size_t>> entries) {
+    n = nInput;
+    for (size_t i = 0; i < n; i++) {
+        entries.push_back({i, i});
+    }
+    sort(entries.begin(), entries.end());
+    entries.erase(unique(entries.begin(), entries.end()), entries.end());
+
+    rowPtr.assign(n+1, 0);
+    colIdx.resize(entries.size());
+    for (size_t e = 0; e < entries.size(); e++) {
+        assert(entries[e].first < n && entries[e].second < n);
+        rowPtr[entries[e].first+1]++;
+        colIdx[e] = entries[e].second;
+    }
+    for (size_t i = 0; i < n; i++) {
+        rowPtr[i+1] += rowPtr[i];
+    }
+}
+
+/**
+ * Returns the pattern of an n x n band matrix.
+ *
+ * @param n        Matrix size.
+ * @param kl       Number of subdiagonals.
+ * @param ku       Number of superdiagonals.
+ * @return         Sparsity pattern.
+ */
+sparsityPattern sparsityPattern::banded(size_t n, size_t kl, size_t ku) {
+    sparsityPattern band;
+    band.n = n;
+    band.rowPtr.assign(1, 0);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = (i > kl ? i-kl : 0); j <= min(n-1, i+ku); j++) {
+            band.colIdx.push_back(j);
+        }
+        band.rowPtr.push_back(band.colIdx.size());
+    }
+
+    return band;
+}
+
+/**
+ * Returns the number of nonzero entries.
+ *
+ * @return         Number of entries in the pattern.
+ */
+size_t sparsityPattern::nnz() const {
+    return colIdx.size();
+}
+
+/**
+ * Returns the largest i-j over the nonzero entries (i, j).
+ *
+ * @return         Number of subdiagonals.
+ */
+size_t sparsityPattern::lowerBandwidth() const {
+    size_t kl = 0;
+    for (size_t i = 0; i < n; i++) {
+        kl = max(kl, i - min(i, colIdx[rowPtr[i]]));
+    }
+
+    return kl;
+}
+
+/**
+ * Returns the largest j-i over the nonzero entries (i, j).
+ *
+ * @return         Number of superdiagonals.
+ */
+size_t sparsityPattern::upperBandwidth() const {
+    size_t ku = 0;
+    for (size_t i = 0; i < n; i++) {
+        ku = max(ku, max(colIdx[rowPtr[i+1]-1], i) - i);
+    }
+
+    return ku;
+}
+
+/**
+ * Constructor for csrMatrix.
+ *
+ * @param patternInput Positions of the nonzero entries.
+ * @return             N/A.
+ */
+csrMatrix::csrMatrix(const sparsityPattern &patternInput) {
+    pattern = patternInput;
+    values.assign(pattern.nnz(), 0.0);
+}
+
+/**
+ * Computes y = A x.
+ *
+ * @param x        Vector of length n.
+ * @param y        Set to A x.
+ * @return         Nothing.
+ */
+void csrMatrix::multiply(const double *x, double *y) const {
+    for (size_t i = 0; i < pattern.n; i++) {
+        double sum = 0;
+        for (size_t p = pattern.rowPtr[i]; p < pattern.rowPtr[i+1]; p++) {
+            sum += values[p]*x[pattern.colIdx[p]];
+        }
+        y[i] = sum;
+    }
+}
+
+/**
+ * Constructor for bandedMatrix, all entries zero.
+ *
+ * @param nInput   Matrix size.
+ * @param klInput  Number of subdiagonals.
+ * @param kuInput  Number of superdiagonals.
+ * @return         N/A.
+ */
+bandedMatrix::bandedMatrix(size_t nInput, size_t klInput, size_t kuInput) {
+    n = nInput;
+    kl = klInput;
+    ku = kuInput;
+    data.assign(n*(2*kl+ku+1), 0.0);
+}
+
+/**
+ * Constructor for bandedMatrix from a sparse matrix, with the smallest band
+ * holding its pattern.
+ *
+ * @param A        Sparse matrix.
+ * @return         N/A.
+ */
+bandedMatrix::bandedMatrix(const csrMatrix &A) :
+bandedMatrix(A.pattern.n, A.pattern.lowerBandwidth(),
+A.pattern.upperBandwidth()) {
+    for (size_t i = 0; i < n; i++) {
+        for (size_t p = A.pattern.rowPtr[i]; p < A.pattern.rowPtr[i+1];
+        p++) {
+            at(i, A.pattern.colIdx[p]) = A.values[p];
+        }
+    }
+}
+
+/**
+ * Returns a reference to entry (i, j).
+ *
+ * @param i        Row.
+ * @param j        Column (with -kl <= j-i <= ku+kl).
+ * @return         Reference to the entry.
+ */
+double& bandedMatrix::at(size_t i, size_t j) {
+    return data[i*(2*kl+ku+1) + (j + kl - i)];
+}
+
+double bandedMatrix::at(size_t i, size_t j) const {
+    return data[i*(2*kl+ku+1) + (j + kl - i)];
+}
+
+/**
+ * Colors the columns of a sparsity pattern so that no two columns of the
+ * same color have a nonzero in the same row (greedily, in column order).
+ * All columns of one color can then be perturbed together when estimating
+ * the Jacobian by finite differences. A band matrix gets kl+ku+1 colors.
+ *
+ * @param pattern  Sparsity pattern of the Jacobian.
+ * @param nColors  Set to the number of colors used.
+ * @return         Color of each column.
+ */
+vector<int> colorColumns(const sparsityPattern &pattern, int &nColors) {
+    size_t n = pattern.n;
+
+    // Rows of each column (the transpose of the pattern)
+    vector<size_t> colPtr(n+1, 0), rowIdx(pattern.nnz());
+    for (size_t p = 0; p < pattern.nnz(); p++) {
+        colPtr[pattern.colIdx[p]+1]++;
+    }
+    for (size_t j = 0; j < n; j++) {
+        colPtr[j+1] += colPtr[j];
+    }
+    vector<size_t> next(colPtr.begin(), colPtr.end()-1);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t p = pattern.rowPtr[i]; p < pattern.rowPtr[i+1]; p++) {
+            rowIdx[next[pattern.colIdx[p]]++] = i;
+        }
+    }
+
+    // Give each column the smallest color not used by a column it shares a
+    // row with
+    vector<int> colors(n, -1);
+    vector<size_t> forbidden;
+    nColors = 0;
+    for (size_t j = 0; j < n; j++) {
+        forbidden.assign(nColors+1, n);
+        for (size_t p = colPtr[j]; p < colPtr[j+1]; p++) {
+            size_t i = rowIdx[p];
+            for (size_t q = pattern.rowPtr[i]; q < pattern.rowPtr[i+1]; q++) {
+                int c = colors[pattern.colIdx[q]];
+                if (c >= 0) {
+                    forbidden[c] = j;
+                }
+            }
+        }
+        int c = 0;
+        while (forbidden[c] == j) {
+            c++;
+        }
+        colors[j] = c;
+        nColors = max(nColors, c+1);
+    }
+
+    return colors;
+}
+
+/**
+ * Estimates the Jacobian df/dX at (t, X) by forward differences, one RHS
+ * evaluation per color: the columns of a color are perturbed together and
+ * each nonzero of the pattern is read off the row it belongs to.
+ *
+ * @param f        Function that writes dX/dt into its third argument.
+ * @param t        Time value.
+ * @param X        State (n values).
+ * @param fX       f(t, X) (n values).
+ * @param params   Vector of parameter values.
+ * @param colors   Column colors from colorColumns.
+ * @param nColors  Number of colors.
+ * @param J        Jacobian, whose pattern must hold every nonzero of
+ * df/dX; its values are overwritten.
+ * @return         Number of RHS evaluations used.
+ */
+int estimateJacobian(inPlaceRHS f, double t, const double *X,
+const double *fX, const vector<double> &params, const vector<int> &colors,
+int nColors, csrMatrix &J) {
+    TRACE_ZONE("estimateJacobian");
+    size_t n = J.pattern.n;
+    vector<double> Xp(X, X + n), fXp(n), eps(n);
+    for (size_t j = 0; j < n; j++) {
+        eps[j] = sqrt(2.2e-16)*max(1.0, abs(X[j]));
+    }
+
+    for (int c = 0; c < nColors; c++) {
+        for (size_t j = 0; j < n; j++) {
+            if (colors[j] == c) {
+                Xp[j] = X[j] + eps[j];
+            }
+        }
+        f(t, Xp.data(), fXp.data(), n, params);
+        for (size_t i = 0; i < n; i++) {
+            for (size_t p = J.pattern.rowPtr[i]; p < J.pattern.rowPtr[i+1];
+            p++) {
+                size_t j = J.pattern.colIdx[p];
+                if (colors[j] == c) {
+                    J.values[p] = (fXp[i] - fX[i])/eps[j];
+                }
+            }
+        }
+        for (size_t j = 0; j < n; j++) {
+            if (colors[j] == c) {
+                Xp[j] = X[j];
+            }
+        }
+    }
+
+    return nColors;
+}
+
+/**
+ * Returns I - gamma*J, the matrix implicit methods solve with.
+ *
+ * @param J        Jacobian (its pattern includes the diagonal).
+ * @param gamma    Scalar, e.g. the step size for backward Euler.
+ * @return         I - gamma*J, with the pattern of J.
+ */
+csrMatrix iterationMatrix(const csrMatrix &J, double gamma) {
+    csrMatrix M(J.pattern);
+    for (size_t i = 0; i < J.pattern.n; i++) {
+        for (size_t p = J.pattern.rowPtr[i]; p < J.pattern.rowPtr[i+1]; p++) {
+            M.values[p] = (J.pattern.colIdx[p] == i ? 1.0 : 0.0) -
+            gamma*J.values[p];
+        }
+    }
+
+    return M;
+}
+
+/**
+ * LU factorization of a band matrix with partial pivoting (as in LAPACK's
+ * dgbtrf), kept so that it can be reused for many solves, e.g. over several
+ * steps of an implicit method.
+ */
+class bandedLU {
+    public:
+        // Factor A
+        void factor(const bandedMatrix&);
+        // Solve A x = b in place
+        void solve(double*) const;
+
+    private:
+        bandedMatrix LU;
+        vector<size_t> pivots;
+};
+
+/**
+ * Factors A = P L U, where U has kl+ku superdiagonals.
+ *
+ * @param A        Band matrix.
+ * @return         Nothing.
+ */
+void bandedLU::factor(const bandedMatrix &A) {
+    TRACE_ZONE("bandedLU::factor");
+    LU = A;
+    size_t n = LU.n, kl = LU.kl, ku = LU.ku;
+    pivots.resize(n);
+
+    for (size_t k = 0; k < n; k++) {
+        size_t last = min(n-1, k+kl);
+        size_t lastCol = min(n-1, k+kl+ku);
+
+        // Pivot on the largest entry in column k
+        size_t p = k;
+        for (size_t i = k+1; i <= last; i++) {
+            if (abs(LU.at(i, k)) > abs(LU.at(p, k))) {
+                p = i;
+            }
+        }
+        if (LU.at(p, k) == 0) {
+            throw runtime_error("bandedLU: matrix is singular");
+        }
+        pivots[k] = p;
+        if (p != k) {
+            for (size_t j = k; j <= lastCol; j++) {
+                swap(LU.at(k, j), LU.at(p, j));
+            }
+        }
+
+        // Eliminate below the pivot, storing the multipliers in L
+        for (size_t i = k+1; i <= last; i++) {
+            double l = LU.at(i, k)/LU.at(k, k);
+            LU.at(i, k) = l;
+            if (l != 0) {
+                for (size_t j = k+1; j <= lastCol; j++) {
+                    LU.at(i, j) -= l*LU.at(k, j);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Solves A x = b using the factorization.
+ *
+ * @param b        Right-hand side, overwritten with x.
+ * @return         Nothing.
+ */
+void bandedLU::solve(double *b) const {
+    TRACE_ZONE("bandedLU::solve");
+    size_t n = LU.n, kl = LU.kl, ku = LU.ku;
+
+    // Apply the row interchanges and L
+    for (size_t k = 0; k < n; k++) {
+        swap(b[k], b[pivots[k]]);
+        for (size_t i = k+1; i <= min(n-1, k+kl); i++) {
+            b[i] -= LU.at(i, k)*b[k];
+        }
+    }
+
+    // Back substitution with U
+    for (size_t k = n; k-- > 0; ) {
+        double sum = b[k];
+        for (size_t j = k+1; j <= min(n-1, k+kl+ku); j++) {
+            sum -= LU.at(k, j)*b[j];
+        }
+        b[k] = sum/LU.at(k, k);
+    }
+}
+
+/**
+ * Sparse LU factorization without pivoting, for matrices such as I - gamma J
+ * that are dominated by their diagonal. analyze orders the unknowns with
+ * reverse Cuthill-McKee to limit fill-in and works out where the fill-in
+ * goes; this is done once per sparsity pattern. factor then only does the
+ * arithmetic, so an implicit method can refactor cheaply whenever gamma or
+ * J changes, and solve can be called any number of times in between.
+ */
+class sparseLU {
+    public:
+        // Order the unknowns and find the pattern of the factors
+        void analyze(const sparsityPattern&);
+        // Factor a matrix with the analyzed pattern
+        void factor(const csrMatrix&);
+        // Solve A x = b in place
+        void solve(double*) const;
+        // Number of entries in L and U together
+        size_t nnz() const;
+
+    private:
+        size_t n = 0;
+        // perm[i] is the original index of the ith unknown
+        vector<size_t> perm;
+        // Pattern of L (strictly lower part) and U of the permuted matrix
+        sparsityPattern factors;
+        vector<size_t> diagPos;
+        // Position in the factors of each entry of the original matrix
+        vector<size_t> scatter;
+        vector<double> values;
+};
+
+/**
+ * Orders the unknowns with reverse Cuthill-McKee and computes the pattern of
+ * the L and U factors of the reordered matrix.
+ *
+ * @param pattern  Sparsity pattern of the matrices to be factored.
+ * @return         Nothing.
+ */
+void sparseLU::analyze(const sparsityPattern &pattern) {
+    TRACE_ZONE("sparseLU::analyze");
+    n = pattern.n;
+
+    // Symmetrized adjacency lists
+    vector<vector<size_t>> adj(n);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t p = pattern.rowPtr[i]; p < pattern.rowPtr[i+1]; p++) {
+            size_t j = pattern.colIdx[p];
+            if (j != i) {
+                adj[i].push_back(j);
+                adj[j].push_back(i);
+            }
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        sort(adj[i].begin(), adj[i].end());
+        adj[i].erase(unique(adj[i].begin(), adj[i].end()), adj[i].end());
+    }
+
+    // Cuthill-McKee: breadth first from a node of least degree in each
+    // connected component, visiting neighbours in order of degree
+    vector<size_t> byDegree(n);
+    for (size_t i = 0; i < n; i++) {
+        byDegree[i] = i;
+    }
+    stable_sort(byDegree.begin(), byDegree.end(), [&](size_t a, size_t b) {
+        return adj[a].size() < adj[b].size();
+    });
+    vector<bool> visited(n, false);
+    perm.clear();
+    for (size_t s = 0; s < n; s++) {
+        if (visited[byDegree[s]]) {
+            continue;
+        }
+        size_t head = perm.size();
+        perm.push_back(byDegree[s]);
+        visited[byDegree[s]] = true;
+        while (head < perm.size()) {
+            size_t v = perm[head++];
+            size_t first = perm.size();
+            for (size_t q = 0; q < adj[v].size(); q++) {
+                if (!visited[adj[v][q]]) {
+                    visited[adj[v][q]] = true;
+                    perm.push_back(adj[v][q]);
+                }
+            }
+            stable_sort(perm.begin() + first, perm.end(),
+            [&](size_t a, size_t b) {
+                return adj[a].size() < adj[b].size();
+            });
+        }
+    }
+    reverse(perm.begin(), perm.end());
+    vector<size_t> invPerm(n);
+    for (size_t i = 0; i < n; i++) {
+        invPerm[perm[i]] = i;
+    }
+
+    // Symbolic factorization row by row: row i of L U holds row i of the
+    // permuted matrix plus, for each k < i in it (taken in increasing
+    // order, including fill), the part of row k of U right of k
+    factors.n = n;
+    factors.rowPtr.assign(1, 0);
+    factors.colIdx.clear();
+    diagPos.resize(n);
+    vector<size_t> mark(n, n), upper;
+    priority_queue<size_t, vector<size_t>, greater<size_t>> lower;
+    for (size_t i = 0; i < n; i++) {
+        size_t row = perm[i];
+        upper.clear();
+        for (size_t p = pattern.rowPtr[row]; p < pattern.rowPtr[row+1]; p++) {
+            size_t j = invPerm[pattern.colIdx[p]];
+            mark[j] = i;
+            if (j < i) {
+                lower.push(j);
+            } else {
+                upper.push_back(j);
+            }
+        }
+        while (!lower.empty()) {
+            size_t k = lower.top();
+            lower.pop();
+            factors.colIdx.push_back(k);
+            for (size_t q = diagPos[k]+1; q < factors.rowPtr[k+1]; q++) {
+                size_t j = factors.colIdx[q];
+                if (mark[j] != i) {
+                    mark[j] = i;
+                    if (j < i) {
+                        lower.push(j);
+                    } else {
+                        upper.push_back(j);
+                    }
+                }
+            }
+        }
+        sort(upper.begin(), upper.end());
+        diagPos[i] = factors.colIdx.size();
+        factors.colIdx.insert(factors.colIdx.end(), upper.begin(),
+        upper.end());
+        factors.rowPtr.push_back(factors.colIdx.size());
+    }
+
+    // Where each original entry goes in the factors
+    scatter.resize(pattern.nnz());
+    vector<size_t> pos(n);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t q = factors.rowPtr[i]; q < factors.rowPtr[i+1]; q++) {
+            pos[factors.colIdx[q]] = q;
+        }
+        size_t row = perm[i];
+        for (size_t p = pattern.rowPtr[row]; p < pattern.rowPtr[row+1]; p++) {
+            scatter[p] = pos[invPerm[pattern.colIdx[p]]];
+        }
+    }
+    values.assign(factors.nnz(), 0.0);
+}
+
+/**
+ * Computes the L and U factors of A, whose pattern must be the one passed
+ * to analyze.
+ *
+ * @param A        Matrix to be factored.
+ * @return         Nothing.
+ */
+void sparseLU::factor(const csrMatrix &A) {
+    TRACE_ZONE("sparseLU::factor");
+    assert(A.values.size() == scatter.size());
+    fill(values.begin(), values.end(), 0.0);
+    for (size_t p = 0; p < scatter.size(); p++) {
+        values[scatter[p]] += A.values[p];
+    }
+
+    // Row i is reduced by the rows k < i of U it has entries in
+    vector<size_t> pos(n);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t q = factors.rowPtr[i]; q < factors.rowPtr[i+1]; q++) {
+            pos[factors.colIdx[q]] = q;
+        }
+        for (size_t q = factors.rowPtr[i]; q < diagPos[i]; q++) {
+            size_t k = factors.colIdx[q];
+            double l = values[q]/values[diagPos[k]];
+            values[q] = l;
+            for (size_t r = diagPos[k]+1; r < factors.rowPtr[k+1]; r++) {
+                values[pos[factors.colIdx[r]]] -= l*values[r];
+            }
+        }
+        if (values[diagPos[i]] == 0) {
+            throw runtime_error("sparseLU: zero pivot (the matrix needs "
+            "pivoting or is singular)");
+        }
+    }
+}
+
+/**
+ * Solves A x = b using the factors.
+ *
+ * @param b        Right-hand side, overwritten with x.
+ * @return         Nothing.
+ */
+void sparseLU::solve(double *b) const {
+    TRACE_ZONE("sparseLU::solve");
+    vector<double> y(n);
+    for (size_t i = 0; i < n; i++) {
+        y[i] = b[perm[i]];
+    }
+
+    // Forward substitution with L (unit diagonal)
+    for (size_t i = 0; i < n; i++) {
+        double sum = y[i];
+        for (size_t q = factors.rowPtr[i]; q < diagPos[i]; q++) {
+            sum -= values[q]*y[factors.colIdx[q]];
+        }
+        y[i] = sum;
+    }
+
+    // Back substitution with U
+    for (size_t i = n; i-- > 0; ) {
+        double sum = y[i];
+        for (size_t q = diagPos[i]+1; q < factors.rowPtr[i+1]; q++) {
+            sum -= values[q]*y[factors.colIdx[q]];
+        }
+        y[i] = sum/values[diagPos[i]];
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        b[perm[i]] = y[i];
+    }
+}
+
+/**
+ * Returns the number of entries in the L and U factors.
+ *
+ * @return         Number of stored entries (including fill-in).
+ */
+size_t sparseLU::nnz() const {
+    return factors.nnz();
+}
+
+#endif
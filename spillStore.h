@@ -0,0 +1,363 @@
+#ifndef SPILLSTORE_H
+#define SPILLSTORE_H
+
+// POSIX calls used for the spill file and memory mapping
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <trace.h>
+
+using namespace std;
+
+/**
+ * Row store for solutions larger than memory. Rows of t followed by X are
+ * appended to a chunk in memory; each chunk is written to an unlinked
+ * temporary file as soon as it is full, and chunks are memory-mapped back
+ * when rows in them are read. At most window chunks are mapped at once (the
+ * least recently used one is unmapped first), so memory stays bounded
+ * whatever the number of rows. Reading the chunks in order makes the store
+ * ask the kernel to read the next chunk ahead. A copy gets a spill file of
+ * its own. Not thread safe.
+ */
+template <typename T>
+class spillStore {
+    public:
+        // Constructor, creates the spill file
+        spillStore(size_t, size_t chunkRowsInput=65536, int windowInput=4,
+        string dir="/tmp");
+        // Copy constructor, copies the rows into a new spill file
+        spillStore(const spillStore&);
+        // Destructor, unmaps the chunks and closes the spill file
+        ~spillStore();
+        // Appends the row (t, X)
+        void push(T, const vector<T>&);
+        // Number of rows
+        size_t size() const;
+        // Number of columns (1 + number of components of X)
+        size_t cols() const;
+        // Pointer to row i (t, then X), valid until the next call
+        const T* row(size_t);
+        // Last row
+        const vector<T>& back() const;
+        // Bytes of rows held in memory (the chunk being filled and the
+        // mapped chunks)
+        size_t residentBytes() const;
+        // Numbers of chunks written out, mapped in and read ahead
+        long spilled = 0;
+        long mapped = 0;
+        long prefetched = 0;
+
+        spillStore& operator=(const spillStore&) = delete;
+
+    private:
+        // A chunk mapped from the spill file
+        class mappedChunk {
+            public:
+                size_t chunk;
+                T *data;
+                long lastUse;
+        };
+        size_t nCols;
+        size_t chunkRows;
+        int window;
+        // Bytes between chunks in the file (chunk size rounded up to pages)
+        size_t stride;
+        // Directory of the spill file
+        string dir;
+        int fd = -1;
+        size_t nRows = 0;
+        // Chunk being filled
+        vector<T> current;
+        vector<T> last;
+        vector<mappedChunk> maps;
+        long useCount = 0;
+        // Last chunk read, to detect sequential access
+        size_t lastChunk = size_t (-1);
+        // Creates the unlinked spill file in dir
+        void openFile();
+        // Returns the mapping of chunk c, mapping it if need be
+        T* map(size_t);
+};
+
+/**
+ * Owning pointer to a spillStore that copies the store along with itself,
+ * so that copies of a solution never share (and grow) the same rows.
+ */
+template <typename T>
+class spillHandle {
+    public:
+        spillHandle() {}
+        spillHandle(const spillHandle &other) {
+            if (other.store) {
+                store.reset(new spillStore<T>(*other.store));
+            }
+        }
+        spillHandle& operator=(const spillHandle &other) {
+            if (this != &other) {
+                store.reset(other.store ? new spillStore<T>(*other.store) :
+                nullptr);
+            }
+            return *this;
+        }
+        void reset(spillStore<T> *p) {
+            store.reset(p);
+        }
+        spillStore<T>* operator->() const {
+            return store.get();
+        }
+        explicit operator bool() const {
+            return bool(store);
+        }
+
+    private:
+        unique_ptr<spillStore<T>> store;
+};
+
+/**
+ * Constructor for spillStore.
+ *
+ * @param nColsInput      Number of values per row (1 + components of X).
+ * @param chunkRowsInput  Number of rows per chunk.
+ * @param windowInput     Largest number of chunks mapped at once.
+ * @param dirInput        Directory the spill file is created in.
+ * @return                N/A.
+ */
+template <typename T>
+spillStore<T>::spillStore(size_t nColsInput, size_t chunkRowsInput,
+int windowInput, string dirInput) {
+    nCols = nColsInput;
+    chunkRows = max(chunkRowsInput, size_t (1));
+    window = max(windowInput, 2);
+    size_t page = sysconf(_SC_PAGESIZE);
+    stride = (chunkRows*nCols*sizeof(T) + page - 1)/page*page;
+    current.reserve(chunkRows*nCols);
+    dir = dirInput;
+    openFile();
+}
+
+/**
+ * Copy constructor for spillStore. The chunks written out by other are
+ * copied into a spill file of this store's own, one chunk at a time, so
+ * that rows pushed to either store afterwards do not show up in the other.
+ *
+ * @param other    Store to copy.
+ * @return         N/A.
+ */
+template <typename T>
+spillStore<T>::spillStore(const spillStore &other) : nCols(other.nCols),
+chunkRows(other.chunkRows), window(other.window), stride(other.stride),
+dir(other.dir), nRows(other.nRows), current(other.current),
+last(other.last) {
+    current.reserve(chunkRows*nCols);
+    openFile();
+    size_t bytes = chunkRows*nCols*sizeof(T);
+    vector<char> buffer(bytes);
+    for (size_t c = 0; c < nRows/chunkRows; c++) {
+        off_t offset = off_t (c)*stride;
+        for (size_t done = 0; done < bytes; ) {
+            ssize_t n = pread(other.fd, buffer.data() + done, bytes - done,
+            offset + done);
+            if (n <= 0) {
+                close(fd);
+                throw runtime_error("spillStore: could not read the spill "
+                "file");
+            }
+            done += n;
+        }
+        for (size_t done = 0; done < bytes; ) {
+            ssize_t n = pwrite(fd, buffer.data() + done, bytes - done,
+            offset + done);
+            if (n <= 0) {
+                close(fd);
+                throw runtime_error("spillStore: could not write to the "
+                "spill file");
+            }
+            done += n;
+        }
+    }
+}
+
+/**
+ * Destructor for spillStore.
+ *
+ * @return         N/A.
+ */
+template <typename T>
+spillStore<T>::~spillStore() {
+    for (size_t k = 0; k < maps.size(); k++) {
+        munmap(maps[k].data, stride);
+    }
+    close(fd);
+}
+
+/**
+ * Creates the spill file in dir. The file is unlinked at once, so it goes
+ * away with the process.
+ *
+ * @return         Nothing.
+ */
+template <typename T>
+void spillStore<T>::openFile() {
+    string name = dir + "/odespillXXXXXX";
+    vector<char> path(name.begin(), name.end());
+    path.push_back('\0');
+    fd = mkstemp(path.data());
+    if (fd < 0) {
+        throw runtime_error("spillStore: could not create a file in " + dir);
+    }
+    unlink(path.data());
+}
+
+/**
+ * Appends the row (ti, Xi), writing the chunk out once it is full.
+ *
+ * @param ti       Time value.
+ * @param Xi       State at ti.
+ * @return         Nothing.
+ */
+template <typename T>
+void spillStore<T>::push(T ti, const vector<T> &Xi) {
+    if (Xi.size() + 1 != nCols) {
+        throw runtime_error("spillStore: rows should have one value for t "
+        "and one for each component of X");
+    }
+    current.push_back(ti);
+    current.insert(current.end(), Xi.begin(), Xi.end());
+    last.assign(current.end() - nCols, current.end());
+    nRows++;
+    if (current.size() == chunkRows*nCols) {
+        TRACE_ZONE("spill chunk");
+        size_t bytes = current.size()*sizeof(T);
+        off_t offset = off_t ((nRows - 1)/chunkRows)*stride;
+        const char *p = (const char*) current.data();
+        for (size_t done = 0; done < bytes; ) {
+            ssize_t n = pwrite(fd, p + done, bytes - done, offset + done);
+            if (n <= 0) {
+                throw runtime_error("spillStore: could not write to the "
+                "spill file");
+            }
+            done += n;
+        }
+        spilled++;
+        current.clear();
+    }
+}
+
+/**
+ * Returns the number of rows.
+ *
+ * @return         Rows.
+ */
+template <typename T>
+size_t spillStore<T>::size() const {
+    return nRows;
+}
+
+/**
+ * Returns the number of values per row.
+ *
+ * @return         Columns.
+ */
+template <typename T>
+size_t spillStore<T>::cols() const {
+    return nCols;
+}
+
+/**
+ * Returns the last row.
+ *
+ * @return         t followed by X of the last row.
+ */
+template <typename T>
+const vector<T>& spillStore<T>::back() const {
+    return last;
+}
+
+/**
+ * Returns the number of bytes of rows held in memory.
+ *
+ * @return         Bytes.
+ */
+template <typename T>
+size_t spillStore<T>::residentBytes() const {
+    return current.capacity()*sizeof(T) + maps.size()*stride;
+}
+
+/**
+ * Returns the mapping of chunk c, mapping it (and unmapping the least
+ * recently used chunk if the window is full) if it is not mapped yet.
+ *
+ * @param c        Index of a chunk that has been written out.
+ * @return         Pointer to the first row of the chunk.
+ */
+template <typename T>
+T* spillStore<T>::map(size_t c) {
+    for (size_t k = 0; k < maps.size(); k++) {
+        if (maps[k].chunk == c) {
+            maps[k].lastUse = ++useCount;
+            return maps[k].data;
+        }
+    }
+    if (maps.size() >= window) {
+        size_t oldest = 0;
+        for (size_t k = 1; k < maps.size(); k++) {
+            if (maps[k].lastUse < maps[oldest].lastUse) {
+                oldest = k;
+            }
+        }
+        munmap(maps[oldest].data, stride);
+        maps.erase(maps.begin() + oldest);
+    }
+    void *p = mmap(nullptr, stride, PROT_READ, MAP_SHARED, fd, off_t (c)*stride);
+    if (p == MAP_FAILED) {
+        throw runtime_error("spillStore: could not map the spill file");
+    }
+    mapped++;
+    mappedChunk m;
+    m.chunk = c;
+    m.data = (T*) p;
+    m.lastUse = ++useCount;
+    maps.push_back(m);
+
+    return m.data;
+}
+
+/**
+ * Returns a pointer to row i: t followed by the components of X. Moving on
+ * to the chunk after the last one read asks the kernel to read the chunk
+ * after that ahead, so sequential passes overlap reading with use.
+ *
+ * @param i        Index of the row.
+ * @return         Pointer valid until the next call of row or push.
+ */
+template <typename T>
+const T* spillStore<T>::row(size_t i) {
+    size_t c = i/chunkRows;
+    size_t nSpilled = nRows/chunkRows;
+    if (c >= nSpilled) {
+        return current.data() + (i - c*chunkRows)*nCols;
+    }
+    T *data = map(c);
+    if (c != lastChunk) {
+        if (c == lastChunk + 1 && c + 1 < nSpilled) {
+            TRACE_ZONE("spill prefetch");
+            // Map the next chunk as well and have it read in the background
+            T *next = map(c + 1);
+            madvise(next, stride, MADV_WILLNEED);
+            prefetched++;
+            data = map(c);
+        }
+        lastChunk = c;
+    }
+
+    return data + (i - c*chunkRows)*nCols;
+}
+
+#endif
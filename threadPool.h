@@ -0,0 +1,145 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Fixed set of threads that repeatedly run a task together, one call per
+ * thread, as needed by every stage of a solver working on a partitioned
+ * state. The threads are created once, so a run costs a wake-up rather than
+ * a thread creation. The calling thread takes part as thread 0.
+ */
+class threadPool {
+    public:
+        // Constructor
+        threadPool(int nThreadsInput=0);
+        // Destructor, stops the threads
+        ~threadPool();
+        // Number of threads (including the caller)
+        int size();
+        // Call task(i) on thread i for every i, returning once all are done
+        void run(const function<void(int)>&);
+
+        threadPool(const threadPool&) = delete;
+        threadPool& operator=(const threadPool&) = delete;
+
+    private:
+        int nThreads;
+        vector<thread> workers;
+        mutex lock;
+        condition_variable startCond;
+        condition_variable doneCond;
+        const function<void(int)> *task = nullptr;
+        long generation = 0;
+        int pending = 0;
+        bool stopping = false;
+        // Body of each worker thread
+        void workerLoop(int);
+};
+
+/**
+ * Constructor for threadPool, starts nThreads-1 worker threads.
+ *
+ * @param nThreadsInput Number of threads including the caller (0 means one
+ * per core).
+ * @return              N/A.
+ */
+threadPool::threadPool(int nThreadsInput) {
+    nThreads = nThreadsInput;
+    if (nThreads <= 0) {
+        nThreads = max(1u, thread::hardware_concurrency());
+    }
+    for (int i = 1; i < nThreads; i++) {
+        workers.push_back(thread(&threadPool::workerLoop, this, i));
+    }
+}
+
+/**
+ * Destructor for threadPool, waits for the worker threads to exit.
+ *
+ * @return         N/A.
+ */
+threadPool::~threadPool() {
+    {
+        unique_lock<mutex> guard(lock);
+        stopping = true;
+    }
+    startCond.notify_all();
+    for (int i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
+
+/**
+ * Returns the number of threads, including the calling thread.
+ *
+ * @return         Number of threads.
+ */
+int threadPool::size() {
+    return nThreads;
+}
+
+/**
+ * Waits for tasks and runs them until the pool is destroyed.
+ *
+ * @param id       Index of the thread.
+ * @return         Nothing.
+ */
+void threadPool::workerLoop(int id) {
+    long seen = 0;
+    while (true) {
+        const function<void(int)> *current;
+        {
+            unique_lock<mutex> guard(lock);
+            startCond.wait(guard, [&]() {
+                return stopping || generation != seen;
+            });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            current = task;
+        }
+        (*current)(id);
+        {
+            unique_lock<mutex> guard(lock);
+            if (--pending == 0) {
+                doneCond.notify_one();
+            }
+        }
+    }
+}
+
+/**
+ * Calls task(i) on thread i for i = 0, ..., size()-1 and returns once every
+ * call has returned. Thread 0 is the calling thread.
+ *
+ * @param work     Task to be run.
+ * @return         Nothing.
+ */
+void threadPool::run(const function<void(int)> &work) {
+    if (nThreads == 1) {
+        work(0);
+        return;
+    }
+    {
+        unique_lock<mutex> guard(lock);
+        task = &work;
+        pending = nThreads - 1;
+        generation++;
+    }
+    startCond.notify_all();
+    work(0);
+    unique_lock<mutex> guard(lock);
+    doneCond.wait(guard, [&]() {
+        return pending == 0;
+    });
+}
+
+#endif
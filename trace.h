@@ -0,0 +1,258 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/**
+ * Scoped timeline tracing, written as a Chrome trace (open it in
+ * chrome://tracing or ui.perfetto.dev).
+ *
+ * Tracing is compiled in only if ODE_TRACE is defined (e.g. with
+ * -DODE_TRACE); otherwise TRACE_ZONE and TRACE_DETAIL_ZONE expand to nothing
+ * and traceStart/traceStop do nothing. When compiled in, it is off until
+ * traceStart is called or the environment variable ODE_TRACE_FILE names the
+ * file to write (ODE_TRACE_DETAIL=1 also records the fine grained zones in
+ * vecOps.h and the RHS, which fire millions of times in a typical run).
+ *
+ * Each thread appends events to its own buffer under that buffer's lock,
+ * which only traceStart and traceStop ever contend for; the buffers are
+ * merged when the trace is written.
+ */
+#ifdef ODE_TRACE
+
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * A finished zone: name, start and duration in nanoseconds.
+ */
+class traceEvent {
+    public:
+        const char *name;
+        int64_t start;
+        int64_t duration;
+};
+
+/**
+ * Events recorded by one thread, and the lock that guards them against
+ * traceStart and traceStop running on other threads.
+ */
+class traceBuffer {
+    public:
+        int tid;
+        mutex lock;
+        vector<traceEvent> events;
+};
+
+/**
+ * Global tracing state: whether tracing is on, the output file and the
+ * buffers of every thread that has recorded an event.
+ */
+class traceState {
+    public:
+        atomic<bool> on{false};
+        atomic<bool> detail{false};
+        // Incremented by traceStart, so zones that straddle a restart (and
+        // so were timed from the old epoch) are dropped
+        atomic<int> generation{0};
+        chrono::steady_clock::time_point epoch;
+        string filename;
+        mutex lock;
+        vector<unique_ptr<traceBuffer>> buffers;
+
+        // Starts tracing if ODE_TRACE_FILE is set, writes it at exit
+        traceState();
+        ~traceState();
+};
+
+/**
+ * Returns the global tracing state.
+ *
+ * @return         Tracing state.
+ */
+inline traceState& traceGlobal() {
+    static traceState state;
+    return state;
+}
+
+/**
+ * Returns the calling thread's event buffer, creating it on first use.
+ * Buffers are owned by the global state, so they outlive their threads.
+ *
+ * @return         Buffer of the calling thread.
+ */
+inline traceBuffer& traceLocalBuffer() {
+    thread_local traceBuffer *buffer = nullptr;
+    if (buffer == nullptr) {
+        traceState &state = traceGlobal();
+        lock_guard<mutex> guard(state.lock);
+        state.buffers.push_back(unique_ptr<traceBuffer>(new traceBuffer()));
+        buffer = state.buffers.back().get();
+        buffer->tid = state.buffers.size();
+    }
+
+    return *buffer;
+}
+
+/**
+ * Returns nanoseconds since tracing started.
+ *
+ * @return         Time stamp.
+ */
+inline int64_t traceNow() {
+    return chrono::duration_cast<chrono::nanoseconds>(
+    chrono::steady_clock::now() - traceGlobal().epoch).count();
+}
+
+/**
+ * Starts recording zones, discarding any earlier events.
+ *
+ * @param filename Trace file written by traceStop.
+ * @param detail   Whether to record the fine grained zones too.
+ * @return         Nothing.
+ */
+inline void traceStart(string filename, bool detail=false) {
+    traceState &state = traceGlobal();
+    lock_guard<mutex> guard(state.lock);
+    state.generation++;
+    for (int i = 0; i < state.buffers.size(); i++) {
+        lock_guard<mutex> bufferGuard(state.buffers[i]->lock);
+        state.buffers[i]->events.clear();
+    }
+    state.filename = filename;
+    state.epoch = chrono::steady_clock::now();
+    state.detail = detail;
+    state.on = true;
+}
+
+/**
+ * Stops recording and writes the trace in Chrome's JSON trace event format,
+ * one complete ("X") event per zone. Zones that other threads finish while
+ * this runs may be left out.
+ *
+ * @return         Nothing.
+ */
+inline void traceStop() {
+    traceState &state = traceGlobal();
+    if (!state.on.exchange(false)) {
+        return;
+    }
+    lock_guard<mutex> guard(state.lock);
+    ofstream file(state.filename);
+    // Time stamps are in microseconds
+    file << fixed << setprecision(3);
+    int pid = getpid();
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" << endl;
+    bool first = true;
+    for (int b = 0; b < state.buffers.size(); b++) {
+        traceBuffer &buffer = *state.buffers[b];
+        lock_guard<mutex> bufferGuard(buffer.lock);
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",";
+        file << "\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer.tid;
+        file << ",\"args\":{\"name\":\"thread " << buffer.tid << "\"}}";
+        first = false;
+        for (int i = 0; i < buffer.events.size(); i++) {
+            const traceEvent &e = buffer.events[i];
+            file << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",";
+            file << "\"ts\":" << e.start/1e3 << ",\"dur\":";
+            file << e.duration/1e3 << ",\"pid\":" << pid << ",\"tid\":";
+            file << buffer.tid << "}";
+        }
+        buffer.events.clear();
+    }
+    file << "\n]}" << endl;
+}
+
+/**
+ * Constructor for traceState, starts tracing if ODE_TRACE_FILE is set.
+ *
+ * @return         N/A.
+ */
+inline traceState::traceState() {
+    epoch = chrono::steady_clock::now();
+    const char *file = getenv("ODE_TRACE_FILE");
+    const char *detailEnv = getenv("ODE_TRACE_DETAIL");
+    if (file != nullptr && *file != '\0') {
+        filename = file;
+        detail = (detailEnv != nullptr && string(detailEnv) == "1");
+        on = true;
+    }
+}
+
+/**
+ * Destructor for traceState, writes the trace if tracing is still on.
+ *
+ * @return         N/A.
+ */
+inline traceState::~traceState() {
+    if (on) {
+        // traceStop takes the lock itself and uses the global state, which
+        // is this object
+        traceStop();
+    }
+}
+
+/**
+ * Records the time between its construction and destruction as a zone, if
+ * tracing was on when it was constructed.
+ */
+class traceZone {
+    public:
+        traceZone(const char *nameInput, bool isDetail=false) {
+            traceState &state = traceGlobal();
+            active = state.on && (!isDetail || state.detail);
+            if (active) {
+                name = nameInput;
+                generation = state.generation;
+                start = traceNow();
+            }
+        }
+        ~traceZone() {
+            if (active) {
+                int64_t end = traceNow();
+                traceBuffer &buffer = traceLocalBuffer();
+                lock_guard<mutex> guard(buffer.lock);
+                if (generation == traceGlobal().generation) {
+                    buffer.events.push_back({name, start, end-start});
+                }
+            }
+        }
+
+    private:
+        bool active;
+        const char *name;
+        int generation;
+        int64_t start;
+};
+
+#define TRACE_CAT2(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT2(a, b)
+// Records the rest of the enclosing scope as a zone called name (a string
+// literal)
+#define TRACE_ZONE(name) traceZone TRACE_CAT(traceZone_, __LINE__)(name)
+// Same, but only recorded if detailed tracing was asked for
+#define TRACE_DETAIL_ZONE(name) \
+traceZone TRACE_CAT(traceZone_, __LINE__)(name, true)
+
+#else
+
+#include <string>
+
+#define TRACE_ZONE(name)
+#define TRACE_DETAIL_ZONE(name)
+
+inline void traceStart(std::string, bool=false) {}
+inline void traceStop() {}
+
+#endif
+
+#endif
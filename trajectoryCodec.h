@@ -0,0 +1,934 @@
+#ifndef TRAJECTORYCODEC_H
+#define TRAJECTORYCODEC_H
+
+// POSIX calls used to memory-map trajectory files
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <trace.h>
+
+using namespace std;
+
+/**
+ * Appends values of up to 64 bits to a stream of 64-bit words, most
+ * significant bit first.
+ */
+class bitWriter {
+    public:
+        // Appends the low nBits bits of value
+        void write(uint64_t, int);
+        // Pads the last word with zeros
+        void finish();
+        // Empties the stream
+        void clear();
+        vector<uint64_t> words;
+
+    private:
+        uint64_t acc = 0;
+        int nAcc = 0;
+};
+
+/**
+ * Reads values written by bitWriter, throwing rather than reading past the
+ * end of the stream.
+ */
+class bitReader {
+    public:
+        // Constructor
+        bitReader(const uint64_t*, size_t);
+        // Reads nBits bits (1 to 64)
+        uint64_t read(int);
+
+    private:
+        const uint64_t *words;
+        size_t totalBits = 0;
+        size_t pos = 0;
+};
+
+/**
+ * Gorilla XOR encoding of a column of doubles. Each value is XORed with the
+ * previous one; for a smooth trajectory the sign, exponent and leading
+ * mantissa bits usually agree, so only the meaningful bits of the XOR are
+ * written, reusing the previous window of meaningful bits when they fit.
+ */
+class xorEncoder {
+    public:
+        // Encodes x to out
+        void encode(double, bitWriter&);
+        // Forgets the previous value, for the start of a block
+        void reset();
+
+    private:
+        uint64_t prev = 0;
+        int prevLead = -1;
+        int prevTrail = 0;
+        bool first = true;
+};
+
+/**
+ * Decodes a column written by xorEncoder.
+ */
+class xorDecoder {
+    public:
+        // Decodes the next value from in
+        double decode(bitReader&);
+
+    private:
+        uint64_t prev = 0;
+        int prevLead = 0;
+        int prevTrail = 0;
+        bool first = true;
+};
+
+/**
+ * Delta-of-delta encoding of a column of increasing times. The differences
+ * are taken between the bit patterns of the doubles as 64-bit integers, so
+ * the encoding is lossless; on a uniform grid the second difference is
+ * almost always 0 or +-1 and takes one or nine bits.
+ */
+class deltaEncoder {
+    public:
+        // Encodes t to out
+        void encode(double, bitWriter&);
+        // Forgets the previous values, for the start of a block
+        void reset();
+
+    private:
+        uint64_t prev = 0;
+        uint64_t prevDelta = 0;
+        bool first = true;
+};
+
+/**
+ * Decodes a column written by deltaEncoder.
+ */
+class deltaDecoder {
+    public:
+        // Decodes the next value from in
+        double decode(bitReader&);
+
+    private:
+        uint64_t prev = 0;
+        uint64_t prevDelta = 0;
+        bool first = true;
+};
+
+/**
+ * Streams a trajectory to a compressed file. t is delta-of-delta encoded and
+ * each component of X is XOR encoded, each column in its own bit stream.
+ * Rows are grouped into blocks of blockRows rows whose encoders start
+ * afresh, so any block (and any column of it) can be decoded on its own; an
+ * index of the blocks is written at the end of the file by close.
+ */
+class trajectoryWriter {
+    public:
+        // Constructor, writes the header
+        trajectoryWriter(string, vector<string>, int blockRowsInput=4096);
+        // Destructor, closes the file
+        ~trajectoryWriter();
+        // Appends the point (t, X)
+        void operator()(double, const vector<double>&);
+        // Writes the last block and the index
+        void close();
+        // Number of rows and bytes written so far
+        long rows = 0;
+        uint64_t bytes = 0;
+
+        trajectoryWriter(const trajectoryWriter&) = delete;
+        trajectoryWriter& operator=(const trajectoryWriter&) = delete;
+
+    private:
+        ofstream file;
+        int nCols;
+        int blockRows;
+        int blockSize = 0;
+        double blockT0 = 0;
+        deltaEncoder tEncoder;
+        vector<xorEncoder> encoders;
+        vector<bitWriter> streams;
+        // Offset, number of rows and first t of each block
+        vector<int64_t> offsets;
+        vector<int64_t> blockSizes;
+        vector<double> blockT0s;
+        // Writes the current block
+        void flush();
+        void writeRaw(const void*, size_t);
+};
+
+/**
+ * Reads a file written by trajectoryWriter, which is memory-mapped.
+ */
+class trajectoryReader {
+    public:
+        // Constructor, maps the file and reads the index
+        trajectoryReader(string);
+        // Destructor, unmaps the file
+        ~trajectoryReader();
+        // Number of blocks and rows
+        size_t nBlocks();
+        long nRows();
+        // Number of rows and first t of block b
+        long blockRows(size_t);
+        double blockStart(size_t);
+        // Decodes column c (0 for t) of block b, appending it to col
+        void readColumn(size_t, int, vector<double>&);
+        // Decodes block b, appending its rows to t and X
+        void readBlock(size_t, vector<double>&, vector<vector<double>>&);
+        // Decodes every block
+        void readAll(vector<double>&, vector<vector<double>>&);
+        // Index of the block a time value falls in, by binary search
+        size_t findBlock(double);
+        // Decodes the rows with t in [t1, t2], keeping every stride-th one
+        long readWindow(double, double, vector<double>&,
+        vector<vector<double>>&, long stride=1);
+        // Headings of t and each component
+        vector<string> headings;
+
+        trajectoryReader(const trajectoryReader&) = delete;
+        trajectoryReader& operator=(const trajectoryReader&) = delete;
+
+    private:
+        const char *bytes = nullptr;
+        size_t size = 0;
+        int nCols = 0;
+        vector<int64_t> offsets;
+        vector<int64_t> blockSizes;
+        vector<double> blockT0s;
+};
+
+/**
+ * Appends the low nBits bits of value to the stream.
+ *
+ * @param value    Bits to be written (any higher bits must be zero).
+ * @param nBits    Number of bits (1 to 64).
+ * @return         Nothing.
+ */
+void bitWriter::write(uint64_t value, int nBits) {
+    if (nAcc + nBits < 64) {
+        acc = (acc << nBits) | value;
+        nAcc += nBits;
+        return;
+    }
+    // Fill the current word and start the next with what is left
+    int rest = nAcc + nBits - 64;
+    words.push_back((nAcc == 0) ? value : (acc << (64 - nAcc)) |
+    (value >> rest));
+    acc = (rest == 0) ? 0 : value & ((uint64_t(1) << rest) - 1);
+    nAcc = rest;
+}
+
+/**
+ * Writes out the last partial word, padded with zeros.
+ *
+ * @return         Nothing.
+ */
+void bitWriter::finish() {
+    if (nAcc > 0) {
+        words.push_back(acc << (64 - nAcc));
+        acc = 0;
+        nAcc = 0;
+    }
+}
+
+/**
+ * Empties the stream.
+ *
+ * @return         Nothing.
+ */
+void bitWriter::clear() {
+    words.clear();
+    acc = 0;
+    nAcc = 0;
+}
+
+/**
+ * Constructor for bitReader.
+ *
+ * @param wordsInput Words written by bitWriter.
+ * @param nWords     Number of words in the stream.
+ * @return           N/A.
+ */
+bitReader::bitReader(const uint64_t *wordsInput, size_t nWords) {
+    words = wordsInput;
+    totalBits = 64*nWords;
+}
+
+/**
+ * Reads the next nBits bits.
+ *
+ * @param nBits    Number of bits (1 to 64).
+ * @return         Bits read, in the low nBits bits.
+ */
+uint64_t bitReader::read(int nBits) {
+    if (pos + nBits > totalBits) {
+        throw runtime_error("trajectoryReader: stream ends early");
+    }
+    size_t w = pos >> 6;
+    int off = pos & 63;
+    uint64_t bits = words[w] << off;
+    if (off + nBits > 64) {
+        bits |= words[w+1] >> (64 - off);
+    }
+    pos += nBits;
+
+    return bits >> (64 - nBits);
+}
+
+/**
+ * Encodes x: the first value of a block is written in full, then a 0 bit
+ * for a repeat, 10 and the meaningful bits of the XOR if they fit in the
+ * previous window, or 11, the number of leading zeros (6 bits), the number
+ * of meaningful bits less one (6 bits) and the meaningful bits.
+ *
+ * @param x        Value.
+ * @param out      Stream of the column.
+ * @return         Nothing.
+ */
+void xorEncoder::encode(double x, bitWriter &out) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    if (first) {
+        out.write(bits, 64);
+        prev = bits;
+        first = false;
+        return;
+    }
+    uint64_t diff = bits ^ prev;
+    prev = bits;
+    if (diff == 0) {
+        out.write(0, 1);
+        return;
+    }
+    int lead = __builtin_clzll(diff);
+    int trail = __builtin_ctzll(diff);
+    if (prevLead >= 0 && lead >= prevLead && trail >= prevTrail) {
+        out.write(2, 2);
+        out.write(diff >> prevTrail, 64 - prevLead - prevTrail);
+    } else {
+        int sig = 64 - lead - trail;
+        out.write(3, 2);
+        out.write(lead, 6);
+        out.write(sig - 1, 6);
+        out.write(diff >> trail, sig);
+        prevLead = lead;
+        prevTrail = trail;
+    }
+}
+
+/**
+ * Forgets the previous value, so the next is written in full.
+ *
+ * @return         Nothing.
+ */
+void xorEncoder::reset() {
+    prevLead = -1;
+    prevTrail = 0;
+    first = true;
+}
+
+/**
+ * Decodes the next value of a column.
+ *
+ * @param in       Stream of the column.
+ * @return         Value.
+ */
+double xorDecoder::decode(bitReader &in) {
+    if (first) {
+        prev = in.read(64);
+        first = false;
+    } else if (in.read(1) == 1) {
+        if (in.read(1) == 1) {
+            prevLead = in.read(6);
+            int sig = in.read(6) + 1;
+            prevTrail = 64 - prevLead - sig;
+        }
+        // Only a corrupt stream reuses a window before setting one, or sets
+        // one that does not fit in 64 bits
+        if (prevLead < 0 || prevTrail < 0) {
+            throw runtime_error("trajectoryReader: corrupt column stream");
+        }
+        prev ^= in.read(64 - prevLead - prevTrail) << prevTrail;
+    }
+    double x;
+    memcpy(&x, &prev, sizeof(x));
+
+    return x;
+}
+
+/**
+ * Encodes t: the first value of a block is written in full, then the
+ * zigzag encoded second difference of the bit patterns as 0 (for zero) or
+ * 10, 110, 1110, 11110 or 11111 followed by 7, 12, 20, 32 or 64 bits.
+ *
+ * @param t        Time value.
+ * @param out      Stream of the column.
+ * @return         Nothing.
+ */
+void deltaEncoder::encode(double t, bitWriter &out) {
+    uint64_t bits;
+    memcpy(&bits, &t, sizeof(bits));
+    if (first) {
+        out.write(bits, 64);
+        prev = bits;
+        prevDelta = 0;
+        first = false;
+        return;
+    }
+    // Differences wrap around modulo 2^64, so any two doubles will do
+    uint64_t delta = bits - prev;
+    int64_t dod = int64_t (delta - prevDelta);
+    uint64_t zigzag = (uint64_t (dod) << 1) ^ uint64_t (dod >> 63);
+    prev = bits;
+    prevDelta = delta;
+    if (zigzag == 0) {
+        out.write(0, 1);
+    } else if (zigzag < (uint64_t(1) << 7)) {
+        out.write(2, 2);
+        out.write(zigzag, 7);
+    } else if (zigzag < (uint64_t(1) << 12)) {
+        out.write(6, 3);
+        out.write(zigzag, 12);
+    } else if (zigzag < (uint64_t(1) << 20)) {
+        out.write(14, 4);
+        out.write(zigzag, 20);
+    } else if (zigzag < (uint64_t(1) << 32)) {
+        out.write(30, 5);
+        out.write(zigzag, 32);
+    } else {
+        out.write(31, 5);
+        out.write(zigzag, 64);
+    }
+}
+
+/**
+ * Forgets the previous values, so the next is written in full.
+ *
+ * @return         Nothing.
+ */
+void deltaEncoder::reset() {
+    first = true;
+}
+
+/**
+ * Decodes the next time value.
+ *
+ * @param in       Stream of the column.
+ * @return         Time value.
+ */
+double deltaDecoder::decode(bitReader &in) {
+    if (first) {
+        prev = in.read(64);
+        prevDelta = 0;
+        first = false;
+    } else {
+        // Count the 1 bits of the prefix (at most 4)
+        int prefix = 0;
+        while (prefix < 4 && in.read(1) == 1) {
+            prefix++;
+        }
+        static const int widths[5] = {0, 7, 12, 20, 32};
+        int nBits = (prefix == 4) ? ((in.read(1) == 1) ? 64 : 32) :
+        widths[prefix];
+        uint64_t zigzag = (nBits > 0) ? in.read(nBits) : 0;
+        uint64_t dod = (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+        prevDelta += dod;
+        prev += prevDelta;
+    }
+    double t;
+    memcpy(&t, &prev, sizeof(t));
+
+    return t;
+}
+
+/**
+ * Constructor for trajectoryWriter. The file starts with the magic number,
+ * the number of columns, the block size and the headings (each its length
+ * and characters), padded to a multiple of 8 bytes.
+ *
+ * @param filename Name of the file.
+ * @param headingsInput Headings of t and each component of X.
+ * @param blockRowsInput Number of rows per block.
+ * @return         N/A.
+ */
+trajectoryWriter::trajectoryWriter(string filename,
+vector<string> headingsInput, int blockRowsInput) {
+    if (headingsInput.size() < 2) {
+        throw runtime_error("trajectoryWriter: there should be a heading for "
+        "t and each variable");
+    }
+    file.open(filename, ios::binary);
+    if (!file) {
+        throw runtime_error("trajectoryWriter: could not open " + filename);
+    }
+    nCols = headingsInput.size();
+    blockRows = max(blockRowsInput, 1);
+    encoders.resize(nCols - 1);
+    streams.resize(nCols);
+
+    int64_t nCols64 = nCols, blockRows64 = blockRows;
+    writeRaw("ODETRJ01", 8);
+    writeRaw(&nCols64, sizeof(nCols64));
+    writeRaw(&blockRows64, sizeof(blockRows64));
+    for (int c = 0; c < nCols; c++) {
+        int64_t length = headingsInput[c].size();
+        writeRaw(&length, sizeof(length));
+        writeRaw(headingsInput[c].data(), length);
+    }
+    // Pad to a multiple of 8 bytes, so the streams can be read in place
+    writeRaw("\0\0\0\0\0\0\0", (8 - bytes % 8) % 8);
+}
+
+/**
+ * Destructor for trajectoryWriter, writes whatever has not been written.
+ *
+ * @return         N/A.
+ */
+trajectoryWriter::~trajectoryWriter() {
+    close();
+}
+
+/**
+ * Writes size bytes at data to the file, counting them.
+ *
+ * @param data     Bytes.
+ * @param size     Number of bytes.
+ * @return         Nothing.
+ */
+void trajectoryWriter::writeRaw(const void *data, size_t size) {
+    file.write((const char*) data, size);
+    bytes += size;
+}
+
+/**
+ * Appends the point (ti, Xi), writing out the block if it is full.
+ *
+ * @param ti       Time value.
+ * @param Xi       State at ti.
+ * @return         Nothing.
+ */
+void trajectoryWriter::operator()(double ti, const vector<double> &Xi) {
+    if (Xi.size() + 1 != nCols) {
+        throw runtime_error("trajectoryWriter: there should be a heading for "
+        "t and each variable");
+    }
+    if (blockSize == 0) {
+        blockT0 = ti;
+    }
+    tEncoder.encode(ti, streams[0]);
+    for (int j = 0; j < nCols - 1; j++) {
+        encoders[j].encode(Xi[j], streams[j+1]);
+    }
+    rows++;
+    if (++blockSize == blockRows) {
+        flush();
+    }
+}
+
+/**
+ * Writes the current block: its number of rows, the number of words of
+ * each column's stream and then the streams.
+ *
+ * @return         Nothing.
+ */
+void trajectoryWriter::flush() {
+    TRACE_ZONE("write trajectory block");
+    if (blockSize == 0) {
+        return;
+    }
+    offsets.push_back(bytes);
+    blockSizes.push_back(blockSize);
+    blockT0s.push_back(blockT0);
+    int64_t size64 = blockSize;
+    writeRaw(&size64, sizeof(size64));
+    for (int c = 0; c < nCols; c++) {
+        streams[c].finish();
+        int64_t nWords = streams[c].words.size();
+        writeRaw(&nWords, sizeof(nWords));
+    }
+    for (int c = 0; c < nCols; c++) {
+        writeRaw(streams[c].words.data(),
+        streams[c].words.size()*sizeof(uint64_t));
+        streams[c].clear();
+    }
+
+    // The next block is decodable on its own
+    tEncoder.reset();
+    for (int j = 0; j < nCols - 1; j++) {
+        encoders[j].reset();
+    }
+    blockSize = 0;
+}
+
+/**
+ * Writes the last block and the index (offset, number of rows and first t
+ * of each block, then the number of blocks, the offset of the index and an
+ * end marker), then closes the file. Further calls do nothing.
+ *
+ * @return         Nothing.
+ */
+void trajectoryWriter::close() {
+    if (!file.is_open()) {
+        return;
+    }
+    flush();
+    int64_t indexOffset = bytes;
+    for (size_t b = 0; b < offsets.size(); b++) {
+        writeRaw(&offsets[b], sizeof(int64_t));
+        writeRaw(&blockSizes[b], sizeof(int64_t));
+        writeRaw(&blockT0s[b], sizeof(double));
+    }
+    int64_t nBlocks = offsets.size();
+    writeRaw(&nBlocks, sizeof(nBlocks));
+    writeRaw(&indexOffset, sizeof(indexOffset));
+    writeRaw("ODETRJ1E", 8);
+    file.close();
+}
+
+/**
+ * Constructor for trajectoryReader.
+ *
+ * @param filename Name of a file written by trajectoryWriter.
+ * @return         N/A.
+ */
+trajectoryReader::trajectoryReader(string filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("trajectoryReader: could not open " + filename);
+    }
+    struct stat info;
+    fstat(fd, &info);
+    size = info.st_size;
+    void *mapped = (size > 0) ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE,
+    fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw runtime_error("trajectoryReader: could not map " + filename);
+    }
+    bytes = (const char*) mapped;
+
+    // Header
+    int64_t nCols64, blockRows64, nBlocks, indexOffset;
+    size_t pos = 8;
+    bool valid = size >= 40 && memcmp(bytes, "ODETRJ01", 8) == 0 &&
+    memcmp(bytes + size - 8, "ODETRJ1E", 8) == 0;
+    if (valid) {
+        memcpy(&nCols64, bytes + pos, 8);
+        memcpy(&blockRows64, bytes + pos + 8, 8);
+        pos += 16;
+        valid = nCols64 >= 1 && nCols64 <= int64_t (size/8);
+        for (int64_t c = 0; valid && c < nCols64; c++) {
+            int64_t length;
+            valid = pos + 8 <= size;
+            if (valid) {
+                memcpy(&length, bytes + pos, 8);
+                pos += 8;
+                valid = length >= 0 && size_t (length) <= size - pos;
+            }
+            if (valid) {
+                headings.push_back(string(bytes + pos, length));
+                pos += length;
+            }
+        }
+        nCols = nCols64;
+    }
+
+    // Index
+    if (valid) {
+        memcpy(&nBlocks, bytes + size - 24, 8);
+        memcpy(&indexOffset, bytes + size - 16, 8);
+        valid = nBlocks >= 0 && nBlocks <= int64_t (size/24) &&
+        indexOffset >= 0 &&
+        size_t (indexOffset) + 24*size_t (nBlocks) + 24 == size;
+    }
+    if (!valid) {
+        munmap((void*) bytes, size);
+        throw runtime_error("trajectoryReader: " + filename +
+        " is not a trajectory file");
+    }
+    for (int64_t b = 0; b < nBlocks; b++) {
+        const char *entry = bytes + indexOffset + 24*b;
+        int64_t offset, rows;
+        double t0;
+        memcpy(&offset, entry, 8);
+        memcpy(&rows, entry + 8, 8);
+        memcpy(&t0, entry + 16, 8);
+
+        // The block, its stream lengths and its streams must all lie
+        // between the header and the index, so decoding stays in the file
+        int64_t room = indexOffset - offset;
+        valid = offset >= int64_t (pos) && room >= 8*(1 + nCols64);
+        if (valid) {
+            int64_t stored;
+            memcpy(&stored, bytes + offset, 8);
+            valid = rows >= 0 && stored == rows;
+            room -= 8*(1 + nCols64);
+        }
+        for (int c = 0; valid && c < nCols; c++) {
+            int64_t nWords;
+            memcpy(&nWords, bytes + offset + 8*(1 + c), 8);
+            // Every value takes at least one bit
+            valid = nWords >= 0 && nWords <= room/8 && rows <= 64*nWords;
+            if (valid) {
+                room -= 8*nWords;
+            }
+        }
+        if (!valid) {
+            munmap((void*) bytes, size);
+            throw runtime_error("trajectoryReader: block " + to_string(b) +
+            " of " + filename + " is corrupt");
+        }
+        offsets.push_back(offset);
+        blockSizes.push_back(rows);
+        blockT0s.push_back(t0);
+    }
+}
+
+/**
+ * Destructor for trajectoryReader, unmaps the file.
+ *
+ * @return         N/A.
+ */
+trajectoryReader::~trajectoryReader() {
+    munmap((void*) bytes, size);
+}
+
+/**
+ * Returns the number of blocks.
+ *
+ * @return         Number of blocks.
+ */
+size_t trajectoryReader::nBlocks() {
+    return offsets.size();
+}
+
+/**
+ * Returns the number of rows.
+ *
+ * @return         Number of rows.
+ */
+long trajectoryReader::nRows() {
+    long n = 0;
+    for (size_t b = 0; b < blockSizes.size(); b++) {
+        n += blockSizes[b];
+    }
+
+    return n;
+}
+
+/**
+ * Returns the number of rows of block b.
+ *
+ * @param b        Block index.
+ * @return         Number of rows.
+ */
+long trajectoryReader::blockRows(size_t b) {
+    return blockSizes.at(b);
+}
+
+/**
+ * Returns the first t value of block b.
+ *
+ * @param b        Block index.
+ * @return         First t value.
+ */
+double trajectoryReader::blockStart(size_t b) {
+    return blockT0s.at(b);
+}
+
+/**
+ * Decodes column c of block b without touching the other columns. The
+ * constructor has checked that the streams lie inside the file; a stream
+ * too short for the block's rows throws a runtime_error.
+ *
+ * @param b        Block index.
+ * @param c        Column index (0 for t, j+1 for component j of X).
+ * @param col      The values are appended to col.
+ * @return         Nothing.
+ */
+void trajectoryReader::readColumn(size_t b, int c, vector<double> &col) {
+    if (b >= offsets.size() || c < 0 || c >= nCols) {
+        throw runtime_error("trajectoryReader: no such block or column");
+    }
+    // Skip the row count, the stream lengths and the preceding streams
+    const char *block = bytes + offsets[b];
+    const char *stream = block + 8*(1 + nCols);
+    int64_t nWords;
+    for (int k = 0; k < c; k++) {
+        memcpy(&nWords, block + 8*(1 + k), 8);
+        stream += 8*nWords;
+    }
+    memcpy(&nWords, block + 8*(1 + c), 8);
+    bitReader in((const uint64_t*) stream, nWords);
+    long rows = blockSizes[b];
+    size_t start = col.size();
+    col.resize(start + rows);
+    if (c == 0) {
+        deltaDecoder decoder;
+        for (long i = 0; i < rows; i++) {
+            col[start + i] = decoder.decode(in);
+        }
+    } else {
+        xorDecoder decoder;
+        for (long i = 0; i < rows; i++) {
+            col[start + i] = decoder.decode(in);
+        }
+    }
+}
+
+/**
+ * Decodes block b.
+ *
+ * @param b        Block index.
+ * @param t        The t values of the block are appended to t.
+ * @param X        The X values of the block are appended to X.
+ * @return         Nothing.
+ */
+void trajectoryReader::readBlock(size_t b, vector<double> &t,
+vector<vector<double>> &X) {
+    TRACE_ZONE("read trajectory block");
+    size_t start = X.size();
+    readColumn(b, 0, t);
+    X.resize(start + blockSizes[b], vector<double>(nCols - 1));
+    vector<double> col;
+    for (int c = 1; c < nCols; c++) {
+        col.clear();
+        readColumn(b, c, col);
+        for (size_t i = 0; i < col.size(); i++) {
+            X[start + i][c-1] = col[i];
+        }
+    }
+}
+
+/**
+ * Decodes the whole trajectory.
+ *
+ * @param t        Set to the t values.
+ * @param X        Set to the X values.
+ * @return         Nothing.
+ */
+void trajectoryReader::readAll(vector<double> &t, vector<vector<double>> &X) {
+    t.clear();
+    X.clear();
+    t.reserve(nRows());
+    X.reserve(nRows());
+    for (size_t b = 0; b < offsets.size(); b++) {
+        readBlock(b, t, X);
+    }
+}
+
+/**
+ * Returns the index of the block time value ti falls in: the last block
+ * whose first t is not past ti, found by binary search of the index. Files
+ * of solutions integrated backwards in time (t decreasing) are handled as
+ * well.
+ *
+ * @param ti       Time value.
+ * @return         Block index (0 if ti comes before the first block).
+ */
+size_t trajectoryReader::findBlock(double ti) {
+    vector<double>::iterator after;
+    if (blockT0s.empty() || blockT0s.front() <= blockT0s.back()) {
+        after = upper_bound(blockT0s.begin(), blockT0s.end(), ti);
+    } else {
+        after = upper_bound(blockT0s.begin(), blockT0s.end(), ti,
+        greater<double>());
+    }
+
+    return (after == blockT0s.begin()) ? 0 : after - blockT0s.begin() - 1;
+}
+
+/**
+ * Decodes the rows whose t value lies in [t1, t2] (in either order). The
+ * first block is found with findBlock, and only blocks that overlap the
+ * window are decoded; the X columns of a block are only decoded if some of
+ * its rows are kept. With stride > 1, only the first row of the window and
+ * every stride-th one after it are kept, so long windows can be plotted
+ * decimated.
+ *
+ * @param t1       One end of the window.
+ * @param t2       Other end of the window.
+ * @param t        The t values of the rows kept are appended to t.
+ * @param X        The X values of the rows kept are appended to X.
+ * @param stride   Keep every stride-th row of the window.
+ * @return         Number of rows appended.
+ */
+long trajectoryReader::readWindow(double t1, double t2, vector<double> &t,
+vector<vector<double>> &X, long stride) {
+    TRACE_ZONE("read trajectory window");
+    if (t1 > t2) {
+        swap(t1, t2);
+    }
+    stride = max(stride, 1L);
+    bool ascending = blockT0s.empty() || blockT0s.front() <= blockT0s.back();
+    long inWindow = 0;
+    long appended = 0;
+    vector<double> tBlock, col;
+    vector<long> keep;
+    for (size_t b = findBlock(ascending ? t1 : t2); b < offsets.size(); b++) {
+        // Blocks from here on start past the window
+        if (ascending ? blockT0s[b] > t2 : blockT0s[b] < t1) {
+            break;
+        }
+        tBlock.clear();
+        readColumn(b, 0, tBlock);
+        keep.clear();
+        for (size_t i = 0; i < tBlock.size(); i++) {
+            if (tBlock[i] >= t1 && tBlock[i] <= t2 &&
+            inWindow++ % stride == 0) {
+                keep.push_back(i);
+            }
+        }
+        if (keep.empty()) {
+            continue;
+        }
+        size_t start = X.size();
+        X.resize(start + keep.size(), vector<double>(nCols - 1));
+        for (size_t k = 0; k < keep.size(); k++) {
+            t.push_back(tBlock[keep[k]]);
+        }
+        for (int c = 1; c < nCols; c++) {
+            col.clear();
+            readColumn(b, c, col);
+            for (size_t k = 0; k < keep.size(); k++) {
+                X[start + k][c-1] = col[keep[k]];
+            }
+        }
+        appended += keep.size();
+    }
+
+    return appended;
+}
+
+/**
+ * Writes a solution to a compressed trajectory file.
+ *
+ * @param filename Name of the file.
+ * @param t        t values of the solution (a vector or a uniformGrid).
+ * @param X        X values of the solution.
+ * @param headings Headings of t and each component of X.
+ * @param blockRows Number of rows per block.
+ * @return         Number of bytes written.
+ */
+template <typename Grid>
+uint64_t writeTrajectory(string filename, const Grid &t,
+const vector<vector<double>> &X, vector<string> headings,
+int blockRows=4096) {
+    trajectoryWriter writer(filename, headings, blockRows);
+    for (size_t i = 0; i < t.size(); i++) {
+        writer(t[i], X[i]);
+    }
+    writer.close();
+
+    return writer.bytes;
+}
+
+#endif
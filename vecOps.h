@@ -1,3 +1,6 @@
+#ifndef VECOPS_H
+#define VECOPS_H
+
 // Required for using vectors
 #include <vector>
 // Required for assert() calls later
@@ -9,9 +12,22 @@
 #include <cmath>
 // Required std::generate call later
 #include <bits/stdc++.h>
+#include <trace.h>
 
 using namespace std;
 
+/**
+ * Makes T non-deducible when used as sameType<T>, so that arguments of
+ * another arithmetic type (e.g. an int t0) convert to the T deduced from
+ * the other arguments.
+ */
+template <typename T>
+struct scalarIdentity {
+    typedef T type;
+};
+template <typename T>
+using sameType = typename scalarIdentity<T>::type;
+
 /**
  * Generates a vector of N+1 linearly spaced points between and including
  * t0 and tf. 
@@ -19,26 +35,88 @@ using namespace std;
  * @param t0       Initial t value.
  * @param tf       Final t value.
  * @param N        N+1 t values are stored in the return vector.
- * @return         t vector.
+ * @return         t vector (of doubles unless T is given explicitly, as in 
+ * linspace<float>(t0, tf, N)).
  */
-vector<double> linspace(double t0, double tf, int N) {
-    double dt = (tf-t0)/N;
-    vector<double> t(N+1);
+template <typename T=double>
+vector<T> linspace(sameType<T> t0, sameType<T> tf, int N) {
+    T dt = (tf-t0)/N;
+    vector<T> t(N+1);
     std::generate(t.begin(), t.end(), [&t0, n = 0, &dt]() mutable { 
         return t0 + n++ * dt; });
 
     return t;
 }
 
+/**
+ * The grid of linspace(t0, tf, N) held as t0, dt and N instead of N+1 
+ * values, for fixed step runs too long to store their time values. Point i 
+ * is computed as t0 + i*dt when asked for, which is exactly the value 
+ * linspace stores, so there is no accumulated rounding error.
+ */
+template <typename T=double>
+class uniformGrid {
+    public:
+        // Constructor, same arguments as linspace
+        uniformGrid(sameType<T> t0Input=0, sameType<T> tfInput=0, 
+        long NInput=0);
+        // Number of points (N+1)
+        size_t size() const;
+        // Point i
+        T operator[](size_t) const;
+
+        T t0;
+        T dt;
+        long N;
+};
+
+/**
+ * Constructor for uniformGrid.
+ * 
+ * @param t0Input  Initial t value.
+ * @param tfInput  Final t value.
+ * @param NInput   Number of steps (the grid has NInput+1 points).
+ * @return         N/A.
+ */
+template <typename T>
+uniformGrid<T>::uniformGrid(sameType<T> t0Input, sameType<T> tfInput, 
+long NInput) {
+    t0 = t0Input;
+    N = NInput;
+    dt = (N > 0) ? T((tfInput-t0Input)/N) : T(0);
+}
+
+/**
+ * Returns the number of points.
+ * 
+ * @return         N+1.
+ */
+template <typename T>
+size_t uniformGrid<T>::size() const {
+    return N+1;
+}
+
+/**
+ * Returns point i of the grid.
+ * 
+ * @param i        Index (0 to N).
+ * @return         t0 + i*dt.
+ */
+template <typename T>
+T uniformGrid<T>::operator[](size_t i) const {
+    return t0 + T(i) * dt;
+}
+
 /**
  * Print each entry of vec with "name[index] is:" before it
  * 
- * @param vec      Vector whose elements are of type double.
+ * @param vec      Vector whose elements are of type T.
  * @param name     Name of vector whose elements are to be printed.
  * @return         Nothing.
  */
-void printVec(vector<double> vec, string name) {
-    for (int i = 0 ; i < vec.size(); i++) {
+template <typename T>
+void printVec(const vector<T> &vec, string name) {
+    for (size_t i = 0 ; i < vec.size(); i++) {
         cout << name << "[" << i << "] is: " << vec[i] << endl;
     }
 }
@@ -46,19 +124,22 @@ void printVec(vector<double> vec, string name) {
 /**
  * Multiples specified vector by the specified scalar.
  * 
- * @param scalar   Scalar of type double.
- * @param X        Vector of type double.
+ * @param scalar   Scalar (converted to T).
+ * @param X        Vector of type T.
  * @return         scalar * X.
  */
-vector<double> scalMult(double scalar, vector<double> X) {
+template <typename T, typename S>
+vector<T> scalMult(S scalar, const vector<T> &X) {
+    TRACE_DETAIL_ZONE("scalMult");
     // Initialize variables
-    int N = X.size();
-    vector<double> returnArr(N);
+    size_t N = X.size();
+    vector<T> returnArr(N);
 
     // Loop over elements of X multiply them by a scalar and assign it to 
     // returnArr
-    for (int i = 0; i < N; i++) {
-        returnArr[i] = scalar*X[i];
+    T a = T(scalar);
+    for (size_t i = 0; i < N; i++) {
+        returnArr[i] = a*X[i];
     }
 
     return returnArr;
@@ -70,13 +151,15 @@ vector<double> scalMult(double scalar, vector<double> X) {
  * @param x        Input vector.
  * @return         Absolute value of x.
  */
-vector<double> vecAbs(vector<double> x) {
+template <typename T>
+vector<T> vecAbs(const vector<T> &x) {
+    TRACE_DETAIL_ZONE("vecAbs");
     // Initialize variables
-    int N = x.size();
-    vector<double> absx(N);
+    size_t N = x.size();
+    vector<T> absx(N);
 
     // Loop over elements of x[i] and take absolute value
-    for (int i = 0; i < N; i++) {
+    for (size_t i = 0; i < N; i++) {
         absx[i] = abs(x[i]);
     }
 
@@ -86,20 +169,22 @@ vector<double> vecAbs(vector<double> x) {
 /**
  * Adds the two specified 1d vectors.
  * 
- * @param X        An array of type double.
- * @param Y        An array of type double.
+ * @param X        An array of type T.
+ * @param Y        An array of type T.
  * @return         Result of X + Y.
  */
-vector<double> vecAdd(vector<double> X, vector<double> Y) {
+template <typename T>
+vector<T> vecAdd(const vector<T> &X, const vector<T> &Y) {
+    TRACE_DETAIL_ZONE("vecAdd");
     // Initialize variable
-    int N = X.size();
-    vector<double> returnArr(N);
+    size_t N = X.size();
+    vector<T> returnArr(N);
 
     // Check if X and Y match in size; if they don't throw an error
     assert(X.size() == Y.size());
 
     // For loop was originally used but returned a bizarre error
-    for (int i = 0 ; i < N; i++) {
+    for (size_t i = 0 ; i < N; i++) {
         returnArr[i] = X[i]+Y[i];
     }
 
@@ -109,21 +194,216 @@ vector<double> vecAdd(vector<double> X, vector<double> Y) {
 /**
  * Multiplies the two specified vectors.
  * 
- * @param X        An array of type double.
- * @param Y        An array of type double.
+ * @param X        An array of type T.
+ * @param Y        An array of type T.
  * @return         X * Y element-wise.
  */
-vector<double> vecMult(vector<double> X, vector<double> Y) {
+template <typename T>
+vector<T> vecMult(const vector<T> &X, const vector<T> &Y) {
+    TRACE_DETAIL_ZONE("vecMult");
     // Initialize variables
-    int N = X.size();
-    vector<double> returnArr(N);
+    size_t N = X.size();
+    vector<T> returnArr(N);
 
     // Check if X and Y match in size; if they don't throw an error
     assert(X.size() == Y.size());
 
-    for (int i = 0; i < N; i++) {
+    for (size_t i = 0; i < N; i++) {
         returnArr[i] = X[i]*Y[i];
     }
 
     return returnArr;
-}
\ No newline at end of file
+}
+
+/**
+ * LU decomposition with partial pivoting of a small dense matrix, in place: 
+ * afterwards A holds L (unit diagonal, below it) and U (on and above it) of 
+ * the row-permuted matrix.
+ * 
+ * @param A        Square matrix; overwritten by its LU factors.
+ * @param perm     Set to the row of A used as pivot row i.
+ * @return         Nothing.
+ */
+template <typename T>
+void luDecompose(vector<vector<T>> &A, vector<int> &perm) {
+    size_t n = A.size();
+    perm.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        perm[i] = i;
+    }
+    for (size_t k = 0; k < n; k++) {
+        // Largest pivot in column k
+        size_t p = k;
+        for (size_t i = k+1; i < n; i++) {
+            if (abs(A[i][k]) > abs(A[p][k])) {
+                p = i;
+            }
+        }
+        if (A[p][k] == T(0)) {
+            throw runtime_error("luDecompose: matrix is singular");
+        }
+        swap(A[k], A[p]);
+        swap(perm[k], perm[p]);
+        for (size_t i = k+1; i < n; i++) {
+            A[i][k] = A[i][k]/A[k][k];
+            for (size_t j = k+1; j < n; j++) {
+                A[i][j] = A[i][j] - A[i][k]*A[k][j];
+            }
+        }
+    }
+}
+
+/**
+ * Solves A x = b given the LU factors of A from luDecompose.
+ * 
+ * @param LU       Factors of A.
+ * @param perm     Row permutation from luDecompose.
+ * @param b        Right-hand side.
+ * @return         x.
+ */
+template <typename T>
+vector<T> luSolve(const vector<vector<T>> &LU, const vector<int> &perm, 
+const vector<T> &b) {
+    size_t n = LU.size();
+    vector<T> x(n);
+    // Forward substitution with L, then back substitution with U
+    for (size_t i = 0; i < n; i++) {
+        x[i] = b[perm[i]];
+        for (size_t j = 0; j < i; j++) {
+            x[i] = x[i] - LU[i][j]*x[j];
+        }
+    }
+    for (size_t i = n; i-- > 0;) {
+        for (size_t j = i+1; j < n; j++) {
+            x[i] = x[i] - LU[i][j]*x[j];
+        }
+        x[i] = x[i]/LU[i][i];
+    }
+
+    return x;
+}
+
+/**
+ * Eigenvalues of a small dense real matrix: reduction to upper Hessenberg 
+ * form by Householder reflections, then shifted QR iterations (Givens 
+ * rotations in complex arithmetic, Wilkinson shifts) with deflation of the 
+ * trailing eigenvalue each time its subdiagonal entry becomes negligible.
+ * 
+ * @param A        Square matrix.
+ * @return         Eigenvalues, largest modulus first.
+ */
+template <typename T>
+vector<complex<T>> eigenvalues(vector<vector<T>> A) {
+    size_t n = A.size();
+    // Householder reduction to upper Hessenberg form
+    for (size_t k = 0; k + 2 < n; k++) {
+        T alpha = 0;
+        for (size_t i = k+1; i < n; i++) {
+            alpha += A[i][k]*A[i][k];
+        }
+        alpha = (A[k+1][k] > 0) ? -sqrt(alpha) : sqrt(alpha);
+        vector<T> v(n - k - 1);
+        T vNorm2 = 0;
+        for (size_t i = 0; i < v.size(); i++) {
+            v[i] = A[k+1+i][k] - ((i == 0) ? alpha : T(0));
+            vNorm2 += v[i]*v[i];
+        }
+        if (vNorm2 == T(0)) {
+            continue;
+        }
+        for (size_t j = 0; j < n; j++) {
+            T dot = 0;
+            for (size_t i = 0; i < v.size(); i++) {
+                dot += v[i]*A[k+1+i][j];
+            }
+            for (size_t i = 0; i < v.size(); i++) {
+                A[k+1+i][j] -= 2*dot/vNorm2*v[i];
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            T dot = 0;
+            for (size_t j = 0; j < v.size(); j++) {
+                dot += A[i][k+1+j]*v[j];
+            }
+            for (size_t j = 0; j < v.size(); j++) {
+                A[i][k+1+j] -= 2*dot/vNorm2*v[j];
+            }
+        }
+    }
+    vector<vector<complex<T>>> H(n, vector<complex<T>>(n));
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = (i > 0) ? i-1 : 0; j < n; j++) {
+            H[i][j] = A[i][j];
+        }
+    }
+
+    // QR iterations on the active block H[lo..hi][lo..hi]
+    const T eps = numeric_limits<T>::epsilon();
+    int its = 0;
+    for (size_t hi = (n > 0) ? n-1 : 0; hi > 0;) {
+        if (abs(H[hi][hi-1]) <= eps*(abs(H[hi][hi]) + abs(H[hi-1][hi-1]))) {
+            H[hi][hi-1] = 0;
+            hi--;
+            its = 0;
+            continue;
+        }
+        if (++its > 1000) {
+            throw runtime_error("eigenvalues: QR iterations did not "
+            "converge");
+        }
+        size_t lo = hi - 1;
+        while (lo > 0 && abs(H[lo][lo-1]) > eps*(abs(H[lo][lo]) + 
+        abs(H[lo-1][lo-1]))) {
+            lo--;
+        }
+        // Eigenvalue of the trailing 2 x 2 block closest to its last entry,
+        // with an exceptional shift now and then to break cycles
+        complex<T> a = H[hi-1][hi-1], b = H[hi-1][hi], c = H[hi][hi-1];
+        complex<T> d = H[hi][hi];
+        complex<T> half = (a + d)/T(2);
+        complex<T> disc = sqrt(half*half - (a*d - b*c));
+        complex<T> mu = (abs(half + disc - d) < abs(half - disc - d)) ?
+        half + disc : half - disc;
+        if (its % 11 == 0) {
+            mu = d + abs(c);
+        }
+        for (size_t k = lo; k <= hi; k++) {
+            H[k][k] -= mu;
+        }
+        // H - mu I = QR by Givens rotations, then H = RQ + mu I
+        vector<complex<T>> cs(hi - lo), sn(hi - lo);
+        for (size_t k = lo; k < hi; k++) {
+            complex<T> x = H[k][k], y = H[k+1][k];
+            T r = sqrt(norm(x) + norm(y));
+            cs[k-lo] = (r == T(0)) ? complex<T>(1) : x/r;
+            sn[k-lo] = (r == T(0)) ? complex<T>(0) : y/r;
+            for (size_t j = k; j <= hi; j++) {
+                complex<T> u = H[k][j], w = H[k+1][j];
+                H[k][j] = conj(cs[k-lo])*u + conj(sn[k-lo])*w;
+                H[k+1][j] = -sn[k-lo]*u + cs[k-lo]*w;
+            }
+        }
+        for (size_t k = lo; k < hi; k++) {
+            for (size_t i = lo; i <= min(k+2, hi); i++) {
+                complex<T> u = H[i][k], w = H[i][k+1];
+                H[i][k] = u*cs[k-lo] + w*sn[k-lo];
+                H[i][k+1] = -u*conj(sn[k-lo]) + w*conj(cs[k-lo]);
+            }
+        }
+        for (size_t k = lo; k <= hi; k++) {
+            H[k][k] += mu;
+        }
+    }
+
+    vector<complex<T>> lambda(n);
+    for (size_t i = 0; i < n; i++) {
+        lambda[i] = H[i][i];
+    }
+    sort(lambda.begin(), lambda.end(), [](complex<T> x, complex<T> y) {
+        return abs(x) > abs(y);
+    });
+
+    return lambda;
+}
+
+#endif
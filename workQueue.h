@@ -0,0 +1,401 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+// POSIX calls used to manage the queue directory
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Work queue kept in a directory on a (possibly shared) filesystem, so that
+ * worker processes on several hosts can share tasks without any external
+ * service. The directory contains
+ *
+ *   pending/task_N        tasks nobody has claimed yet,
+ *   claimed/task_N        tasks being worked on,
+ *   claimed/task_N.lease  lease of the worker holding task_N (an owner id
+ *                         unique to the claim, host:pid:thread:count),
+ *                         whose modification time is its last heartbeat
+ *                         (clocks of the hosts are assumed to roughly agree),
+ *   results/task_N.csv    output of finished tasks.
+ *
+ * Tasks are claimed by renaming them from pending to claimed, which only one
+ * worker can succeed at. Tasks whose lease has not been renewed for
+ * leaseSeconds are assumed to belong to dead workers and are moved back to
+ * pending. A lease is only ever removed by first renaming it to a name
+ * private to the remover and checking its owner id, so a worker whose lease
+ * was reclaimed cannot release the claim of the task's new owner. Results
+ * are written to a temporary file and renamed, so a finished task is never
+ * half-written.
+ */
+class workQueue {
+    public:
+        // Constructor
+        workQueue(string, double leaseSecondsInput=60);
+        // Create the queue directories and nTasks pending tasks
+        void create(int);
+        // Claim a pending task
+        int claim();
+        // Renew the lease on a task
+        void renew(int);
+        // Store the result of a task and release it
+        void complete(int, string);
+        // Move tasks with expired leases back to pending
+        int reclaimExpired();
+        // Whether every task has a result
+        bool finished();
+        // Concatenate results in task order
+        void merge(string, string);
+        // Claim and run tasks until every task has a result
+        void runWorker(function<string(int)>);
+
+    private:
+        string dir;
+        double leaseSeconds;
+        // Owner ids of the leases this worker has taken out, by task
+        map<int, string> owners;
+        // Owner id written in a lease, or "" if there is none
+        string leaseOwner(string);
+        // Remove a lease if it is held by the given owner
+        bool takeLease(string, string, bool);
+        // Total number of tasks
+        int nTasks();
+        // File name of a task
+        string taskName(int);
+        // Names of files in a queue subdirectory
+        vector<string> listDir(string);
+};
+
+/**
+ * Constructor for workQueue.
+ *
+ * @param dirInput          Queue directory.
+ * @param leaseSecondsInput Seconds without a heartbeat after which a claimed
+ * task is given to another worker.
+ * @return                  N/A.
+ */
+workQueue::workQueue(string dirInput, double leaseSecondsInput) {
+    dir = dirInput;
+    leaseSeconds = leaseSecondsInput;
+}
+
+/**
+ * Returns the file name used for task i.
+ *
+ * @param i        Task index.
+ * @return         File name (without directory).
+ */
+string workQueue::taskName(int i) {
+    stringstream name;
+    name << "task_" << setw(6) << setfill('0') << i;
+
+    return name.str();
+}
+
+/**
+ * Lists the files in a subdirectory of the queue, skipping leases and
+ * temporary files.
+ *
+ * @param sub      Subdirectory name.
+ * @return         Sorted file names.
+ */
+vector<string> workQueue::listDir(string sub) {
+    vector<string> names;
+    DIR *d = opendir((dir + "/" + sub).c_str());
+    if (d == nullptr) {
+        return names;
+    }
+    for (dirent *entry = readdir(d); entry != nullptr; entry = readdir(d)) {
+        string name = entry->d_name;
+        if (name.compare(0, 5, "task_") == 0 &&
+        name.find(".lease") == string::npos &&
+        name.find(".tmp") == string::npos) {
+            names.push_back(name);
+        }
+    }
+    closedir(d);
+    sort(names.begin(), names.end());
+
+    return names;
+}
+
+/**
+ * Returns the owner id written in the lease of a claimed task.
+ *
+ * @param task     Path of the claimed task.
+ * @return         Owner id, or "" if the task has no lease.
+ */
+string workQueue::leaseOwner(string task) {
+    string owner;
+    ifstream lease(task + ".lease");
+    getline(lease, owner);
+
+    return owner;
+}
+
+/**
+ * Removes the lease of a claimed task if it is held by owner. The lease is
+ * first renamed to a name private to this thread, so no other worker can
+ * renew or remove it while it is checked; a lease held by someone else is
+ * linked back into place.
+ *
+ * @param task     Path of the claimed task.
+ * @param owner    Owner id the lease must hold.
+ * @param expired  Whether the lease must also have expired.
+ * @return         Whether the lease was removed.
+ */
+bool workQueue::takeLease(string task, string owner, bool expired) {
+    string lease = task + ".lease";
+    stringstream taken;
+    taken << lease << "." << getpid() << "." <<
+    hash<thread::id>()(this_thread::get_id()) << ".tmp";
+    if (rename(lease.c_str(), taken.str().c_str()) != 0) {
+        return false;
+    }
+
+    string held;
+    ifstream file(taken.str());
+    getline(file, held);
+    file.close();
+    struct stat info;
+    bool ours = held == owner && (!expired ||
+    (stat(taken.str().c_str(), &info) == 0 &&
+    difftime(time(nullptr), info.st_mtime) > leaseSeconds));
+    if (!ours) {
+        // link, unlike rename, cannot replace a lease written meanwhile
+        link(taken.str().c_str(), lease.c_str());
+    }
+    unlink(taken.str().c_str());
+
+    return ours;
+}
+
+/**
+ * Creates the queue directories and nTasks pending tasks.
+ *
+ * @param n        Number of tasks.
+ * @return         Nothing.
+ */
+void workQueue::create(int n) {
+    mkdir(dir.c_str(), 0755);
+    mkdir((dir + "/pending").c_str(), 0755);
+    mkdir((dir + "/claimed").c_str(), 0755);
+    mkdir((dir + "/results").c_str(), 0755);
+
+    ofstream file;
+    file.open(dir + "/nTasks");
+    file << n << endl;
+    file.close();
+    for (int i = 0; i < n; i++) {
+        file.open(dir + "/pending/" + taskName(i));
+        file << i << endl;
+        file.close();
+    }
+}
+
+/**
+ * Returns the total number of tasks in the queue.
+ *
+ * @return         Number of tasks.
+ */
+int workQueue::nTasks() {
+    int n = 0;
+    ifstream file(dir + "/nTasks");
+    file >> n;
+
+    return n;
+}
+
+/**
+ * Claims a pending task and takes out a lease on it.
+ *
+ * @return         Index of the claimed task, or -1 if none is pending.
+ */
+int workQueue::claim() {
+    // Claims made by this process, which make owner ids unique
+    static atomic<long> nClaims(0);
+    vector<string> pending = listDir("pending");
+    char host[256] = "";
+    gethostname(host, sizeof(host)-1);
+
+    for (int i = 0; i < pending.size(); i++) {
+        string claimed = dir + "/claimed/" + pending[i];
+        // Only one worker can rename the task, the others get an error
+        if (rename((dir + "/pending/" + pending[i]).c_str(),
+        claimed.c_str()) == 0) {
+            int task = stoi(pending[i].substr(5));
+            stringstream owner;
+            owner << host << ":" << getpid() << ":" <<
+            hash<thread::id>()(this_thread::get_id()) << ":" << nClaims++;
+            owners[task] = owner.str();
+            ofstream lease(claimed + ".lease");
+            lease << owner.str() << endl;
+            lease.close();
+            return task;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Renews the lease on a claimed task (the heartbeat), unless it has been
+ * reclaimed and now belongs to another worker.
+ *
+ * @param i        Task index.
+ * @return         Nothing.
+ */
+void workQueue::renew(int i) {
+    string task = dir + "/claimed/" + taskName(i);
+    if (owners.count(i) && leaseOwner(task) == owners[i]) {
+        utime((task + ".lease").c_str(), nullptr);
+    }
+}
+
+/**
+ * Stores the result of a task and releases its claim, if this worker still
+ * holds it. A task whose lease was reclaimed is left to its new owner (which
+ * writes the same result again).
+ *
+ * @param i        Task index.
+ * @param result   Output of the task.
+ * @return         Nothing.
+ */
+void workQueue::complete(int i, string result) {
+    string name = dir + "/results/" + taskName(i) + ".csv";
+    stringstream tmpName;
+    tmpName << name << "." << getpid() << ".tmp";
+
+    ofstream file(tmpName.str());
+    file << result;
+    file.close();
+    rename(tmpName.str().c_str(), name.c_str());
+
+    // The task file goes only once the lease is known to be ours
+    string task = dir + "/claimed/" + taskName(i);
+    if (owners.count(i) && takeLease(task, owners[i], false)) {
+        unlink(task.c_str());
+    }
+    owners.erase(i);
+}
+
+/**
+ * Moves claimed tasks whose lease has expired back to pending. The lease is
+ * removed before the task is moved, so a worker that claims the task again
+ * cannot have its new lease removed.
+ *
+ * @return         Number of tasks moved back.
+ */
+int workQueue::reclaimExpired() {
+    vector<string> claimed = listDir("claimed");
+    int nReclaimed = 0;
+    time_t now = time(nullptr);
+
+    for (int i = 0; i < claimed.size(); i++) {
+        string task = dir + "/claimed/" + claimed[i];
+        struct stat info;
+        string owner = leaseOwner(task);
+        if (owner != "") {
+            if (!takeLease(task, owner, true)) {
+                continue;
+            }
+        } else if (stat(task.c_str(), &info) != 0 ||
+        difftime(now, info.st_ctime) <= leaseSeconds) {
+            // Without a lease the worker died before writing it (or is
+            // about to); renaming the task set its status change time
+            continue;
+        }
+        if (rename(task.c_str(), (dir + "/pending/" + claimed[i]).c_str()) ==
+        0) {
+            nReclaimed++;
+        }
+    }
+
+    return nReclaimed;
+}
+
+/**
+ * Checks whether every task has a result.
+ *
+ * @return         Whether the queue is finished.
+ */
+bool workQueue::finished() {
+    return listDir("results").size() == nTasks();
+}
+
+/**
+ * Concatenates the results of all tasks in task order into one file.
+ *
+ * @param filename Output file name.
+ * @param header   First line of the output file (skipped if empty).
+ * @return         Nothing.
+ */
+void workQueue::merge(string filename, string header) {
+    ofstream out(filename);
+    if (header != "") {
+        out << header << endl;
+    }
+    int n = nTasks();
+    for (int i = 0; i < n; i++) {
+        ifstream in(dir + "/results/" + taskName(i) + ".csv");
+        out << in.rdbuf();
+    }
+    out.close();
+}
+
+/**
+ * Claims and runs tasks until every task has a result. While a task runs a
+ * background thread renews its lease; when nothing is pending the worker
+ * looks for expired leases instead, so tasks of dead workers get redone.
+ *
+ * @param work     Function that runs task i and returns its result.
+ * @return         Nothing.
+ */
+void workQueue::runWorker(function<string(int)> work) {
+    // Heartbeat often enough that a live worker never loses its lease
+    chrono::milliseconds beat(int (1000*leaseSeconds/4));
+
+    while (!finished()) {
+        int i = claim();
+        if (i < 0) {
+            if (reclaimExpired() == 0) {
+                this_thread::sleep_for(beat);
+            }
+            continue;
+        }
+
+        atomic<bool> running(true);
+        thread heartbeat([&]() {
+            auto last = chrono::steady_clock::now();
+            while (running) {
+                this_thread::sleep_for(chrono::milliseconds(50));
+                if (chrono::steady_clock::now() - last >= beat) {
+                    renew(i);
+                    last = chrono::steady_clock::now();
+                }
+            }
+        });
+        string result = work(i);
+        running = false;
+        heartbeat.join();
+        complete(i, result);
+    }
+}
+
+#endif